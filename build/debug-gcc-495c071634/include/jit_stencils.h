@@ -0,0 +1,320 @@
+/* Generated by jitgen from build/debug-gcc-495c071634/obj/jit/stencils.o. Do not edit. */
+
+static const unsigned char jit_code_exit[] = {
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x89,
+    0x07, 0xc3,
+};
+
+static const jit_hole_t jit_holes_exit[] = {
+    { 2, JIT_HOLE_IP, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_exit = {
+    jit_code_exit, 14, jit_holes_exit, 1
+};
+
+static const unsigned char jit_code_MOVE[] = {
+    0x48, 0x8b, 0x47, 0x20, 0x48, 0x83, 0x80, 0x18, 0x01, 0x00, 0x00, 0x01,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b,
+    0x0c, 0xc6, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x48, 0x89, 0x0c, 0xc6,
+};
+
+static const jit_hole_t jit_holes_MOVE[] = {
+    { 14, JIT_HOLE_ARG2, 0, 0 },
+    { 28, JIT_HOLE_ARG1, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_MOVE = {
+    jit_code_MOVE, 40, jit_holes_MOVE, 2
+};
+
+static const unsigned char jit_code_LOAD_INT[] = {
+    0x41, 0x56, 0x41, 0xb8, 0x30, 0x00, 0x00, 0x00, 0xb9, 0x01, 0x00, 0x00,
+    0x00, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x49,
+    0xbe, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x41, 0x55, 0x4c,
+    0x8d, 0x2c, 0xc6, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x41, 0x54, 0x49, 0x89, 0xd4, 0x55, 0x48, 0x89, 0xf5, 0x53, 0x48,
+    0x89, 0xfb, 0x48, 0x83, 0xec, 0x10, 0x48, 0x8b, 0x57, 0x10, 0x48, 0x8b,
+    0x77, 0x20, 0x48, 0x8d, 0x7c, 0x24, 0x08, 0x4c, 0x89, 0x72, 0x08, 0xff,
+    0xd0, 0x84, 0xc0, 0x74, 0x57, 0x48, 0x8b, 0x44, 0x24, 0x08, 0x4c, 0x89,
+    0xe2, 0x48, 0x89, 0xee, 0x48, 0x89, 0xdf, 0x48, 0xb9, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0xc7, 0x40, 0x04, 0x00, 0x00, 0x00, 0x00,
+    0xc6, 0x40, 0x08, 0x00, 0x48, 0x89, 0x48, 0x10, 0x49, 0x89, 0x45, 0x00,
+    0x48, 0x8b, 0x43, 0x20, 0x48, 0x83, 0x80, 0x20, 0x01, 0x00, 0x00, 0x01,
+    0x48, 0x83, 0xc4, 0x10, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x5b, 0x5d, 0x41, 0x5c, 0x41, 0x5d, 0x41, 0x5e, 0xff, 0xe0,
+    0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4c, 0x89, 0x33, 0x48,
+    0x83, 0xc4, 0x10, 0x5b, 0x5d, 0x41, 0x5c, 0x41, 0x5d, 0x41, 0x5e, 0xc3,
+};
+
+static const jit_hole_t jit_holes_LOAD_INT[] = {
+    { 15, JIT_HOLE_ARG1, 0, 0 },
+    { 25, JIT_HOLE_IP, 0, 0 },
+    { 41, JIT_HOLE_SYMBOL, 0, 0 },
+    { 105, JIT_HOLE_SIGNED_LONGARG, 0, 0 },
+    { 150, JIT_HOLE_CONTINUE, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_LOAD_INT = {
+    jit_code_LOAD_INT, 192, jit_holes_LOAD_INT, 5
+};
+
+static const unsigned char jit_code_LOAD_UPVAL[] = {
+    0x48, 0x8b, 0x47, 0x20, 0x48, 0x83, 0x80, 0x28, 0x01, 0x00, 0x00, 0x01,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b,
+    0x4c, 0xc2, 0x08, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x48, 0x89, 0x0c, 0xc6,
+};
+
+static const jit_hole_t jit_holes_LOAD_UPVAL[] = {
+    { 14, JIT_HOLE_ARG2, 0, 0 },
+    { 29, JIT_HOLE_ARG1, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_LOAD_UPVAL = {
+    jit_code_LOAD_UPVAL, 41, jit_holes_LOAD_UPVAL, 2
+};
+
+static const unsigned char jit_data_0[] = {
+    0x72, 0x65, 0x66, 0x65, 0x72, 0x65, 0x6e, 0x63, 0x65, 0x20, 0x74, 0x6f,
+    0x20, 0x75, 0x6e, 0x64, 0x65, 0x66, 0x69, 0x6e, 0x65, 0x64, 0x20, 0x63,
+    0x65, 0x6c, 0x6c, 0x00,
+};
+
+static const unsigned char jit_code_LOAD_CELL[] = {
+    0x48, 0x8b, 0x47, 0x20, 0x48, 0x83, 0x80, 0x30, 0x01, 0x00, 0x00, 0x01,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8d,
+    0x0c, 0xc6, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x48, 0x8b, 0x44, 0xc2, 0x08, 0x48, 0x8b, 0x40, 0x08, 0x48, 0x85, 0xc0,
+    0x74, 0x16, 0x48, 0x89, 0x01, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0xff, 0xe0, 0x0f, 0x1f, 0x80, 0x00, 0x00, 0x00, 0x00,
+    0x48, 0xbf, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x83,
+    0xec, 0x08, 0x48, 0xba, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xff, 0xd2,
+};
+
+static const jit_hole_t jit_holes_LOAD_CELL[] = {
+    { 14, JIT_HOLE_ARG1, 0, 0 },
+    { 28, JIT_HOLE_ARG2, 0, 0 },
+    { 55, JIT_HOLE_CONTINUE, 0, 0 },
+    { 74, JIT_HOLE_DATA, 0, 0 },
+    { 88, JIT_HOLE_SYMBOL, 1, 0 },
+};
+
+static const jit_stencil_t jit_stencil_LOAD_CELL = {
+    jit_code_LOAD_CELL, 98, jit_holes_LOAD_CELL, 5
+};
+
+static const unsigned char jit_code_LOAD_GLOBAL[] = {
+    0x48, 0x8b, 0x47, 0x20, 0x48, 0x83, 0x80, 0x38, 0x01, 0x00, 0x00, 0x01,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8d,
+    0x0c, 0xc6, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x48, 0xc1, 0xe0, 0x04, 0x48, 0x03, 0x47, 0x28, 0x48, 0x8b, 0x00, 0x48,
+    0x85, 0xc0, 0x74, 0x14, 0x48, 0x89, 0x01, 0x48, 0xb8, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0, 0x0f, 0x1f, 0x44, 0x00, 0x00,
+    0x48, 0xbf, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x83,
+    0xec, 0x08, 0x48, 0xba, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xff, 0xd2,
+};
+
+static const jit_hole_t jit_holes_LOAD_GLOBAL[] = {
+    { 14, JIT_HOLE_ARG1, 0, 0 },
+    { 28, JIT_HOLE_LONGARG, 0, 0 },
+    { 57, JIT_HOLE_CONTINUE, 0, 0 },
+    { 74, JIT_HOLE_DATA, 0, 0 },
+    { 88, JIT_HOLE_SYMBOL, 1, 0 },
+};
+
+static const jit_stencil_t jit_stencil_LOAD_GLOBAL = {
+    jit_code_LOAD_GLOBAL, 98, jit_holes_LOAD_GLOBAL, 5
+};
+
+static const unsigned char jit_code_TAILCALL_SELF[] = {
+    0x55, 0x48, 0x89, 0xf1, 0x48, 0x89, 0xd5, 0x53, 0x48, 0x89, 0xfb, 0x48,
+    0x83, 0xec, 0x08, 0x48, 0x8b, 0x57, 0x20, 0xa1, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x85, 0xc0, 0x75, 0x70, 0x80, 0xba, 0xf0, 0x09,
+    0x00, 0x00, 0x00, 0x75, 0x73, 0x48, 0x83, 0x82, 0x80, 0x01, 0x00, 0x00,
+    0x01, 0x48, 0x89, 0xcf, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x48, 0x83, 0x82, 0xf0, 0x00, 0x00, 0x00, 0x01, 0x48, 0x8d,
+    0x34, 0xc1, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x48, 0x83, 0x82, 0x08, 0x01, 0x00, 0x00, 0x01, 0x48, 0xba, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0xc1, 0xe2, 0x03, 0xff, 0xd0,
+    0x48, 0x83, 0xc4, 0x08, 0x48, 0x89, 0xea, 0x48, 0x89, 0xdf, 0x48, 0x89,
+    0xc6, 0x5b, 0x5d, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0xff, 0xe0, 0x66, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x48, 0x8b, 0x02, 0x80, 0xb8, 0x90, 0x00, 0x00, 0x00, 0x00, 0x74, 0x84,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x89,
+    0x03, 0x48, 0x83, 0xc4, 0x08, 0x5b, 0x5d, 0xc3,
+};
+
+static const jit_hole_t jit_holes_TAILCALL_SELF[] = {
+    { 20, JIT_HOLE_SYMBOL, 2, 0 },
+    { 54, JIT_HOLE_ARG2, 0, 0 },
+    { 76, JIT_HOLE_SYMBOL, 3, 0 },
+    { 94, JIT_HOLE_ARG3, 0, 0 },
+    { 125, JIT_HOLE_TARGET, 0, 0 },
+    { 158, JIT_HOLE_IP, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_TAILCALL_SELF = {
+    jit_code_TAILCALL_SELF, 176, jit_holes_TAILCALL_SELF, 6
+};
+
+static const unsigned char jit_code_TAILCALL_SELF0[] = {
+    0xa1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x4f,
+    0x20, 0x85, 0xc0, 0x75, 0x2f, 0x80, 0xb9, 0xf0, 0x09, 0x00, 0x00, 0x00,
+    0x75, 0x32, 0x48, 0x83, 0x81, 0x88, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x83, 0x81, 0xf0,
+    0x00, 0x00, 0x00, 0x01, 0x48, 0x83, 0x81, 0x08, 0x01, 0x00, 0x00, 0x01,
+    0xff, 0xe0, 0x66, 0x90, 0x48, 0x8b, 0x01, 0x80, 0xb8, 0x90, 0x00, 0x00,
+    0x00, 0x00, 0x74, 0xc5, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x48, 0x89, 0x07, 0xc3,
+};
+
+static const jit_hole_t jit_holes_TAILCALL_SELF0[] = {
+    { 1, JIT_HOLE_SYMBOL, 2, 0 },
+    { 36, JIT_HOLE_TARGET, 0, 0 },
+    { 78, JIT_HOLE_IP, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_TAILCALL_SELF0 = {
+    jit_code_TAILCALL_SELF0, 90, jit_holes_TAILCALL_SELF0, 3
+};
+
+static const unsigned char jit_code_JUMP[] = {
+    0x48, 0x8b, 0x47, 0x20, 0x48, 0x83, 0x80, 0x90, 0x01, 0x00, 0x00, 0x01,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0,
+};
+
+static const jit_hole_t jit_holes_JUMP[] = {
+    { 14, JIT_HOLE_TARGET, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_JUMP = {
+    jit_code_JUMP, 24, jit_holes_JUMP, 1
+};
+
+static const unsigned char jit_code_JUMP_BACK[] = {
+    0xa1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x4f,
+    0x20, 0x85, 0xc0, 0x75, 0x1f, 0x80, 0xb9, 0xf0, 0x09, 0x00, 0x00, 0x00,
+    0x75, 0x22, 0x48, 0x83, 0x81, 0x90, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0, 0x66, 0x90,
+    0x48, 0x8b, 0x01, 0x80, 0xb8, 0x90, 0x00, 0x00, 0x00, 0x00, 0x74, 0xd5,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x89,
+    0x07, 0xc3,
+};
+
+static const jit_hole_t jit_holes_JUMP_BACK[] = {
+    { 1, JIT_HOLE_SYMBOL, 2, 0 },
+    { 36, JIT_HOLE_TARGET, 0, 0 },
+    { 62, JIT_HOLE_IP, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_JUMP_BACK = {
+    jit_code_JUMP_BACK, 74, jit_holes_JUMP_BACK, 3
+};
+
+static const unsigned char jit_code_IF[] = {
+    0x48, 0xb9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b,
+    0x47, 0x20, 0x48, 0x83, 0x80, 0xa8, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x00, 0x48,
+    0x39, 0x04, 0xce, 0x74, 0x0f, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0xff, 0xe0, 0x0f, 0x1f, 0x00, 0x48, 0xb8, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0,
+};
+
+static const jit_hole_t jit_holes_IF[] = {
+    { 2, JIT_HOLE_ARG1, 0, 0 },
+    { 24, JIT_HOLE_SYMBOL, 4, 0 },
+    { 43, JIT_HOLE_NEXT2, 0, 0 },
+    { 58, JIT_HOLE_TARGET, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_IF = {
+    jit_code_IF, 68, jit_holes_IF, 4
+};
+
+static const unsigned char jit_code_IFNOT[] = {
+    0x48, 0xb9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b,
+    0x47, 0x20, 0x48, 0x83, 0x80, 0xb0, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x00, 0x48,
+    0x39, 0x04, 0xce, 0x74, 0x0f, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0xff, 0xe0, 0x0f, 0x1f, 0x00, 0x48, 0xb8, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0,
+};
+
+static const jit_hole_t jit_holes_IFNOT[] = {
+    { 2, JIT_HOLE_ARG1, 0, 0 },
+    { 24, JIT_HOLE_SYMBOL, 4, 0 },
+    { 43, JIT_HOLE_TARGET, 0, 0 },
+    { 58, JIT_HOLE_NEXT2, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_IFNOT = {
+    jit_code_IFNOT, 68, jit_holes_IFNOT, 4
+};
+
+static const unsigned char jit_code_IF_BACK[] = {
+    0xa1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x4f,
+    0x20, 0x85, 0xc0, 0x75, 0x4f, 0x80, 0xb9, 0xf0, 0x09, 0x00, 0x00, 0x00,
+    0x75, 0x52, 0x48, 0x83, 0x81, 0xa8, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0xb9, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x00, 0x48, 0x39, 0x04,
+    0xce, 0x74, 0x11, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0xff, 0xe0, 0x0f, 0x1f, 0x44, 0x00, 0x00, 0x48, 0xb8, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0, 0x0f, 0x1f, 0x40, 0x00,
+    0x48, 0x8b, 0x01, 0x80, 0xb8, 0x90, 0x00, 0x00, 0x00, 0x00, 0x74, 0xa5,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x89,
+    0x07, 0xc3,
+};
+
+static const jit_hole_t jit_holes_IF_BACK[] = {
+    { 1, JIT_HOLE_SYMBOL, 2, 0 },
+    { 36, JIT_HOLE_SYMBOL, 4, 0 },
+    { 46, JIT_HOLE_ARG1, 0, 0 },
+    { 65, JIT_HOLE_NEXT2, 0, 0 },
+    { 82, JIT_HOLE_TARGET, 0, 0 },
+    { 110, JIT_HOLE_IP, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_IF_BACK = {
+    jit_code_IF_BACK, 122, jit_holes_IF_BACK, 6
+};
+
+static const unsigned char jit_code_IFNOT_BACK[] = {
+    0xa1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x4f,
+    0x20, 0x85, 0xc0, 0x75, 0x4f, 0x80, 0xb9, 0xf0, 0x09, 0x00, 0x00, 0x00,
+    0x75, 0x52, 0x48, 0x83, 0x81, 0xb0, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0xb9, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x00, 0x48, 0x39, 0x04,
+    0xce, 0x74, 0x11, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0xff, 0xe0, 0x0f, 0x1f, 0x44, 0x00, 0x00, 0x48, 0xb8, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0, 0x0f, 0x1f, 0x40, 0x00,
+    0x48, 0x8b, 0x01, 0x80, 0xb8, 0x90, 0x00, 0x00, 0x00, 0x00, 0x74, 0xa5,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x89,
+    0x07, 0xc3,
+};
+
+static const jit_hole_t jit_holes_IFNOT_BACK[] = {
+    { 1, JIT_HOLE_SYMBOL, 2, 0 },
+    { 36, JIT_HOLE_SYMBOL, 4, 0 },
+    { 46, JIT_HOLE_ARG1, 0, 0 },
+    { 65, JIT_HOLE_TARGET, 0, 0 },
+    { 82, JIT_HOLE_NEXT2, 0, 0 },
+    { 110, JIT_HOLE_IP, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_IFNOT_BACK = {
+    jit_code_IFNOT_BACK, 122, jit_holes_IFNOT_BACK, 6
+};
+
+#define JIT_SYMBOLS(X) \
+    X(eris_new) \
+    X(eris_bug) \
+    X(eris_prof_pending) \
+    X(memmove) \
+    X(eris_nil)
+
+#define JIT_DATA(X) \
+    X(jit_data_0)
@@ -0,0 +1,323 @@
+/* Generated by jitgen from build/debug-gcc-694dc0825e/obj/jit/stencils.o. Do not edit. */
+
+static const unsigned char jit_code_exit[] = {
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x89,
+    0x07, 0xc3,
+};
+
+static const jit_hole_t jit_holes_exit[] = {
+    { 2, JIT_HOLE_IP, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_exit = {
+    jit_code_exit, 14, jit_holes_exit, 1
+};
+
+static const unsigned char jit_code_MOVE[] = {
+    0x48, 0x8b, 0x47, 0x20, 0x48, 0x83, 0x80, 0x18, 0x01, 0x00, 0x00, 0x01,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b,
+    0x0c, 0xc6, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x48, 0x89, 0x0c, 0xc6,
+};
+
+static const jit_hole_t jit_holes_MOVE[] = {
+    { 14, JIT_HOLE_ARG2, 0, 0 },
+    { 28, JIT_HOLE_ARG1, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_MOVE = {
+    jit_code_MOVE, 40, jit_holes_MOVE, 2
+};
+
+static const unsigned char jit_code_LOAD_INT[] = {
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x41, 0x57,
+    0x48, 0xb9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x49, 0xbf,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x41, 0x56, 0x49, 0xbe,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x41, 0x55, 0x41, 0x54,
+    0x49, 0x89, 0xd4, 0x55, 0x48, 0x89, 0xf5, 0x53, 0x4c, 0x8d, 0x6c, 0xc5,
+    0x00, 0x48, 0x89, 0xfb, 0x48, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0x00, 0x00, 0x48, 0x83, 0xec, 0x18, 0x48, 0x8b, 0x57, 0x10, 0x48, 0x8b,
+    0x77, 0x20, 0x4c, 0x89, 0x72, 0x08, 0x48, 0x39, 0xc8, 0x72, 0x41, 0x48,
+    0xba, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfa, 0xff, 0x4c, 0x21, 0xf8,
+    0x48, 0x09, 0xd0, 0x49, 0x89, 0x45, 0x00, 0x48, 0x83, 0x86, 0x20, 0x01,
+    0x00, 0x00, 0x01, 0x4c, 0x89, 0xe2, 0x48, 0x89, 0xee, 0x48, 0x83, 0xc4,
+    0x18, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48,
+    0x89, 0xdf, 0x5b, 0x5d, 0x41, 0x5c, 0x41, 0x5d, 0x41, 0x5e, 0x41, 0x5f,
+    0xff, 0xe0, 0x66, 0x90, 0x41, 0xb8, 0x30, 0x00, 0x00, 0x00, 0xb9, 0x01,
+    0x00, 0x00, 0x00, 0x48, 0x8d, 0x7c, 0x24, 0x08, 0x48, 0xb8, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xd0, 0x84, 0xc0, 0x74, 0x30,
+    0x48, 0xba, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf9, 0xff, 0x48, 0x8b,
+    0x44, 0x24, 0x08, 0xc6, 0x40, 0x08, 0x00, 0x48, 0x8b, 0x73, 0x20, 0xc7,
+    0x40, 0x04, 0x00, 0x00, 0x00, 0x00, 0x4c, 0x89, 0x78, 0x10, 0x48, 0x09,
+    0xd0, 0x49, 0x89, 0x45, 0x00, 0xeb, 0x88, 0x0f, 0x1f, 0x44, 0x00, 0x00,
+    0x4c, 0x89, 0x33, 0x48, 0x83, 0xc4, 0x18, 0x5b, 0x5d, 0x41, 0x5c, 0x41,
+    0x5d, 0x41, 0x5e, 0x41, 0x5f, 0xc3,
+};
+
+static const jit_hole_t jit_holes_LOAD_INT[] = {
+    { 2, JIT_HOLE_ARG1, 0, 0 },
+    { 14, JIT_HOLE_SIGNED_LONGARG, 0, 140737488355328 },
+    { 24, JIT_HOLE_SIGNED_LONGARG, 0, 0 },
+    { 36, JIT_HOLE_IP, 0, 0 },
+    { 135, JIT_HOLE_CONTINUE, 0, 0 },
+    { 178, JIT_HOLE_SYMBOL, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_LOAD_INT = {
+    jit_code_LOAD_INT, 258, jit_holes_LOAD_INT, 6
+};
+
+static const unsigned char jit_code_LOAD_UPVAL[] = {
+    0x48, 0x8b, 0x47, 0x20, 0x48, 0x83, 0x80, 0x28, 0x01, 0x00, 0x00, 0x01,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b,
+    0x4c, 0xc2, 0x08, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x48, 0x89, 0x0c, 0xc6,
+};
+
+static const jit_hole_t jit_holes_LOAD_UPVAL[] = {
+    { 14, JIT_HOLE_ARG2, 0, 0 },
+    { 29, JIT_HOLE_ARG1, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_LOAD_UPVAL = {
+    jit_code_LOAD_UPVAL, 41, jit_holes_LOAD_UPVAL, 2
+};
+
+static const unsigned char jit_data_0[] = {
+    0x72, 0x65, 0x66, 0x65, 0x72, 0x65, 0x6e, 0x63, 0x65, 0x20, 0x74, 0x6f,
+    0x20, 0x75, 0x6e, 0x64, 0x65, 0x66, 0x69, 0x6e, 0x65, 0x64, 0x20, 0x63,
+    0x65, 0x6c, 0x6c, 0x00,
+};
+
+static const unsigned char jit_code_LOAD_CELL[] = {
+    0x48, 0xb9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b,
+    0x47, 0x20, 0x48, 0x83, 0x80, 0x30, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4c, 0x8d, 0x04, 0xc6,
+    0x48, 0xb8, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x48, 0x23,
+    0x44, 0xca, 0x08, 0x48, 0xb9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfc,
+    0xff, 0x48, 0x8b, 0x40, 0x08, 0x48, 0x39, 0xc8, 0x74, 0x12, 0x49, 0x89,
+    0x00, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff,
+    0xe0, 0x0f, 0x1f, 0x00, 0x48, 0xbf, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x48, 0x83, 0xec, 0x08, 0x31, 0xc0, 0x48, 0xba, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xd2,
+};
+
+static const jit_hole_t jit_holes_LOAD_CELL[] = {
+    { 2, JIT_HOLE_ARG2, 0, 0 },
+    { 24, JIT_HOLE_ARG1, 0, 0 },
+    { 75, JIT_HOLE_CONTINUE, 0, 0 },
+    { 90, JIT_HOLE_DATA, 0, 0 },
+    { 106, JIT_HOLE_SYMBOL, 1, 0 },
+};
+
+static const jit_stencil_t jit_stencil_LOAD_CELL = {
+    jit_code_LOAD_CELL, 116, jit_holes_LOAD_CELL, 5
+};
+
+static const unsigned char jit_code_LOAD_GLOBAL[] = {
+    0x48, 0xb9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfc, 0xff, 0x48, 0x8b,
+    0x47, 0x20, 0x48, 0x83, 0x80, 0x38, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4c, 0x8d, 0x04, 0xc6,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0xc1,
+    0xe0, 0x04, 0x48, 0x03, 0x47, 0x28, 0x48, 0x8b, 0x00, 0x48, 0x39, 0xc8,
+    0x74, 0x12, 0x49, 0x89, 0x00, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0xff, 0xe0, 0x0f, 0x1f, 0x00, 0x48, 0xbf, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x83, 0xec, 0x08, 0x31, 0xc0,
+    0x48, 0xba, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xd2,
+};
+
+static const jit_hole_t jit_holes_LOAD_GLOBAL[] = {
+    { 24, JIT_HOLE_ARG1, 0, 0 },
+    { 38, JIT_HOLE_LONGARG, 0, 0 },
+    { 67, JIT_HOLE_CONTINUE, 0, 0 },
+    { 82, JIT_HOLE_DATA, 0, 0 },
+    { 98, JIT_HOLE_SYMBOL, 1, 0 },
+};
+
+static const jit_stencil_t jit_stencil_LOAD_GLOBAL = {
+    jit_code_LOAD_GLOBAL, 108, jit_holes_LOAD_GLOBAL, 5
+};
+
+static const unsigned char jit_code_TAILCALL_SELF[] = {
+    0x55, 0x48, 0x89, 0xf1, 0x48, 0x89, 0xd5, 0x53, 0x48, 0x89, 0xfb, 0x48,
+    0x83, 0xec, 0x08, 0x48, 0x8b, 0x57, 0x20, 0xa1, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x85, 0xc0, 0x75, 0x70, 0x80, 0xba, 0xf0, 0x09,
+    0x00, 0x00, 0x00, 0x75, 0x73, 0x48, 0x83, 0x82, 0x80, 0x01, 0x00, 0x00,
+    0x01, 0x48, 0x89, 0xcf, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x48, 0x83, 0x82, 0xf0, 0x00, 0x00, 0x00, 0x01, 0x48, 0x8d,
+    0x34, 0xc1, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x48, 0x83, 0x82, 0x08, 0x01, 0x00, 0x00, 0x01, 0x48, 0xba, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0xc1, 0xe2, 0x03, 0xff, 0xd0,
+    0x48, 0x83, 0xc4, 0x08, 0x48, 0x89, 0xea, 0x48, 0x89, 0xdf, 0x48, 0x89,
+    0xc6, 0x5b, 0x5d, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0xff, 0xe0, 0x66, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x48, 0x8b, 0x02, 0x80, 0xb8, 0x90, 0x00, 0x00, 0x00, 0x00, 0x74, 0x84,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x89,
+    0x03, 0x48, 0x83, 0xc4, 0x08, 0x5b, 0x5d, 0xc3,
+};
+
+static const jit_hole_t jit_holes_TAILCALL_SELF[] = {
+    { 20, JIT_HOLE_SYMBOL, 2, 0 },
+    { 54, JIT_HOLE_ARG2, 0, 0 },
+    { 76, JIT_HOLE_SYMBOL, 3, 0 },
+    { 94, JIT_HOLE_ARG3, 0, 0 },
+    { 125, JIT_HOLE_TARGET, 0, 0 },
+    { 158, JIT_HOLE_IP, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_TAILCALL_SELF = {
+    jit_code_TAILCALL_SELF, 176, jit_holes_TAILCALL_SELF, 6
+};
+
+static const unsigned char jit_code_TAILCALL_SELF0[] = {
+    0xa1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x4f,
+    0x20, 0x85, 0xc0, 0x75, 0x2f, 0x80, 0xb9, 0xf0, 0x09, 0x00, 0x00, 0x00,
+    0x75, 0x32, 0x48, 0x83, 0x81, 0x88, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x83, 0x81, 0xf0,
+    0x00, 0x00, 0x00, 0x01, 0x48, 0x83, 0x81, 0x08, 0x01, 0x00, 0x00, 0x01,
+    0xff, 0xe0, 0x66, 0x90, 0x48, 0x8b, 0x01, 0x80, 0xb8, 0x90, 0x00, 0x00,
+    0x00, 0x00, 0x74, 0xc5, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x48, 0x89, 0x07, 0xc3,
+};
+
+static const jit_hole_t jit_holes_TAILCALL_SELF0[] = {
+    { 1, JIT_HOLE_SYMBOL, 2, 0 },
+    { 36, JIT_HOLE_TARGET, 0, 0 },
+    { 78, JIT_HOLE_IP, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_TAILCALL_SELF0 = {
+    jit_code_TAILCALL_SELF0, 90, jit_holes_TAILCALL_SELF0, 3
+};
+
+static const unsigned char jit_code_JUMP[] = {
+    0x48, 0x8b, 0x47, 0x20, 0x48, 0x83, 0x80, 0x90, 0x01, 0x00, 0x00, 0x01,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0,
+};
+
+static const jit_hole_t jit_holes_JUMP[] = {
+    { 14, JIT_HOLE_TARGET, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_JUMP = {
+    jit_code_JUMP, 24, jit_holes_JUMP, 1
+};
+
+static const unsigned char jit_code_JUMP_BACK[] = {
+    0xa1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x4f,
+    0x20, 0x85, 0xc0, 0x75, 0x1f, 0x80, 0xb9, 0xf0, 0x09, 0x00, 0x00, 0x00,
+    0x75, 0x22, 0x48, 0x83, 0x81, 0x90, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0, 0x66, 0x90,
+    0x48, 0x8b, 0x01, 0x80, 0xb8, 0x90, 0x00, 0x00, 0x00, 0x00, 0x74, 0xd5,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x89,
+    0x07, 0xc3,
+};
+
+static const jit_hole_t jit_holes_JUMP_BACK[] = {
+    { 1, JIT_HOLE_SYMBOL, 2, 0 },
+    { 36, JIT_HOLE_TARGET, 0, 0 },
+    { 62, JIT_HOLE_IP, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_JUMP_BACK = {
+    jit_code_JUMP_BACK, 74, jit_holes_JUMP_BACK, 3
+};
+
+static const unsigned char jit_code_IF[] = {
+    0x48, 0xb9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b,
+    0x47, 0x20, 0x48, 0x83, 0x80, 0xa8, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfb, 0xff, 0x48, 0x39, 0x04, 0xce,
+    0x74, 0x12, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xff, 0xe0, 0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00, 0x48, 0xb8, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0,
+};
+
+static const jit_hole_t jit_holes_IF[] = {
+    { 2, JIT_HOLE_ARG1, 0, 0 },
+    { 40, JIT_HOLE_NEXT2, 0, 0 },
+    { 58, JIT_HOLE_TARGET, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_IF = {
+    jit_code_IF, 68, jit_holes_IF, 3
+};
+
+static const unsigned char jit_code_IFNOT[] = {
+    0x48, 0xb9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b,
+    0x47, 0x20, 0x48, 0x83, 0x80, 0xb0, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfb, 0xff, 0x48, 0x39, 0x04, 0xce,
+    0x74, 0x12, 0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xff, 0xe0, 0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00, 0x48, 0xb8, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0,
+};
+
+static const jit_hole_t jit_holes_IFNOT[] = {
+    { 2, JIT_HOLE_ARG1, 0, 0 },
+    { 40, JIT_HOLE_TARGET, 0, 0 },
+    { 58, JIT_HOLE_NEXT2, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_IFNOT = {
+    jit_code_IFNOT, 68, jit_holes_IFNOT, 3
+};
+
+static const unsigned char jit_code_IF_BACK[] = {
+    0xa1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x4f,
+    0x20, 0x85, 0xc0, 0x75, 0x4f, 0x80, 0xb9, 0xf0, 0x09, 0x00, 0x00, 0x00,
+    0x75, 0x52, 0x48, 0x83, 0x81, 0xa8, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb9,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0xb8, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xfb, 0xff, 0x48, 0x39, 0x04, 0xce, 0x74, 0x14,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0,
+    0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0xb8, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0, 0x0f, 0x1f, 0x40, 0x00,
+    0x48, 0x8b, 0x01, 0x80, 0xb8, 0x90, 0x00, 0x00, 0x00, 0x00, 0x74, 0xa5,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x89,
+    0x07, 0xc3,
+};
+
+static const jit_hole_t jit_holes_IF_BACK[] = {
+    { 1, JIT_HOLE_SYMBOL, 2, 0 },
+    { 36, JIT_HOLE_ARG1, 0, 0 },
+    { 62, JIT_HOLE_NEXT2, 0, 0 },
+    { 82, JIT_HOLE_TARGET, 0, 0 },
+    { 110, JIT_HOLE_IP, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_IF_BACK = {
+    jit_code_IF_BACK, 122, jit_holes_IF_BACK, 5
+};
+
+static const unsigned char jit_code_IFNOT_BACK[] = {
+    0xa1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x4f,
+    0x20, 0x85, 0xc0, 0x75, 0x4f, 0x80, 0xb9, 0xf0, 0x09, 0x00, 0x00, 0x00,
+    0x75, 0x52, 0x48, 0x83, 0x81, 0xb0, 0x01, 0x00, 0x00, 0x01, 0x48, 0xb9,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0xb8, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xfb, 0xff, 0x48, 0x39, 0x04, 0xce, 0x74, 0x14,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0,
+    0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0xb8, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xe0, 0x0f, 0x1f, 0x40, 0x00,
+    0x48, 0x8b, 0x01, 0x80, 0xb8, 0x90, 0x00, 0x00, 0x00, 0x00, 0x74, 0xa5,
+    0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x89,
+    0x07, 0xc3,
+};
+
+static const jit_hole_t jit_holes_IFNOT_BACK[] = {
+    { 1, JIT_HOLE_SYMBOL, 2, 0 },
+    { 36, JIT_HOLE_ARG1, 0, 0 },
+    { 62, JIT_HOLE_TARGET, 0, 0 },
+    { 82, JIT_HOLE_NEXT2, 0, 0 },
+    { 110, JIT_HOLE_IP, 0, 0 },
+};
+
+static const jit_stencil_t jit_stencil_IFNOT_BACK = {
+    jit_code_IFNOT_BACK, 122, jit_holes_IFNOT_BACK, 5
+};
+
+#define JIT_SYMBOLS(X) \
+    X(eris_new) \
+    X(eris_bug) \
+    X(eris_prof_pending) \
+    X(memmove)
+
+#define JIT_DATA(X) \
+    X(jit_data_0)
@@ -0,0 +1,3215 @@
+/* Compiled ahead of time by eris_aot_emit; see src/aot.h. */
+#include <string.h>
+
+#include "aot.h"
+#include "misc.h"
+#include "types.h"
+#include "vm.h"
+
+/* "id" */
+static const instr_t bench_aot_code_0[] = {
+    0x00000010,
+};
+
+static int bench_aot_0(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    val_t r0;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    r0 = regs[0];
+    switch (S->ip - code) {
+      case 0: goto L0;
+      default: return AOT_EXIT;
+    }
+  L0:
+    if (!depth) {
+        regs[0] = r0;
+        S->ip = code + 0;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = r0;
+    return 1;
+}
+
+/* "call-return" */
+static const instr_t bench_aot_code_1[] = {
+    0x00000002, 0x00010102, 0x01010006, 0x01010006, 0x01010006, 0x01010006,
+    0x01010006, 0x01010006, 0x01010006, 0x01010006, 0x01010006, 0x01010006,
+    0x01010006, 0x01010006, 0x01010006, 0x01010006, 0x01010006, 0x01010006,
+    0x00000110,
+};
+
+static int bench_aot_1(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 3: goto L3;
+      case 4: goto L4;
+      case 5: goto L5;
+      case 6: goto L6;
+      case 7: goto L7;
+      case 8: goto L8;
+      case 9: goto L9;
+      case 10: goto L10;
+      case 11: goto L11;
+      case 12: goto L12;
+      case 13: goto L13;
+      case 14: goto L14;
+      case 15: goto L15;
+      case 16: goto L16;
+      case 17: goto L17;
+      case 18: goto L18;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    S->ip = code + 2;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L3:
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    S->ip = code + 4;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L5:
+    S->ip = code + 5;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L6:
+    S->ip = code + 6;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L7:
+    S->ip = code + 7;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L8:
+    S->ip = code + 8;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L9:
+    S->ip = code + 9;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L10:
+    S->ip = code + 10;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L11:
+    S->ip = code + 11;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L12:
+    S->ip = code + 12;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L13:
+    S->ip = code + 13;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L14:
+    S->ip = code + 14;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L15:
+    S->ip = code + 15;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L16:
+    S->ip = code + 16;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L17:
+    S->ip = code + 17;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L18:
+    if (!depth) {
+        S->ip = code + 18;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "call-n-unverified" */
+static const instr_t bench_aot_code_2[] = {
+    0x00000002, 0x002a0101, 0x00010301, 0x61010008, 0x61010008, 0x61010008,
+    0x61010008, 0x61010008, 0x61010008, 0x61010008, 0x61010008, 0x61010008,
+    0x61010008, 0x61010008, 0x61010008, 0x61010008, 0x61010008, 0x61010008,
+    0x61010008, 0x00000312, 0x0002000f, 0x00000310, 0x00000110,
+};
+
+static int bench_aot_2(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      case 5: goto L5;
+      case 6: goto L6;
+      case 7: goto L7;
+      case 8: goto L8;
+      case 9: goto L9;
+      case 10: goto L10;
+      case 11: goto L11;
+      case 12: goto L12;
+      case 13: goto L13;
+      case 14: goto L14;
+      case 15: goto L15;
+      case 16: goto L16;
+      case 17: goto L17;
+      case 18: goto L18;
+      case 19: goto L19;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    frame->data.call.ip = code + 1;
+    if (UNLIKELY(!make_fixnum(&regs[1], 42, S->thread, frame))) {
+        S->ip = code + 1;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    frame->data.call.ip = code + 2;
+    if (UNLIKELY(!make_fixnum(&regs[3], 1, S->thread, frame))) {
+        S->ip = code + 2;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    S->ip = code + 4;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L5:
+    S->ip = code + 5;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L6:
+    S->ip = code + 6;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L7:
+    S->ip = code + 7;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L8:
+    S->ip = code + 8;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L9:
+    S->ip = code + 9;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L10:
+    S->ip = code + 10;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L11:
+    S->ip = code + 11;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L12:
+    S->ip = code + 12;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L13:
+    S->ip = code + 13;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L14:
+    S->ip = code + 14;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L15:
+    S->ip = code + 15;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L16:
+    S->ip = code + 16;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L17:
+    S->ip = code + 17;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L18:
+    S->ip = code + 18;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 3, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L19:
+    AOT_COUNT(OP_IF);
+    if (!VAL_IS_NIL(regs[3]))
+        goto L21;
+    goto L22;
+  L21:
+    if (!depth) {
+        S->ip = code + 21;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[3];
+    return 1;
+  L22:
+    if (!depth) {
+        S->ip = code + 22;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "loop" */
+static const instr_t bench_aot_code_3[] = {
+    0x00000102, 0x00000200, 0x00040302, 0x02020106, 0x00000213, 0x0007000f,
+    0x00010102, 0x00000200, 0x00050302, 0x02020106, 0x0102000d, 0x00000010,
+    0x00000010,
+};
+
+static int bench_aot_3(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      case 10: goto L10;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[0];
+    AOT_COUNT(OP_MOVE);
+    regs[2] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[3] = func->upvals[4];
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[1], 2, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(regs[2]))
+        goto L6;
+    goto L12;
+  L6:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_MOVE);
+    regs[2] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[3] = func->upvals[5];
+    S->ip = code + 9;
+    status = eris_aot_invoke(S, regs[1], 2, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L10:
+    if (eris_prof_due(S->thread) || UNLIKELY(S->thread->gc_pending)) {
+        S->ip = code + 10;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_TAILCALL_SELF);
+    STAT(S->thread, closure_calls++);
+    STAT(S->thread, tail_calls++);
+    memmove(regs, regs + 2, sizeof(val_t) * 1);
+    goto L0;
+    if (!depth) {
+        S->ip = code + 11;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[0];
+    return 1;
+  L12:
+    if (!depth) {
+        S->ip = code + 12;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[0];
+    return 1;
+}
+
+/* "tail-call-loop" */
+static const instr_t bench_aot_code_4[] = {
+    0x00000002, 0x03e80101, 0x01010006, 0x00000110,
+};
+
+static int bench_aot_4(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 3: goto L3;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    frame->data.call.ip = code + 1;
+    if (UNLIKELY(!make_fixnum(&regs[1], 1000, S->thread, frame))) {
+        S->ip = code + 1;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    S->ip = code + 2;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L3:
+    if (!depth) {
+        S->ip = code + 3;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "jump-loop" */
+static const instr_t bench_aot_code_5[] = {
+    0x00000102, 0x00010202, 0x00000300, 0x00040402, 0x02030106, 0x00000313,
+    0x0006000f, 0x00000300, 0x00050402, 0x02030206, 0x00030000, 0xfff5000f,
+    0x00000010,
+};
+
+static int bench_aot_5(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 5: goto L5;
+      case 10: goto L10;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    AOT_COUNT(OP_MOVE);
+    regs[3] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[4] = func->upvals[4];
+    S->ip = code + 4;
+    status = eris_aot_invoke(S, regs[1], 3, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L5:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(regs[3]))
+        goto L7;
+    goto L12;
+  L7:
+    AOT_COUNT(OP_MOVE);
+    regs[3] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[4] = func->upvals[5];
+    S->ip = code + 9;
+    status = eris_aot_invoke(S, regs[2], 3, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L10:
+    AOT_COUNT(OP_MOVE);
+    regs[0] = regs[3];
+    AOT_COUNT(OP_JUMP);
+    if (eris_prof_due(S->thread) || UNLIKELY(S->thread->gc_pending)) {
+        S->ip = code + 11;
+        return AOT_EXIT;
+    }
+    goto L0;
+  L12:
+    if (!depth) {
+        S->ip = code + 12;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[0];
+    return 1;
+}
+
+/* "float-loop" */
+static const instr_t bench_aot_code_6[] = {
+    0x00000202, 0x00000300, 0x00040402, 0x02030206, 0x00000313, 0x000b000f,
+    0x00010202, 0x00000300, 0x00050402, 0x02030206, 0x00020202, 0x00010400,
+    0x00070502, 0x02040206, 0x0203000d, 0x00000010, 0x00000110,
+};
+
+static int bench_aot_6(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      case 10: goto L10;
+      case 14: goto L14;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[0];
+    AOT_COUNT(OP_MOVE);
+    regs[3] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[4] = func->upvals[4];
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[2], 3, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(regs[3]))
+        goto L6;
+    goto L16;
+  L6:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    AOT_COUNT(OP_MOVE);
+    regs[3] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[4] = func->upvals[5];
+    S->ip = code + 9;
+    status = eris_aot_invoke(S, regs[2], 3, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L10:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    AOT_COUNT(OP_MOVE);
+    regs[4] = regs[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[5] = func->upvals[7];
+    S->ip = code + 13;
+    status = eris_aot_invoke(S, regs[2], 4, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L14:
+    if (eris_prof_due(S->thread) || UNLIKELY(S->thread->gc_pending)) {
+        S->ip = code + 14;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_TAILCALL_SELF);
+    STAT(S->thread, closure_calls++);
+    STAT(S->thread, tail_calls++);
+    memmove(regs, regs + 3, sizeof(val_t) * 2);
+    goto L0;
+    if (!depth) {
+        S->ip = code + 15;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[0];
+    return 1;
+  L16:
+    if (!depth) {
+        S->ip = code + 16;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "float-main" */
+static const instr_t bench_aot_code_7[] = {
+    0x00000002, 0x03e80101, 0x00010202, 0x02010006, 0x00000110,
+};
+
+static int bench_aot_7(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    frame->data.call.ip = code + 1;
+    if (UNLIKELY(!make_fixnum(&regs[1], 1000, S->thread, frame))) {
+        S->ip = code + 1;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    if (!depth) {
+        S->ip = code + 4;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "walk" */
+static const instr_t bench_aot_code_8[] = {
+    0x00000012, 0x000f000f, 0x00030202, 0x00040402, 0x00000500, 0x02040206,
+    0x00050502, 0x00000600, 0x02050206, 0x00020202, 0x00010300, 0x02030206,
+    0x00030400, 0x00050300, 0x0203000d, 0x00000010, 0x00000110,
+};
+
+static int bench_aot_8(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 6: goto L6;
+      case 9: goto L9;
+      case 12: goto L12;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_IF);
+    if (!VAL_IS_NIL(regs[0]))
+        goto L2;
+    goto L16;
+  L2:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[3];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[4] = func->upvals[4];
+    AOT_COUNT(OP_MOVE);
+    regs[5] = regs[0];
+    S->ip = code + 5;
+    status = eris_aot_invoke(S, regs[2], 4, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L6:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[5] = func->upvals[5];
+    AOT_COUNT(OP_MOVE);
+    regs[6] = regs[0];
+    S->ip = code + 8;
+    status = eris_aot_invoke(S, regs[2], 5, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L9:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    AOT_COUNT(OP_MOVE);
+    regs[3] = regs[1];
+    S->ip = code + 11;
+    status = eris_aot_invoke(S, regs[2], 3, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L12:
+    AOT_COUNT(OP_MOVE);
+    regs[4] = regs[3];
+    AOT_COUNT(OP_MOVE);
+    regs[3] = regs[5];
+    if (eris_prof_due(S->thread) || UNLIKELY(S->thread->gc_pending)) {
+        S->ip = code + 14;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_TAILCALL_SELF);
+    STAT(S->thread, closure_calls++);
+    STAT(S->thread, tail_calls++);
+    memmove(regs, regs + 3, sizeof(val_t) * 2);
+    goto L0;
+    if (!depth) {
+        S->ip = code + 15;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[0];
+    return 1;
+  L16:
+    if (!depth) {
+        S->ip = code + 16;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "walk-main" */
+static const instr_t bench_aot_code_9[] = {
+    0x00000002, 0x00010102, 0x00000201, 0x02010006, 0x00000110,
+};
+
+static int bench_aot_9(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    frame->data.call.ip = code + 2;
+    if (UNLIKELY(!make_fixnum(&regs[2], 0, S->thread, frame))) {
+        S->ip = code + 2;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    if (!depth) {
+        S->ip = code + 4;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "inner" */
+static const instr_t bench_aot_code_10[] = {
+    0x00010002, 0x00000010,
+};
+
+static int bench_aot_10(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    val_t r0;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    r0 = regs[0];
+    switch (S->ip - code) {
+      case 0: goto L0;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    r0 = func->upvals[1];
+    if (!depth) {
+        regs[0] = r0;
+        S->ip = code + 1;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = r0;
+    return 1;
+}
+
+/* "closure-create" */
+static const instr_t bench_aot_code_11[] = {
+    0x00000002, 0x00000102, 0x00000214, 0x00000214, 0x00000214, 0x00000214,
+    0x00000214, 0x00000214, 0x00000214, 0x00000214, 0x00000214, 0x00000214,
+    0x00000214, 0x00000214, 0x00000214, 0x00000214, 0x00000214, 0x00000214,
+    0x00000210,
+};
+
+static int bench_aot_11(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[0];
+    S->ip = code + 2;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 3;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 4;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 5;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 6;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 7;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 8;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 9;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 10;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 11;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 12;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 13;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 14;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 15;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 16;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    S->ip = code + 17;
+    if (UNLIKELY(!eris_aot_close(S, 2, 0)))
+        return AOT_EXIT;
+    AOT_COUNT(OP_CLOSE);
+    if (!depth) {
+        S->ip = code + 18;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[2];
+    return 1;
+}
+
+/* "cell-load" */
+static const instr_t bench_aot_code_12[] = {
+    0x00000003, 0x00000003, 0x00000003, 0x00000003, 0x00000003, 0x00000003,
+    0x00000003, 0x00000003, 0x00000003, 0x00000003, 0x00000003, 0x00000003,
+    0x00000003, 0x00000003, 0x00000003, 0x00000003, 0x00000010,
+};
+
+static int bench_aot_12(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    val_t r0;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    r0 = regs[0];
+    switch (S->ip - code) {
+      case 0: goto L0;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    AOT_COUNT(OP_LOAD_CELL);
+    r0 = deref_cell(get_cell(func->upvals[0]));
+    if (!depth) {
+        regs[0] = r0;
+        S->ip = code + 16;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = r0;
+    return 1;
+}
+
+/* "global-load" */
+static const instr_t bench_aot_code_13[] = {
+    0x00000004, 0x00000004, 0x00000004, 0x00000004, 0x00000004, 0x00000004,
+    0x00000004, 0x00000004, 0x00000004, 0x00000004, 0x00000004, 0x00000004,
+    0x00000004, 0x00000004, 0x00000004, 0x00000004, 0x00000010,
+};
+
+static int bench_aot_13(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    val_t r0;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    r0 = regs[0];
+    switch (S->ip - code) {
+      case 0: goto L0;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    AOT_COUNT(OP_LOAD_GLOBAL);
+    r0 = deref_cell(&S->globals[0]);
+    if (!depth) {
+        regs[0] = r0;
+        S->ip = code + 16;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = r0;
+    return 1;
+}
+
+/* "seq-build" */
+static const instr_t bench_aot_code_14[] = {
+    0x00000002, 0x00010102, 0x00010202, 0x00010302, 0x00010402, 0x00010502,
+    0x00010602, 0x00010702, 0x00010802, 0x08010006, 0x08010006, 0x08010006,
+    0x08010006, 0x08010006, 0x08010006, 0x08010006, 0x08010006, 0x08010006,
+    0x08010006, 0x08010006, 0x08010006, 0x08010006, 0x08010006, 0x08010006,
+    0x08010006, 0x00000110,
+};
+
+static int bench_aot_14(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 10: goto L10;
+      case 11: goto L11;
+      case 12: goto L12;
+      case 13: goto L13;
+      case 14: goto L14;
+      case 15: goto L15;
+      case 16: goto L16;
+      case 17: goto L17;
+      case 18: goto L18;
+      case 19: goto L19;
+      case 20: goto L20;
+      case 21: goto L21;
+      case 22: goto L22;
+      case 23: goto L23;
+      case 24: goto L24;
+      case 25: goto L25;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[3] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[4] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[5] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[6] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[7] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[8] = func->upvals[1];
+    S->ip = code + 9;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L10:
+    S->ip = code + 10;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L11:
+    S->ip = code + 11;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L12:
+    S->ip = code + 12;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L13:
+    S->ip = code + 13;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L14:
+    S->ip = code + 14;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L15:
+    S->ip = code + 15;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L16:
+    S->ip = code + 16;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L17:
+    S->ip = code + 17;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L18:
+    S->ip = code + 18;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L19:
+    S->ip = code + 19;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L20:
+    S->ip = code + 20;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L21:
+    S->ip = code + 21;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L22:
+    S->ip = code + 22;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L23:
+    S->ip = code + 23;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L24:
+    S->ip = code + 24;
+    status = eris_aot_invoke(S, regs[0], 1, 8, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L25:
+    if (!depth) {
+        S->ip = code + 25;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "nil-branch" */
+static const instr_t bench_aot_code_15[] = {
+    0x00000002, 0x00010102, 0x00000012, 0x0001000f, 0x00000013, 0x0001000f,
+    0x00000112, 0x0001000f, 0x00000113, 0x0001000f, 0x00000012, 0x0001000f,
+    0x00000013, 0x0001000f, 0x00000112, 0x0001000f, 0x00000113, 0x0001000f,
+    0x00000012, 0x0001000f, 0x00000013, 0x0001000f, 0x00000112, 0x0001000f,
+    0x00000113, 0x0001000f, 0x00000012, 0x0001000f, 0x00000013, 0x0001000f,
+    0x00000112, 0x0001000f, 0x00000113, 0x0001000f, 0x00000010,
+};
+
+static int bench_aot_15(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    val_t r0, r1;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    r0 = regs[0];
+    r1 = regs[1];
+    switch (S->ip - code) {
+      case 0: goto L0;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    r0 = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    r1 = func->upvals[1];
+    AOT_COUNT(OP_IF);
+    if (!VAL_IS_NIL(r0))
+        goto L4;
+    goto L4;
+  L4:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(r0))
+        goto L6;
+    goto L6;
+  L6:
+    AOT_COUNT(OP_IF);
+    if (!VAL_IS_NIL(r1))
+        goto L8;
+    goto L8;
+  L8:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(r1))
+        goto L10;
+    goto L10;
+  L10:
+    AOT_COUNT(OP_IF);
+    if (!VAL_IS_NIL(r0))
+        goto L12;
+    goto L12;
+  L12:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(r0))
+        goto L14;
+    goto L14;
+  L14:
+    AOT_COUNT(OP_IF);
+    if (!VAL_IS_NIL(r1))
+        goto L16;
+    goto L16;
+  L16:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(r1))
+        goto L18;
+    goto L18;
+  L18:
+    AOT_COUNT(OP_IF);
+    if (!VAL_IS_NIL(r0))
+        goto L20;
+    goto L20;
+  L20:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(r0))
+        goto L22;
+    goto L22;
+  L22:
+    AOT_COUNT(OP_IF);
+    if (!VAL_IS_NIL(r1))
+        goto L24;
+    goto L24;
+  L24:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(r1))
+        goto L26;
+    goto L26;
+  L26:
+    AOT_COUNT(OP_IF);
+    if (!VAL_IS_NIL(r0))
+        goto L28;
+    goto L28;
+  L28:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(r0))
+        goto L30;
+    goto L30;
+  L30:
+    AOT_COUNT(OP_IF);
+    if (!VAL_IS_NIL(r1))
+        goto L32;
+    goto L32;
+  L32:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(r1))
+        goto L34;
+    goto L34;
+  L34:
+    if (!depth) {
+        regs[0] = r0;
+        regs[1] = r1;
+        S->ip = code + 34;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = r0;
+    return 1;
+}
+
+/* "str-nth" */
+static const instr_t bench_aot_code_16[] = {
+    0x00000002, 0x00020102, 0x00010202, 0x02010006, 0x00030102, 0x00010202,
+    0x02010006, 0x00040102, 0x00010202, 0x02010006, 0x00050102, 0x00010202,
+    0x02010006, 0x00060102, 0x00010202, 0x02010006, 0x00070102, 0x00010202,
+    0x02010006, 0x00080102, 0x00010202, 0x02010006, 0x00090102, 0x00010202,
+    0x02010006, 0x000a0102, 0x00010202, 0x02010006, 0x000b0102, 0x00010202,
+    0x02010006, 0x000c0102, 0x00010202, 0x02010006, 0x000d0102, 0x00010202,
+    0x02010006, 0x000e0102, 0x00010202, 0x02010006, 0x000f0102, 0x00010202,
+    0x02010006, 0x00100102, 0x00010202, 0x02010006, 0x00110102, 0x00010202,
+    0x02010006, 0x00000110,
+};
+
+static int bench_aot_16(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      case 7: goto L7;
+      case 10: goto L10;
+      case 13: goto L13;
+      case 16: goto L16;
+      case 19: goto L19;
+      case 22: goto L22;
+      case 25: goto L25;
+      case 28: goto L28;
+      case 31: goto L31;
+      case 34: goto L34;
+      case 37: goto L37;
+      case 40: goto L40;
+      case 43: goto L43;
+      case 46: goto L46;
+      case 49: goto L49;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[3];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 6;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L7:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[4];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 9;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L10:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[5];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 12;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L13:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[6];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 15;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L16:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[7];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 18;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L19:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[8];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 21;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L22:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[9];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 24;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L25:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[10];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 27;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L28:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[11];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 30;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L31:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[12];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 33;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L34:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[13];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 36;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L37:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[14];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 39;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L40:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[15];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 42;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L43:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[16];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 45;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L46:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[17];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 48;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L49:
+    if (!depth) {
+        S->ip = code + 49;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "bignum-add" */
+static const instr_t bench_aot_code_17[] = {
+    0x00000002, 0x00010102, 0x00010202, 0x02010006, 0x00010102, 0x00010202,
+    0x02010006, 0x00010102, 0x00010202, 0x02010006, 0x00010102, 0x00010202,
+    0x02010006, 0x00010102, 0x00010202, 0x02010006, 0x00010102, 0x00010202,
+    0x02010006, 0x00010102, 0x00010202, 0x02010006, 0x00010102, 0x00010202,
+    0x02010006, 0x00010102, 0x00010202, 0x02010006, 0x00010102, 0x00010202,
+    0x02010006, 0x00010102, 0x00010202, 0x02010006, 0x00010102, 0x00010202,
+    0x02010006, 0x00010102, 0x00010202, 0x02010006, 0x00010102, 0x00010202,
+    0x02010006, 0x00010102, 0x00010202, 0x02010006, 0x00010102, 0x00010202,
+    0x02010006, 0x00000110,
+};
+
+static int bench_aot_17(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      case 7: goto L7;
+      case 10: goto L10;
+      case 13: goto L13;
+      case 16: goto L16;
+      case 19: goto L19;
+      case 22: goto L22;
+      case 25: goto L25;
+      case 28: goto L28;
+      case 31: goto L31;
+      case 34: goto L34;
+      case 37: goto L37;
+      case 40: goto L40;
+      case 43: goto L43;
+      case 46: goto L46;
+      case 49: goto L49;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 6;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L7:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 9;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L10:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 12;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L13:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 15;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L16:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 18;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L19:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 21;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L22:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 24;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L25:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 27;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L28:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 30;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L31:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 33;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L34:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 36;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L37:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 39;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L40:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 42;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L43:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 45;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L46:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    S->ip = code + 48;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L49:
+    if (!depth) {
+        S->ip = code + 49;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "alloc-churn" */
+static const instr_t bench_aot_code_18[] = {
+    0x00000001, 0x00010001, 0x00020001, 0x00030001, 0x00040001, 0x00050001,
+    0x00060001, 0x00070001, 0x00080001, 0x00090001, 0x000a0001, 0x000b0001,
+    0x000c0001, 0x000d0001, 0x000e0001, 0x000f0001, 0x00000010,
+};
+
+static int bench_aot_18(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    val_t r0;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    r0 = regs[0];
+    switch (S->ip - code) {
+      case 0: goto L0;
+      default: return AOT_EXIT;
+    }
+  L0:
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 0;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 0, S->thread, frame))) {
+        S->ip = code + 0;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 1;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 1, S->thread, frame))) {
+        S->ip = code + 1;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 2;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 2, S->thread, frame))) {
+        S->ip = code + 2;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 3;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 3, S->thread, frame))) {
+        S->ip = code + 3;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 4;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 4, S->thread, frame))) {
+        S->ip = code + 4;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 5;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 5, S->thread, frame))) {
+        S->ip = code + 5;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 6;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 6, S->thread, frame))) {
+        S->ip = code + 6;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 7;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 7, S->thread, frame))) {
+        S->ip = code + 7;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 8;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 8, S->thread, frame))) {
+        S->ip = code + 8;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 9;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 9, S->thread, frame))) {
+        S->ip = code + 9;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 10;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 10, S->thread, frame))) {
+        S->ip = code + 10;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 11;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 11, S->thread, frame))) {
+        S->ip = code + 11;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 12;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 12, S->thread, frame))) {
+        S->ip = code + 12;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 13;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 13, S->thread, frame))) {
+        S->ip = code + 13;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 14;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 14, S->thread, frame))) {
+        S->ip = code + 14;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (AOT_LOAD_INT_ALLOCATES) {
+        frame->data.call.ip = code + 15;
+        regs[0] = r0;
+    }
+    if (UNLIKELY(!make_fixnum(&r0, 15, S->thread, frame))) {
+        S->ip = code + 15;
+        return AOT_EXIT;
+    }
+    if (AOT_LOAD_INT_ALLOCATES) {
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    if (!depth) {
+        regs[0] = r0;
+        S->ip = code + 16;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = r0;
+    return 1;
+}
+
+/* "io-read-zero" */
+static const instr_t bench_aot_code_19[] = {
+    0x00000002, 0x00010102, 0x00020202, 0x02010006, 0x00010102, 0x00020202,
+    0x02010006, 0x00010102, 0x00020202, 0x02010006, 0x00010102, 0x00020202,
+    0x02010006, 0x00010102, 0x00020202, 0x02010006, 0x00010102, 0x00020202,
+    0x02010006, 0x00010102, 0x00020202, 0x02010006, 0x00010102, 0x00020202,
+    0x02010006, 0x00010102, 0x00020202, 0x02010006, 0x00010102, 0x00020202,
+    0x02010006, 0x00010102, 0x00020202, 0x02010006, 0x00010102, 0x00020202,
+    0x02010006, 0x00010102, 0x00020202, 0x02010006, 0x00010102, 0x00020202,
+    0x02010006, 0x00010102, 0x00020202, 0x02010006, 0x00010102, 0x00020202,
+    0x02010006, 0x00000110,
+};
+
+static int bench_aot_19(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      case 7: goto L7;
+      case 10: goto L10;
+      case 13: goto L13;
+      case 16: goto L16;
+      case 19: goto L19;
+      case 22: goto L22;
+      case 25: goto L25;
+      case 28: goto L28;
+      case 31: goto L31;
+      case 34: goto L34;
+      case 37: goto L37;
+      case 40: goto L40;
+      case 43: goto L43;
+      case 46: goto L46;
+      case 49: goto L49;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 6;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L7:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 9;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L10:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 12;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L13:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 15;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L16:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 18;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L19:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 21;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L22:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 24;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L25:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 27;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L28:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 30;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L31:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 33;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L34:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 36;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L37:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 39;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L40:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 42;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L43:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 45;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L46:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 48;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L49:
+    if (!depth) {
+        S->ip = code + 49;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "io-pipe-writer" */
+static const instr_t bench_aot_code_20[] = {
+    0x00000002, 0x00010102, 0x00020202, 0x02010006, 0x0000000e, 0x00000010,
+};
+
+static int bench_aot_20(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    if (eris_prof_due(S->thread) || UNLIKELY(S->thread->gc_pending)) {
+        S->ip = code + 4;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_TAILCALL_SELF0);
+    STAT(S->thread, closure_calls++);
+    STAT(S->thread, tail_calls++);
+    goto L0;
+    if (!depth) {
+        S->ip = code + 5;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[0];
+    return 1;
+}
+
+/* "fiber-child" */
+static const instr_t bench_aot_code_21[] = {
+    0x00000002, 0x00000010,
+};
+
+static int bench_aot_21(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    val_t r0;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    r0 = regs[0];
+    switch (S->ip - code) {
+      case 0: goto L0;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    r0 = func->upvals[0];
+    if (!depth) {
+        regs[0] = r0;
+        S->ip = code + 1;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = r0;
+    return 1;
+}
+
+/* "fiber-spawn-join" */
+static const instr_t bench_aot_code_22[] = {
+    0x00000002, 0x00020102, 0x01010006, 0x00010002, 0x01010006, 0x00000002,
+    0x00020102, 0x01010006, 0x00010002, 0x01010006, 0x00000002, 0x00020102,
+    0x01010006, 0x00010002, 0x01010006, 0x00000002, 0x00020102, 0x01010006,
+    0x00010002, 0x01010006, 0x00000002, 0x00020102, 0x01010006, 0x00010002,
+    0x01010006, 0x00000002, 0x00020102, 0x01010006, 0x00010002, 0x01010006,
+    0x00000002, 0x00020102, 0x01010006, 0x00010002, 0x01010006, 0x00000002,
+    0x00020102, 0x01010006, 0x00010002, 0x01010006, 0x00000002, 0x00020102,
+    0x01010006, 0x00010002, 0x01010006, 0x00000002, 0x00020102, 0x01010006,
+    0x00010002, 0x01010006, 0x00000002, 0x00020102, 0x01010006, 0x00010002,
+    0x01010006, 0x00000002, 0x00020102, 0x01010006, 0x00010002, 0x01010006,
+    0x00000002, 0x00020102, 0x01010006, 0x00010002, 0x01010006, 0x00000002,
+    0x00020102, 0x01010006, 0x00010002, 0x01010006, 0x00000002, 0x00020102,
+    0x01010006, 0x00010002, 0x01010006, 0x00000002, 0x00020102, 0x01010006,
+    0x00010002, 0x01010006, 0x00000110,
+};
+
+static int bench_aot_22(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 3: goto L3;
+      case 5: goto L5;
+      case 8: goto L8;
+      case 10: goto L10;
+      case 13: goto L13;
+      case 15: goto L15;
+      case 18: goto L18;
+      case 20: goto L20;
+      case 23: goto L23;
+      case 25: goto L25;
+      case 28: goto L28;
+      case 30: goto L30;
+      case 33: goto L33;
+      case 35: goto L35;
+      case 38: goto L38;
+      case 40: goto L40;
+      case 43: goto L43;
+      case 45: goto L45;
+      case 48: goto L48;
+      case 50: goto L50;
+      case 53: goto L53;
+      case 55: goto L55;
+      case 58: goto L58;
+      case 60: goto L60;
+      case 63: goto L63;
+      case 65: goto L65;
+      case 68: goto L68;
+      case 70: goto L70;
+      case 73: goto L73;
+      case 75: goto L75;
+      case 78: goto L78;
+      case 80: goto L80;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 2;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L3:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 4;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L5:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 7;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L8:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 9;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L10:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 12;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L13:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 14;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L15:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 17;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L18:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 19;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L20:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 22;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L23:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 24;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L25:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 27;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L28:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 29;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L30:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 32;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L33:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 34;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L35:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 37;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L38:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 39;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L40:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 42;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L43:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 44;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L45:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 47;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L48:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 49;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L50:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 52;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L53:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 54;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L55:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 57;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L58:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 59;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L60:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 62;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L63:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 64;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L65:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 67;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L68:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 69;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L70:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 72;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L73:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 74;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L75:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 77;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L78:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 79;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L80:
+    if (!depth) {
+        S->ip = code + 80;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "fiber-partner" */
+static const instr_t bench_aot_code_23[] = {
+    0x00000002, 0x00010006, 0x0000000e, 0x00000010,
+};
+
+static int bench_aot_23(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 2: goto L2;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    S->ip = code + 1;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L2:
+    if (eris_prof_due(S->thread) || UNLIKELY(S->thread->gc_pending)) {
+        S->ip = code + 2;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_TAILCALL_SELF0);
+    STAT(S->thread, closure_calls++);
+    STAT(S->thread, tail_calls++);
+    goto L0;
+    if (!depth) {
+        S->ip = code + 3;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[0];
+    return 1;
+}
+
+/* "fiber-yield" */
+static const instr_t bench_aot_code_24[] = {
+    0x00000002, 0x00010006, 0x00010006, 0x00010006, 0x00010006, 0x00010006,
+    0x00010006, 0x00010006, 0x00010006, 0x00010006, 0x00010006, 0x00010006,
+    0x00010006, 0x00010006, 0x00010006, 0x00010006, 0x00010006, 0x00000110,
+};
+
+static int bench_aot_24(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 2: goto L2;
+      case 3: goto L3;
+      case 4: goto L4;
+      case 5: goto L5;
+      case 6: goto L6;
+      case 7: goto L7;
+      case 8: goto L8;
+      case 9: goto L9;
+      case 10: goto L10;
+      case 11: goto L11;
+      case 12: goto L12;
+      case 13: goto L13;
+      case 14: goto L14;
+      case 15: goto L15;
+      case 16: goto L16;
+      case 17: goto L17;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    S->ip = code + 1;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L2:
+    S->ip = code + 2;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L3:
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    S->ip = code + 4;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L5:
+    S->ip = code + 5;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L6:
+    S->ip = code + 6;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L7:
+    S->ip = code + 7;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L8:
+    S->ip = code + 8;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L9:
+    S->ip = code + 9;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L10:
+    S->ip = code + 10;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L11:
+    S->ip = code + 11;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L12:
+    S->ip = code + 12;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L13:
+    S->ip = code + 13;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L14:
+    S->ip = code + 14;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L15:
+    S->ip = code + 15;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L16:
+    S->ip = code + 16;
+    status = eris_aot_invoke(S, regs[0], 1, 0, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L17:
+    if (!depth) {
+        S->ip = code + 17;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "fib" */
+static const instr_t bench_aot_code_25[] = {
+    0x00000102, 0x00000200, 0x00040302, 0x02020106, 0x00000213, 0x0014000f,
+    0x00000200, 0x00050302, 0x02020106, 0x00000213, 0x000f000f, 0x00010102,
+    0x00000300, 0x00050402, 0x02030106, 0x00080202, 0x01030206, 0x00000500,
+    0x00060602, 0x02050106, 0x01050206, 0x00050400, 0x00020202, 0x02030206,
+    0x00000310, 0x00000010,
+};
+
+static int bench_aot_25(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      case 9: goto L9;
+      case 15: goto L15;
+      case 17: goto L17;
+      case 20: goto L20;
+      case 21: goto L21;
+      case 24: goto L24;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[0];
+    AOT_COUNT(OP_MOVE);
+    regs[2] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[3] = func->upvals[4];
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[1], 2, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(regs[2]))
+        goto L6;
+    goto L25;
+  L6:
+    AOT_COUNT(OP_MOVE);
+    regs[2] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[3] = func->upvals[5];
+    S->ip = code + 8;
+    status = eris_aot_invoke(S, regs[1], 2, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L9:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(regs[2]))
+        goto L11;
+    goto L25;
+  L11:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[1];
+    AOT_COUNT(OP_MOVE);
+    regs[3] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[4] = func->upvals[5];
+    S->ip = code + 14;
+    status = eris_aot_invoke(S, regs[1], 3, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L15:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[8];
+    S->ip = code + 16;
+    status = eris_aot_invoke(S, regs[2], 3, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L17:
+    AOT_COUNT(OP_MOVE);
+    regs[5] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[6] = func->upvals[6];
+    S->ip = code + 19;
+    status = eris_aot_invoke(S, regs[1], 5, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L20:
+    S->ip = code + 20;
+    status = eris_aot_invoke(S, regs[2], 5, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L21:
+    AOT_COUNT(OP_MOVE);
+    regs[4] = regs[5];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    S->ip = code + 23;
+    status = eris_aot_invoke(S, regs[2], 3, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L24:
+    if (!depth) {
+        S->ip = code + 24;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[3];
+    return 1;
+  L25:
+    if (!depth) {
+        S->ip = code + 25;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[0];
+    return 1;
+}
+
+/* "fib-main" */
+static const instr_t bench_aot_code_26[] = {
+    0x00000002, 0x00140101, 0x01010006, 0x00000110,
+};
+
+static int bench_aot_26(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 3: goto L3;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    frame->data.call.ip = code + 1;
+    if (UNLIKELY(!make_fixnum(&regs[1], 20, S->thread, frame))) {
+        S->ip = code + 1;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    S->ip = code + 2;
+    status = eris_aot_invoke(S, regs[0], 1, 1, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L3:
+    if (!depth) {
+        S->ip = code + 3;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "ack" */
+static const instr_t bench_aot_code_27[] = {
+    0x00000202, 0x00000300, 0x00040402, 0x02030206, 0x00000313, 0x0012000f,
+    0x00010300, 0x02030206, 0x00000313, 0x0013000f, 0x00010202, 0x00010400,
+    0x00050502, 0x02040206, 0x00000300, 0x00080602, 0x02030606, 0x00000400,
+    0x00050502, 0x02040206, 0x00030500, 0x0204000d, 0x00000010, 0x00020202,
+    0x00010300, 0x00050402, 0x02030206, 0x00000310, 0x00010202, 0x00000300,
+    0x00050402, 0x02030206, 0x0203000d, 0x00000010,
+};
+
+static int bench_aot_27(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      case 8: goto L8;
+      case 14: goto L14;
+      case 17: goto L17;
+      case 20: goto L20;
+      case 27: goto L27;
+      case 32: goto L32;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[0];
+    AOT_COUNT(OP_MOVE);
+    regs[3] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[4] = func->upvals[4];
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[2], 3, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(regs[3]))
+        goto L6;
+    goto L23;
+  L6:
+    AOT_COUNT(OP_MOVE);
+    regs[3] = regs[1];
+    S->ip = code + 7;
+    status = eris_aot_invoke(S, regs[2], 3, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L8:
+    AOT_COUNT(OP_IFNOT);
+    if (VAL_IS_NIL(regs[3]))
+        goto L10;
+    goto L28;
+  L10:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    AOT_COUNT(OP_MOVE);
+    regs[4] = regs[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[5] = func->upvals[5];
+    S->ip = code + 13;
+    status = eris_aot_invoke(S, regs[2], 4, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L14:
+    AOT_COUNT(OP_MOVE);
+    regs[3] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[6] = func->upvals[8];
+    S->ip = code + 16;
+    status = eris_aot_invoke(S, regs[6], 3, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L17:
+    AOT_COUNT(OP_MOVE);
+    regs[4] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[5] = func->upvals[5];
+    S->ip = code + 19;
+    status = eris_aot_invoke(S, regs[2], 4, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L20:
+    AOT_COUNT(OP_MOVE);
+    regs[5] = regs[3];
+    if (eris_prof_due(S->thread) || UNLIKELY(S->thread->gc_pending)) {
+        S->ip = code + 21;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_TAILCALL_SELF);
+    STAT(S->thread, closure_calls++);
+    STAT(S->thread, tail_calls++);
+    memmove(regs, regs + 4, sizeof(val_t) * 2);
+    goto L0;
+    if (!depth) {
+        S->ip = code + 22;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[0];
+    return 1;
+  L23:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[2];
+    AOT_COUNT(OP_MOVE);
+    regs[3] = regs[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[4] = func->upvals[5];
+    S->ip = code + 26;
+    status = eris_aot_invoke(S, regs[2], 3, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L27:
+    if (!depth) {
+        S->ip = code + 27;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[3];
+    return 1;
+  L28:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[1];
+    AOT_COUNT(OP_MOVE);
+    regs[3] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[4] = func->upvals[5];
+    S->ip = code + 31;
+    status = eris_aot_invoke(S, regs[2], 3, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L32:
+    if (eris_prof_due(S->thread) || UNLIKELY(S->thread->gc_pending)) {
+        S->ip = code + 32;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_TAILCALL_SELF);
+    STAT(S->thread, closure_calls++);
+    STAT(S->thread, tail_calls++);
+    memmove(regs, regs + 3, sizeof(val_t) * 2);
+    goto L0;
+    if (!depth) {
+        S->ip = code + 33;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[0];
+    return 1;
+}
+
+/* "ack-main" */
+static const instr_t bench_aot_code_28[] = {
+    0x00000002, 0x00020101, 0x00320201, 0x02010006, 0x00000110,
+};
+
+static int bench_aot_28(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    frame->data.call.ip = code + 1;
+    if (UNLIKELY(!make_fixnum(&regs[1], 2, S->thread, frame))) {
+        S->ip = code + 1;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    frame->data.call.ip = code + 2;
+    if (UNLIKELY(!make_fixnum(&regs[2], 50, S->thread, frame))) {
+        S->ip = code + 2;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_LOAD_INT);
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    if (!depth) {
+        S->ip = code + 4;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[1];
+    return 1;
+}
+
+/* "inc" */
+static const instr_t bench_aot_code_29[] = {
+    0x00000102, 0x00000200, 0x00010302, 0x02020106, 0x00000210,
+};
+
+static int bench_aot_29(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[0];
+    AOT_COUNT(OP_MOVE);
+    regs[2] = regs[0];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[3] = func->upvals[1];
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[1], 2, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    if (!depth) {
+        S->ip = code + 4;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[2];
+    return 1;
+}
+
+/* "seq-pipeline-1000" */
+static const instr_t bench_aot_code_30[] = {
+    0x00050102, 0x00060202, 0x00000002, 0x02010006, 0x00010300, 0x00060202,
+    0x00010002, 0x02020006, 0x00020400, 0x00030202, 0x00040302, 0x00020002,
+    0x03020006, 0x00000210,
+};
+
+static int bench_aot_30(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      case 8: goto L8;
+      case 13: goto L13;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[5];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[6];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[0];
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[0], 1, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    AOT_COUNT(OP_MOVE);
+    regs[3] = regs[1];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[6];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[1];
+    S->ip = code + 7;
+    status = eris_aot_invoke(S, regs[0], 2, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L8:
+    AOT_COUNT(OP_MOVE);
+    regs[4] = regs[2];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[3];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[3] = func->upvals[4];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[0] = func->upvals[2];
+    S->ip = code + 12;
+    status = eris_aot_invoke(S, regs[0], 2, 3, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L13:
+    if (!depth) {
+        S->ip = code + 13;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[2];
+    return 1;
+}
+
+/* "seq-nested-row" */
+static const instr_t bench_aot_code_31[] = {
+    0x00050202, 0x00060302, 0x00000102, 0x02020106, 0x00020400, 0x00030202,
+    0x00040302, 0x00020102, 0x03020106, 0x00000210,
+};
+
+static int bench_aot_31(vm_state_t *S, unsigned depth)
+{
+    val_t *const regs = S->regs;
+    closure_t *const func = S->func;
+    frame_t *const frame = S->frame;
+    instr_t *const code = func->proto->code;
+    int status;
+    (void) regs, (void) func, (void) frame, (void) depth;
+    switch (S->ip - code) {
+      case 0: goto L0;
+      case 4: goto L4;
+      case 9: goto L9;
+      default: return AOT_EXIT;
+    }
+  L0:
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[5];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[3] = func->upvals[6];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[0];
+    S->ip = code + 3;
+    status = eris_aot_invoke(S, regs[1], 2, 2, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L4:
+    AOT_COUNT(OP_MOVE);
+    regs[4] = regs[2];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[2] = func->upvals[3];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[3] = func->upvals[4];
+    AOT_COUNT(OP_LOAD_UPVAL);
+    regs[1] = func->upvals[2];
+    S->ip = code + 8;
+    status = eris_aot_invoke(S, regs[1], 2, 3, 1, false, depth);
+    if (status != AOT_DONE)
+        return status;
+  L9:
+    if (!depth) {
+        S->ip = code + 9;
+        return AOT_EXIT;
+    }
+    AOT_COUNT(OP_RETURN);
+    regs[0] = regs[2];
+    return 1;
+}
+
+static const struct eris_aot_entry bench_aot_entries[] = {
+    { "id", bench_aot_code_0, 1, 1, 1, bench_aot_0 },
+    { "call-return", bench_aot_code_1, 19, 0, 2, bench_aot_1 },
+    { "call-n-unverified", bench_aot_code_2, 23, 0, 4, bench_aot_2 },
+    { "loop", bench_aot_code_3, 13, 1, 4, bench_aot_3 },
+    { "tail-call-loop", bench_aot_code_4, 4, 0, 2, bench_aot_4 },
+    { "jump-loop", bench_aot_code_5, 13, 1, 5, bench_aot_5 },
+    { "float-loop", bench_aot_code_6, 17, 2, 6, bench_aot_6 },
+    { "float-main", bench_aot_code_7, 5, 0, 3, bench_aot_7 },
+    { "walk", bench_aot_code_8, 17, 2, 7, bench_aot_8 },
+    { "walk-main", bench_aot_code_9, 5, 0, 3, bench_aot_9 },
+    { "inner", bench_aot_code_10, 2, 0, 1, bench_aot_10 },
+    { "closure-create", bench_aot_code_11, 19, 0, 3, bench_aot_11 },
+    { "cell-load", bench_aot_code_12, 17, 0, 1, bench_aot_12 },
+    { "global-load", bench_aot_code_13, 17, 0, 1, bench_aot_13 },
+    { "seq-build", bench_aot_code_14, 26, 0, 9, bench_aot_14 },
+    { "nil-branch", bench_aot_code_15, 35, 0, 2, bench_aot_15 },
+    { "str-nth", bench_aot_code_16, 50, 0, 3, bench_aot_16 },
+    { "bignum-add", bench_aot_code_17, 50, 0, 3, bench_aot_17 },
+    { "alloc-churn", bench_aot_code_18, 17, 0, 1, bench_aot_18 },
+    { "io-read-zero", bench_aot_code_19, 50, 0, 3, bench_aot_19 },
+    { "io-pipe-writer", bench_aot_code_20, 6, 0, 3, bench_aot_20 },
+    { "fiber-child", bench_aot_code_21, 2, 0, 1, bench_aot_21 },
+    { "fiber-spawn-join", bench_aot_code_22, 81, 0, 2, bench_aot_22 },
+    { "fiber-partner", bench_aot_code_23, 4, 0, 2, bench_aot_23 },
+    { "fiber-yield", bench_aot_code_24, 18, 0, 2, bench_aot_24 },
+    { "fib", bench_aot_code_25, 26, 1, 7, bench_aot_25 },
+    { "fib-main", bench_aot_code_26, 4, 0, 2, bench_aot_26 },
+    { "ack", bench_aot_code_27, 34, 2, 7, bench_aot_27 },
+    { "ack-main", bench_aot_code_28, 5, 0, 3, bench_aot_28 },
+    { "inc", bench_aot_code_29, 5, 1, 4, bench_aot_29 },
+    { "seq-pipeline-1000", bench_aot_code_30, 14, 0, 5, bench_aot_30 },
+    { "seq-nested-row", bench_aot_code_31, 10, 1, 5, bench_aot_31 },
+};
+
+__attribute__((constructor))
+static void bench_aot_register(void)
+{
+    eris_aot_register(bench_aot_entries, 32, AOT_ABI);
+}
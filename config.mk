@@ -10,6 +10,9 @@ CC=gcc
 CPP=$(CC) -E
 CCLD=$(CC)
 CFLAGS+= -std=c99 -Wall -Wextra -Werror -Wswitch-enum -Wswitch-default -pipe
+# Only the API in include/eris/eris.h gets exported from liberis (see
+# ERIS_API_BEGIN), so the compiler's free to inline and specialize the rest.
+CFLAGS+= -fvisibility=hidden
 # LIBS is defined in Makefile.
 LDLIBS+= $(addprefix -l,$(LIBS))
 
@@ -27,9 +30,22 @@ else
 CFLAGS_DEBUG= -O0 -g
 endif
 CFLAGS_RELEASE= -O3 -fomit-frame-pointer -DNDEBUG -DERIS_RELEASE
+# Release, plus link-time optimization and profile feedback. main.mk first
+# builds an instrumented copy of the benchmark suite, runs it, and then builds
+# everything using the profiles it wrote. Profiles go in the build directory,
+# so they're kept apart per compiler and flags like everything else. Code the
+# benchmarks never run (eg. rvmi) just goes without.
+PGO_USE_FLAGS= -flto=auto -ffat-lto-objects -fprofile-use \
+	-fprofile-partial-training -Wno-missing-profile
+CFLAGS_PGO= $(CFLAGS_RELEASE) $(PGO_USE_FLAGS)
 # feel free to mess around with this one.
 CFLAGS_CUSTOM=
 
+# For liberis.so's objects. Calls between eris' own functions needn't go
+# through the PLT, since we don't support interposing them; this also keeps
+# them compiling the same as the static library's, profile and all.
+PIC_CFLAGS= -fPIC -fno-semantic-interposition
+
 # Default to debug.
 ifeq (,$(MODE))
 MODE=debug
@@ -39,6 +55,13 @@ ifeq (debug,$(MODE))
 CFLAGS+= $(CFLAGS_DEBUG)
 else ifeq (release,$(MODE))
 CFLAGS+= $(CFLAGS_RELEASE)
+else ifeq (pgo,$(MODE))
+ifneq (gcc,$(CC))
+$(error "MODE=pgo only knows gcc's profiling flags")
+endif
+CFLAGS+= $(CFLAGS_PGO)
+LDFLAGS+= -flto=auto
+AR=gcc-ar
 else ifeq (custom,$(MODE))
 CFLAGS+= $(CFLAGS_CUSTOM)
 else
@@ -47,6 +70,60 @@ endif
 
 BUILD_NAME=$(MODE)-$(CC)
 
+
+# Runtime statistics (see eris_stats_snapshot in eris.h). On by default only in
+# debug builds; release builds compile them out.
+ifeq (debug,$(MODE))
+STATS?=1
+else
+STATS?=0
+endif
+
+ifeq (1,$(STATS))
+CFLAGS+= -DERIS_STATS
+endif
+
+
+# Value representation (see src/types.h). NANBOX=1 packs doubles, fixnums and
+# nil into the values themselves instead of boxing them; it needs a 64-bit
+# target.
+NANBOX?=0
+
+ifeq (1,$(NANBOX))
+CFLAGS+= -DERIS_NANBOX
+endif
+
+# NIL_NULL=1 makes nil the null pointer, rather than a pointer to a static
+# object; `make bench' compares the two. NaN-boxing has its own nil.
+NIL_NULL?=0
+
+ifeq (1,$(NIL_NULL))
+ifeq (1,$(NANBOX))
+$(error "NIL_NULL=1 and NANBOX=1 don't mix")
+endif
+CFLAGS+= -DERIS_NIL_NULL
+endif
+
+
+# The template JIT (see src/jit.h) only knows x86-64. Set JIT=0 to disable it.
+ifeq (x86_64,$(shell uname -m))
+JIT?=1
+else
+JIT?=0
+endif
+
+ifeq (1,$(JIT))
+CFLAGS+= -DERIS_JIT
+GENFILE_NAMES+= include/jit_stencils.h
+endif
+
+# Stencils must reference holes and symbols by 64-bit absolute address, and
+# mustn't use anything jitgen can't relocate: PC-relative references, jump
+# tables, unwind tables, stack protectors, or code split into other sections.
+STENCIL_CFLAGS= -O2 -DNDEBUG -mcmodel=large -fno-pic -ffunction-sections \
+	-fno-asynchronous-unwind-tables -fno-stack-protector -fcf-protection=none \
+	-fno-jump-tables -fno-reorder-blocks-and-partition -fomit-frame-pointer
+
 
 # Uncomment the following to build with clang. clang produces nicer error
 # messages, but forfeits the ability to use macros inside gdb.
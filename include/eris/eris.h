@@ -8,6 +8,8 @@
 
 #include <eris/portability.h>
 
+ERIS_API_BEGIN
+
 typedef struct eris_vm eris_vm_t;
 /* TODO: better name? */
 typedef struct eris_thread eris_thread_t;
@@ -36,7 +38,130 @@ void eris_frame_end(eris_frame_t *frame);
 eris_thread_t *eris_frame_thread(eris_frame_t *frame);
 eris_vm_t *eris_thread_vm(eris_thread_t *thread);
 
+/* Tunes the parallel builtins (seq-from-fn, seq-map, seq-reduce). They may
+ * spread work over up to `workers' OS threads besides the calling one, and run
+ * serially on inputs shorter than `cutoff'. `workers' = 0 disables parallelism
+ * entirely. Don't call this while eris code is running on `vm'.
+ */
+void eris_vm_set_parallelism(eris_vm_t *vm, size_t workers, size_t cutoff);
+
+/* A sampling profiler for eris code. While it runs, whichever eris code is
+ * running on `vm' is sampled about `hz' times per second of CPU time. It uses
+ * SIGPROF and ITIMER_PROF, so don't use those yourself meanwhile. Profilers
+ * running on several VMs at once share the timer, at the rate the first of them
+ * asked for, and so its samples. Returns false on failure.
+ */
+bool eris_prof_start(eris_vm_t *vm, unsigned hz);
+void eris_prof_stop(eris_vm_t *vm);
+/* Writes the samples taken so far in the "collapsed stack" format that
+ * flamegraph tools read: one line per distinct stack, giving its frames root
+ * first and separated by `;', then a space and the number of samples. Frames
+ * are written as NAME+PC, where NAME is the function's name (or its proto's
+ * address, if it has none) and PC the offset of its current instruction. */
+void eris_prof_dump(eris_vm_t *vm, FILE *out);
+/* Discards the samples taken so far. */
+void eris_prof_reset(eris_vm_t *vm);
+
+
+/* The garbage collector, which frees what eris code and this API allocate once
+ * nothing refers to it. It works incrementally: once the heap has grown
+ * `growth_percent' past what the last collection left, the next starts at the
+ * next safe point in eris code, or call to this API that allocates; then each
+ * time a thread has allocated another `step_bytes', it does a step of marking
+ * or sweeping, worth `work_percent' of that, or `max_pause_ns' nanoseconds if
+ * that's nonzero and comes first. Small steps and a low cap keep pauses short;
+ * large ones cost less overall. Two pauses aren't capped: starting a
+ * collection scans the registers of the thread that starts it, all at once;
+ * and a thread about to go past `hard_limit' (below) first finishes the
+ * collection under way, however long that takes.
+ *
+ * The heap's size can be limited too, to bound what an untrusted program can
+ * take. Once it reaches `soft_limit' bytes, a collection starts as soon as it
+ * can, however little the heap's grown. Allocation past `hard_limit' bytes
+ * fails once finishing the collection under way, if any, doesn't free enough:
+ * eris code then raises, which fails the eris_call that ran it, and the API
+ * functions that push values fail. Threads claim the heap `step_bytes' at a
+ * time, so that may happen with up to that much per other thread unused. A
+ * hard limit of 0 means none; a soft limit of 0, half the hard one.
+ *
+ * The heap counts objects, and what they own outside it: bignums' digits,
+ * strings' indexes, and a page or two of each unfinished fiber's stack; and
+ * the buffers of reads under way. It doesn't count the rest of a fiber's stack
+ * that runs deep, or GMP's scratch space, which bignum arithmetic bounds by
+ * failing on results over 2^28 bits.
+ */
+typedef struct {
+    size_t step_bytes;
+    unsigned work_percent;
+    unsigned growth_percent;
+    uint64_t max_pause_ns;
+    size_t soft_limit, hard_limit;
+} eris_gc_config_t;
+
+void eris_gc_get_config(eris_vm_t *vm, eris_gc_config_t *out);
+/* Don't call this while eris code is running on `vm'. */
+void eris_gc_set_config(eris_vm_t *vm, const eris_gc_config_t *config);
+
+/* Pauses are counted by the base-2 logarithm of their length: bucket i of the
+ * histogram counts those of 2^i to 2^(i+1) nanoseconds, the last any longer. */
+#define ERIS_GC_PAUSE_BUCKETS 32
+
+typedef struct {
+    uint64_t cycles;            /* collections finished */
+    uint64_t pauses;            /* steps, and starts of collections */
+    uint64_t pause_ns_total, pause_ns_max;
+    uint64_t pause_hist[ERIS_GC_PAUSE_BUCKETS];
+    uint64_t freed_bytes;
+    uint64_t limit_failures;    /* allocations failed at the hard limit */
+    size_t heap_bytes;          /* allocated and not yet freed */
+    size_t peak_bytes;          /* the most heap_bytes has been, or claimed */
+    size_t live_bytes;          /* what the last collection left */
+} eris_gc_stats_t;
+
+/* Counts from threads running meanwhile may be slightly stale. */
+void eris_gc_stats(eris_vm_t *vm, eris_gc_stats_t *out);
+/* Writes `stats' to `out', one counter or histogram bucket per line. */
+void eris_gc_stats_print(const eris_gc_stats_t *stats, FILE *out);
+/* Finishes the collection under way, if any, and then does a whole one at
+ * once; or only the former, if eris code is running on `S's VM. */
+void eris_gc_collect(eris_frame_t *S);
+
 
+/* Runtime statistics. These are only gathered by builds with STATS=1 (the
+ * default for debug builds; see config.mk); release builds compile the
+ * counters out completely.
+ */
+typedef enum {
+    ERIS_SHAPE_NIL, ERIS_SHAPE_NUM, ERIS_SHAPE_BUILTIN, ERIS_SHAPE_PROTO,
+    ERIS_SHAPE_CLOSURE, ERIS_SHAPE_C_CLOSURE, ERIS_SHAPE_STRING,
+    ERIS_SHAPE_SEQ, ERIS_SHAPE_VEC, ERIS_SHAPE_SYMBOL, ERIS_SHAPE_CELL,
+    ERIS_SHAPE_FIBER,
+    ERIS_NUM_SHAPES
+} eris_shape_id_t;
+
+/* Opcodes are a byte. */
+#define ERIS_STATS_MAX_OPS 256
+
+typedef struct {
+    uint64_t allocs[ERIS_NUM_SHAPES];      /* indexed by eris_shape_id_t */
+    uint64_t alloc_bytes[ERIS_NUM_SHAPES];
+    /* Calls, by what was called. Self tail calls count as closure calls. */
+    uint64_t closure_calls, builtin_calls, c_closure_calls;
+    uint64_t tail_calls, non_tail_calls;
+    /* Instructions executed, by opcode. */
+    uint64_t instrs[ERIS_STATS_MAX_OPS];
+} eris_stats_t;
+
+/* Stores the sum of the counters of all of `vm's threads, past and present,
+ * in `*out'. Counts from threads running meanwhile may be slightly stale.
+ * Returns false, and zeroes `*out', if statistics weren't compiled in. */
+bool eris_stats_snapshot(eris_vm_t *vm, eris_stats_t *out);
+/* Zeroes all of `vm's counters. */
+void eris_stats_reset(eris_vm_t *vm);
+/* Writes the nonzero counters in `stats' to `out', one per line. */
+void eris_stats_print(const eris_stats_t *stats, FILE *out);
+
+
 /* Miscellaneous stuff. */
 
 /* A very primitive mechanism for dealing with eris exceptions. Calls
@@ -55,10 +180,14 @@ void eris_protect(
 
 /* These functions use and manipulate the eris stack.
  * Indices are from the top of the stack. */
-/* TODO: document */
+/* Removes the top `num' slots. */
 void eris_pop(eris_frame_t *S, size_t num);
+/* Pushes `num' slots, each containing nil. */
 void eris_extend(eris_frame_t *S, size_t num);
+/* Copies the value in slot `src' into slot `dst'. */
 void eris_move(eris_frame_t *S, eris_idx_t dst, eris_idx_t src);
+/* Copies slots `src' through `src+num-1' into slots `dst' through
+ * `dst+num-1'. The ranges may overlap. */
 void eris_copy(eris_frame_t *S, eris_idx_t dst, eris_idx_t src, size_t num);
 
 /* Pushes the value in slot `idx'. */
@@ -75,17 +204,34 @@ eris_idx_t eris_num_slots(eris_frame_t *S);
  * After the call, the stack has shrunk by (nargs-1) slots (if nargs is 0, it
  * has _grown_ by one slot), and the return value of the function is on top of
  * the stack (slot 0).
+ *
+ * Returns false iff the function raised (eg. it ran out of memory; see
+ * eris_gc_config_t), in which case the value on top is nil.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_call(eris_frame_t *S, eris_idx_t func_idx, size_t nargs);
+
+/* Like eris_call, but keeps all of the function's return values, of which
+ * there may be any number (including zero), and sets `*nresults' to how many
+ * there are. After the call, the stack has shrunk by nargs slots and then
+ * grown by that many; the first return value is deepest, the last on top
+ * (slot 0). If the function raised, there are none.
  */
-void eris_call(eris_frame_t *S, eris_idx_t func_idx, size_t nargs);
+ERIS_WARN_UNUSED_RESULT
+bool eris_call_n(eris_frame_t *S, eris_idx_t func_idx, size_t nargs,
+                 size_t *nresults);
 
 /* Like eris_call, but calls a builtin. */
 void eris_builtin(eris_frame_t *S, eris_builtin_t builtin, size_t nargs);
 
 
-/* Pushing data onto stack. */
-void eris_push_int(eris_frame_t *S, eris_int_t i);
+/* Pushing data onto stack. Those that allocate fail, pushing nothing, iff
+ * allocation failed. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_push_int(eris_frame_t *S, eris_int_t i);
 void eris_push_ratio(eris_frame_t *S, eris_int_t num, eris_uint_t denom);
-void eris_push_float(eris_frame_t *S, eris_float_t f);
+ERIS_WARN_UNUSED_RESULT
+bool eris_push_float(eris_frame_t *S, eris_float_t f);
 
 void eris_push_cstring(eris_frame_t *S, const char *string);
 void eris_push_nil(eris_frame_t *S);
@@ -169,6 +315,90 @@ size_t eris_get_string(eris_frame_t *s, eris_idx_t idx, size_t len, char *buf);
  */
 size_t eris_get_cstring(eris_frame_t *s, eris_idx_t idx, size_t len, char *buf);
 
+
+/* Borrowed views. These point into eris' heap, at the bytes of the string or
+ * symbol in slot `idx', rather than copying them. They fail if it isn't one.
+ * A view is good until the next call that might allocate or collect garbage
+ * (most calls taking an eris_frame_t), unless the value is pinned, in which
+ * case it's good while the value's both pinned and kept alive (in a slot, say).
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_view_string(eris_frame_t *S, eris_idx_t idx,
+                      const char **data, size_t *len);
+ERIS_WARN_UNUSED_RESULT
+bool eris_view_symbol(eris_frame_t *S, eris_idx_t idx,
+                      const char **data, size_t *len);
+
+/* Pinning the value in slot `idx' keeps the GC from moving it, until it's
+ * unpinned as many times as it was pinned; past 254 pins, it stays pinned for
+ * good. Pinning doesn't keep the value alive. Values that aren't in the heap
+ * (nil, or numbers that fit in a slot) needn't be pinned, and are ignored.
+ */
+void eris_pin(eris_frame_t *S, eris_idx_t idx);
+void eris_unpin(eris_frame_t *S, eris_idx_t idx);
+
+/* Bulk data. These push a seq built from `n' C values in one call, failing,
+ * and pushing nothing, iff allocation failed. For eris_push_string_seq, `lens'
+ * gives the strings' lengths in bytes, or is NULL if they're null-terminated;
+ * it also fails if one of them isn't valid UTF-8.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_push_int_seq(eris_frame_t *S, size_t n, const eris_int_t *ints);
+ERIS_WARN_UNUSED_RESULT
+bool eris_push_float_seq(eris_frame_t *S, size_t n,
+                         const eris_float_t *floats);
+ERIS_WARN_UNUSED_RESULT
+bool eris_push_string_seq(eris_frame_t *S, size_t n,
+                          const char *const *strings, const size_t *lens);
+
+/* Fails if slot `idx' doesn't hold a seq or vec. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_check_seq_len(eris_frame_t *S, eris_idx_t idx, size_t *lenp);
+
+/* These read elements `start' through `start+n-1' of the seq or vec in slot
+ * `idx' into C arrays, viewing strings as eris_view_string does. They fail,
+ * leaving the arrays in some unspecified state, if it's not a seq or vec, if it
+ * has too few elements, or if one of them is of the wrong type. Any real number
+ * will do for eris_get_floats, but eris_get_ints takes only integers that fit
+ * in an eris_int_t.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_get_ints(eris_frame_t *S, eris_idx_t idx, size_t start, size_t n,
+                   eris_int_t *out);
+ERIS_WARN_UNUSED_RESULT
+bool eris_get_floats(eris_frame_t *S, eris_idx_t idx, size_t start, size_t n,
+                     eris_float_t *out);
+ERIS_WARN_UNUSED_RESULT
+bool eris_view_strings(eris_frame_t *S, eris_idx_t idx, size_t start, size_t n,
+                       const char **data, size_t *lens);
+
+
+/* Serialization. Nil, numbers, strings, symbols, and seqs and vecs of them can
+ * be serialized, sharing and cycles included; see src/serial.h for the format,
+ * which is only good between like builds on like machines.
+ *
+ * eris_serialize encodes the value in slot `idx' into a buffer it mallocs, for
+ * the caller to free. It fails iff that value holds something else (say, a
+ * function) or allocation failed.
+ *
+ * eris_deserialize decodes the first `len' bytes of `buf' and pushes the value.
+ * It decodes in place, so strings, seqs and vecs are used straight from `buf',
+ * uncopied: `buf' must be 8-byte aligned and writable, and must outlive every
+ * value decoded from it. (A MAP_PRIVATE file mapping does; only the pages
+ * holding seqs, vecs, symbols and numbers get written.) The VM keeps the
+ * numbers it has to box (all but NaN-boxed ones) alive, and remembers the
+ * value, so that decoding the same buffer again pushes the same value, until
+ * eris_release_buffer lets them go; release a buffer before you free it, and
+ * use nothing decoded from it after. It fails, pushing nothing, iff `buf'
+ * isn't a valid encoding or allocation failed; a buffer it fails on, or one
+ * decoded and since released, is good for nothing.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_serialize(eris_frame_t *S, eris_idx_t idx, void **buf, size_t *len);
+ERIS_WARN_UNUSED_RESULT
+bool eris_deserialize(eris_frame_t *S, void *buf, size_t len);
+void eris_release_buffer(eris_frame_t *S, void *buf);
+
 
 /* Loading compiled chunks. Treat all these functions as if they might cause
  * exceptional control flow. (Most of them can. Some can't, but that may change
@@ -192,4 +422,6 @@ void eris_loader_load(eris_frame_t *S, eris_idx_t idx);
  */
 void eris_loader_close(eris_frame_t *S, eris_idx_t idx);
 
+ERIS_API_END
+
 #endif
@@ -14,6 +14,16 @@
 #define ERIS_WARN_UNUSED_RESULT
 #endif
 
+/* Brackets the declarations of liberis' public API. liberis is built with
+ * hidden visibility, so these are the only symbols it exports. */
+#if defined __GNUC__ || __has_attribute(__visibility__)
+#define ERIS_API_BEGIN _Pragma("GCC visibility push(default)")
+#define ERIS_API_END _Pragma("GCC visibility pop")
+#else
+#define ERIS_API_BEGIN
+#define ERIS_API_END
+#endif
+
 #ifdef ERIS_HAS_ATTR_DEFINED
 #undef __has_attribute
 #undef ERIS_HAS_ATTR_DEFINED
@@ -9,16 +9,111 @@ EXE_DIR=$(BUILD_DIR)/bin
 OBJ_DIR=$(BUILD_DIR)/obj
 DEP_DIR=$(BUILD_DIR)/dep
 
+LIBRARY_DIR=$(BUILD_DIR)/lib
+
 EXES=$(addprefix $(EXE_DIR)/,$(EXE_NAMES))
+LIBRARIES=$(LIBRARY_DIR)/liberis.a $(LIBRARY_DIR)/liberis.so
 GENFILES=$(addprefix $(BUILD_DIR)/,$(GENFILE_NAMES))
 OBJFILES=$(CFILES:src/%.c=$(OBJ_DIR)/%.o)
 
-all: $(EXES) $(GENFILES) TAGS
+all: $(EXES) $(LIBRARIES) $(LIBRARY_DIR)/pkgconfig/eris.pc $(GENFILES) TAGS
 
 
 # Real targets.
 $(EXE_DIR)/rvmi: $(OBJFILES)
 
+# The library, ie. everything but rvmi. The shared one needs its own
+# position-independent objects, which live in $(OBJ_DIR)/pic.
+LIB_OBJFILES=$(filter-out $(OBJ_DIR)/rvmi.o,$(OBJFILES))
+PIC_OBJFILES=$(LIB_OBJFILES:$(OBJ_DIR)/%=$(OBJ_DIR)/pic/%)
+
+$(LIBRARY_DIR)/liberis.a: $(LIB_OBJFILES) | $(LIBRARY_DIR)/
+	@echo "  AR	$@"
+	$(QUIET) rm -f $@
+	$(QUIET) $(AR) rcs $@ $^
+
+$(LIBRARY_DIR)/liberis.so: $(PIC_OBJFILES) | $(LIBRARY_DIR)/
+	@echo "  LD	$@"
+	$(QUIET) $(CCLD) -shared $(LDFLAGS) -o $@ $^ $(LDLIBS)
+
+# pkg-config's paths don't include $(ROOT), since that isn't where we'll end up.
+$(LIBRARY_DIR)/pkgconfig/eris.pc: $(MAKEFILES) | $(LIBRARY_DIR)/pkgconfig/
+	@echo "  GEN	$@"
+	$(QUIET) printf '%s\n' \
+	    'libdir=$(patsubst $(ROOT)%,%,$(LIB))' \
+	    'includedir=$(patsubst $(ROOT)%,%,$(INCLUDE))' \
+	    '' \
+	    'Name: eris' \
+	    'Description: The eris virtual machine' \
+	    'Version: $(VERSION)' \
+	    'Libs: -L$${libdir} -leris' \
+	    'Libs.private: $(LDLIBS)' \
+	    'Cflags: -I$${includedir}' > $@
+
+# Installing the library. The headers are the ones in include/eris, plus the
+# generated builtins.expando.
+INSTALL_HEADERS=include/eris/eris.h include/eris/portability.h \
+	$(BUILD_DIR)/include/eris/builtins.expando
+
+.PHONY: install uninstall
+install: $(LIBRARIES) $(INSTALL_HEADERS) $(LIBRARY_DIR)/pkgconfig/eris.pc
+	@echo "  INSTALL	$(PREFIX)"
+	$(QUIET) install -d $(LIB)/pkgconfig $(INCLUDE)/eris
+	$(QUIET) install -m 644 $(LIBRARY_DIR)/liberis.a $(LIB)/
+	$(QUIET) install -m 755 $(LIBRARY_DIR)/liberis.so $(LIB)/
+	$(QUIET) install -m 644 $(LIBRARY_DIR)/pkgconfig/eris.pc $(LIB)/pkgconfig/
+	$(QUIET) install -m 644 $(INSTALL_HEADERS) $(INCLUDE)/eris/
+
+uninstall:
+	@echo "  UNINSTALL	$(PREFIX)"
+	$(QUIET) rm -f $(LIB)/liberis.a $(LIB)/liberis.so $(LIB)/pkgconfig/eris.pc
+	$(QUIET) rm -f $(addprefix $(INCLUDE)/eris/,$(notdir $(INSTALL_HEADERS)))
+	$(QUIET) rmdir $(INCLUDE)/eris 2>/dev/null || true
+
+# The benchmark suite. See src/bench/bench.c.
+BENCH_OBJFILES=$(BENCH_CFILES:src/%.c=$(OBJ_DIR)/%.o)
+
+$(EXE_DIR)/bench: $(LIB_OBJFILES) $(BENCH_OBJFILES)
+$(EXE_DIR)/bench: LDFLAGS+= -Wl,--wrap=malloc
+
+$(BENCH_OBJFILES): INCLUDE_DIRS+=$(BUILD_DIR)/include/ src/
+$(BENCH_OBJFILES): CFLAGS+= -DBENCH_BUILD_ID='"$(BUILD_ID)"'
+$(BENCH_OBJFILES): $(OBJ_DIR)/bench/%.o: src/bench/%.c $(HFILES) \
+		$(GENFILES) $(PGO_TRAINED) | $(OBJ_DIR)/bench/
+	@echo "  CC	$<"
+	$(QUIET) $(CC) $(CFLAGS) $(PGO_DUMPBASE) -c $< -o $@
+
+.PHONY: bench
+bench: $(EXE_DIR)/bench
+	$(EXE_DIR)/bench
+
+# The suite with and without the profiler, to show its overhead.
+.PHONY: bench-prof
+bench-prof: $(EXE_DIR)/bench
+	$(EXE_DIR)/bench
+	$(EXE_DIR)/bench -P 1000 | tail -n +2
+
+# The suite with the parallel builtins sharing work out over 3 extra threads.
+.PHONY: bench-par
+bench-par: $(EXE_DIR)/bench
+	$(EXE_DIR)/bench -j 3
+
+# The suite again, compiled ahead of time (see src/aot.h): bench -E writes C
+# for every proto the suite uses, and bench-aot is bench with that linked in.
+# Run it with -A to use it.
+$(BUILD_DIR)/bench_aot.c: $(EXE_DIR)/bench
+	@echo "  GEN	$@"
+	$(QUIET) $< -E $@.tmp && mv $@.tmp $@
+
+$(OBJ_DIR)/bench_aot.o: INCLUDE_DIRS+=$(BUILD_DIR)/include/ src/
+$(OBJ_DIR)/bench_aot.o: $(BUILD_DIR)/bench_aot.c $(HFILES) $(GENFILES) \
+		| $(OBJ_DIR)/
+	@echo "  CC	$<"
+	$(QUIET) $(CC) $(CFLAGS) -c $< -o $@
+
+$(EXE_DIR)/bench-aot: $(LIB_OBJFILES) $(BENCH_OBJFILES) $(OBJ_DIR)/bench_aot.o
+$(EXE_DIR)/bench-aot: LDFLAGS+= -Wl,--wrap=malloc
+
 .PRECIOUS: %/
 %/:
 	@echo "  MKDIR	$@"
@@ -41,6 +136,62 @@ $(BUILD_DIR)/include/eris/builtins.expando: \
 	$(QUIET) $(CPP) $(CFLAGS) -D'BUILTIN(x,...)=ERIS_BUILTIN(x)' \
 	    -o - - < $< | sed '/^#\|^$$/d' >> $@
 
+# The JIT's stencils, and the header jitgen makes out of them. See src/jit.h.
+$(OBJ_DIR)/jit/stencils.o: INCLUDE_DIRS+=$(BUILD_DIR)/include/ src/
+$(OBJ_DIR)/jit/stencils.o: src/jit/stencils.c $(HFILES) \
+		$(BUILD_DIR)/include/eris/builtins.expando | $(OBJ_DIR)/jit/
+	@echo "  CC	$<"
+	$(QUIET) $(CC) $(filter-out -O% -g% -DNDEBUG -fomit-frame-pointer \
+	    $(PGO_USE_FLAGS),$(CFLAGS)) $(STENCIL_CFLAGS) -c $< -o $@
+
+$(BUILD_DIR)/jitgen: src/jit/jitgen.c | $(BUILD_DIR)/
+	@echo "  LD	$@"
+	$(QUIET) $(CCLD) $(filter-out $(PGO_USE_FLAGS),$(CFLAGS)) $(LDFLAGS) \
+	    -o $@ $<
+
+$(BUILD_DIR)/include/jit_stencils.h: $(OBJ_DIR)/jit/stencils.o $(BUILD_DIR)/jitgen
+	@echo "  GEN	$@"
+	$(QUIET) mkdir -p "$(dir $@)"
+	$(QUIET) $(BUILD_DIR)/jitgen $< > $@.tmp && mv $@.tmp $@
+
+# Profile-guided builds (MODE=pgo; see config.mk). We build an instrumented
+# copy of the library and benchmarks under $(PGO_DIR), without the final
+# build's flags, and run the benchmarks to train it. Every object of the final
+# build depends on the training run.
+#
+# gcc finds an object's profile, and tells its static functions apart, by the
+# "dump base" name it compiles it under; normally that's derived from the
+# object's name. We compile an object and its instrumented and position-
+# independent counterparts under the same one, so that they share a profile.
+ifeq (pgo,$(MODE))
+PGO_DIR=$(BUILD_DIR)/pgo-gen
+PGO_CFLAGS=$(filter-out $(PGO_USE_FLAGS),$(CFLAGS)) -fprofile-generate
+PGO_OBJFILES=$(patsubst $(OBJ_DIR)/%,$(PGO_DIR)/obj/%,\
+	$(LIB_OBJFILES) $(BENCH_OBJFILES))
+PGO_TRAINED=$(PGO_DIR)/trained
+PGO_DUMPBASE=-dumpbase $(basename $(patsubst $(PGO_DIR)/obj/%,$(OBJ_DIR)/%,\
+	$(@:$(OBJ_DIR)/pic/%=$(OBJ_DIR)/%)))
+
+$(PGO_DIR)/obj/%.o: INCLUDE_DIRS+=$(BUILD_DIR)/include/ src/
+$(PGO_DIR)/obj/%.o: src/%.c $(HFILES) $(GENFILES)
+	@echo "  CC	$< (instrumented)"
+	$(QUIET) mkdir -p "$(dir $@)"
+	$(QUIET) $(CC) $(PGO_CFLAGS) $(PGO_DUMPBASE) -c $< -o $@
+
+$(PGO_DIR)/bin/bench: $(PGO_OBJFILES) | $(PGO_DIR)/bin/
+	@echo "  LD	$@"
+	$(QUIET) $(CCLD) -fprofile-generate $(LDFLAGS) -Wl,--wrap=malloc \
+	    -o $@ $^ $(LDLIBS)
+
+# The profiles land in $(OBJ_DIR), next to the objects that'll use them.
+$(PGO_TRAINED): $(PGO_DIR)/bin/bench | $(OBJ_DIR)/
+	@echo "  TRAIN	$<"
+	$(QUIET) find $(OBJ_DIR) -name '*.gcda' -delete
+	$(QUIET) $< -t 0.05 >/dev/null
+	$(QUIET) touch $@
+endif
+
+
 # Disassembly targets.
 ifneq (, $(filter %.s %.rodata,$(MAKECMDGOALS)))
 CFLAGS+= -g
@@ -64,9 +215,14 @@ $(BUILD_DIR)/rvmi.rodata: $(EXE_DIR)/rvmi | $(BUILD_DIR)/
 
 # Pattern rules
 $(OBJ_DIR)/%.o: INCLUDE_DIRS+=$(BUILD_DIR)/include/
-$(OBJ_DIR)/%.o: src/%.c | $(OBJ_DIR)/
+$(OBJ_DIR)/%.o: src/%.c $(PGO_TRAINED) | $(OBJ_DIR)/
 	@echo "  CC	$<"
-	$(QUIET) $(CC) $(CFLAGS) -c $< -o $@
+	$(QUIET) $(CC) $(CFLAGS) $(PGO_DUMPBASE) -c $< -o $@
+
+$(OBJ_DIR)/pic/%.o: INCLUDE_DIRS+=$(BUILD_DIR)/include/
+$(OBJ_DIR)/pic/%.o: src/%.c $(PGO_TRAINED) | $(OBJ_DIR)/pic/
+	@echo "  CC	$< (pic)"
+	$(QUIET) $(CC) $(CFLAGS) $(PGO_DUMPBASE) $(PIC_CFLAGS) -c $< -o $@
 
 $(EXES): %: | $(EXE_DIR)/
 	@echo "  LD	$@"
@@ -94,8 +250,8 @@ $(shell find . -name '*.dep' -empty -print0 | xargs -0 rm -f)
 $(DEP_DIR)/%.dep: INCLUDE_DIRS+=$(BUILD_DIR)/include/
 $(DEP_DIR)/%.dep: src/%.c $(GENFILES) | $(DEP_DIR)/
 	@echo "  DEP	$<"
-	$(QUIET) $(CC) -MM -MT "$(OBJ_DIR)/$*.o $@" $(filter-out -pedantic -g%,$(CFLAGS)) \
-		$< >$@
+	$(QUIET) $(CC) -MM -MT "$(OBJ_DIR)/$*.o $(OBJ_DIR)/pic/$*.o $@" \
+		$(filter-out -pedantic -g% $(PGO_USE_FLAGS),$(CFLAGS)) $< >$@
 
 DEPFILES=$(CFILES:src/%.c=$(DEP_DIR)/%.dep)
 
@@ -0,0 +1,613 @@
+#define _DEFAULT_SOURCE
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "aio.h"
+#include "fiber.h"
+#include "misc.h"
+#include "runtime.h"
+#include "str.h"
+#include "types.h"
+
+enum aio_op { AIO_READ, AIO_WRITE, AIO_ACCEPT, AIO_CONNECT };
+
+static bool wants_input(enum aio_op op)
+{
+    return op == AIO_READ || op == AIO_ACCEPT;
+}
+
+static void complete(fiber_t *fiber, intptr_t result)
+{
+    fiber->io_result = result;
+    fiber->io_done = true;
+}
+
+
+/* Doing operations ourselves. Like io_uring's completions, these result in
+ * what the system call returned, or negative errno. */
+static intptr_t try_op(enum aio_op op, int fd, void *addr, size_t len)
+{
+    ssize_t r;
+    switch (op) {
+      case AIO_READ: r = read(fd, addr, len); break;
+      case AIO_WRITE: r = write(fd, addr, len); break;
+      case AIO_ACCEPT: r = accept(fd, NULL, NULL); break;
+      case AIO_CONNECT: r = connect(fd, addr, (socklen_t) len); break;
+      default: IMPOSSIBLE("unrecognized I/O operation: %d", (int) op);
+    }
+    return r < 0 ? -errno : r;
+}
+
+static bool would_block(enum aio_op op, intptr_t r)
+{
+    return r == -EAGAIN || r == -EWOULDBLOCK
+        || (op == AIO_CONNECT && r == -EINPROGRESS);
+}
+
+/* Waits for a connect that's under way on `fd' to succeed or fail. */
+static intptr_t finish_connect(int fd)
+{
+    struct pollfd p = { .fd = fd, .events = POLLOUT, .revents = 0 };
+    int err;
+    socklen_t len = sizeof err;
+    while (poll(&p, 1, -1) < 0)
+        if (errno != EINTR)
+            return -errno;
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+        return -errno;
+    return -err;
+}
+
+/* Does `op', blocking until it's done, even if `fd' is non-blocking. */
+static intptr_t block_op(enum aio_op op, int fd, void *addr, size_t len)
+{
+    for (;;) {
+        intptr_t r = try_op(op, fd, addr, len);
+        /* An interrupted connect carries on without us. */
+        if (op == AIO_CONNECT && (r == -EINPROGRESS || r == -EINTR))
+            return finish_connect(fd);
+        if (r == -EINTR)
+            continue;
+        if (!would_block(op, r))
+            return r;
+        struct pollfd p = {
+            .fd = fd,
+            .events = wants_input(op) ? POLLIN : POLLOUT,
+            .revents = 0,
+        };
+        if (poll(&p, 1, -1) < 0 && errno != EINTR)
+            return -errno;
+    }
+}
+
+/* Frees `fiber's I/O buffer, giving back what it was charged. */
+static void drop_buf(fiber_t *fiber)
+{
+    free(fiber->io_buf);
+    fiber->io_buf = NULL;
+    eris_uncharge(fiber->thread, fiber->io_charge);
+    fiber->io_charge = 0;
+}
+
+
+#ifdef __linux__
+struct eris_aio {
+    bool uring;                 /* else we're using epoll */
+    int fd;                     /* the ring's, or epoll's */
+    /* The ring: both queues share one mapping, `ring'; the submission queue
+     * entries themselves have their own, `sqes'. */
+    void *ring;
+    size_t ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_head, *sq_tail, sq_mask, sq_entries;
+    unsigned *cq_head, *cq_tail, cq_mask;
+    struct io_uring_cqe *cqes;
+};
+
+static bool setup_uring(struct eris_aio *aio)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof p);
+    int fd = (int) syscall(__NR_io_uring_setup, ERIS_AIO_ENTRIES, &p);
+    if (fd < 0)
+        return false;
+    /* We want one mapping for both queues, and to read and write at the file
+     * position, ie. Linux 5.6 or later. */
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)
+        || !(p.features & IORING_FEAT_RW_CUR_POS)) {
+        close(fd);
+        return false;
+    }
+
+    size_t ring_size = MAX(p.sq_off.array + p.sq_entries * sizeof(unsigned),
+                           p.cq_off.cqes
+                           + p.cq_entries * sizeof(struct io_uring_cqe));
+    size_t sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    char *ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    void *sqes = ring == MAP_FAILED ? MAP_FAILED
+        : mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (ring != MAP_FAILED)
+            munmap(ring, ring_size);
+        close(fd);
+        return false;
+    }
+
+    aio->fd = fd;
+    aio->ring = ring;
+    aio->ring_size = ring_size;
+    aio->sqes = sqes;
+    aio->sqes_size = sqes_size;
+    aio->sq_head = (unsigned *) (ring + p.sq_off.head);
+    aio->sq_tail = (unsigned *) (ring + p.sq_off.tail);
+    aio->sq_mask = *(unsigned *) (ring + p.sq_off.ring_mask);
+    aio->sq_entries = p.sq_entries;
+    aio->cq_head = (unsigned *) (ring + p.cq_off.head);
+    aio->cq_tail = (unsigned *) (ring + p.cq_off.tail);
+    aio->cq_mask = *(unsigned *) (ring + p.cq_off.ring_mask);
+    aio->cqes = (struct io_uring_cqe *) (ring + p.cq_off.cqes);
+    /* We fill the entries in order, so the queue's indirection is the
+     * identity. */
+    unsigned *array = (unsigned *) (ring + p.sq_off.array);
+    for (unsigned i = 0; i < p.sq_entries; ++i)
+        array[i] = i;
+    return true;
+}
+
+static struct eris_aio *get_aio(eris_thread_t *thread)
+{
+    if (thread->aio)
+        return thread->aio;
+    struct eris_aio *aio = calloc(1, sizeof *aio);
+    if (!aio)
+        return NULL;
+    aio->uring = setup_uring(aio);
+    if (!aio->uring && (aio->fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        free(aio);
+        return NULL;
+    }
+    return thread->aio = aio;
+}
+
+void eris_aio_free(eris_thread_t *thread)
+{
+    struct eris_aio *aio = thread->aio;
+    if (!aio)
+        return;
+    if (aio->uring) {
+        munmap(aio->sqes, aio->sqes_size);
+        munmap(aio->ring, aio->ring_size);
+    }
+    close(aio->fd);
+    free(aio);
+    thread->aio = NULL;
+}
+
+
+/* The io_uring. We're the only ones to touch the submission queue's tail and
+ * the completion queue's head; the kernel moves their other ends. */
+static unsigned unsubmitted(struct eris_aio *aio)
+{
+    return *aio->sq_tail - __atomic_load_n(aio->sq_head, __ATOMIC_ACQUIRE);
+}
+
+static int enter(struct eris_aio *aio, unsigned to_submit, bool wait)
+{
+    return (int) syscall(__NR_io_uring_enter, aio->fd, to_submit,
+                         wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0,
+                         NULL, 0);
+}
+
+/* Wakes the fibers whose operations have completed. Returns whether any had.
+ */
+static bool reap(struct eris_aio *aio)
+{
+    unsigned head = *aio->cq_head;
+    unsigned tail = __atomic_load_n(aio->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail)
+        return false;
+    for (; head != tail; ++head) {
+        struct io_uring_cqe *cqe = &aio->cqes[head & aio->cq_mask];
+        fiber_t *fiber = (fiber_t *) (uintptr_t) cqe->user_data;
+        complete(fiber, cqe->res);
+        eris_fiber_wake(fiber);
+    }
+    __atomic_store_n(aio->cq_head, head, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* The kernel won't take our submissions, so fails their operations, and wakes
+ * their fibers, with `err'. */
+static void fail_unsubmitted(struct eris_aio *aio, int err)
+{
+    unsigned tail = *aio->sq_tail;
+    unsigned head = tail - unsubmitted(aio);
+    for (unsigned i = head; i != tail; ++i) {
+        fiber_t *fiber =
+            (fiber_t *) (uintptr_t) aio->sqes[i & aio->sq_mask].user_data;
+        complete(fiber, -err);
+        eris_fiber_wake(fiber);
+    }
+    __atomic_store_n(aio->sq_tail, head, __ATOMIC_RELEASE);
+}
+
+/* Submits everything queued; if `wait', until some fiber wakes. */
+static void submit(struct eris_aio *aio, bool wait)
+{
+    while (unsubmitted(aio) || wait) {
+        int r = enter(aio, unsubmitted(aio), wait);
+        int err = r < 0 ? errno : 0;
+        if (err && err != EINTR && err != EAGAIN && err != EBUSY) {
+            bool woke = unsubmitted(aio) > 0;
+            fail_unsubmitted(aio, err);
+            if (wait && !woke && !reap(aio))
+                eris_bug("io_uring_enter: %s", strerror(err));
+            return;
+        }
+        /* EAGAIN and EBUSY mean the kernel's short of room for completions
+         * until we take some. */
+        if (reap(aio))
+            wait = false;
+    }
+}
+
+static bool queue_sqe(struct eris_aio *aio, fiber_t *fiber, enum aio_op op,
+                      int fd, void *addr, size_t len)
+{
+    if (unsubmitted(aio) == aio->sq_entries) {
+        submit(aio, false);
+        if (unsubmitted(aio) == aio->sq_entries)
+            return false;
+    }
+
+    unsigned tail = *aio->sq_tail;
+    struct io_uring_sqe *sqe = &aio->sqes[tail & aio->sq_mask];
+    memset(sqe, 0, sizeof *sqe);
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t) addr;
+    sqe->user_data = (uintptr_t) fiber;
+    switch (op) {
+      case AIO_READ:
+      case AIO_WRITE:
+        sqe->opcode = op == AIO_READ ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->len = (uint32_t) len;
+        sqe->off = (uint64_t) -1;   /* at, and advancing, the file position */
+        break;
+      case AIO_ACCEPT:
+        sqe->opcode = IORING_OP_ACCEPT;
+        break;
+      case AIO_CONNECT:
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->off = len;             /* the address's length */
+        break;
+      default: IMPOSSIBLE("unrecognized I/O operation: %d", (int) op);
+    }
+    __atomic_store_n(aio->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+
+/* The epoll fallback. */
+static intptr_t try_nonblocking(enum aio_op op, int fd, void *addr, size_t len)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags >= 0 && !(flags & O_NONBLOCK))
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    intptr_t r;
+    do r = try_op(op, fd, addr, len); while (r == -EINTR);
+    return r;
+}
+
+/* Has epoll wake `fiber' once `op' on `fd' won't block. */
+static bool watch(struct eris_aio *aio, fiber_t *fiber, enum aio_op op, int fd)
+{
+    struct epoll_event ev;
+    ev.events = (wants_input(op) ? EPOLLIN : EPOLLOUT) | EPOLLONESHOT;
+    ev.data.ptr = fiber;
+    return !epoll_ctl(aio->fd, EPOLL_CTL_MOD, fd, &ev)
+        || (errno == ENOENT && !epoll_ctl(aio->fd, EPOLL_CTL_ADD, fd, &ev));
+}
+
+void eris_aio_poll(eris_thread_t *thread, bool submit_, bool wait)
+{
+    struct eris_aio *aio = thread->aio;
+    assert (aio && thread->io_waiting);
+    if (aio->uring) {
+        if (reap(aio))
+            wait = false;
+        if (submit_ || wait)
+            submit(aio, wait);
+        return;
+    }
+
+    if (!submit_ && !wait)
+        return;
+    struct epoll_event events[64];
+    int n, timeout = wait ? -1 : 0;
+    while ((n = epoll_wait(aio->fd, events, ARRAY_LEN(events), timeout)) < 0) {
+        if (errno != EINTR)
+            eris_bug("epoll_wait: %s", strerror(errno));
+        if (!wait)
+            return;
+    }
+    for (int i = 0; i < n; ++i)
+        eris_fiber_wake(events[i].data.ptr);
+}
+
+/* Starts `op' for the current fiber and parks it, or if we can't, does it
+ * now. Either way, leaves `*S' ready to run the builtin again. */
+static void start(vm_state_t *S, enum aio_op op, int fd, void *addr,
+                  size_t len)
+{
+    eris_thread_t *thread = S->thread;
+    fiber_t *self = thread->fiber;
+    struct eris_aio *aio;
+    if (thread->vm_calls != 1 || !(aio = get_aio(thread))) {
+        complete(self, block_op(op, fd, addr, len));
+        return;
+    }
+
+    if (aio->uring) {
+        if (!queue_sqe(aio, self, op, fd, addr, len)) {
+            complete(self, block_op(op, fd, addr, len));
+            return;
+        }
+    } else {
+        intptr_t r = try_nonblocking(op, fd, addr, len);
+        if (!would_block(op, r) || !watch(aio, self, op, fd)) {
+            complete(self, would_block(op, r) ? -errno : r);
+            return;
+        }
+        /* We'll start it again when we wake. */
+        drop_buf(self);
+    }
+    eris_fiber_park(S);
+}
+
+#else  /* !__linux__ */
+void eris_aio_free(eris_thread_t *thread) { (void) thread; }
+
+void eris_aio_poll(eris_thread_t *thread, bool submit_, bool wait)
+{
+    (void) thread; (void) submit_; (void) wait;
+    IMPOSSIBLE("no fiber waits on I/O without %s", "Linux");
+}
+
+static void start(vm_state_t *S, enum aio_op op, int fd, void *addr,
+                  size_t len)
+{
+    complete(S->thread->fiber, block_op(op, fd, addr, len));
+}
+#endif  /* __linux__ */
+
+
+/* The operations. */
+bool eris_aio_read(vm_state_t *S, int fd, size_t len)
+{
+    fiber_t *self = S->thread->fiber;
+    len = MIN(len, (size_t) INT32_MAX);
+    /* Room for a byte at least, since malloc(0) may be NULL. The buffer's
+     * charged to the heap till the read's done, so that eris code can't ask
+     * for more than the heap has room for. */
+    size_t size = MAX(len, 1);
+    if (!eris_charge(S->thread, size))
+        return false;
+    if (!(self->io_buf = malloc(size))) {
+        eris_uncharge(S->thread, size);
+        return false;
+    }
+    self->io_charge = (uint32_t) size;
+    start(S, AIO_READ, fd, self->io_buf, len);
+    return true;
+}
+
+bool eris_aio_write(vm_state_t *S, int fd, const void *data, size_t len)
+{
+    start(S, AIO_WRITE, fd, (void *) data, MIN(len, (size_t) INT32_MAX));
+    return true;
+}
+
+bool eris_aio_accept(vm_state_t *S, int fd)
+{
+    start(S, AIO_ACCEPT, fd, NULL, 0);
+    return true;
+}
+
+static bool parse_addr(struct sockaddr_storage *ss, socklen_t *sslen,
+                       const char *addr, size_t len)
+{
+    char buf[INET6_ADDRSTRLEN + sizeof "[]:65535"];
+    if (len >= sizeof buf)
+        return false;
+    memcpy(buf, addr, len);
+    buf[len] = '\0';
+
+    char *colon = strrchr(buf, ':'), *end;
+    if (!colon || colon == buf || !isdigit((unsigned char) colon[1]))
+        return false;
+    unsigned long port = strtoul(colon + 1, &end, 10);
+    if (*end || port > 65535)
+        return false;
+    *colon = '\0';
+
+    memset(ss, 0, sizeof *ss);
+    if (buf[0] == '[' && colon[-1] == ']') {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) ss;
+        colon[-1] = '\0';
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons((uint16_t) port);
+        *sslen = sizeof *sin6;
+        return inet_pton(AF_INET6, buf + 1, &sin6->sin6_addr) == 1;
+    }
+    struct sockaddr_in *sin = (struct sockaddr_in *) ss;
+    sin->sin_family = AF_INET;
+    sin->sin_port = htons((uint16_t) port);
+    *sslen = sizeof *sin;
+    return inet_pton(AF_INET, buf, &sin->sin_addr) == 1;
+}
+
+bool eris_aio_connect(vm_state_t *S, const char *addr, size_t len)
+{
+    fiber_t *self = S->thread->fiber;
+    /* epoll woke us, so our connection's been made or refused. */
+    if (self->io_fd >= 0) {
+        complete(self, finish_connect(self->io_fd));
+        return true;
+    }
+
+    struct sockaddr_storage *ss = malloc(sizeof *ss);
+    socklen_t sslen;
+    if (!ss || !parse_addr(ss, &sslen, addr, len)) {
+        free(ss);
+        return false;
+    }
+    int fd = socket(ss->ss_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        free(ss);
+        complete(self, -errno);
+        return true;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    self->io_buf = ss;
+    self->io_fd = fd;
+    start(S, AIO_CONNECT, fd, ss, sslen);
+    return true;
+}
+
+intptr_t eris_aio_take(fiber_t *fiber, void **buf)
+{
+    assert (fiber->io_done);
+    intptr_t result = fiber->io_result;
+    /* A connect results in its socket, if it worked. */
+    if (fiber->io_fd >= 0) {
+        if (result >= 0)
+            result = fiber->io_fd;
+        else
+            close(fiber->io_fd);
+        fiber->io_fd = -1;
+    }
+    if (buf) {
+        *buf = fiber->io_buf;
+        fiber->io_buf = NULL;
+    }
+    drop_buf(fiber);
+    fiber->io_done = false;
+    return result;
+}
+
+
+/* Text. `held' maps each fd to the bytes held back from it: up to 3, packed
+ * low byte first, with their count in the top byte. `num_held' counts the fds
+ * with any, so that reads needn't take the lock when none do. */
+static pthread_mutex_t held_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t *held;
+static size_t held_len;
+static size_t num_held;
+
+static size_t unhold(int fd, char *out)
+{
+    if (!__atomic_load_n(&num_held, __ATOMIC_ACQUIRE))
+        return 0;
+    size_t n = 0;
+    pthread_mutex_lock(&held_lock);
+    if ((size_t) fd < held_len && held[fd]) {
+        n = held[fd] >> 24;
+        for (size_t k = 0; k < n; ++k)
+            out[k] = (char) (held[fd] >> 8 * k);
+        held[fd] = 0;
+        __atomic_sub_fetch(&num_held, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&held_lock);
+    return n;
+}
+
+static bool hold(int fd, const char *bytes, size_t n)
+{
+    assert (0 < n && n <= 3);
+    uint32_t packed = (uint32_t) n << 24;
+    for (size_t k = 0; k < n; ++k)
+        packed |= (uint32_t) (unsigned char) bytes[k] << 8 * k;
+
+    pthread_mutex_lock(&held_lock);
+    if ((size_t) fd >= held_len) {
+        size_t len = MAX((size_t) fd + 1, MAX(2 * held_len, 16));
+        uint32_t *grown = realloc(held, len * sizeof *held);
+        if (!grown) {
+            pthread_mutex_unlock(&held_lock);
+            return false;
+        }
+        memset(grown + held_len, 0, (len - held_len) * sizeof *held);
+        held = grown;
+        held_len = len;
+    }
+    if (!held[fd])
+        __atomic_add_fetch(&num_held, 1, __ATOMIC_RELEASE);
+    held[fd] = packed;
+    pthread_mutex_unlock(&held_lock);
+    return true;
+}
+
+intptr_t eris_aio_take_text(fiber_t *fiber, int fd, char **buf)
+{
+    void *raw;
+    intptr_t n = eris_aio_take(fiber, &raw);
+    if (n < 0) {
+        free(raw);
+        return n;
+    }
+    /* Room for what's held back, before we take it. */
+    char *text = realloc(raw, (size_t) n + 3);
+    if (!text) {
+        free(raw);
+        return -ENOMEM;
+    }
+    char prev[3];
+    size_t k = unhold(fd, prev);
+    if (!n && k) {
+        free(text);
+        return -EILSEQ;
+    }
+    memmove(text + k, text, (size_t) n);
+    memcpy(text, prev, k);
+    size_t len = (size_t) n + k;
+
+    size_t cut = eris_utf8_cut(text, len);
+    if (cut && !hold(fd, text + len - cut, cut)) {
+        free(text);
+        return -ENOMEM;
+    }
+    if (n && len == cut) {
+        free(text);
+        return -EAGAIN;
+    }
+    *buf = text;
+    return (intptr_t) (len - cut);
+}
+
+void eris_aio_forget(int fd)
+{
+    char prev[3];
+    (void) unhold(fd, prev);
+}
@@ -0,0 +1,82 @@
+/* Asynchronous I/O for fibers (see fiber.h).
+ *
+ * A fiber that reads, writes, accepts or connects parks until the operation
+ * completes, and its thread runs other fibers meanwhile. On Linux each thread
+ * lazily sets up an io_uring, which we drive with raw system calls: parking
+ * queues a submission, and when the run queue drains (or someone yields) we
+ * submit every queued one at once, and wake every fiber whose operation has
+ * completed. If the kernel won't give us a ring we fall back to epoll, trying
+ * each operation on a non-blocking file first and parking only if it would
+ * block. That sets O_NONBLOCK on the files it's given, and in that mode only
+ * one fiber at a time may wait on any one file.
+ *
+ * Where a fiber can't switch (see fiber.h), or elsewhere than Linux, the
+ * operations just block the thread.
+ *
+ * An operation is a builtin's two-step dance. The first time it runs, the
+ * builtin calls eris_aio_<op>, which replaces the VM state as eris_fiber_yield
+ * does, without advancing the ip past the call; so once the fiber is woken the
+ * builtin runs again, finds its fiber's `io_done' set, and finishes with
+ * eris_aio_take. (In the epoll fallback a fiber is woken when its operation
+ * won't block, and the builtin starts it again.)
+ */
+#ifndef _AIO_H_
+#define _AIO_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "misc.h"
+#include "types.h"
+
+/* How many operations a thread's ring queues before it must submit them. */
+#define ERIS_AIO_ENTRIES 256
+
+/* These fail, leaving `*S' alone, iff allocation failed or `addr' is bad. */
+
+/* Reads up to `len' bytes from `fd', into a buffer eris_aio_take hands over. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_aio_read(vm_state_t *S, int fd, size_t len);
+
+/* Writes up to `len' bytes of `data', which must outlive the operation. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_aio_write(vm_state_t *S, int fd, const void *data, size_t len);
+
+/* Accepts a connection on listening socket `fd'; results in its socket. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_aio_accept(vm_state_t *S, int fd);
+
+/* Connects a new TCP socket to `addr', a numeric "host:port" (with IPv6
+ * hosts in brackets); results in the socket. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_aio_connect(vm_state_t *S, const char *addr, size_t len);
+
+/* Finishes `fiber's completed operation: returns its result, which is
+ * negative errno if it failed, and hands the caller any buffer it read into,
+ * to free. */
+intptr_t eris_aio_take(fiber_t *fiber, void **buf);
+
+/* Finishes `fiber's completed read of `fd' as text. Like eris_aio_take, but
+ * the bytes an earlier read of `fd' held back come first, and a UTF-8 sequence
+ * that the read cut short is held back in turn, for the next. Returns how many
+ * bytes are left at `*buf', to free, or negative errno: -EILSEQ if the file
+ * ends partway through a sequence, and -EAGAIN if every byte read was held
+ * back, so that the caller should read again. Whether the rest is valid UTF-8
+ * is the caller's to check.
+ *
+ * fds belong to the process, so what's held back is the process's too. */
+intptr_t eris_aio_take_text(fiber_t *fiber, int fd, char **buf);
+
+/* Drops whatever was held back from `fd', as it's closed. */
+void eris_aio_forget(int fd);
+
+/* For fiber.c's scheduler: wakes the fibers whose operations have completed.
+ * If `submit', first submits queued operations; if `wait', blocks until at
+ * least one fiber wakes. Only call it while some fiber is waiting. */
+void eris_aio_poll(eris_thread_t *thread, bool submit, bool wait);
+
+/* Frees `thread's ring, if it has one. */
+void eris_aio_free(eris_thread_t *thread);
+
+#endif
@@ -0,0 +1,566 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aot.h"
+#include "misc.h"
+#include "prof.h"
+#include "runtime.h"
+#include "stats.h"
+#include "types.h"
+#include "vm.h"
+
+#define FRAME(f) (f)->data.call
+
+
+/* The registry: a JudyHS array from code, as bytes, to the entry for it.
+ * Registering happens as programs start, and attaching as they load protos;
+ * one lock is plenty. */
+static Pvoid_t registry;
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void eris_aot_register(const struct eris_aot_entry *entries, size_t num,
+                       unsigned abi)
+{
+    if (abi != AOT_ABI)
+        eris_bug("AOT code compiled for a differently-built eris");
+    pthread_mutex_lock(&registry_lock);
+    for (size_t i = 0; i < num; ++i) {
+        const struct eris_aot_entry *entry = &entries[i];
+        PPvoid_t slot = JudyHSIns(&registry, (void *) entry->code,
+                                  entry->code_len * sizeof *entry->code, PJE0);
+        if (slot == PPJERR)
+            eris_bug("out of memory");
+        if (!*slot)
+            *slot = (void *) entry;
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+bool eris_aot_attach(proto_t *proto)
+{
+    assert (proto->verified);
+    pthread_mutex_lock(&registry_lock);
+    PPvoid_t slot = JudyHSGet(registry, proto->code,
+                              proto->code_len * sizeof *proto->code);
+    const struct eris_aot_entry *entry = slot ? *slot : NULL;
+    pthread_mutex_unlock(&registry_lock);
+
+    if (!entry || entry->num_args != proto->num_args
+        || entry->num_regs != proto->num_regs)
+        return false;
+    __atomic_store_n(&proto->aot, entry, __ATOMIC_RELEASE);
+    return true;
+}
+
+
+/* Running compiled code. */
+int eris_aot_call(vm_state_t *S, unsigned depth)
+{
+    for (;;) {
+        const struct eris_aot_entry *aot =
+            __atomic_load_n(&S->func->proto->aot, __ATOMIC_ACQUIRE);
+        if (!aot)
+            return AOT_EXIT;
+        int status = aot->func(S, depth);
+        if (status != AOT_TAILCALL)
+            return status;
+    }
+}
+
+bool eris_aot_close(vm_state_t *S, reg_t dest, longarg_t index)
+{
+    proto_t *proto = S->func->proto->local_funcs[index];
+    const capture_t *cap = &proto->capture;
+    if (cap->shared) {
+        S->regs[dest] = CONTENTS_VAL(cap->shared);
+        return true;
+    }
+
+    FRAME(S->frame).ip = S->ip;
+    closure_t *func;
+    if (!new_closure(&func, proto->num_upvals, S->thread, S->frame))
+        return false;
+    func->proto = proto;
+
+    const uint8_t *idx = cap->indices;
+    for (size_t i = 0; i < cap->num_from_upvals; ++i)
+        func->upvals[i] = S->func->upvals[idx[i]];
+    idx += cap->num_from_upvals;
+    for (size_t i = 0; i < cap->num_from_regs; ++i)
+        func->upvals[cap->num_from_upvals + i] = S->regs[idx[i]];
+    S->regs[dest] = CONTENTS_VAL(func);
+    return true;
+}
+
+
+/* Emitting C. */
+typedef struct {
+    FILE *out;
+    const proto_t *proto;
+    /* Whether registers live in C locals, r0 and so on, rather than in
+     * `regs'. */
+    bool locals;
+    /* Where the interpreter may enter us, and where we need labels (entries,
+     * and wherever we jump). */
+    bool *entry;
+    bool *label;
+} emit_t;
+
+typedef char reg_name_t[16];
+
+static const char *reg_name(const emit_t *e, unsigned reg, reg_name_t buf)
+{
+    snprintf(buf, sizeof(reg_name_t), e->locals ? "r%u" : "regs[%u]", reg);
+    return buf;
+}
+
+static size_t jump_target(const proto_t *proto, size_t pc)
+{
+    return (size_t) ((ptrdiff_t) pc + VM_SIGNED_LONGARG(proto->code[pc]));
+}
+
+/* Copies registers kept in locals to `regs', and back. */
+static void spill(const emit_t *e, int indent)
+{
+    if (e->locals)
+        for (unsigned r = 0; r < e->proto->num_regs; ++r)
+            fprintf(e->out, "%*sregs[%u] = r%u;\n", indent, "", r, r);
+}
+
+static void reload(const emit_t *e, int indent, int except)
+{
+    if (e->locals)
+        for (unsigned r = 0; r < e->proto->num_regs; ++r)
+            if ((int) r != except)
+                fprintf(e->out, "%*sr%u = regs[%u];\n", indent, "", r, r);
+}
+
+/* Leaves the instruction at `pc' to the interpreter. */
+static void exit_at(const emit_t *e, size_t pc, int indent, bool spilled)
+{
+    if (!spilled)
+        spill(e, indent);
+    fprintf(e->out, "%*sS->ip = code + %zu;\n", indent, "", pc);
+    fprintf(e->out, "%*sreturn AOT_EXIT;\n", indent, "");
+}
+
+/* Backward jumps leave profiling samples, and starting collections, to the
+ * interpreter, as the JIT's do. */
+static void poll_prof(const emit_t *e, size_t pc)
+{
+    fprintf(e->out, "    if (eris_prof_due(S->thread)"
+            " || UNLIKELY(S->thread->gc_pending)) {\n");
+    exit_at(e, pc, 8, false);
+    fprintf(e->out, "    }\n");
+}
+
+static void emit_jump(const emit_t *e, size_t from, size_t target)
+{
+    if (target <= from)
+        poll_prof(e, from);
+    fprintf(e->out, "    goto L%zu;\n", target);
+}
+
+static void emit_call(const emit_t *e, size_t pc, const char *funcval,
+                      reg_t offset, nargs_t nargs, nresults_t nresults,
+                      bool tail_call)
+{
+    assert (!e->locals);
+    fprintf(e->out, "    S->ip = code + %zu;\n", pc);
+    fprintf(e->out,
+            "    status = eris_aot_invoke(S, %s, %u, %u, %u, %s, depth);\n"
+            "    if (status != AOT_DONE)\n"
+            "        return status;\n",
+            funcval, offset, nargs, nresults, tail_call ? "true" : "false");
+}
+
+static void emit_instr(const emit_t *e, size_t pc)
+{
+    FILE *out = e->out;
+    instr_t instr = e->proto->code[pc];
+    unsigned a1 = VM_ARG1(instr), a2 = VM_ARG2(instr), a3 = VM_ARG3(instr);
+    reg_name_t r1, r2;
+    char funcval[64];
+
+    switch ((enum op) VM_OP(instr)) {
+      case OP_MOVE:
+        fprintf(out, "    AOT_COUNT(OP_MOVE);\n    %s = %s;\n",
+                reg_name(e, a1, r1), reg_name(e, a2, r2));
+        break;
+
+      case OP_LOAD_INT:
+        /* May allocate, in which case the GC wants our registers. */
+        if (e->locals) {
+            fprintf(out, "    if (AOT_LOAD_INT_ALLOCATES) {\n"
+                    "        frame->data.call.ip = code + %zu;\n", pc);
+            spill(e, 8);
+            fprintf(out, "    }\n");
+        }
+        else {
+            fprintf(out, "    frame->data.call.ip = code + %zu;\n", pc);
+        }
+        fprintf(out, "    if (UNLIKELY(!make_fixnum(&%s, %d, S->thread, "
+                "frame))) {\n", reg_name(e, a1, r1),
+                (int) VM_SIGNED_LONGARG(instr));
+        exit_at(e, pc, 8, true);
+        fprintf(out, "    }\n");
+        if (e->locals) {
+            fprintf(out, "    if (AOT_LOAD_INT_ALLOCATES) {\n");
+            reload(e, 8, (int) a1);
+            fprintf(out, "    }\n");
+        }
+        fprintf(out, "    AOT_COUNT(OP_LOAD_INT);\n");
+        break;
+
+      case OP_LOAD_UPVAL:
+        fprintf(out, "    AOT_COUNT(OP_LOAD_UPVAL);\n"
+                "    %s = func->upvals[%u];\n", reg_name(e, a1, r1), a2);
+        break;
+
+      case OP_LOAD_CELL:
+        fprintf(out, "    AOT_COUNT(OP_LOAD_CELL);\n"
+                "    %s = deref_cell(get_cell(func->upvals[%u]));\n",
+                reg_name(e, a1, r1), a2);
+        break;
+
+      case OP_LOAD_GLOBAL:
+        fprintf(out, "    AOT_COUNT(OP_LOAD_GLOBAL);\n"
+                "    %s = deref_cell(&S->globals[%u]);\n",
+                reg_name(e, a1, r1), (unsigned) VM_LONGARG(instr));
+        break;
+
+      case OP_CALL_CELL: case OP_CALL_CELL_N:
+      case OP_TAILCALL_CELL: case OP_TAILCALL_CELL0:
+        snprintf(funcval, sizeof funcval,
+                 "deref_cell(get_cell(func->upvals[%u]))", a1);
+        goto call;
+
+      case OP_CALL_REG: case OP_CALL_REG_N:
+      case OP_TAILCALL_REG: case OP_TAILCALL_REG0:
+        snprintf(funcval, sizeof funcval, "%s", reg_name(e, a1, r1));
+        goto call;
+
+      call: {
+          enum op op = VM_OP(instr);
+          bool call_n = op == OP_CALL_CELL_N || op == OP_CALL_REG_N;
+          bool tail0 = op == OP_TAILCALL_CELL0 || op == OP_TAILCALL_REG0;
+          bool tail_call = tail0 || op == OP_TAILCALL_CELL
+              || op == OP_TAILCALL_REG;
+          emit_call(e, pc, funcval, tail0 ? 0 : a2,
+                    call_n ? VM_CALL_N_NARGS(instr) : a3,
+                    call_n ? VM_CALL_N_NRESULTS(instr) : 1, tail_call);
+      }
+        break;
+
+      case OP_TAILCALL_SELF:
+      case OP_TAILCALL_SELF0:
+        poll_prof(e, pc);
+        fprintf(out, "    AOT_COUNT(%s);\n"
+                "    STAT(S->thread, closure_calls++);\n"
+                "    STAT(S->thread, tail_calls++);\n",
+                VM_OP(instr) == OP_TAILCALL_SELF
+                ? "OP_TAILCALL_SELF" : "OP_TAILCALL_SELF0");
+        if (VM_OP(instr) == OP_TAILCALL_SELF && a2) {
+            /* Moving arguments down, so in order. */
+            if (e->locals)
+                for (unsigned i = 0; i < a3; ++i)
+                    fprintf(out, "    r%u = r%u;\n", i, a2 + i);
+            else
+                fprintf(out, "    memmove(regs, regs + %u, sizeof(val_t) * "
+                        "%u);\n", a2, a3);
+        }
+        fprintf(out, "    goto L0;\n");
+        break;
+
+      case OP_JUMP:
+        fprintf(out, "    AOT_COUNT(OP_JUMP);\n");
+        emit_jump(e, pc, jump_target(e->proto, pc));
+        break;
+
+        /* Like the interpreter, we go straight to the following JUMP's
+         * target. */
+      case OP_IF:
+      case OP_IFNOT:
+        fprintf(out, "    AOT_COUNT(%s);\n"
+                "    if (%sVAL_IS_NIL(%s))\n"
+                "        goto L%zu;\n",
+                VM_OP(instr) == OP_IF ? "OP_IF" : "OP_IFNOT",
+                VM_OP(instr) == OP_IF ? "!" : "", reg_name(e, a1, r1),
+                pc + 2);
+        emit_jump(e, pc, jump_target(e->proto, pc + 1));
+        break;
+
+        /* Returning to compiled code is a C return; to the interpreter, the
+         * interpreter's job. */
+      case OP_RETURN:
+        fprintf(out, "    if (!depth) {\n");
+        exit_at(e, pc, 8, false);
+        fprintf(out, "    }\n"
+                "    AOT_COUNT(OP_RETURN);\n"
+                "    regs[0] = %s;\n"
+                "    return 1;\n", reg_name(e, a1, r1));
+        break;
+
+      case OP_RETURN_N:
+        fprintf(out, "    if (!depth) {\n");
+        exit_at(e, pc, 8, false);
+        fprintf(out, "    }\n"
+                "    AOT_COUNT(OP_RETURN_N);\n");
+        if (e->locals)
+            for (unsigned i = 0; i < a2; ++i)
+                fprintf(out, "    regs[%u] = r%u;\n", i, a1 + i);
+        else if (a1)
+            fprintf(out, "    memmove(regs, regs + %u, sizeof(val_t) * "
+                    "%u);\n", a1, a2);
+        fprintf(out, "    return %u;\n", a2);
+        break;
+
+      case OP_CLOSE:
+        assert (!e->locals);
+        fprintf(out, "    S->ip = code + %zu;\n"
+                "    if (UNLIKELY(!eris_aot_close(S, %u, %u)))\n"
+                "        return AOT_EXIT;\n"
+                "    AOT_COUNT(OP_CLOSE);\n", pc, a1,
+                (unsigned) VM_LONGARG(instr));
+        break;
+
+      default:
+        IMPOSSIBLE("unrecognized opcode: %u", VM_OP(instr));
+    }
+}
+
+/* Finds where we can be entered, and where we need labels. */
+static void find_labels(emit_t *e)
+{
+    const proto_t *proto = e->proto;
+    e->entry[0] = e->label[0] = true;
+    for (size_t pc = 0; pc < proto->code_len; ++pc) {
+        instr_t instr = proto->code[pc];
+        switch ((enum op) VM_OP(instr)) {
+          case OP_CALL_CELL: case OP_CALL_REG:
+          case OP_CALL_CELL_N: case OP_CALL_REG_N:
+          case OP_TAILCALL_CELL: case OP_TAILCALL_REG:
+          case OP_TAILCALL_CELL0: case OP_TAILCALL_REG0:
+            e->entry[pc + 1] = e->label[pc + 1] = true;
+            break;
+
+          case OP_JUMP: {
+              size_t target = jump_target(proto, pc);
+              e->label[target] = true;
+              if (target <= pc)
+                  e->entry[target] = true;
+          }
+            break;
+
+          case OP_IF:
+          case OP_IFNOT:
+            e->label[pc + 2] = true;
+            break;
+
+          case OP_MOVE: case OP_LOAD_INT: case OP_LOAD_UPVAL:
+          case OP_LOAD_CELL: case OP_LOAD_GLOBAL:
+          case OP_TAILCALL_SELF: case OP_TAILCALL_SELF0:
+          case OP_RETURN: case OP_RETURN_N:
+          case OP_CLOSE:
+            break;
+
+          default:
+            IMPOSSIBLE("unrecognized opcode: %u", VM_OP(instr));
+        }
+    }
+}
+
+/* Whether `proto' calls anything, and whether it makes closures. */
+static void scan(const proto_t *proto, bool *calls, bool *closes)
+{
+    *calls = *closes = false;
+    for (size_t pc = 0; pc < proto->code_len; ++pc) {
+        switch ((enum op) VM_OP(proto->code[pc])) {
+          case OP_CALL_CELL: case OP_CALL_REG:
+          case OP_CALL_CELL_N: case OP_CALL_REG_N:
+          case OP_TAILCALL_CELL: case OP_TAILCALL_REG:
+          case OP_TAILCALL_CELL0: case OP_TAILCALL_REG0:
+            *calls = true;
+            break;
+
+          case OP_CLOSE:
+            *closes = true;
+            break;
+
+          case OP_MOVE: case OP_LOAD_INT: case OP_LOAD_UPVAL:
+          case OP_LOAD_CELL: case OP_LOAD_GLOBAL:
+          case OP_TAILCALL_SELF: case OP_TAILCALL_SELF0:
+          case OP_JUMP: case OP_RETURN: case OP_RETURN_N:
+          case OP_IF: case OP_IFNOT:
+            break;
+
+          default:
+            IMPOSSIBLE("unrecognized opcode: %u", VM_OP(proto->code[pc]));
+        }
+    }
+}
+
+static void emit_string(FILE *out, const char *str)
+{
+    if (!str) {
+        fputs("NULL", out);
+        return;
+    }
+    putc('"', out);
+    for (const unsigned char *p = (const unsigned char *) str; *p; ++p) {
+        if (*p == '"' || *p == '\\')
+            fprintf(out, "\\%c", *p);
+        else if (*p < 0x20 || *p >= 0x7f)
+            fprintf(out, "\\%03o", *p);
+        else
+            putc(*p, out);
+    }
+    putc('"', out);
+}
+
+static bool emit_proto(FILE *out, const char *prefix, size_t index,
+                       const proto_t *proto)
+{
+    /* Registers can live in locals if nobody else looks at them while we
+     * run, which calls and closing over them would. */
+    bool calls, closes;
+    scan(proto, &calls, &closes);
+    emit_t e = {
+        .out = out,
+        .proto = proto,
+        .locals = !calls && !closes && proto->num_regs <= AOT_MAX_LOCALS,
+        .entry = calloc(proto->code_len + 1, sizeof(bool)),
+        .label = calloc(proto->code_len + 1, sizeof(bool)),
+    };
+    if (!e.entry || !e.label) {
+        free(e.entry);
+        free(e.label);
+        return false;
+    }
+    find_labels(&e);
+
+    fprintf(out, "\n/* ");
+    emit_string(out, proto->name);
+    fprintf(out, " */\nstatic const instr_t %s_code_%zu[] = {", prefix, index);
+    for (size_t pc = 0; pc < proto->code_len; ++pc)
+        fprintf(out, "%s0x%08" PRIx32 ",", pc % 6 ? " " : "\n    ",
+                (uint32_t) proto->code[pc]);
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "static int %s_%zu(vm_state_t *S, unsigned depth)\n{\n"
+            "    val_t *const regs = S->regs;\n"
+            "    closure_t *const func = S->func;\n"
+            "    frame_t *const frame = S->frame;\n"
+            "    instr_t *const code = func->proto->code;\n", prefix, index);
+    if (calls)
+        fprintf(out, "    int status;\n");
+    if (e.locals && proto->num_regs) {
+        for (unsigned r = 0; r < proto->num_regs; ++r)
+            fprintf(out, "%s r%u", r ? "," : "    val_t", r);
+        fprintf(out, ";\n");
+    }
+    fprintf(out, "    (void) regs, (void) func, (void) frame, (void) depth;\n");
+    reload(&e, 4, -1);
+
+    fprintf(out, "    switch (S->ip - code) {\n");
+    for (size_t pc = 0; pc < proto->code_len; ++pc)
+        if (e.entry[pc])
+            fprintf(out, "      case %zu: goto L%zu;\n", pc, pc);
+    fprintf(out, "      default: return AOT_EXIT;\n    }\n");
+
+    for (size_t pc = 0; pc < proto->code_len; ++pc) {
+        /* The JUMP after a conditional is unreachable, unless labelled. */
+        if (pc && (VM_OP(proto->code[pc-1]) == OP_IF
+                   || VM_OP(proto->code[pc-1]) == OP_IFNOT) && !e.label[pc])
+            continue;
+        if (e.label[pc])
+            fprintf(out, "  L%zu:\n", pc);
+        emit_instr(&e, pc);
+    }
+    fprintf(out, "}\n");
+
+    free(e.entry);
+    free(e.label);
+    return true;
+}
+
+/* Appends `proto' to the growable array `*protos'. */
+static bool push(const proto_t ***protos, size_t *num, size_t *cap,
+                 const proto_t *proto)
+{
+    if (*num == *cap) {
+        size_t new_cap = *cap ? 2 * *cap : 16;
+        const proto_t **grown = realloc(*protos, new_cap * sizeof *grown);
+        if (!grown)
+            return false;
+        *protos = grown;
+        *cap = new_cap;
+    }
+    (*protos)[(*num)++] = proto;
+    return true;
+}
+
+bool eris_aot_emit(FILE *out, const char *prefix,
+                   proto_t *const *protos, size_t num_protos)
+{
+    /* Protos to visit, and those we've compiled, each code only once (keyed
+     * by code, in a JudyHS array, as the registry is). */
+    const proto_t **todo = NULL, **emitted = NULL;
+    size_t num_todo = 0, cap_todo = 0, num_emitted = 0, cap_emitted = 0;
+    Pvoid_t seen = NULL;
+    bool ok = false;
+
+    fprintf(out, "/* Compiled ahead of time by eris_aot_emit; see src/aot.h. "
+            "*/\n#include <string.h>\n\n#include \"aot.h\"\n"
+            "#include \"misc.h\"\n#include \"types.h\"\n#include \"vm.h\"\n");
+
+    for (size_t i = num_protos; i-- > 0;)
+        if (!push(&todo, &num_todo, &cap_todo, protos[i]))
+            goto done;
+
+    while (num_todo) {
+        const proto_t *proto = todo[--num_todo];
+        assert (proto->verified);
+        PPvoid_t slot = JudyHSIns(&seen, proto->code,
+                                  proto->code_len * sizeof *proto->code, PJE0);
+        if (slot == PPJERR)
+            goto done;
+        if (*slot)
+            continue;
+        *slot = (void *) proto;
+
+        if (!emit_proto(out, prefix, num_emitted, proto)
+            || !push(&emitted, &num_emitted, &cap_emitted, proto))
+            goto done;
+        for (size_t i = proto->num_local_funcs; i-- > 0;)
+            if (!push(&todo, &num_todo, &cap_todo, proto->local_funcs[i]))
+                goto done;
+    }
+
+    if (num_emitted) {
+        fprintf(out, "\nstatic const struct eris_aot_entry %s_entries[] = {\n",
+                prefix);
+        for (size_t i = 0; i < num_emitted; ++i) {
+            fprintf(out, "    { ");
+            emit_string(out, emitted[i]->name);
+            fprintf(out, ", %s_code_%zu, %zu, %u, %u, %s_%zu },\n",
+                    prefix, i, emitted[i]->code_len,
+                    (unsigned) emitted[i]->num_args,
+                    (unsigned) emitted[i]->num_regs, prefix, i);
+        }
+        fprintf(out, "};\n\n__attribute__((constructor))\n"
+                "static void %s_register(void)\n{\n"
+                "    eris_aot_register(%s_entries, %zu, AOT_ABI);\n}\n",
+                prefix, prefix, num_emitted);
+    }
+    ok = !ferror(out);
+
+  done:
+    JudyHSFreeArray(&seen, PJE0);
+    free(todo);
+    free(emitted);
+    return ok;
+}
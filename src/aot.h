@@ -0,0 +1,226 @@
+/* Ahead-of-time compilation, of bytecode to C.
+ *
+ * eris_aot_emit translates verified protos into a C file with one function per
+ * proto. Compiled with the same flags as liberis, against its internal headers
+ * (src/ and the build's include/), and linked with the static library, the
+ * file registers its functions at startup. eris_aot_attach then gives each
+ * proto whose code is identical to one of theirs that function, which the VM
+ * runs from then on in place of interpreting the proto or JIT-compiling it.
+ *
+ * Compiled code follows the bytecode instruction by instruction: jumps become
+ * gotos, and self tail calls loops. A proto that neither calls nor closes over
+ * anything, and has few registers, keeps them in C locals, storing them to its
+ * register window only where anyone else might look: when allocating, and on
+ * leaving. Others keep them in the window. Calls go through eris_aot_invoke,
+ * which calls closures with compiled code directly in C, and builtins through
+ * eris_vm_builtin; a compiled tail call returns AOT_TAILCALL, and the
+ * trampoline in eris_aot_call makes it.
+ *
+ * Everything else it leaves to the interpreter, like the JIT (see jit.h): it
+ * brings the VM state up to date and returns AOT_EXIT. That covers calling
+ * interpreted closures, returning from the outermost compiled call, builtins
+ * that raise or switch fibers, allocation failing, profiling samples and
+ * collections (see gc.h) falling due, and compiled calls nesting too deep.
+ * The interpreter gets back into compiled code where the JIT's does, so a
+ * compiled proto can be entered at its start, after each call, and at the
+ * target of each backward jump.
+ *
+ * There's no file format for compiled code yet, so the protos to compile come
+ * from whoever builds them; bench -E (see src/bench/bench.c) is one.
+ */
+#ifndef _AOT_H_
+#define _AOT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gc.h"
+#include "misc.h"
+#include "prof.h"
+#include "runtime.h"
+#include "stats.h"
+#include "types.h"
+#include "vm.h"
+
+/* How deep compiled calls nest in C before we leave the rest to the
+ * interpreter, to keep the C stack bounded. */
+#define AOT_MAX_DEPTH 256
+
+/* The most registers a proto can have and keep them in C locals. Storing more
+ * at every exit would cost more than it saves. */
+#define AOT_MAX_LOCALS 16
+
+/* What compiled code and eris_aot_invoke return, besides a compiled function's
+ * count of values returned. */
+enum {
+    /* The call's done; carry on. (Only from eris_aot_invoke.) */
+    AOT_DONE = 0,
+    /* `*S' is where the interpreter should carry on from. */
+    AOT_EXIT = -1,
+    /* `*S' is at the start of the closure we're tail-calling. */
+    AOT_TAILCALL = -2,
+};
+
+/* Compiled code runs in the innermost frame `*S', which it keeps up to date
+ * for the GC and profiler. `depth' is how many compiled calls we're inside: at
+ * 0, we're running for the interpreter, and leave returns to it. */
+typedef int aot_func_t(vm_state_t *S, unsigned depth);
+
+/* What we know of the proto compiled: its code (a copy), and what else the
+ * compiled code assumes of it. */
+struct eris_aot_entry {
+    const char *name;
+    const instr_t *code;
+    size_t code_len;
+    nargs_t num_args;
+    uint16_t num_regs;
+    aot_func_t *func;
+};
+
+/* Compiled code must agree with liberis on these. */
+#ifdef ERIS_NANBOX
+#define AOT_REPR 1u
+#elif defined ERIS_NIL_NULL
+#define AOT_REPR 2u
+#else
+#define AOT_REPR 0u
+#endif
+#define AOT_ABI ((unsigned) (sizeof(eris_thread_t) << 16            \
+                             ^ sizeof(proto_t) << 8 ^ AOT_REPR))
+
+/* Whether LOAD_INT can allocate. Only without NaN-boxing, since its operand is
+ * 16 bits. */
+#ifdef ERIS_NANBOX
+#define AOT_LOAD_INT_ALLOCATES 0
+#else
+#define AOT_LOAD_INT_ALLOCATES 1
+#endif
+
+/* Compiled code does the interpreter's counting; see stats.h. */
+#define AOT_COUNT(op) STAT(S->thread, instrs[op]++)
+
+/* Writes C compiling `protos', their local functions, theirs, and so on, each
+ * distinct code only once, to `out'. `prefix' starts the name of everything it
+ * defines, so must be a C identifier. The protos must be verified.
+ *
+ * Returns false iff writing failed.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_aot_emit(FILE *out, const char *prefix,
+                   proto_t *const *protos, size_t num_protos);
+
+/* Registers compiled code's `num' entries. Called by the code itself as it's
+ * loaded, with its idea of AOT_ABI, which must match ours. */
+void eris_aot_register(const struct eris_aot_entry *entries, size_t num,
+                       unsigned abi);
+
+/* If code compiled ahead of time has `proto's code, has the VM run that from
+ * now on. `proto' must be verified, and its code mustn't change afterward.
+ * Returns whether it found any. */
+bool eris_aot_attach(proto_t *proto);
+
+/* Runs `S->func's compiled code from `S->ip', and then that of whatever it
+ * tail-calls, until one returns or exits. */
+int eris_aot_call(vm_state_t *S, unsigned depth);
+
+/* For the interpreter's JIT_RUN: if `S->func' has compiled code, runs it until
+ * it exits, and returns true. `*S' may then be in another proto, or fiber. */
+static inline bool eris_aot_run(vm_state_t *S)
+{
+    if (!__atomic_load_n(&S->func->proto->aot, __ATOMIC_ACQUIRE))
+        return false;
+    eris_aot_call(S, 0);
+    return true;
+}
+
+/* For compiled code: the call at `S->ip', to `funcval'. Calls builtins, and
+ * closures with compiled code, returning AOT_DONE, or for tail calls of the
+ * latter, AOT_TAILCALL. Leaves anything else at the call to the interpreter.
+ */
+static inline
+int eris_aot_invoke(vm_state_t *S, val_t funcval, reg_t offset,
+                    nargs_t nargs, nresults_t nresults, bool tail_call,
+                    unsigned depth)
+{
+    /* Errors are the interpreter's to raise. */
+    if (UNLIKELY(!VAL_IS_OBJ(funcval)))
+        return AOT_EXIT;
+    obj_t *funcobj = VAL_OBJ(funcval);
+
+    if (LIKELY(OBJ_ISA(closure, funcobj))) {
+        closure_t *func = OBJ_CONTENTS(closure, funcobj);
+        if (!__atomic_load_n(&func->proto->aot, __ATOMIC_ACQUIRE)
+            || UNLIKELY(nargs != func->proto->num_args)
+            || (!tail_call && depth >= AOT_MAX_DEPTH))
+            return AOT_EXIT;
+        STAT(S->thread, instrs[VM_OP(*S->ip)]++);
+        STAT(S->thread, closure_calls++);
+
+        if (tail_call) {
+            STAT(S->thread, tail_calls++);
+            if (offset)
+                memmove(S->regs, S->regs + offset, sizeof(val_t) * nargs);
+            S->frame->data.call.func = func;
+            S->func = func;
+            S->ip = func->proto->code;
+            eris_prof_poll(*S);
+            eris_gc_poll(*S);
+            return AOT_TAILCALL;
+        }
+
+        /* As the interpreter would, but we return here rather than to the
+         * caller's code, and put things back as they were. */
+        STAT(S->thread, non_tail_calls++);
+        const vm_state_t caller = *S;
+        S->frame->data.call.ip = S->ip;
+        --S->frame;
+        S->frame->tag = FRAME_CALL;
+        S->frame->data.call.func = func;
+        S->regs += offset;
+        S->func = func;
+        S->ip = func->proto->code;
+        eris_prof_poll(*S);
+        eris_gc_poll(*S);
+
+        int nreturned = eris_aot_call(S, depth + 1);
+        if (nreturned < 0)
+            return AOT_EXIT;
+        *S = caller;
+        if (UNLIKELY(VM_IS_CALL_N(*S->ip))) {
+            for (nresults_t i = (nresults_t) nreturned; i < nresults; ++i)
+                S->regs[offset + i] = eris_nil;
+        }
+        else if (UNLIKELY(!nreturned)) {
+            S->regs[offset] = eris_nil;
+        }
+        return AOT_DONE;
+    }
+
+    if (LIKELY(OBJ_ISA(builtin, funcobj))) {
+        builtin_t *builtin = OBJ_CONTENTS(builtin, funcobj);
+        if (UNLIKELY(nargs != builtin->num_args)
+            && (UNLIKELY(!builtin->variadic)
+                || UNLIKELY(nargs < builtin->num_args)))
+            return AOT_EXIT;
+        STAT(S->thread, instrs[VM_OP(*S->ip)]++);
+        if (!eris_vm_builtin(S, builtin, offset, nargs, nresults))
+            return AOT_EXIT;
+        STAT(S->thread, builtin_calls++);
+        if (tail_call)
+            STAT(S->thread, tail_calls++);
+        else
+            STAT(S->thread, non_tail_calls++);
+        return AOT_DONE;
+    }
+
+    return AOT_EXIT;
+}
+
+/* For compiled code: CLOSE, at `S->ip'. Returns false iff allocation failed. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_aot_close(vm_state_t *S, reg_t dest, longarg_t index);
+
+#endif
@@ -0,0 +1,405 @@
+/* Implementation of the stack-based C API in eris/eris.h. */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <eris/eris.h>
+
+#include "gc.h"
+#include "misc.h"
+#include "num.h"
+#include "runtime.h"
+#include "serial.h"
+#include "str.h"
+#include "types.h"
+#include "vm.h"
+
+/* The value in slot `idx', counting down from the top of the stack. Calls that
+ * touch slots enter the VM meanwhile, so that no other thread starts a
+ * collection under them; see gc.h. */
+#define SLOT(S, idx) ((S)->regs[(S)->num_regs - 1 - (idx)])
+
+static void reserve(eris_frame_t *S, size_t num)
+{
+    eris_thread_t *thread = S->thread;
+    if (UNLIKELY(S->regs + S->num_regs + num
+                 > thread->regs + thread->num_regs))
+        eris_bug("eris stack overflow");
+}
+
+static void push(eris_frame_t *S, val_t v)
+{
+    reserve(S, 1);
+    S->regs[S->num_regs++] = v;
+}
+
+
+/* Frames. */
+eris_frame_t *eris_frame_begin(eris_thread_t *thread)
+{
+    /* TODO: nested frames, for C functions called from eris. */
+    if (thread->api_frame)
+        return NULL;
+    eris_frame_t *S = malloc(sizeof *S);
+    if (!S)
+        return NULL;
+    S->regs = thread->regs;
+    S->num_regs = 0;
+    S->frame = thread->frames;
+    S->thread = thread;
+    eris_gc_enter(thread);
+    thread->api_frame = S;
+    eris_gc_leave(thread);
+    return S;
+}
+
+void eris_frame_end(eris_frame_t *S)
+{
+    eris_gc_enter(S->thread);
+    S->thread->api_frame = NULL;
+    eris_gc_leave(S->thread);
+    free(S);
+}
+
+eris_thread_t *eris_frame_thread(eris_frame_t *S) { return S->thread; }
+
+
+/* Manipulating the stack. */
+void eris_pop(eris_frame_t *S, size_t num)
+{
+    assert (num <= S->num_regs);
+    eris_gc_enter(S->thread);
+    S->num_regs -= num;
+    eris_gc_leave(S->thread);
+}
+
+void eris_extend(eris_frame_t *S, size_t num)
+{
+    reserve(S, num);
+    eris_gc_enter(S->thread);
+    for (size_t i = 0; i < num; ++i)
+        S->regs[S->num_regs++] = eris_nil;
+    eris_gc_leave(S->thread);
+}
+
+void eris_move(eris_frame_t *S, eris_idx_t dst, eris_idx_t src)
+{
+    assert (dst < S->num_regs && src < S->num_regs);
+    eris_gc_enter(S->thread);
+    SLOT(S, dst) = SLOT(S, src);
+    eris_gc_leave(S->thread);
+}
+
+void eris_copy(eris_frame_t *S, eris_idx_t dst, eris_idx_t src, size_t num)
+{
+    if (!num)
+        return;
+    assert (dst + num <= S->num_regs && src + num <= S->num_regs);
+    /* The slots are contiguous, running downward from slot `idx+num-1'. */
+    eris_gc_enter(S->thread);
+    memmove(&SLOT(S, dst + num - 1), &SLOT(S, src + num - 1),
+            num * sizeof(val_t));
+    eris_gc_leave(S->thread);
+}
+
+void eris_dup(eris_frame_t *S, eris_idx_t idx)
+{
+    assert (idx < S->num_regs);
+    eris_gc_enter(S->thread);
+    push(S, SLOT(S, idx));
+    eris_gc_leave(S->thread);
+}
+
+eris_idx_t eris_num_slots(eris_frame_t *S) { return S->num_regs; }
+
+
+/* Calling functions. */
+bool eris_call_n(eris_frame_t *S, eris_idx_t func_idx, size_t nargs,
+                 size_t *nresultsp)
+{
+    assert (func_idx >= nargs && func_idx < S->num_regs);
+    assert (nargs <= UINT8_MAX);
+
+    /* Lay out the function and its arguments just above the stack, call it,
+     * and replace the arguments with its results. */
+    reserve(S, 1 + nargs);
+    eris_gc_enter(S->thread);
+    val_t *base = S->regs + S->num_regs;
+    base[0] = SLOT(S, func_idx);
+    memcpy(base + 1, base - nargs, nargs * sizeof(val_t));
+
+    size_t nresults;
+    bool ok = eris_vm_call(S->thread, base, S->frame, (nargs_t) nargs,
+                           &nresults);
+    memmove(base - nargs, base, nresults * sizeof(val_t));
+    S->num_regs = S->num_regs - nargs + nresults;
+    eris_gc_leave(S->thread);
+    *nresultsp = nresults;
+    return ok;
+}
+
+bool eris_call(eris_frame_t *S, eris_idx_t func_idx, size_t nargs)
+{
+    size_t nresults;
+    bool ok = eris_call_n(S, func_idx, nargs, &nresults);
+    /* Keep only the first return value, or nil if there were none. */
+    if (nresults) {
+        eris_pop(S, nresults - 1);
+    }
+    else {
+        eris_gc_enter(S->thread);
+        push(S, eris_nil);
+        eris_gc_leave(S->thread);
+    }
+    return ok;
+}
+
+
+/* Pushing data onto the stack. */
+void eris_push_nil(eris_frame_t *S)
+{
+    eris_gc_enter(S->thread);
+    push(S, eris_nil);
+    eris_gc_leave(S->thread);
+}
+
+bool eris_push_int(eris_frame_t *S, eris_int_t i)
+{
+    val_t v;
+    eris_gc_api_poll(S->thread);
+    eris_gc_enter(S->thread);
+    bool ok = make_fixnum(&v, i, S->thread, S->frame);
+    if (ok)
+        push(S, v);
+    eris_gc_leave(S->thread);
+    return ok;
+}
+
+bool eris_push_float(eris_frame_t *S, eris_float_t f)
+{
+    val_t v;
+    eris_gc_api_poll(S->thread);
+    eris_gc_enter(S->thread);
+    bool ok = make_flonum(&v, f, S->thread, S->frame);
+    if (ok)
+        push(S, v);
+    eris_gc_leave(S->thread);
+    return ok;
+}
+
+
+/* Borrowed views and pinning. */
+static bool view(val_t v, const char **data, size_t *len)
+{
+    string_t *str;
+    symbol_t *sym;
+    if (VAL_AS(string, v, &str)) {
+        *data = str->data;
+        *len = CONTENTS_LEN(str);
+    } else if (VAL_AS(symbol, v, &sym)) {
+        *data = sym->data;
+        *len = CONTENTS_LEN(sym);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool eris_view_string(eris_frame_t *S, eris_idx_t idx,
+                      const char **data, size_t *len)
+{
+    assert (idx < S->num_regs);
+    return VAL_ISA(string, SLOT(S, idx)) && view(SLOT(S, idx), data, len);
+}
+
+bool eris_view_symbol(eris_frame_t *S, eris_idx_t idx,
+                      const char **data, size_t *len)
+{
+    assert (idx < S->num_regs);
+    return VAL_ISA(symbol, SLOT(S, idx)) && view(SLOT(S, idx), data, len);
+}
+
+void eris_pin(eris_frame_t *S, eris_idx_t idx)
+{
+    assert (idx < S->num_regs);
+    val_t v = SLOT(S, idx);
+    if (!VAL_IS_NIL(v) && VAL_IS_OBJ(v))
+        obj_pin(VAL_OBJ(v));
+}
+
+void eris_unpin(eris_frame_t *S, eris_idx_t idx)
+{
+    assert (idx < S->num_regs);
+    val_t v = SLOT(S, idx);
+    if (!VAL_IS_NIL(v) && VAL_IS_OBJ(v))
+        obj_unpin(VAL_OBJ(v));
+}
+
+
+/* Bulk data. We push each seq before filling it in, so that it's in a slot
+ * while we allocate its elements. push_seq enters the VM; its callers leave
+ * once they're done, or pop the seq with pop_seq if they fail. It fails,
+ * having left, iff allocation failed. */
+static seq_t *push_seq(eris_frame_t *S, size_t n)
+{
+    seq_t *seq;
+    eris_gc_api_poll(S->thread);
+    reserve(S, 1);
+    eris_gc_enter(S->thread);
+    if (!new_seq(&seq, n, S->thread, S->frame)) {
+        eris_gc_leave(S->thread);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; ++i)
+        seq->data[i] = eris_nil;
+    push(S, CONTENTS_VAL(seq));
+    return seq;
+}
+
+static bool pop_seq(eris_frame_t *S)
+{
+    eris_pop(S, 1);
+    eris_gc_leave(S->thread);
+    return false;
+}
+
+bool eris_push_int_seq(eris_frame_t *S, size_t n, const eris_int_t *ints)
+{
+    seq_t *seq = push_seq(S, n);
+    if (!seq)
+        return false;
+    for (size_t i = 0; i < n; ++i)
+        if (!make_fixnum(&seq->data[i], ints[i], S->thread, S->frame))
+            return pop_seq(S);
+    eris_gc_leave(S->thread);
+    return true;
+}
+
+bool eris_push_float_seq(eris_frame_t *S, size_t n,
+                         const eris_float_t *floats)
+{
+    seq_t *seq = push_seq(S, n);
+    if (!seq)
+        return false;
+    for (size_t i = 0; i < n; ++i)
+        if (!make_flonum(&seq->data[i], floats[i], S->thread, S->frame))
+            return pop_seq(S);
+    eris_gc_leave(S->thread);
+    return true;
+}
+
+bool eris_push_string_seq(eris_frame_t *S, size_t n,
+                          const char *const *strings, const size_t *lens)
+{
+    seq_t *seq = push_seq(S, n);
+    if (!seq)
+        return false;
+    for (size_t i = 0; i < n; ++i) {
+        string_t *str;
+        size_t len = lens ? lens[i] : strlen(strings[i]);
+        if (!eris_str_new(&str, strings[i], len, S->thread, S->frame))
+            return pop_seq(S);
+        seq->data[i] = CONTENTS_VAL(str);
+    }
+    eris_gc_leave(S->thread);
+    return true;
+}
+
+/* The elements of the seq or vec `v'. */
+static bool elems(val_t v, const val_t **data, size_t *len)
+{
+    seq_t *seq;
+    vec_t *vec;
+    if (VAL_AS(seq, v, &seq)) {
+        *data = seq->data;
+        *len = CONTENTS_LEN(seq);
+    } else if (VAL_AS(vec, v, &vec)) {
+        *data = vec->data;
+        *len = vec->len;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/* Elements `start' through `start+n-1' of the seq or vec in slot `idx'. */
+static bool elem_range(eris_frame_t *S, eris_idx_t idx, size_t start,
+                       size_t n, const val_t **out)
+{
+    const val_t *data;
+    size_t len;
+    assert (idx < S->num_regs);
+    if (!elems(SLOT(S, idx), &data, &len) || start > len || n > len - start)
+        return false;
+    *out = data + start;
+    return true;
+}
+
+bool eris_check_seq_len(eris_frame_t *S, eris_idx_t idx, size_t *lenp)
+{
+    const val_t *data;
+    assert (idx < S->num_regs);
+    return elems(SLOT(S, idx), &data, lenp);
+}
+
+bool eris_get_ints(eris_frame_t *S, eris_idx_t idx, size_t start, size_t n,
+                   eris_int_t *out)
+{
+    const val_t *data;
+    if (!elem_range(S, idx, start, n, &data))
+        return false;
+    for (size_t i = 0; i < n; ++i)
+        if (!get_fixnum(data[i], &out[i]))
+            return false;
+    return true;
+}
+
+bool eris_get_floats(eris_frame_t *S, eris_idx_t idx, size_t start, size_t n,
+                     eris_float_t *out)
+{
+    const val_t *data;
+    if (!elem_range(S, idx, start, n, &data))
+        return false;
+    for (size_t i = 0; i < n; ++i)
+        if (!get_real(data[i], &out[i])
+            && !eris_num_to_double(data[i], &out[i]))
+            return false;
+    return true;
+}
+
+bool eris_view_strings(eris_frame_t *S, eris_idx_t idx, size_t start, size_t n,
+                       const char **data, size_t *lens)
+{
+    const val_t *elem;
+    if (!elem_range(S, idx, start, n, &elem))
+        return false;
+    for (size_t i = 0; i < n; ++i)
+        if (!VAL_ISA(string, elem[i]) || !view(elem[i], &data[i], &lens[i]))
+            return false;
+    return true;
+}
+
+/* Serialization. */
+bool eris_serialize(eris_frame_t *S, eris_idx_t idx, void **buf, size_t *len)
+{
+    assert (idx < S->num_regs);
+    return eris_serial_encode(SLOT(S, idx), buf, len);
+}
+
+bool eris_deserialize(eris_frame_t *S, void *buf, size_t len)
+{
+    val_t v;
+    eris_gc_api_poll(S->thread);
+    reserve(S, 1);
+    eris_gc_enter(S->thread);
+    bool ok = eris_serial_decode(&v, buf, len, S->thread, S->frame);
+    if (ok)
+        push(S, v);
+    eris_gc_leave(S->thread);
+    return ok;
+}
+
+void eris_release_buffer(eris_frame_t *S, void *buf)
+{
+    eris_serial_release(S->thread, buf);
+}
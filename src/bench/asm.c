@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aot.h"
+#include "asm.h"
+#include "loader.h"
+#include "misc.h"
+#include "runtime.h"
+#include "types.h"
+#include "vm.h"
+
+#define NO_LABEL ((size_t) -1)
+
+bool asm_optimize = false;
+bool asm_aot = false;
+size_t asm_num_attached = 0;
+proto_t **asm_protos = NULL;
+size_t asm_num_protos = 0;
+
+void asm_init(asm_t *a, eris_thread_t *thread)
+{
+    memset(a, 0, sizeof *a);
+    for (size_t i = 0; i < ASM_MAX_LABELS; ++i)
+        a->labels[i] = NO_LABEL;
+    a->thread = thread;
+}
+
+static void emit(asm_t *a, instr_t instr)
+{
+    if (a->len == a->cap) {
+        a->cap = a->cap ? 2 * a->cap : 32;
+        if (!(a->code = realloc(a->code, a->cap * sizeof *a->code)))
+            eris_bug("asm: out of memory");
+    }
+    a->code[a->len++] = instr;
+}
+
+void asm_op(asm_t *a, enum op op, unsigned a1, unsigned a2, unsigned a3)
+{
+    if (a1 > 0xff || a2 > 0xff || a3 > 0xff)
+        eris_bug("asm: argument out of range");
+    emit(a, VM_INSTR(op, a1, a2, a3));
+}
+
+void asm_op_long(asm_t *a, enum op op, unsigned a1, int longarg)
+{
+    if (a1 > 0xff || longarg < INT16_MIN || longarg > UINT16_MAX)
+        eris_bug("asm: argument out of range");
+    emit(a, VM_INSTR_LONG(op, a1, (longarg_t) longarg));
+}
+
+void asm_label(asm_t *a, unsigned label)
+{
+    if (label >= ASM_MAX_LABELS || a->labels[label] != NO_LABEL)
+        eris_bug("asm: bad or duplicate label %u", label);
+    a->labels[label] = a->len;
+}
+
+void asm_jump(asm_t *a, unsigned label)
+{
+    if (label >= ASM_MAX_LABELS)
+        eris_bug("asm: bad label %u", label);
+    a->fixups = realloc(a->fixups, (a->num_fixups + 1) * sizeof *a->fixups);
+    if (!a->fixups)
+        eris_bug("asm: out of memory");
+    a->fixups[a->num_fixups].pc = a->len;
+    a->fixups[a->num_fixups].label = label;
+    ++a->num_fixups;
+    emit(a, VM_INSTR_LONG(OP_JUMP, 0, 0));
+}
+
+unsigned asm_local(asm_t *a, proto_t *proto)
+{
+    if (a->num_local_funcs == ASM_MAX_LOCAL_FUNCS)
+        eris_bug("asm: too many local functions");
+    a->local_funcs[a->num_local_funcs] = proto;
+    return a->num_local_funcs++;
+}
+
+proto_t *asm_proto_unverified(asm_t *a, const char *name, nargs_t num_args,
+                              upval_t num_upvals, uint16_t num_regs)
+{
+    for (size_t i = 0; i < a->num_fixups; ++i) {
+        size_t pc = a->fixups[i].pc, target = a->labels[a->fixups[i].label];
+        if (target == NO_LABEL)
+            eris_bug("asm: %s: label %u never placed", name,
+                     a->fixups[i].label);
+        a->code[pc] = VM_INSTR_LONG(OP_JUMP, 0,
+                                    (longarg_t) (signed_longarg_t)
+                                    ((ptrdiff_t) target - (ptrdiff_t) pc));
+    }
+    free(a->fixups);
+
+    proto_t *proto;
+    if (!new_proto(&proto, a->num_local_funcs, a->thread, NULL))
+        eris_bug("asm: out of memory");
+    memset(proto, 0, sizeof *proto);
+    proto->name = name;
+    proto->code = a->code;
+    proto->code_len = a->len;
+    proto->num_args = num_args;
+    proto->num_upvals = num_upvals;
+    proto->num_regs = num_regs;
+    proto->num_local_funcs = a->num_local_funcs;
+    memcpy(proto->local_funcs, a->local_funcs,
+           a->num_local_funcs * sizeof *a->local_funcs);
+
+    if (!num_upvals)
+        asm_capture(proto, a->thread, 0, NULL, 0, NULL);
+    return proto;
+}
+
+proto_t *asm_proto(asm_t *a, const char *name, nargs_t num_args,
+                   upval_t num_upvals, uint16_t num_regs)
+{
+    proto_t *proto = asm_proto_unverified(a, name, num_args, num_upvals,
+                                          num_regs);
+    const char *why;
+    if (!eris_proto_verify(proto, &why))
+        eris_bug("asm: %s doesn't verify: %s", name, why);
+
+    if (asm_optimize) {
+        size_t before = proto->code_len;
+        if (!eris_proto_optimize(proto))
+            eris_bug("asm: out of memory");
+        if (!eris_proto_verify(proto, &why))
+            eris_bug("asm: %s doesn't verify once optimized: %s", name, why);
+        fprintf(stderr, "%s\t%zu\t%zu\n", name, before, proto->code_len);
+    }
+    if (asm_aot && eris_aot_attach(proto))
+        ++asm_num_attached;
+
+    asm_protos = realloc(asm_protos, (asm_num_protos + 1) * sizeof *asm_protos);
+    if (!asm_protos)
+        eris_bug("asm: out of memory");
+    asm_protos[asm_num_protos++] = proto;
+    return proto;
+}
+
+void asm_capture(proto_t *proto, eris_thread_t *thread,
+                 size_t n_upval_idxs, const upval_t *upval_idxs,
+                 size_t n_reg_idxs, const reg_t *reg_idxs)
+{
+    if (!eris_proto_set_capture(proto, n_upval_idxs, upval_idxs,
+                                n_reg_idxs, reg_idxs, thread, NULL))
+        eris_bug("asm: out of memory");
+}
+
+closure_t *asm_closure(eris_thread_t *thread, proto_t *proto,
+                       const val_t *upvals)
+{
+    closure_t *closure;
+    if (!new_closure(&closure, proto->num_upvals, thread, NULL))
+        eris_bug("asm: out of memory");
+    closure->proto = proto;
+    if (proto->num_upvals)
+        memcpy(closure->upvals, upvals, proto->num_upvals * sizeof *upvals);
+    return closure;
+}
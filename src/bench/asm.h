@@ -0,0 +1,69 @@
+/* A tiny bytecode assembler, for building protos by hand in benchmarks. It
+ * aborts via eris_bug on any error, since it's only for our own programs. */
+#ifndef _BENCH_ASM_H_
+#define _BENCH_ASM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "misc.h"
+#include "types.h"
+
+#define ASM_MAX_LABELS 16
+#define ASM_MAX_LOCAL_FUNCS 16
+
+typedef struct {
+    instr_t *code;
+    size_t len, cap;
+    /* Where each label is, or (size_t) -1 if not yet placed. */
+    size_t labels[ASM_MAX_LABELS];
+    /* The JUMPs to patch once we know where their labels are. */
+    struct { size_t pc; unsigned label; } *fixups;
+    size_t num_fixups;
+    proto_t *local_funcs[ASM_MAX_LOCAL_FUNCS];
+    size_t num_local_funcs;
+    eris_thread_t *thread;
+} asm_t;
+
+void asm_init(asm_t *a, eris_thread_t *thread);
+void asm_op(asm_t *a, enum op op, unsigned a1, unsigned a2, unsigned a3);
+void asm_op_long(asm_t *a, enum op op, unsigned a1, int longarg);
+/* Places `label' at the next instruction. */
+void asm_label(asm_t *a, unsigned label);
+/* Emits a JUMP to `label', which may be placed before or after. */
+void asm_jump(asm_t *a, unsigned label);
+/* Adds `proto' to our local functions; returns its index, for CLOSE. */
+unsigned asm_local(asm_t *a, proto_t *proto);
+
+/* If set, asm_proto also optimizes the protos it makes (see
+ * eris_proto_optimize), and reports how many instructions each had before and
+ * after on stderr. */
+extern bool asm_optimize;
+
+/* If set, asm_proto also attaches any code compiled ahead of time for the
+ * protos it makes (see aot.h), counting those it finds in asm_num_attached. */
+extern bool asm_aot;
+extern size_t asm_num_attached;
+
+/* Every proto asm_proto has made, in order. */
+extern proto_t **asm_protos;
+extern size_t asm_num_protos;
+
+/* Finishes assembling a proto, and verifies it. `a' can't be used again. A
+ * proto with upvals that we'll CLOSE over needs asm_capture first; see
+ * eris_proto_set_capture. */
+proto_t *asm_proto(asm_t *a, const char *name, nargs_t num_args,
+                   upval_t num_upvals, uint16_t num_regs);
+/* Likewise, but neither verifies nor optimizes it, nor counts it among
+ * asm_protos, so that it runs in the interpreter's checked loop. */
+proto_t *asm_proto_unverified(asm_t *a, const char *name, nargs_t num_args,
+                              upval_t num_upvals, uint16_t num_regs);
+void asm_capture(proto_t *proto, eris_thread_t *thread,
+                 size_t n_upval_idxs, const upval_t *upval_idxs,
+                 size_t n_reg_idxs, const reg_t *reg_idxs);
+
+/* A closure over `proto' with upvals `upvals'. */
+closure_t *asm_closure(eris_thread_t *thread, proto_t *proto,
+                       const val_t *upvals);
+
+#endif
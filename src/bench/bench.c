@@ -0,0 +1,1325 @@
+/* VM benchmarks. Run as `make bench', or directly:
+ *
+ *     build/<build-id>/bin/bench [-O] [-A] [-G] [-P HZ] [-j WORKERS]
+ *         [-E FILE] [-t SECONDS] [NAME...]
+ *
+ * which runs the named benchmarks (default: all of them), each for at least
+ * SECONDS (default 0.1). Output is tab-separated, one line per benchmark,
+ * headed by a line naming the columns: the build ID (see main.mk), the
+ * benchmark, nanoseconds and mallocs per operation, and how many operations
+ * were timed. Since every line carries its build ID, outputs from different
+ * builds can be concatenated and compared directly.
+ *
+ * With -O, we run the peephole optimizer over each benchmark's protos,
+ * printing their instruction counts before and after to stderr, and mark the
+ * build ID with "+O". It isn't the default, since some microbenchmarks
+ * optimize away to nothing.
+ *
+ * With -E, we just build the benchmarks, and write C compiling every proto
+ * they use to FILE (see aot.h). main.mk links that into bench-aot, which with
+ * -A runs the benchmarks' protos as compiled code where it has it, reporting
+ * how many on stderr, and marks the build ID with "+A". Its checked results
+ * are the interpreter's, compared.
+ *
+ * With -G, we write the GC's statistics to stderr once we're done (see
+ * eris_gc_stats in eris.h), pause-time histogram included. The GC collects
+ * what benchmarks allocate as they run; what we set up for them beforehand,
+ * we allocate without a frame, so it stays allocated until we exit.
+ *
+ * With -P, we run the sampling profiler at HZ throughout (see eris_prof_start
+ * in eris.h), and mark the build ID with "+P", so that comparing against a run
+ * without it shows the profiler's overhead; `make bench-prof' does both.
+ *
+ * Otherwise the parallel builtins run serially, keeping runs deterministic.
+ * With -j, they may use WORKERS threads besides ours, and share out inputs of
+ * PAR_BENCH_CUTOFF elements or more, so every seq benchmark runs on the pool;
+ * the build ID is marked "+j". Since the benchmarks check their results
+ * against the serial ones, this checks the parallel path too.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <eris/eris.h>
+
+#include "aot.h"
+#include "asm.h"
+#include "fiber.h"
+#include "gc.h"
+#include "loader.h"
+#include "misc.h"
+#include "num.h"
+#include "runtime.h"
+#include "serial.h"
+#include "str.h"
+#include "types.h"
+#include "vm.h"
+
+#ifndef BENCH_BUILD_ID
+#define BENCH_BUILD_ID "unknown"
+#endif
+
+/* How many times microbenchmarks repeat their operation per call, to amortize
+ * the cost of calling them. */
+#define UNROLL 16
+
+
+/* Counting mallocs. We're linked with --wrap=malloc (see main.mk), so every
+ * call to malloc from eris' code comes here. */
+void *__real_malloc(size_t size);
+void *__wrap_malloc(size_t size);
+
+static size_t num_mallocs;
+
+void *__wrap_malloc(size_t size)
+{
+    /* With -j, the pool's workers malloc too. */
+    __atomic_add_fetch(&num_mallocs, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+
+/* Helpers for building benchmarks. */
+static val_t make_builtin(eris_thread_t *thread, enum builtin_op op,
+                          nargs_t num_args, bool variadic)
+{
+    builtin_t *builtin;
+    if (!new_builtin(&builtin, thread, NULL))
+        eris_bug("out of memory");
+    builtin->op = op;
+    builtin->num_args = num_args;
+    builtin->variadic = variadic;
+    return CONTENTS_VAL(builtin);
+}
+
+static const struct { nargs_t num_args; bool variadic; } builtin_info[] = {
+#define BUILTIN(name, num_args, variadic, ...) { num_args, variadic },
+#include "builtins.expando"
+#undef BUILTIN
+};
+
+#define BUILTIN_VAL(thread, name)                               \
+    make_builtin((thread), CAT(BOP_,name),                      \
+                 builtin_info[CAT(BOP_,name)].num_args,         \
+                 builtin_info[CAT(BOP_,name)].variadic)
+
+static val_t make_int(eris_thread_t *thread, intptr_t i)
+{
+    val_t v;
+    if (!make_fixnum(&v, i, thread, NULL))
+        eris_bug("out of memory");
+    return v;
+}
+
+static val_t make_float(eris_thread_t *thread, double d)
+{
+    val_t v;
+    if (!make_flonum(&v, d, thread, NULL))
+        eris_bug("out of memory");
+    return v;
+}
+
+static val_t closure_val(closure_t *closure) { return CONTENTS_VAL(closure); }
+
+/* A closure with no arguments that calls `func' on the fixnum `n'. */
+static closure_t *call_with_int(eris_thread_t *thread, const char *name,
+                                closure_t *func, int n)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    asm_op_long(&a, OP_LOAD_INT, 1, n);
+    asm_op(&a, OP_CALL_REG, 0, 1, 1);
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    val_t upvals[] = { closure_val(func) };
+    return asm_closure(thread, asm_proto(&a, name, 0, 1, 2), upvals);
+}
+
+
+/* Microbenchmarks. Each returns a closure taking no arguments, which does its
+ * operation UNROLL times. */
+static closure_t *call_return(eris_thread_t *thread)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    proto_t *id = asm_proto(&a, "id", 1, 0, 1);
+
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 1, 1, 0);
+    for (int i = 0; i < UNROLL; ++i)
+        asm_op(&a, OP_CALL_REG, 0, 1, 1);
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    val_t upvals[] = { closure_val(id->capture.shared), eris_nil };
+    return asm_closure(thread, asm_proto(&a, "call-return", 0, 2, 2), upvals);
+}
+
+/* Calls an unverified one-register function for three results, so that the
+ * checked loop fills in the two it doesn't return; returns the one it does. */
+static closure_t *call_n_unverified(eris_thread_t *thread)
+{
+    enum { FILLED };
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    proto_t *id = asm_proto_unverified(&a, "id-unverified", 1, 0, 1);
+
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    asm_op_long(&a, OP_LOAD_INT, 1, 42);
+    asm_op_long(&a, OP_LOAD_INT, 3, 1);
+    for (int i = 0; i < UNROLL; ++i)
+        asm_op(&a, OP_CALL_REG_N, 0, 1, VM_CALL_N_ARG3(1, 3));
+    asm_op(&a, OP_IF, 3, 0, 0);
+    asm_jump(&a, FILLED);
+    asm_op(&a, OP_RETURN, 3, 0, 0);
+    asm_label(&a, FILLED);
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    val_t upvals[] = { closure_val(asm_closure(thread, id, NULL)) };
+    return asm_closure(thread, asm_proto(&a, "call-n-unverified", 0, 1, 4),
+                       upvals);
+}
+
+static closure_t *closure_create(eris_thread_t *thread)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 1, 0);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    proto_t *inner = asm_proto(&a, "inner", 0, 2, 1);
+    asm_capture(inner, thread, 0, NULL, 2, (const reg_t[]) { 0, 1 });
+
+    asm_init(&a, thread);
+    unsigned idx = asm_local(&a, inner);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 1, 0, 0);
+    for (int i = 0; i < UNROLL; ++i)
+        asm_op_long(&a, OP_CLOSE, 2, (int) idx);
+    asm_op(&a, OP_RETURN, 2, 0, 0);
+    val_t upvals[] = { eris_nil };
+    return asm_closure(thread, asm_proto(&a, "closure-create", 0, 1, 3),
+                       upvals);
+}
+
+static closure_t *cell_load(eris_thread_t *thread)
+{
+    cell_t *cell;
+    if (!new_cell(&cell, thread, NULL))
+        eris_bug("out of memory");
+    cell->val = make_int(thread, 42);
+    cell->symbol = NULL;
+
+    asm_t a;
+    asm_init(&a, thread);
+    for (int i = 0; i < UNROLL; ++i)
+        asm_op(&a, OP_LOAD_CELL, 0, 0, 0);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    val_t upvals[] = { CONTENTS_VAL(cell) };
+    return asm_closure(thread, asm_proto(&a, "cell-load", 0, 1, 1), upvals);
+}
+
+static closure_t *global_load(eris_thread_t *thread)
+{
+    longarg_t slot;
+    if (!eris_global_slot(thread->vm, "answer", 6, &slot))
+        eris_bug("out of memory");
+    cell_t *cell = eris_global_cell(thread->vm, slot);
+    eris_gc_shade(thread, cell->val);
+    cell->val = make_int(thread, 42);
+
+    asm_t a;
+    asm_init(&a, thread);
+    for (int i = 0; i < UNROLL; ++i)
+        asm_op_long(&a, OP_LOAD_GLOBAL, 0, slot);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    return asm_closure(thread, asm_proto(&a, "global-load", 0, 0, 1), NULL);
+}
+
+#define SEQ_BUILD_LEN 8
+
+static closure_t *seq_build(eris_thread_t *thread)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    for (int i = 1; i <= SEQ_BUILD_LEN; ++i)
+        asm_op(&a, OP_LOAD_UPVAL, i, 1, 0);
+    for (int i = 0; i < UNROLL; ++i)
+        asm_op(&a, OP_CALL_REG, 0, 1, SEQ_BUILD_LEN);
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    val_t upvals[] = { BUILTIN_VAL(thread, SEQ_MAKE), eris_nil };
+    return asm_closure(thread,
+                       asm_proto(&a, "seq-build", 0, 2, 1 + SEQ_BUILD_LEN),
+                       upvals);
+}
+
+static closure_t *builtin_dispatch(eris_thread_t *thread)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 1, 1, 0);
+    for (int i = 0; i < UNROLL; ++i)
+        asm_op(&a, OP_CALL_REG, 0, 1, 1);
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    val_t upvals[] = { BUILTIN_VAL(thread, IS_NIL), eris_nil };
+    return asm_closure(thread, asm_proto(&a, "builtin-dispatch", 0, 2, 2),
+                       upvals);
+}
+
+/* Tests nil and non-nil for truth, taking each branch in turn. */
+static closure_t *nil_branch(eris_thread_t *thread)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 1, 1, 0);
+    for (int i = 0; i < UNROLL / 2; ++i) {
+        asm_op(&a, OP_IF, i % 2, 0, 0);
+        asm_op_long(&a, OP_JUMP, 0, 1);
+        asm_op(&a, OP_IFNOT, i % 2, 0, 0);
+        asm_op_long(&a, OP_JUMP, 0, 1);
+    }
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    val_t upvals[] = { eris_nil, make_int(thread, 0) };
+    return asm_closure(thread, asm_proto(&a, "nil-branch", 0, 2, 2), upvals);
+}
+
+/* Adds two bignums, each 2^64. */
+static closure_t *bignum_add(eris_thread_t *thread)
+{
+    val_t big;
+    if (!eris_num_shl(&big, make_int(thread, 1), 64, thread, NULL))
+        eris_bug("out of memory");
+
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    for (int i = 0; i < UNROLL; ++i) {
+        asm_op(&a, OP_LOAD_UPVAL, 1, 1, 0);
+        asm_op(&a, OP_LOAD_UPVAL, 2, 1, 0);
+        asm_op(&a, OP_CALL_REG, 0, 1, 2);
+    }
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    val_t upvals[] = { BUILTIN_VAL(thread, ADD), big };
+    return asm_closure(thread, asm_proto(&a, "bignum-add", 0, 2, 3), upvals);
+}
+
+static closure_t *alloc_churn(eris_thread_t *thread)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    for (int i = 0; i < UNROLL; ++i)
+        asm_op_long(&a, OP_LOAD_INT, 0, i);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    return asm_closure(thread, asm_proto(&a, "alloc-churn", 0, 0, 1), NULL);
+}
+
+
+/* Workloads built from arithmetic. Their upvals are, in order: */
+enum { UP_NUM_EQ, UP_SUB, UP_ADD, UP_SEQ_NTH, UP_ZERO, UP_ONE, UP_TWO,
+       UP_HALF, UP_SELF, NUM_ARITH_UPVALS };
+
+static closure_t *arith_closure(eris_thread_t *thread, proto_t *proto)
+{
+    val_t upvals[NUM_ARITH_UPVALS] = {
+        [UP_NUM_EQ] = BUILTIN_VAL(thread, NUM_EQ),
+        [UP_SUB] = BUILTIN_VAL(thread, SUB),
+        [UP_ADD] = BUILTIN_VAL(thread, ADD),
+        [UP_SEQ_NTH] = BUILTIN_VAL(thread, SEQ_NTH),
+        [UP_ZERO] = make_int(thread, 0),
+        [UP_ONE] = make_int(thread, 1),
+        [UP_TWO] = make_int(thread, 2),
+        [UP_HALF] = make_float(thread, 0.5),
+    };
+    closure_t *closure = asm_closure(thread, proto, upvals);
+    closure->upvals[UP_SELF] = closure_val(closure);
+    return closure;
+}
+
+#define TAIL_CALL_LOOP_N 1000
+
+/* (fn loop (n) (if (= n 0) n (loop (- n 1)))), called on TAIL_CALL_LOOP_N. */
+static closure_t *tail_call_loop(eris_thread_t *thread)
+{
+    enum { DONE };
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 1, UP_NUM_EQ, 0);
+    asm_op(&a, OP_MOVE, 2, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 3, UP_ZERO, 0);
+    asm_op(&a, OP_CALL_REG, 1, 2, 2);
+    asm_op(&a, OP_IFNOT, 2, 0, 0);
+    asm_jump(&a, DONE);
+    asm_op(&a, OP_LOAD_UPVAL, 1, UP_SUB, 0);
+    asm_op(&a, OP_MOVE, 2, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 3, UP_ONE, 0);
+    asm_op(&a, OP_CALL_REG, 1, 2, 2);
+    asm_op(&a, OP_TAILCALL_SELF, 0, 2, 1);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    asm_label(&a, DONE);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    proto_t *loop = asm_proto(&a, "loop", 1, NUM_ARITH_UPVALS, 4);
+    return call_with_int(thread, "tail-call-loop", arith_closure(thread, loop),
+                         TAIL_CALL_LOOP_N);
+}
+
+/* tail-call-loop's loop as a JUMP back instead, (while (!= n 0) (set n (- n
+ * 1))), which loads the functions it calls every time round. With -O, those
+ * loads move out of the loop. */
+static closure_t *jump_loop(eris_thread_t *thread)
+{
+    enum { LOOP, DONE };
+    asm_t a;
+    asm_init(&a, thread);
+    asm_label(&a, LOOP);
+    asm_op(&a, OP_LOAD_UPVAL, 1, UP_NUM_EQ, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 2, UP_SUB, 0);
+    asm_op(&a, OP_MOVE, 3, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 4, UP_ZERO, 0);
+    asm_op(&a, OP_CALL_REG, 1, 3, 2);
+    asm_op(&a, OP_IFNOT, 3, 0, 0);
+    asm_jump(&a, DONE);
+    asm_op(&a, OP_MOVE, 3, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 4, UP_ONE, 0);
+    asm_op(&a, OP_CALL_REG, 2, 3, 2);
+    asm_op(&a, OP_MOVE, 0, 3, 0);
+    asm_jump(&a, LOOP);
+    asm_label(&a, DONE);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    proto_t *loop = asm_proto(&a, "jump-loop", 1, NUM_ARITH_UPVALS, 5);
+    return call_with_int(thread, "jump-loop-main", arith_closure(thread, loop),
+                         TAIL_CALL_LOOP_N);
+}
+
+#define FLOAT_LOOP_N 1000
+
+/* (fn loop (n acc) (if (= n 0) acc (loop (- n 1) (+ acc 0.5)))), called on
+ * FLOAT_LOOP_N and 0.0. Every addition makes a flonum. */
+static closure_t *float_loop(eris_thread_t *thread)
+{
+    enum { DONE };
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 2, UP_NUM_EQ, 0);
+    asm_op(&a, OP_MOVE, 3, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 4, UP_ZERO, 0);
+    asm_op(&a, OP_CALL_REG, 2, 3, 2);
+    asm_op(&a, OP_IFNOT, 3, 0, 0);
+    asm_jump(&a, DONE);
+    asm_op(&a, OP_LOAD_UPVAL, 2, UP_SUB, 0);
+    asm_op(&a, OP_MOVE, 3, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 4, UP_ONE, 0);
+    asm_op(&a, OP_CALL_REG, 2, 3, 2);
+    asm_op(&a, OP_LOAD_UPVAL, 2, UP_ADD, 0);
+    asm_op(&a, OP_MOVE, 4, 1, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 5, UP_HALF, 0);
+    asm_op(&a, OP_CALL_REG, 2, 4, 2);
+    asm_op(&a, OP_TAILCALL_SELF, 0, 3, 2);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    asm_label(&a, DONE);
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    proto_t *loop = asm_proto(&a, "float-loop", 2, NUM_ARITH_UPVALS, 6);
+
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    asm_op_long(&a, OP_LOAD_INT, 1, FLOAT_LOOP_N);
+    asm_op(&a, OP_LOAD_UPVAL, 2, 1, 0);
+    asm_op(&a, OP_CALL_REG, 0, 1, 2);
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    val_t upvals[] = { closure_val(arith_closure(thread, loop)),
+                       make_float(thread, 0.0) };
+    return asm_closure(thread, asm_proto(&a, "float-main", 0, 2, 3), upvals);
+}
+
+#define LIST_WALK_N 1000
+
+/* (fn walk (l acc) (if l (walk (nth 1 l) (+ acc (nth 0 l))) acc)), called on
+ * (0 (1 (2 ... (LIST_WALK_N-1 nil)))) and 0, where the lists are seqs. */
+static closure_t *list_walk(eris_thread_t *thread)
+{
+    enum { DONE };
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_IF, 0, 0, 0);
+    asm_jump(&a, DONE);
+    /* r4 = (nth 0 l), r5 = (nth 1 l) */
+    asm_op(&a, OP_LOAD_UPVAL, 2, UP_SEQ_NTH, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 4, UP_ZERO, 0);
+    asm_op(&a, OP_MOVE, 5, 0, 0);
+    asm_op(&a, OP_CALL_REG, 2, 4, 2);
+    asm_op(&a, OP_LOAD_UPVAL, 5, UP_ONE, 0);
+    asm_op(&a, OP_MOVE, 6, 0, 0);
+    asm_op(&a, OP_CALL_REG, 2, 5, 2);
+    /* r3 = (+ acc r4) */
+    asm_op(&a, OP_LOAD_UPVAL, 2, UP_ADD, 0);
+    asm_op(&a, OP_MOVE, 3, 1, 0);
+    asm_op(&a, OP_CALL_REG, 2, 3, 2);
+    asm_op(&a, OP_MOVE, 4, 3, 0);
+    asm_op(&a, OP_MOVE, 3, 5, 0);
+    asm_op(&a, OP_TAILCALL_SELF, 0, 3, 2);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    asm_label(&a, DONE);
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    proto_t *walk = asm_proto(&a, "walk", 2, NUM_ARITH_UPVALS, 7);
+
+    val_t list = eris_nil;
+    for (intptr_t i = LIST_WALK_N - 1; i >= 0; --i) {
+        seq_t *node;
+        if (!new_seq(&node, 2, thread, NULL))
+            eris_bug("out of memory");
+        node->data[0] = make_int(thread, i);
+        node->data[1] = list;
+        list = CONTENTS_VAL(node);
+    }
+
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 1, 1, 0);
+    asm_op_long(&a, OP_LOAD_INT, 2, 0);
+    asm_op(&a, OP_CALL_REG, 0, 1, 2);
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    val_t upvals[] = { closure_val(arith_closure(thread, walk)), list };
+    return asm_closure(thread, asm_proto(&a, "walk-main", 0, 2, 3), upvals);
+}
+
+
+/* String indexing. Each call looks up UNROLL code points spread across a
+ * string of a few megabytes, and returns the last. The strings repeat either
+ * STR_BENCH_ASCII or STR_BENCH_UTF8, which holds a code point of each length
+ * from one byte to four; we always look up the last of a repetition, 'd' or
+ * U+1D11E. */
+#define STR_BENCH_BYTES (4 << 20)
+#define STR_BENCH_ASCII "abcd"
+#define STR_BENCH_UTF8 "a\xc3\xa9\xe2\x82\xac\xf0\x9d\x84\x9e"
+
+static string_t *bench_string(eris_thread_t *thread, const char *unit)
+{
+    size_t unit_len = strlen(unit);
+    size_t len = STR_BENCH_BYTES / unit_len / UNROLL * UNROLL * unit_len;
+    char *buf = malloc(len);
+    string_t *str;
+    if (!buf)
+        eris_bug("out of memory");
+    for (size_t i = 0; i < len; i += unit_len)
+        memcpy(buf + i, unit, unit_len);
+    if (!eris_str_new(&str, buf, len, thread, NULL))
+        eris_bug("out of memory");
+    free(buf);
+    return str;
+}
+
+/* The index of the `i'th code point we look up. */
+static size_t str_pos(const string_t *str, int i)
+{
+    return i * (str->num_chars / UNROLL & ~(size_t) 3) + 3;
+}
+
+static closure_t *str_nth(eris_thread_t *thread, string_t *str)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    for (int i = 0; i < UNROLL; ++i) {
+        asm_op(&a, OP_LOAD_UPVAL, 1, 2 + i, 0);
+        asm_op(&a, OP_LOAD_UPVAL, 2, 1, 0);
+        asm_op(&a, OP_CALL_REG, 0, 1, 2);
+    }
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    val_t upvals[2 + UNROLL] = { BUILTIN_VAL(thread, STR_NTH),
+                                 CONTENTS_VAL(str) };
+    for (int i = 0; i < UNROLL; ++i)
+        upvals[2 + i] = make_int(thread, (intptr_t) str_pos(str, i));
+    return asm_closure(thread, asm_proto(&a, "str-nth", 0, 2 + UNROLL, 3),
+                       upvals);
+}
+
+static closure_t *str_nth_ascii(eris_thread_t *thread)
+{
+    return str_nth(thread, bench_string(thread, STR_BENCH_ASCII));
+}
+
+static closure_t *str_nth_utf8(eris_thread_t *thread)
+{
+    return str_nth(thread, bench_string(thread, STR_BENCH_UTF8));
+}
+
+/* The baseline for str-nth-utf8: the same lookups, done by scanning from the
+ * start of the string, as we would without its index. */
+static intptr_t str_nth_utf8_scan(eris_thread_t *thread)
+{
+    static string_t *str;
+    if (!str)
+        str = bench_string(thread, STR_BENCH_UTF8);
+    const unsigned char *p = (const unsigned char *) str->data;
+    intptr_t c = 0;
+    for (int i = 0; i < UNROLL; ++i) {
+        size_t n = str_pos(str, i), offset = 0;
+        for (;; ++offset)
+            if ((p[offset] & 0xc0) != 0x80 && !n--)
+                break;
+        c = eris_str_decode(str, offset);
+    }
+    return c;
+}
+
+
+/* Asynchronous I/O. io-read-zero reads IO_CHUNK bytes from /dev/zero UNROLL
+ * times, and io-pipe from a pipe a partner fiber keeps writing to. The -stdio
+ * baselines do the same with blocking stdio, making strings of what they read
+ * just as IO-READ does. */
+#define IO_CHUNK 512
+
+static int open_fd(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        eris_bug("can't open %s", path);
+    return fd;
+}
+
+static string_t *io_chunk(eris_thread_t *thread)
+{
+    char buf[IO_CHUNK];
+    string_t *str;
+    memset(buf, 'x', sizeof buf);
+    if (!eris_str_new(&str, buf, sizeof buf, thread, NULL))
+        eris_bug("out of memory");
+    return str;
+}
+
+static closure_t *io_read(eris_thread_t *thread, const char *name, int fd)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    for (int i = 0; i < UNROLL; ++i) {
+        asm_op(&a, OP_LOAD_UPVAL, 1, 1, 0);
+        asm_op(&a, OP_LOAD_UPVAL, 2, 2, 0);
+        asm_op(&a, OP_CALL_REG, 0, 1, 2);
+    }
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    val_t upvals[] = { BUILTIN_VAL(thread, IO_READ), make_int(thread, fd),
+                       make_int(thread, IO_CHUNK) };
+    return asm_closure(thread, asm_proto(&a, name, 0, 3, 3), upvals);
+}
+
+static closure_t *io_read_zero(eris_thread_t *thread)
+{
+    return io_read(thread, "io-read-zero", open_fd("/dev/zero"));
+}
+
+static closure_t *io_pipe(eris_thread_t *thread)
+{
+    int fds[2];
+    if (pipe(fds))
+        eris_bug("can't make a pipe");
+
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 1, 1, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 2, 2, 0);
+    asm_op(&a, OP_CALL_REG, 0, 1, 2);
+    asm_op(&a, OP_TAILCALL_SELF0, 0, 0, 0);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    val_t upvals[] = { BUILTIN_VAL(thread, IO_WRITE), make_int(thread, fds[1]),
+                       CONTENTS_VAL(io_chunk(thread)) };
+    closure_t *writer = asm_closure(
+        thread, asm_proto(&a, "io-pipe-writer", 0, 3, 3), upvals);
+    fiber_t *fiber;
+    if (!eris_fiber_spawn(&fiber, thread, NULL, closure_val(writer)))
+        eris_bug("out of memory");
+    return io_read(thread, "io-pipe", fds[0]);
+}
+
+/* If `out', writes a chunk to it before reading each. */
+static intptr_t io_stdio(eris_thread_t *thread, FILE *in, FILE *out)
+{
+    static string_t *chunk;
+    char buf[IO_CHUNK];
+    string_t *str;
+    if (!chunk)
+        chunk = io_chunk(thread);
+    for (int i = 0; i < UNROLL; ++i) {
+        if (out && (fwrite(chunk->data, IO_CHUNK, 1, out) != 1 || fflush(out)))
+            eris_bug("can't write");
+        if (fread(buf, IO_CHUNK, 1, in) != 1)
+            eris_bug("can't read");
+        if (!eris_str_new(&str, buf, IO_CHUNK, thread, NULL))
+            eris_bug("out of memory");
+    }
+    return 0;
+}
+
+static intptr_t io_read_zero_stdio(eris_thread_t *thread)
+{
+    static FILE *in;
+    if (!in && !(in = fdopen(open_fd("/dev/zero"), "r")))
+        eris_bug("out of memory");
+    return io_stdio(thread, in, NULL);
+}
+
+static intptr_t io_pipe_stdio(eris_thread_t *thread)
+{
+    static FILE *in, *out;
+    int fds[2];
+    if (!in && (pipe(fds) || !(in = fdopen(fds[0], "r"))
+                || !(out = fdopen(fds[1], "w"))))
+        eris_bug("can't make a pipe");
+    return io_stdio(thread, in, out);
+}
+
+
+/* Serialization. serial-encode encodes a seq of SERIAL_BENCH_ROWS rows, and
+ * serial-decode decodes a fresh copy of its encoding, which comes to
+ * SERIAL_BENCH_BYTES; each counts a KiB of it as an operation, so a million
+ * over ns/op is roughly MB/s. A row is a seq of a SERIAL_BENCH_STR-byte
+ * string, a symbol they share, two fixnums, a flonum, nil and the row before,
+ * whose records take 256 bytes, counting its slot in the outer seq.
+ * serial-decode goes through the C API, and releases each copy once done. */
+#define SERIAL_BENCH_ROWS 32768
+#define SERIAL_BENCH_STR 128
+/* 48 bytes being the buffer header, the outer seq's header and the symbol. */
+#define SERIAL_BENCH_BYTES (SERIAL_BENCH_ROWS * 256 + 48)
+
+static void serial_bench_encode(eris_thread_t *thread, void **buf, size_t *len)
+{
+    static seq_t *rows;
+    if (!rows) {
+        char data[SERIAL_BENCH_STR];
+        seq_t *seq, *row;
+        string_t *str;
+        symbol_t *sym;
+        val_t prev = eris_nil;
+        memset(data, 'x', sizeof data);
+        if (!new_seq(&seq, SERIAL_BENCH_ROWS, thread, NULL)
+            || !eris_intern(thread->vm, "row", 3, &sym))
+            eris_bug("out of memory");
+        for (intptr_t i = 0; i < SERIAL_BENCH_ROWS; ++i) {
+            if (!new_seq(&row, 7, thread, NULL)
+                || !eris_str_new(&str, data, sizeof data, thread, NULL))
+                eris_bug("out of memory");
+            row->data[0] = CONTENTS_VAL(str);
+            row->data[1] = CONTENTS_VAL(sym);
+            row->data[2] = make_int(thread, i);
+            row->data[3] = make_int(thread, -i);
+            row->data[4] = make_float(thread, i + 0.5);
+            row->data[5] = eris_nil;
+            row->data[6] = prev;
+            seq->data[i] = prev = CONTENTS_VAL(row);
+        }
+        rows = seq;
+    }
+    if (!eris_serial_encode(CONTENTS_VAL(rows), buf, len))
+        eris_bug("can't encode");
+}
+
+static intptr_t serial_encode(eris_thread_t *thread)
+{
+    void *buf;
+    size_t len;
+    serial_bench_encode(thread, &buf, &len);
+    free(buf);
+    return (intptr_t) len;
+}
+
+/* The frame main runs the benchmarks in, for those that use the C API. */
+static eris_frame_t *api_frame;
+
+static intptr_t serial_decode(eris_thread_t *thread)
+{
+    static void *encoded, *buf;
+    static size_t len;
+    size_t rows;
+    if (!encoded) {
+        serial_bench_encode(thread, &encoded, &len);
+        if (!(buf = malloc(len)))
+            eris_bug("out of memory");
+    }
+    memcpy(buf, encoded, len);
+    if (!eris_deserialize(api_frame, buf, len)
+        || !eris_check_seq_len(api_frame, 0, &rows))
+        eris_bug("can't decode");
+    eris_pop(api_frame, 1);
+    eris_release_buffer(api_frame, buf);
+    return (intptr_t) rows;
+}
+
+
+/* The C API. api-push-int pushes UNROLL ints a call at a time; api-push-int-seq
+ * pushes a seq of API_BULK_N of them in one call, and api-get-ints reads one
+ * back into a C array. Each int is an operation. They use the frame main runs
+ * the benchmarks in, and pop whatever they push, save that api-get-ints leaves
+ * its seq at the bottom of the stack. */
+#define API_BULK_N 1024
+
+static intptr_t api_push_int(eris_thread_t *thread)
+{
+    (void) thread;
+    for (int i = 0; i < UNROLL; ++i)
+        if (!eris_push_int(api_frame, i))
+            eris_bug("out of memory");
+    eris_pop(api_frame, UNROLL);
+    return 0;
+}
+
+static const eris_int_t *api_ints(void)
+{
+    static eris_int_t ints[API_BULK_N];
+    for (size_t i = 0; i < API_BULK_N; ++i)
+        ints[i] = (eris_int_t) i;
+    return ints;
+}
+
+static intptr_t api_push_int_seq(eris_thread_t *thread)
+{
+    (void) thread;
+    static const eris_int_t *ints;
+    if (!ints)
+        ints = api_ints();
+    if (!eris_push_int_seq(api_frame, API_BULK_N, ints))
+        eris_bug("out of memory");
+    eris_pop(api_frame, 1);
+    return 0;
+}
+
+static intptr_t api_get_ints(eris_thread_t *thread)
+{
+    (void) thread;
+    static eris_idx_t depth;
+    eris_int_t ints[API_BULK_N];
+    if (!depth) {
+        if (!eris_push_int_seq(api_frame, API_BULK_N, api_ints()))
+            eris_bug("out of memory");
+        depth = eris_num_slots(api_frame);
+    }
+    if (!eris_get_ints(api_frame, eris_num_slots(api_frame) - depth, 0,
+                       API_BULK_N, ints))
+        eris_bug("can't read ints");
+    return ints[API_BULK_N - 1];
+}
+
+
+/* Fibers. fiber-spawn-join spawns a fiber which returns straight away, and
+ * joins it, UNROLL times. fiber-yield yields UNROLL times to a partner fiber
+ * that does nothing but yield back, so it switches fibers twice as often. */
+static closure_t *fiber_spawn_join(eris_thread_t *thread)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    val_t child_upvals[] = { make_int(thread, 42) };
+    closure_t *child = asm_closure(
+        thread, asm_proto(&a, "fiber-child", 0, 1, 1), child_upvals);
+
+    asm_init(&a, thread);
+    for (int i = 0; i < UNROLL; ++i) {
+        asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+        asm_op(&a, OP_LOAD_UPVAL, 1, 2, 0);
+        asm_op(&a, OP_CALL_REG, 0, 1, 1);
+        asm_op(&a, OP_LOAD_UPVAL, 0, 1, 0);
+        asm_op(&a, OP_CALL_REG, 0, 1, 1);
+    }
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    val_t upvals[] = { BUILTIN_VAL(thread, SPAWN), BUILTIN_VAL(thread, JOIN),
+                       closure_val(child) };
+    return asm_closure(thread, asm_proto(&a, "fiber-spawn-join", 0, 3, 2),
+                       upvals);
+}
+
+static closure_t *fiber_yield(eris_thread_t *thread)
+{
+    val_t upvals[] = { BUILTIN_VAL(thread, YIELD) };
+
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    asm_op(&a, OP_CALL_REG, 0, 1, 0);
+    asm_op(&a, OP_TAILCALL_SELF0, 0, 0, 0);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    closure_t *partner = asm_closure(
+        thread, asm_proto(&a, "fiber-partner", 0, 1, 2), upvals);
+    fiber_t *fiber;
+    if (!eris_fiber_spawn(&fiber, thread, NULL, closure_val(partner)))
+        eris_bug("out of memory");
+
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    for (int i = 0; i < UNROLL; ++i)
+        asm_op(&a, OP_CALL_REG, 0, 1, 0);
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    return asm_closure(thread, asm_proto(&a, "fiber-yield", 0, 1, 2), upvals);
+}
+
+
+/* Macro workloads. These return a closure taking no arguments that does the
+ * whole workload once. */
+
+/* (fn fib (n) (if (= n 0) n (= n 1) n (+ (fib (- n 1)) (fib (- n 2))))) */
+static closure_t *fib(eris_thread_t *thread)
+{
+    enum { RET_N };
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 1, UP_NUM_EQ, 0);
+    asm_op(&a, OP_MOVE, 2, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 3, UP_ZERO, 0);
+    asm_op(&a, OP_CALL_REG, 1, 2, 2);
+    asm_op(&a, OP_IFNOT, 2, 0, 0);
+    asm_jump(&a, RET_N);
+    asm_op(&a, OP_MOVE, 2, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 3, UP_ONE, 0);
+    asm_op(&a, OP_CALL_REG, 1, 2, 2);
+    asm_op(&a, OP_IFNOT, 2, 0, 0);
+    asm_jump(&a, RET_N);
+    /* r3 = (fib (- n 1)) */
+    asm_op(&a, OP_LOAD_UPVAL, 1, UP_SUB, 0);
+    asm_op(&a, OP_MOVE, 3, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 4, UP_ONE, 0);
+    asm_op(&a, OP_CALL_REG, 1, 3, 2);
+    asm_op(&a, OP_LOAD_UPVAL, 2, UP_SELF, 0);
+    asm_op(&a, OP_CALL_REG, 2, 3, 1);
+    /* r4 = (fib (- n 2)) */
+    asm_op(&a, OP_MOVE, 5, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 6, UP_TWO, 0);
+    asm_op(&a, OP_CALL_REG, 1, 5, 2);
+    asm_op(&a, OP_CALL_REG, 2, 5, 1);
+    asm_op(&a, OP_MOVE, 4, 5, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 2, UP_ADD, 0);
+    asm_op(&a, OP_CALL_REG, 2, 3, 2);
+    asm_op(&a, OP_RETURN, 3, 0, 0);
+    asm_label(&a, RET_N);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    proto_t *proto = asm_proto(&a, "fib", 1, NUM_ARITH_UPVALS, 7);
+    return call_with_int(thread, "fib-main", arith_closure(thread, proto), 20);
+}
+
+/* (fn ack (m n)
+ *   (if (= m 0) (+ n 1)
+ *       (= n 0) (ack (- m 1) 1)
+ *       (ack (- m 1) (ack m (- n 1))))) */
+static proto_t *ack_proto(eris_thread_t *thread)
+{
+    enum { M_ZERO, N_ZERO };
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 2, UP_NUM_EQ, 0);
+    asm_op(&a, OP_MOVE, 3, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 4, UP_ZERO, 0);
+    asm_op(&a, OP_CALL_REG, 2, 3, 2);
+    asm_op(&a, OP_IFNOT, 3, 0, 0);
+    asm_jump(&a, M_ZERO);
+    asm_op(&a, OP_MOVE, 3, 1, 0);
+    asm_op(&a, OP_CALL_REG, 2, 3, 2);
+    asm_op(&a, OP_IFNOT, 3, 0, 0);
+    asm_jump(&a, N_ZERO);
+    /* r3 = (ack m (- n 1)) */
+    asm_op(&a, OP_LOAD_UPVAL, 2, UP_SUB, 0);
+    asm_op(&a, OP_MOVE, 4, 1, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 5, UP_ONE, 0);
+    asm_op(&a, OP_CALL_REG, 2, 4, 2);
+    asm_op(&a, OP_MOVE, 3, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 6, UP_SELF, 0);
+    asm_op(&a, OP_CALL_REG, 6, 3, 2);
+    /* (ack (- m 1) r3) */
+    asm_op(&a, OP_MOVE, 4, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 5, UP_ONE, 0);
+    asm_op(&a, OP_CALL_REG, 2, 4, 2);
+    asm_op(&a, OP_MOVE, 5, 3, 0);
+    asm_op(&a, OP_TAILCALL_SELF, 0, 4, 2);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+
+    asm_label(&a, M_ZERO);
+    asm_op(&a, OP_LOAD_UPVAL, 2, UP_ADD, 0);
+    asm_op(&a, OP_MOVE, 3, 1, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 4, UP_ONE, 0);
+    asm_op(&a, OP_CALL_REG, 2, 3, 2);
+    asm_op(&a, OP_RETURN, 3, 0, 0);
+
+    asm_label(&a, N_ZERO);
+    asm_op(&a, OP_LOAD_UPVAL, 2, UP_SUB, 0);
+    asm_op(&a, OP_MOVE, 3, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 4, UP_ONE, 0);
+    asm_op(&a, OP_CALL_REG, 2, 3, 2);
+    asm_op(&a, OP_TAILCALL_SELF, 0, 3, 2);
+    asm_op(&a, OP_RETURN, 0, 0, 0);
+    return asm_proto(&a, "ack", 2, NUM_ARITH_UPVALS, 7);
+}
+
+#define ACK_N 50
+
+/* (ack 2 ACK_N) */
+static closure_t *ackermann(eris_thread_t *thread)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 0, 0, 0);
+    asm_op_long(&a, OP_LOAD_INT, 1, 2);
+    asm_op_long(&a, OP_LOAD_INT, 2, ACK_N);
+    asm_op(&a, OP_CALL_REG, 0, 1, 2);
+    asm_op(&a, OP_RETURN, 1, 0, 0);
+    val_t upvals[] = { closure_val(arith_closure(thread, ack_proto(thread))) };
+    return asm_closure(thread, asm_proto(&a, "ack-main", 0, 1, 3), upvals);
+}
+
+#define PIPELINE_N 1000
+/* Big enough that with -j, the parallel builtins share it out. The result
+ * must still be a fixnum where intptr_t is 32 bits. */
+#define PAR_PIPELINE_N 60000
+#define NESTED_N 512
+/* With -j, the parallel builtins' cutoff: low enough for every benchmark. */
+#define PAR_BENCH_CUTOFF 256
+
+static closure_t *inc_closure(eris_thread_t *thread)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 1, 0, 0);
+    asm_op(&a, OP_MOVE, 2, 0, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 3, 1, 0);
+    asm_op(&a, OP_CALL_REG, 1, 2, 2);
+    asm_op(&a, OP_RETURN, 2, 0, 0);
+    val_t upvals[] = { BUILTIN_VAL(thread, ADD), make_int(thread, 1) };
+    return asm_closure(thread, asm_proto(&a, "inc", 1, 2, 4), upvals);
+}
+
+/* The upvals of the seq benchmarks' protos. */
+enum { U_FROM_FN, U_MAP, U_REDUCE, U_ADD, U_ZERO, U_N, U_FN, NUM_SEQ_UPVALS };
+
+static void seq_upvals(eris_thread_t *thread, val_t *upvals, size_t n,
+                       closure_t *fn)
+{
+    upvals[U_FROM_FN] = BUILTIN_VAL(thread, SEQ_FROM_FN);
+    upvals[U_MAP] = BUILTIN_VAL(thread, SEQ_MAP);
+    upvals[U_REDUCE] = BUILTIN_VAL(thread, SEQ_REDUCE);
+    upvals[U_ADD] = BUILTIN_VAL(thread, ADD);
+    upvals[U_ZERO] = make_int(thread, 0);
+    upvals[U_N] = make_int(thread, (intptr_t) n);
+    upvals[U_FN] = closure_val(fn);
+}
+
+/* (seq-reduce + 0 (seq-map inc (seq-from-fn n inc))) */
+static closure_t *seq_pipeline_n(eris_thread_t *thread, const char *name,
+                                 size_t n)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 1, U_N, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 2, U_FN, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 0, U_FROM_FN, 0);
+    asm_op(&a, OP_CALL_REG, 0, 1, 2);
+    asm_op(&a, OP_MOVE, 3, 1, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 2, U_FN, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 0, U_MAP, 0);
+    asm_op(&a, OP_CALL_REG, 0, 2, 2);
+    asm_op(&a, OP_MOVE, 4, 2, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 2, U_ADD, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 3, U_ZERO, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 0, U_REDUCE, 0);
+    asm_op(&a, OP_CALL_REG, 0, 2, 3);
+    asm_op(&a, OP_RETURN, 2, 0, 0);
+    val_t upvals[NUM_SEQ_UPVALS];
+    seq_upvals(thread, upvals, n, inc_closure(thread));
+    return asm_closure(thread, asm_proto(&a, name, 0, NUM_SEQ_UPVALS, 5),
+                       upvals);
+}
+
+static closure_t *seq_pipeline(eris_thread_t *thread)
+{
+    return seq_pipeline_n(thread, "seq-pipeline-1000", PIPELINE_N);
+}
+
+static closure_t *seq_pipeline_par(eris_thread_t *thread)
+{
+    return seq_pipeline_n(thread, "seq-pipeline-60000", PAR_PIPELINE_N);
+}
+
+/* (seq-reduce + 0 (seq-from-fn n fn)) */
+static proto_t *seq_sum_proto(eris_thread_t *thread, const char *name,
+                              nargs_t num_args)
+{
+    asm_t a;
+    asm_init(&a, thread);
+    asm_op(&a, OP_LOAD_UPVAL, 2, U_N, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 3, U_FN, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 1, U_FROM_FN, 0);
+    asm_op(&a, OP_CALL_REG, 1, 2, 2);
+    asm_op(&a, OP_MOVE, 4, 2, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 2, U_ADD, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 3, U_ZERO, 0);
+    asm_op(&a, OP_LOAD_UPVAL, 1, U_REDUCE, 0);
+    asm_op(&a, OP_CALL_REG, 1, 2, 3);
+    asm_op(&a, OP_RETURN, 2, 0, 0);
+    return asm_proto(&a, name, num_args, NUM_SEQ_UPVALS, 5);
+}
+
+/* The sum of NESTED_N rows, each the sum of 1 through NESTED_N. With -j, the
+ * rows run on the pool's workers, and their own seq builtins, finding it
+ * busy, run serially. */
+static closure_t *seq_nested(eris_thread_t *thread)
+{
+    val_t upvals[NUM_SEQ_UPVALS];
+    seq_upvals(thread, upvals, NESTED_N, inc_closure(thread));
+    closure_t *row = asm_closure(
+        thread, seq_sum_proto(thread, "seq-nested-row", 1), upvals);
+    seq_upvals(thread, upvals, NESTED_N, row);
+    return asm_closure(thread, seq_sum_proto(thread, "seq-nested", 0),
+                       upvals);
+}
+
+
+/* The suite. */
+typedef struct {
+    const char *name;
+    closure_t *(*make)(eris_thread_t *thread);
+    /* How many operations one call does. */
+    size_t ops;
+    /* If `check', one call must return a number equal to `expect'. */
+    bool check;
+    intptr_t expect;
+    /* Baselines written in C have no `make'; we time `native' instead. */
+    intptr_t (*native)(eris_thread_t *thread);
+} bench_t;
+
+static const bench_t benches[] = {
+    { "call-return", call_return, UNROLL, false, 0, NULL },
+    { "call-n-unverified", call_n_unverified, UNROLL, true, 42, NULL },
+    { "tail-call-loop", tail_call_loop, TAIL_CALL_LOOP_N, true, 0, NULL },
+    { "jump-loop", jump_loop, TAIL_CALL_LOOP_N, true, 0, NULL },
+    { "float-loop", float_loop, FLOAT_LOOP_N, true, FLOAT_LOOP_N / 2, NULL },
+    { "list-walk", list_walk, LIST_WALK_N, true,
+      LIST_WALK_N * (LIST_WALK_N - 1) / 2, NULL },
+    { "closure-create", closure_create, UNROLL, false, 0, NULL },
+    { "cell-load", cell_load, UNROLL, true, 42, NULL },
+    { "global-load", global_load, UNROLL, true, 42, NULL },
+    { "seq-build", seq_build, UNROLL, false, 0, NULL },
+    { "builtin-dispatch", builtin_dispatch, UNROLL, false, 0, NULL },
+    { "nil-branch", nil_branch, UNROLL, false, 0, NULL },
+    { "str-nth-ascii", str_nth_ascii, UNROLL, true, 'd', NULL },
+    { "str-nth-utf8", str_nth_utf8, UNROLL, true, 0x1d11e, NULL },
+    { "str-nth-utf8-scan", NULL, UNROLL, true, 0x1d11e, str_nth_utf8_scan },
+    { "bignum-add", bignum_add, UNROLL, false, 0, NULL },
+    { "alloc-churn", alloc_churn, UNROLL, true, UNROLL - 1, NULL },
+    { "io-read-zero", io_read_zero, UNROLL, false, 0, NULL },
+    { "io-read-zero-stdio", NULL, UNROLL, false, 0, io_read_zero_stdio },
+    { "io-pipe", io_pipe, UNROLL, false, 0, NULL },
+    { "io-pipe-stdio", NULL, UNROLL, false, 0, io_pipe_stdio },
+    { "serial-encode", NULL, SERIAL_BENCH_BYTES / 1024, true,
+      SERIAL_BENCH_BYTES, serial_encode },
+    { "serial-decode", NULL, SERIAL_BENCH_BYTES / 1024, true,
+      SERIAL_BENCH_ROWS, serial_decode },
+    { "api-push-int", NULL, UNROLL, false, 0, api_push_int },
+    { "api-push-int-seq", NULL, API_BULK_N, false, 0, api_push_int_seq },
+    { "api-get-ints", NULL, API_BULK_N, true, API_BULK_N - 1, api_get_ints },
+    /* fiber-yield leaves its partner queued, so it goes after this. */
+    { "fiber-spawn-join", fiber_spawn_join, UNROLL, true, 42, NULL },
+    { "fiber-yield", fiber_yield, 2 * UNROLL, false, 0, NULL },
+    { "fib-20", fib, 1, true, 6765, NULL },
+    { "ackermann-2-50", ackermann, 1, true, 2 * ACK_N + 3, NULL },
+    { "seq-pipeline-1000", seq_pipeline, 1, true,
+      /* the sum of 2 through PIPELINE_N+1 */
+      PIPELINE_N * (PIPELINE_N + 3) / 2, NULL },
+    { "seq-pipeline-60000", seq_pipeline_par, 1, true,
+      (intptr_t) PAR_PIPELINE_N / 2 * (PAR_PIPELINE_N + 3), NULL },
+    { "seq-nested-512", seq_nested, 1, true,
+      (intptr_t) NESTED_N * NESTED_N * (NESTED_N + 1) / 2, NULL },
+};
+
+/* Like eris_call_n, we're in the VM while registers above our slots hold
+ * values, so that nobody collects under us; see gc.h. */
+static val_t call(eris_frame_t *S, closure_t *closure)
+{
+    val_t *regs = S->regs + S->num_regs;
+    eris_gc_enter(S->thread);
+    regs[0] = closure_val(closure);
+    if (!eris_vm_call(S->thread, regs, S->frame, 0, NULL))
+        eris_bug("benchmark raised");
+    val_t result = regs[0];
+    eris_gc_leave(S->thread);
+    return result;
+}
+
+/* Calls `b' once, either as `closure' or natively, storing its result. */
+static bool call_once(eris_frame_t *S, const bench_t *b, closure_t *closure,
+                      double *result)
+{
+    if (!closure) {
+        *result = (double) b->native(S->thread);
+        return true;
+    }
+    return get_real(call(S, closure), result);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts))
+        eris_bug("clock_gettime failed");
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *build_id = BENCH_BUILD_ID;
+static char prof_build_id[sizeof BENCH_BUILD_ID "+O+A+P"];
+static char par_build_id[sizeof BENCH_BUILD_ID "+O+A+P+j"];
+
+static void run(eris_frame_t *S, const bench_t *b, double min_secs)
+{
+    closure_t *closure = b->make ? b->make(S->thread) : NULL;
+
+    double result;
+    bool ok = call_once(S, b, closure, &result);
+    if (b->check && (!ok || result != b->expect)) {
+        fprintf(stderr, "bench: %s returned the wrong result\n", b->name);
+        exit(1);
+    }
+
+    /* Double the number of calls until they take long enough to time. */
+    size_t calls = 1, mallocs;
+    double secs;
+    for (;; calls *= 2) {
+        size_t mallocs_before = num_mallocs;
+        double start = now();
+        for (size_t i = 0; i < calls; ++i)
+            call_once(S, b, closure, &result);
+        secs = now() - start;
+        mallocs = num_mallocs - mallocs_before;
+        if (secs >= min_secs)
+            break;
+    }
+
+    double ops = (double) calls * b->ops;
+    printf("%s\t%s\t%.2f\t%.2f\t%.0f\n", build_id, b->name,
+           secs * 1e9 / ops, mallocs / ops, ops);
+    fflush(stdout);
+}
+
+static bool selected(const char *name, int argc, char **argv)
+{
+    if (!argc)
+        return true;
+    for (int i = 0; i < argc; ++i)
+        if (!strcmp(name, argv[i]))
+            return true;
+    return false;
+}
+
+/* bench -E: builds the selected benchmarks, and compiles their protos. */
+static int emit(eris_thread_t *thread, const char *path, int argc,
+                char **argv)
+{
+    for (size_t i = 0; i < ARRAY_LEN(benches); ++i)
+        if (benches[i].make && selected(benches[i].name, argc, argv))
+            benches[i].make(thread);
+
+    FILE *out = fopen(path, "w");
+    bool ok = out && eris_aot_emit(out, "bench_aot", asm_protos,
+                                   asm_num_protos);
+    if (out && fclose(out))
+        ok = false;
+    if (!ok) {
+        fprintf(stderr, "bench: couldn't write %s\n", path);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    double min_secs = 0.1;
+    ++argv, --argc;
+    if (argc >= 1 && !strcmp(argv[0], "-O")) {
+        asm_optimize = true;
+        build_id = BENCH_BUILD_ID "+O";
+        ++argv, --argc;
+    }
+    if (argc >= 1 && !strcmp(argv[0], "-A")) {
+        asm_aot = true;
+        build_id = asm_optimize ? BENCH_BUILD_ID "+O+A" : BENCH_BUILD_ID "+A";
+        ++argv, --argc;
+    }
+    bool gc_stats = false;
+    if (argc >= 1 && !strcmp(argv[0], "-G")) {
+        gc_stats = true;
+        ++argv, --argc;
+    }
+    unsigned prof_hz = 0;
+    if (argc >= 2 && !strcmp(argv[0], "-P")) {
+        prof_hz = (unsigned) atoi(argv[1]);
+        snprintf(prof_build_id, sizeof prof_build_id, "%s+P", build_id);
+        build_id = prof_build_id;
+        argv += 2, argc -= 2;
+    }
+    size_t workers = 0;
+    if (argc >= 2 && !strcmp(argv[0], "-j")) {
+        workers = (size_t) atol(argv[1]);
+        snprintf(par_build_id, sizeof par_build_id, "%s+j", build_id);
+        build_id = par_build_id;
+        argv += 2, argc -= 2;
+    }
+    const char *emit_path = NULL;
+    if (argc >= 2 && !strcmp(argv[0], "-E")) {
+        emit_path = argv[1];
+        argv += 2, argc -= 2;
+    }
+    if (argc >= 2 && !strcmp(argv[0], "-t")) {
+        min_secs = atof(argv[1]);
+        argv += 2, argc -= 2;
+    }
+    for (int i = 0; i < argc; ++i) {
+        bool known = false;
+        for (size_t j = 0; j < ARRAY_LEN(benches); ++j)
+            known = known || !strcmp(argv[i], benches[j].name);
+        if (!known) {
+            fprintf(stderr, "bench: no such benchmark: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    eris_vm_t *vm = eris_vm_new();
+    eris_thread_t *thread = vm ? eris_thread_new(vm) : NULL;
+    eris_frame_t *S = thread ? eris_frame_begin(thread) : NULL;
+    if (!S) {
+        fprintf(stderr, "bench: out of memory\n");
+        return 1;
+    }
+    api_frame = S;
+    eris_vm_set_parallelism(vm, workers, PAR_BENCH_CUTOFF);
+    if (prof_hz && !eris_prof_start(vm, prof_hz)) {
+        fprintf(stderr, "bench: couldn't start the profiler\n");
+        return 1;
+    }
+
+    int status = 0;
+    if (emit_path) {
+        status = emit(thread, emit_path, argc, argv);
+    }
+    else {
+        printf("build\tbenchmark\tns/op\tallocs/op\tops\n");
+        for (size_t i = 0; i < ARRAY_LEN(benches); ++i)
+            if (selected(benches[i].name, argc, argv))
+                run(S, &benches[i], min_secs);
+    }
+
+    if (asm_aot)
+        fprintf(stderr, "bench: compiled code for %zu of %zu protos\n",
+                asm_num_attached, asm_num_protos);
+    eris_prof_stop(vm);
+    if (gc_stats) {
+        eris_gc_stats_t stats;
+        eris_gc_stats(vm, &stats);
+        eris_gc_stats_print(&stats, stderr);
+    }
+
+    eris_frame_end(S);
+    eris_thread_destroy(thread);
+    eris_vm_destroy(vm);
+    return status;
+}
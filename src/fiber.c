@@ -0,0 +1,310 @@
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "aio.h"
+#include "fiber.h"
+#include "gc.h"
+#include "misc.h"
+#include "runtime.h"
+#include "types.h"
+#include "vm.h"
+
+/* A new fiber starts in a trampoline that tail-calls REG[0], its function,
+ * much as eris_vm_call's does. When that returns, it returns into the fiber's
+ * FRAME_FIBER frame, which ends it. */
+static instr_t fiber_code[] = {
+    VM_INSTR(OP_TAILCALL_REG, 0, 1, 0),
+    VM_INSTR(OP_RETURN, 1, 0, 0),
+};
+
+/* Like eris_vm_call's, its proto has no code as far as the profiler's
+ * concerned, and the GC knows it isn't an object; but it does use its two
+ * registers. */
+static proto_t fiber_proto = {
+    .code = NULL,
+    .num_regs = 2,
+    .variadic = false,
+    .verified = true,
+};
+
+static closure_t fiber_func = { .proto = &fiber_proto };
+
+
+/* Stacks. A fiber's stack is one stretch of memory, with its registers growing
+ * up from the bottom and its control frames down from the top. We reserve them
+ * a slab at a time, and keep a slab's first page for a link to the next; unused
+ * stacks keep a link to the next in their bottom register. */
+static size_t page_size(void)
+{
+    static size_t size;
+    if (!size)
+        size = (size_t) sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+static size_t stack_size(void)
+{
+    size_t size = ERIS_FIBER_REGS * sizeof(val_t)
+        + ERIS_FIBER_FRAMES * sizeof(frame_t);
+    return INTDIV_CEIL(size, page_size()) * page_size();
+}
+
+static size_t slab_size(void)
+{
+    return page_size() + ERIS_FIBER_SLAB * stack_size();
+}
+
+size_t eris_fiber_stack_charge(void)
+{
+    return 2 * page_size();
+}
+
+static bool new_stack(eris_thread_t *thread, void **out)
+{
+    if (!thread->free_stacks) {
+        /* MAP_NORESERVE, since most of it will never be touched. */
+        char *slab = mmap(NULL, slab_size(), PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (slab == MAP_FAILED)
+            return false;
+        *(void **) slab = thread->stack_slabs;
+        thread->stack_slabs = slab;
+        for (size_t i = ERIS_FIBER_SLAB; i-- > 0;) {
+            void **stack = (void **) (slab + page_size() + i * stack_size());
+            *stack = thread->free_stacks;
+            thread->free_stacks = stack;
+        }
+    }
+    void **stack = thread->free_stacks;
+    thread->free_stacks = *stack;
+    *out = stack;
+    return true;
+}
+
+/* The memory a stack touched stays touched, for the next fiber to use; but we
+ * clear out its registers, as the GC expects of a new stack. */
+static void free_stack(eris_thread_t *thread, void *stack)
+{
+    eris_gc_clean(stack, (val_t *) stack + ERIS_FIBER_REGS);
+    *(void **) stack = thread->free_stacks;
+    thread->free_stacks = stack;
+}
+
+void eris_fiber_free_stacks(eris_thread_t *thread)
+{
+    void *slab = thread->stack_slabs;
+    while (slab) {
+        void *next = *(void **) slab;
+        munmap(slab, slab_size());
+        slab = next;
+    }
+    thread->stack_slabs = NULL;
+    thread->free_stacks = NULL;
+}
+
+
+/* The run queue. */
+static void enqueue(eris_thread_t *thread, fiber_t *fiber)
+{
+    fiber->next = NULL;
+    if (thread->run_tail)
+        thread->run_tail->next = fiber;
+    else
+        thread->run_head = fiber;
+    thread->run_tail = fiber;
+}
+
+static fiber_t *dequeue(eris_thread_t *thread)
+{
+    fiber_t *fiber = thread->run_head;
+    if (fiber && !(thread->run_head = fiber->next))
+        thread->run_tail = NULL;
+    return fiber;
+}
+
+/* The next fiber to run, if any, once we've woken those whose I/O is done.
+ * While others are ready we let parked fibers' operations queue up, to submit
+ * them all at once when someone yields or there's nothing else to run; and if
+ * there isn't, unless we're yielding, we wait for a fiber to wake. */
+static fiber_t *next_fiber(eris_thread_t *thread, bool yielding)
+{
+    if (thread->io_waiting) {
+        bool idle = !thread->run_head;
+        eris_aio_poll(thread, yielding || idle, idle && !yielding);
+    }
+    return dequeue(thread);
+}
+
+/* Switching. */
+static void save(const vm_state_t *S, fiber_t *fiber)
+{
+    fiber->ip = S->ip;
+    fiber->regs = S->regs;
+    fiber->frame = S->frame;
+    fiber->func = S->func;
+}
+
+static void load(vm_state_t *S, fiber_t *fiber)
+{
+    eris_gc_resume(S->thread, fiber);
+    S->thread->fiber = fiber;
+    S->ip = fiber->ip;
+    S->regs = fiber->regs;
+    S->frame = fiber->frame;
+    S->func = fiber->func;
+}
+
+
+bool eris_fiber_spawn(fiber_t **out, eris_thread_t *thread, frame_t *frame,
+                      val_t func)
+{
+    fiber_t *fiber;
+    void *stack;
+    if (!eris_charge(thread, eris_fiber_stack_charge()))
+        return false;
+    if (!new_fiber(&fiber, thread, frame)) {
+        eris_uncharge(thread, eris_fiber_stack_charge());
+        return false;
+    }
+    if (!new_stack(thread, &stack)) {
+        fiber->stack = NULL;
+        eris_uncharge(thread, eris_fiber_stack_charge());
+        return false;
+    }
+
+    val_t *regs = stack;
+    regs[0] = func;
+    frame_t *bottom = (frame_t *) ((char *) stack + stack_size()) - 1;
+    bottom->tag = FRAME_FIBER;
+    frame_t *call_frame = bottom - 1;
+    call_frame->tag = FRAME_CALL;
+    call_frame->data.call.ip = fiber_code;
+    call_frame->data.call.func = &fiber_func;
+
+    *fiber = (fiber_t) {
+        .ip = fiber_code,
+        .regs = regs,
+        .frame = call_frame,
+        .func = &fiber_func,
+        .thread = thread,
+        .stack = stack,
+        .joining = NULL,
+        .dest = NULL,
+        .result = eris_nil,
+        .done = false,
+        .next = NULL,
+        .waiters = NULL,
+        .io_buf = NULL,
+        .io_charge = 0,
+        .io_result = 0,
+        .io_fd = -1,
+        .io_done = false,
+    };
+    if (!eris_gc_fiber_spawned(thread, fiber)) {
+        free_stack(thread, stack);
+        fiber->stack = NULL;
+        eris_uncharge(thread, eris_fiber_stack_charge());
+        return false;
+    }
+    enqueue(thread, fiber);
+    *out = fiber;
+    return true;
+}
+
+bool eris_fiber_yield(vm_state_t *S)
+{
+    eris_thread_t *thread = S->thread;
+    if (thread->vm_calls != 1)
+        return false;
+    fiber_t *next = next_fiber(thread, true);
+    if (next) {
+        save(S, thread->fiber);
+        enqueue(thread, thread->fiber);
+        load(S, next);
+    }
+    return true;
+}
+
+bool eris_fiber_join(vm_state_t *S, fiber_t *fiber, val_t *dest)
+{
+    if (fiber->done) {
+        *dest = fiber->result;
+        return true;
+    }
+    eris_thread_t *thread = S->thread;
+    fiber_t *self = thread->fiber;
+    fiber_t *next;
+    if (thread->vm_calls != 1 || fiber->thread != thread)
+        return false;
+    /* If it's waiting on us, even by way of others, we'd wait forever. */
+    for (fiber_t *f = fiber; f; f = f->joining)
+        if (f == self)
+            return false;
+    if (!(next = next_fiber(thread, false)))
+        return false;
+
+    save(S, self);
+    self->joining = fiber;
+    self->dest = dest;
+    self->next = fiber->waiters;
+    fiber->waiters = self;
+    load(S, next);
+    return true;
+}
+
+void eris_fiber_exit(vm_state_t *S, val_t result)
+{
+    eris_thread_t *thread = S->thread;
+    fiber_t *self = thread->fiber;
+    assert (self != &thread->root_fiber && thread->vm_calls == 1);
+
+    self->done = true;
+    eris_gc_store(thread, CONTENTS_OBJ(self), &self->result, result);
+    for (fiber_t *waiter = self->waiters, *next; waiter; waiter = next) {
+        next = waiter->next;
+        /* Into registers the GC may not have scanned yet. */
+        eris_gc_shade(thread, *waiter->dest);
+        *waiter->dest = result;
+        waiter->joining = NULL;
+        enqueue(thread, waiter);
+    }
+    self->waiters = NULL;
+    eris_gc_fiber_done(thread, self);
+    free_stack(thread, self->stack);
+    self->stack = NULL;
+    eris_uncharge(thread, eris_fiber_stack_charge());
+
+    /* The root fiber never finishes this way, so something's ready to run or
+     * waiting on I/O: it's either waiting on a fiber that is, or on one that's
+     * waiting on... and so on, and JOIN won't close the circle. */
+    fiber_t *next = next_fiber(thread, false);
+    if (!next)
+        eris_bug("fiber deadlock: every fiber is waiting on another");
+    load(S, next);
+}
+
+void eris_fiber_park(vm_state_t *S)
+{
+    eris_thread_t *thread = S->thread;
+    save(S, thread->fiber);
+    ++thread->io_waiting;
+    load(S, next_fiber(thread, false));
+}
+
+void eris_fiber_wake(fiber_t *fiber)
+{
+    --fiber->thread->io_waiting;
+    enqueue(fiber->thread, fiber);
+}
+
+size_t eris_fiber_clear(fiber_t *fiber)
+{
+    if (!fiber->stack)
+        return 0;
+    free_stack(fiber->thread, fiber->stack);
+    return eris_fiber_stack_charge();
+}
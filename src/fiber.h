@@ -0,0 +1,80 @@
+/* Fibers: lightweight threads of eris code, many per OS thread.
+ *
+ * Each fiber has its own register and control stacks, reserved from slabs of
+ * address space that the OS only backs with memory as a fiber touches them, so
+ * a fiber costs a page or two until it runs deep. Each eris_thread_t schedules
+ * its own fibers cooperatively: SPAWN queues a new fiber, and YIELD and JOIN
+ * let the next queued one run. Switching fibers only swaps the ip, regs, frame
+ * and func of the VM's state; no OS context switch, and no C stack switching.
+ *
+ * That means fibers can only switch when there's no C code of ours between the
+ * VM loop and where it was entered from C; ie. not from within a function a
+ * builtin called via eris_vm_call (such as SEQ-MAP's). There, YIELD and JOIN
+ * raise. Fibers also only run while eris code on their thread yields, joins or
+ * waits on I/O (see aio.h); those still queued when the code that entered the
+ * VM returns stay queued until it's next entered.
+ *
+ * A fiber that raises, and has no eris_vm_call between it and the raise, ends
+ * there, as if it had returned nil; whoever joins it gets that nil.
+ */
+#ifndef _FIBER_H_
+#define _FIBER_H_
+
+#include <stdbool.h>
+
+#include "misc.h"
+#include "runtime.h"
+#include "types.h"
+
+/* A fiber's stacks are as large as a thread's, but don't cost that much. */
+#define ERIS_FIBER_REGS   ERIS_THREAD_REGS
+#define ERIS_FIBER_FRAMES ERIS_THREAD_FRAMES
+/* How many fibers' stacks we reserve at once. */
+#define ERIS_FIBER_SLAB 64
+
+/* Makes a fiber on `thread' that will call `func' with no arguments, and puts
+ * it on the back of the run queue. Returns false iff we ran out of memory. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_fiber_spawn(fiber_t **out, eris_thread_t *thread, frame_t *frame,
+                      val_t func);
+
+/* These are for builtins. They take the VM state the current fiber should
+ * resume from, and replace it with that of the fiber to run next, which may be
+ * the same one. They fail, leaving `*S' alone, if we can't switch fibers here.
+ */
+
+/* Lets the fiber at the front of the run queue run, putting us at the back. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_fiber_yield(vm_state_t *S);
+
+/* Waits for `fiber' to finish, and stores its result in `*dest'. Fails if
+ * `fiber' belongs to another thread, or is us or waiting on us, by way of
+ * others perhaps, or if there's nothing else to run, since then we'd wait
+ * forever. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_fiber_join(vm_state_t *S, fiber_t *fiber, val_t *dest);
+
+/* Parks the current fiber, whose I/O aio.c is doing, and runs the next; waits
+ * for one to wake if none's ready. */
+void eris_fiber_park(vm_state_t *S);
+
+/* Puts a parked fiber, whose I/O is done, on the back of the run queue. */
+void eris_fiber_wake(fiber_t *fiber);
+
+/* Finishes the current fiber, whose function returned `result', and runs the
+ * next. */
+void eris_fiber_exit(vm_state_t *S, val_t result);
+
+/* What each fiber's stacks are charged to the heap while it has them (see
+ * eris_charge): the page of registers and the page of frames that it touches
+ * at least. What fibers that run deeper touch beyond that goes uncharged. */
+size_t eris_fiber_stack_charge(void);
+
+/* Frees `fiber's stacks, if it still has them, returning what they were
+ * charged. */
+size_t eris_fiber_clear(fiber_t *fiber);
+
+/* Frees the fiber stacks `thread' reserved. */
+void eris_fiber_free_stacks(eris_thread_t *thread);
+
+#endif
@@ -0,0 +1,966 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <eris/eris.h>
+
+#include "fiber.h"
+#include "gc.h"
+#include "misc.h"
+#include "runtime.h"
+#include "types.h"
+#include "vm.h"
+
+/* Seqs and vecs are marked this many elements at a time, so that a long one
+ * doesn't hold up a step. */
+#define GC_CHUNK 1024
+
+/* Steps check the time whenever they've traced or swept this many more
+ * objects. */
+#define GC_CLOCK_EVERY 64
+
+enum phase { GC_IDLE, GC_MARK, GC_SWEEP };
+
+/* An object to trace, from element `from' on if it's a seq or vec. Objects
+ * are marked before they're pushed, so each is pushed once. */
+typedef struct {
+    obj_t *obj;
+    size_t from;
+} gray_t;
+
+struct eris_gc {
+    eris_gc_config_t config;
+    enum phase phase;
+    uint64_t cycle;             /* of the collection under way, or last */
+    /* The VM's gc_colour: the mark marked objects have, which new ones are
+     * born with. Each snapshot flips it, turning them all white. */
+    size_t colour;
+
+    /* Collected objects: those the last sweep left, along with those the
+     * snapshot since took from threads, all white then; those the sweep under
+     * way has yet to get to; and those of threads since destroyed, until the
+     * next snapshot takes them. The rest are on their threads' lists. */
+    gc_link_t *objs;
+    gc_link_t *sweeping;
+    gc_link_t *orphans, *orphans_tail;
+    /* Uncollected objects we treat as roots; see eris_gc_store. */
+    gc_link_t *remembered;
+    /* A JudyL array of the values held as roots, by key; see eris_gc_hold. */
+    Pvoid_t held;
+    /* The roots marking has yet to get to: the globals from `next_global' on,
+     * the remembered objects from `next_remembered' on, the held values from
+     * `next_held' on till `held_done', and the threads from `next_thread' on,
+     * but those that scanned their own on entering the VM. */
+    size_t next_global;
+    gc_link_t *next_remembered;
+    Word_t next_held;
+    bool held_done;
+    eris_thread_t *next_thread;
+
+    /* The gray objects. If we can't grow it, we leave objects marked but off
+     * it, and find them again once it's empty; see mark_overflowed. */
+    gray_t *gray;
+    size_t num_gray, max_gray;
+    bool overflow;
+
+    /* Guards the rest, but what's accessed atomically, and the VM's list of
+     * threads. Steps, barriers and snapshots all take it. */
+    pthread_mutex_t lock;
+    /* Accessed atomically: whether we're taking a snapshot, which keeps
+     * threads from entering the VM; how many parallel sections are under way;
+     * how many bytes of collected objects there are, with what's charged to
+     * the heap for them (see eris_charge), counting threads' credit as if
+     * they'd allocated it already, so that they can't together allocate past
+     * the hard limit; and the most that's ever been. */
+    bool stopping;
+    size_t parallel;
+    size_t heap, peak;
+    /* Bytes the last sweep left, with those allocated meanwhile; and the heap
+     * that starts the next collection. */
+    size_t live;
+    size_t threshold;
+
+    eris_gc_stats_t stats;
+};
+
+/* `p' percent of `n', without overflowing. */
+static size_t percent(size_t n, unsigned p)
+{
+    return n / 100 * p + n % 100 * p / 100;
+}
+
+/* A step's budget, of bytes traced or swept and of time. */
+typedef struct {
+    struct timespec start;
+    uint64_t max_ns;
+    size_t work, budget;
+    unsigned count;
+} step_t;
+
+
+/* Timing. */
+static uint64_t elapsed_ns(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) (now.tv_sec - start->tv_sec) * 1000000000
+        + (uint64_t) now.tv_nsec - (uint64_t) start->tv_nsec;
+}
+
+static void step_begin(step_t *step, size_t budget, uint64_t max_ns)
+{
+    clock_gettime(CLOCK_MONOTONIC, &step->start);
+    step->max_ns = max_ns;
+    step->work = 0;
+    step->budget = budget;
+    step->count = 0;
+}
+
+/* Whether `step' has done enough. */
+static bool step_over(step_t *step)
+{
+    if (step->work >= step->budget)
+        return true;
+    return step->max_ns && ++step->count % GC_CLOCK_EVERY == 0
+        && elapsed_ns(&step->start) >= step->max_ns;
+}
+
+static void step_end(struct eris_gc *gc, const step_t *step)
+{
+    uint64_t ns = elapsed_ns(&step->start);
+    unsigned bucket = 0;
+    while (bucket + 1 < ERIS_GC_PAUSE_BUCKETS && ns >> (bucket + 1))
+        ++bucket;
+    ++gc->stats.pauses;
+    ++gc->stats.pause_hist[bucket];
+    gc->stats.pause_ns_total += ns;
+    gc->stats.pause_ns_max = MAX(gc->stats.pause_ns_max, ns);
+}
+
+
+/* Marking. */
+static bool is_collected(val_t v)
+{
+    return VAL_IS_OBJ(v) && v != VAL_UNDEFINED
+        && VAL_OBJ(v)->header & HEADER_COLLECTED;
+}
+
+static void push(struct eris_gc *gc, obj_t *obj, size_t from)
+{
+    if (gc->num_gray == gc->max_gray) {
+        size_t max = MAX(gc->max_gray * 2, 256);
+        gray_t *gray = realloc(gc->gray, max * sizeof *gray);
+        if (!gray) {
+            gc->overflow = true;
+            return;
+        }
+        gc->gray = gray;
+        gc->max_gray = max;
+    }
+    gc->gray[gc->num_gray++] = (gray_t) { obj, from };
+}
+
+static bool is_marked(struct eris_gc *gc, gc_link_t *link)
+{
+    return (link->size & GC_LINK_MARK) == gc->colour;
+}
+
+static void shade(struct eris_gc *gc, val_t v)
+{
+    if (!is_collected(v))
+        return;
+    obj_t *obj = VAL_OBJ(v);
+    gc_link_t *link = obj_link(obj);
+    if (is_marked(gc, link))
+        return;
+    link->size ^= GC_LINK_MARK;
+    switch (OBJ_SHAPE_ID(obj)) {
+        /* Nothing in these to trace. */
+      case ERIS_SHAPE_NIL: case ERIS_SHAPE_NUM: case ERIS_SHAPE_BUILTIN:
+      case ERIS_SHAPE_STRING: case ERIS_SHAPE_SYMBOL:
+        break;
+      case ERIS_SHAPE_PROTO: case ERIS_SHAPE_CLOSURE:
+      case ERIS_SHAPE_C_CLOSURE: case ERIS_SHAPE_SEQ: case ERIS_SHAPE_VEC:
+      case ERIS_SHAPE_CELL: case ERIS_SHAPE_FIBER:
+        push(gc, obj, 0);
+        break;
+      case ERIS_NUM_SHAPES:
+      default: IMPOSSIBLE("bad shape: %u", OBJ_SHAPE_ID(obj));
+    }
+}
+
+static void shade_range(struct eris_gc *gc, const val_t *from,
+                        const val_t *to)
+{
+    for (; from < to; ++from)
+        shade(gc, *from);
+}
+
+/* The trampolines in vm.c and fiber.c pretend to be in closures of their own,
+ * which aren't objects. */
+static void shade_func(struct eris_gc *gc, closure_t *func)
+{
+    if (func->proto->code)
+        shade(gc, CONTENTS_VAL(func));
+}
+
+/* Whether `v' might be an object (and so keep one alive). */
+static bool is_dirty(val_t v)
+{
+    return VAL_IS_OBJ(v) && v != eris_nil && v != VAL_UNDEFINED;
+}
+
+/* Clears out registers from `regs' up until ERIS_GC_STACK_GAP clean ones in a
+ * row, or `end'. Returns how many it looked at. */
+static size_t clean(val_t *regs, val_t *end)
+{
+    val_t *p = regs;
+    for (size_t run = 0; p < end && run < ERIS_GC_STACK_GAP; ++p) {
+        if (is_dirty(*p)) {
+            *p = eris_nil;
+            run = 0;
+        }
+        else {
+            ++run;
+        }
+    }
+    return (size_t) (p - regs);
+}
+
+/* Scans a stack of registers from `base' to `end', whose live ones run up to
+ * `top' at least, and to the top of the registers of every call on the control
+ * stack from `frame' (in `func', from `regs') up, if `frame' isn't NULL.
+ * Returns the bytes of registers it scanned and cleaned. */
+static size_t scan_stack(struct eris_gc *gc, val_t *base, val_t *end,
+                         val_t *top, frame_t *frame, val_t *regs,
+                         closure_t *func)
+{
+    while (frame) {
+        shade_func(gc, func);
+        top = MAX(top, regs + func->proto->num_regs);
+        frame_t *caller = frame + 1;
+        if (caller->tag != FRAME_CALL)
+            break;
+        /* As RETURN finds the caller's registers. */
+        regs -= VM_ARG2(*caller->data.call.ip);
+        func = caller->data.call.func;
+        frame = caller;
+    }
+    top = MIN(top, end);
+    shade_range(gc, base, top);
+    return ((size_t) (top - base) + clean(top, end)) * sizeof(val_t);
+}
+
+static size_t scan_fiber(struct eris_gc *gc, fiber_t *fiber)
+{
+    fiber->gc_cycle = gc->cycle;
+    val_t *base = fiber->stack;
+    return scan_stack(gc, base, base + ERIS_FIBER_REGS, base, fiber->frame,
+                      fiber->regs, fiber->func);
+}
+
+/* Traces `obj' from element `from' on. Returns the bytes it looked at. */
+static size_t trace(struct eris_gc *gc, obj_t *obj, size_t from)
+{
+    size_t len;
+    val_t *data;
+    switch (OBJ_SHAPE_ID(obj)) {
+      case ERIS_SHAPE_PROTO: {
+          proto_t *proto = OBJ_CONTENTS(proto, obj);
+          for (size_t i = 0; i < proto->num_local_funcs; ++i)
+              shade(gc, CONTENTS_VAL(proto->local_funcs[i]));
+          if (proto->capture.shared)
+              shade(gc, CONTENTS_VAL(proto->capture.shared));
+          return link_size(obj_link(obj));
+      }
+      case ERIS_SHAPE_CLOSURE: {
+          closure_t *closure = OBJ_CONTENTS(closure, obj);
+          shade(gc, CONTENTS_VAL(closure->proto));
+          shade_range(gc, closure->upvals,
+                      closure->upvals + closure->proto->num_upvals);
+          return link_size(obj_link(obj));
+      }
+      case ERIS_SHAPE_C_CLOSURE: {
+          c_closure_t *closure = OBJ_CONTENTS(c_closure, obj);
+          shade(gc, closure->name);
+          shade_range(gc, closure->upvals,
+                      closure->upvals + closure->num_upvals);
+          return link_size(obj_link(obj));
+      }
+      case ERIS_SHAPE_CELL: {
+          cell_t *cell = OBJ_CONTENTS(cell, obj);
+          shade(gc, cell->val);
+          if (cell->symbol)
+              shade(gc, CONTENTS_VAL(cell->symbol));
+          return link_size(obj_link(obj));
+      }
+      case ERIS_SHAPE_FIBER: {
+          fiber_t *fiber = OBJ_CONTENTS(fiber, obj);
+          size_t work = link_size(obj_link(obj));
+          shade(gc, fiber->result);
+          if (fiber->stack && fiber->gc_cycle != gc->cycle)
+              work += scan_fiber(gc, fiber);
+          return work;
+      }
+      case ERIS_SHAPE_SEQ:
+        len = obj->len;
+        data = OBJ_CONTENTS(seq, obj)->data;
+        break;
+      case ERIS_SHAPE_VEC:
+        len = MIN(OBJ_CONTENTS(vec, obj)->len, obj->len);
+        data = OBJ_CONTENTS(vec, obj)->data;
+        break;
+      case ERIS_SHAPE_NIL: case ERIS_SHAPE_NUM: case ERIS_SHAPE_BUILTIN:
+      case ERIS_SHAPE_STRING: case ERIS_SHAPE_SYMBOL:
+      case ERIS_NUM_SHAPES:
+      default:
+        IMPOSSIBLE("tracing shape %u", OBJ_SHAPE_ID(obj));
+    }
+
+    /* Seqs and vecs. */
+    size_t to = len;
+    if (to - from > GC_CHUNK) {
+        to = from + GC_CHUNK;
+        push(gc, obj, to);
+    }
+    shade_range(gc, data + from, data + to);
+    return (to - from) * sizeof(val_t);
+}
+
+/* Scans `t's registers, unless we have already this collection, and marks its
+ * unfinished fibers gray. `S' is the running state, if `t' is running.
+ * Returns the bytes of registers it looked at. */
+static size_t scan_thread(struct eris_gc *gc, eris_thread_t *t,
+                          const vm_state_t *S)
+{
+    fiber_t *root = &t->root_fiber;
+    if (root->gc_cycle == gc->cycle)
+        return 0;
+    val_t *base = t->regs, *end = t->regs + t->num_regs;
+    val_t *api_top = base;
+    if (t->api_frame)
+        api_top = t->api_frame->regs + t->api_frame->num_regs;
+
+    size_t work;
+    if (!S) {
+        assert (!t->vm_calls && t->fiber == root);
+        work = scan_stack(gc, base, end, api_top, NULL, NULL, NULL);
+    }
+    else if (t->fiber == root) {
+        work = scan_stack(gc, base, end, api_top, S->frame, S->regs, S->func);
+    }
+    else {
+        fiber_t *fiber = t->fiber;
+        val_t *stack = fiber->stack;
+        fiber->gc_cycle = gc->cycle;
+        work = scan_stack(gc, stack, stack + ERIS_FIBER_REGS, stack, S->frame,
+                          S->regs, S->func)
+            + scan_stack(gc, base, end, api_top, root->frame, root->regs,
+                         root->func);
+    }
+    root->gc_cycle = gc->cycle;
+
+    Word_t index = 0;
+    for (int found = Judy1First(t->gc_fibers, &index, PJE0); found;
+         found = Judy1Next(t->gc_fibers, &index, PJE0))
+        shade(gc, CONTENTS_VAL((fiber_t *) index));
+    return work;
+}
+
+/* Scans the roots the snapshot left to us, until we're done or `step' is
+ * over. Returns whether we're done. */
+static bool mark_roots(eris_vm_t *vm, step_t *step)
+{
+    struct eris_gc *gc = vm->gc;
+    for (; gc->next_global < vm->num_globals; ++gc->next_global) {
+        if (step_over(step))
+            return false;
+        shade(gc, vm->globals[gc->next_global].val);
+        step->work += sizeof(val_t);
+    }
+    for (; gc->next_remembered;
+         gc->next_remembered = gc->next_remembered->next) {
+        if (step_over(step))
+            return false;
+        step->work += trace(gc, link_obj(gc->next_remembered), 0);
+    }
+    for (PPvoid_t v = gc->held_done ? NULL
+             : JudyLFirst(gc->held, &gc->next_held, PJE0);
+         v; v = JudyLNext(gc->held, &gc->next_held, PJE0)) {
+        if (step_over(step))
+            return false;
+        shade(gc, (val_t) (uintptr_t) *v);
+        step->work += sizeof(val_t);
+    }
+    gc->held_done = true;
+    for (; gc->next_thread; gc->next_thread = gc->next_thread->next) {
+        if (step_over(step))
+            return false;
+        step->work += scan_thread(gc, gc->next_thread, NULL);
+    }
+    return true;
+}
+
+/* After the gray stack overflowed, some marked objects never made it onto it;
+ * tracing them all again catches them. Slow, but so is running out of memory.
+ * Those born since the snapshot, the rest, needn't be traced. */
+static void mark_overflowed(struct eris_gc *gc)
+{
+    gc->overflow = false;
+    for (gc_link_t *link = gc->objs; link; link = link->next)
+        if (is_marked(gc, link))
+            push(gc, link_obj(link), 0);
+    for (gc_link_t *link = gc->remembered; link; link = link->next)
+        push(gc, link_obj(link), 0);
+}
+
+/* Marks until we run out of roots and gray objects, or `step' is over.
+ * Returns whether we're done. */
+static bool mark(eris_vm_t *vm, step_t *step)
+{
+    struct eris_gc *gc = vm->gc;
+    if (!mark_roots(vm, step))
+        return false;
+    for (;;) {
+        while (gc->num_gray) {
+            if (step_over(step))
+                return false;
+            gray_t gray = gc->gray[--gc->num_gray];
+            step->work += trace(gc, gray.obj, gray.from);
+        }
+        if (!gc->overflow)
+            return true;
+        mark_overflowed(gc);
+    }
+}
+
+static void splice(gc_link_t **list, gc_link_t *head, gc_link_t *tail)
+{
+    if (head) {
+        tail->next = *list;
+        *list = head;
+    }
+}
+
+/* Starts a collection. `S' is the state of `thread' at a safe point, or NULL
+ * if it's outside the VM. Nobody else is in it; see stop_others. We scan only
+ * `thread's registers, whose calls go on without a barrier, and leave the
+ * other roots to marking: other threads' registers can't change till they
+ * enter the VM, which scans them first (see eris_gc_enter). */
+static void snapshot(eris_thread_t *thread, const vm_state_t *S)
+{
+    eris_vm_t *vm = thread->vm;
+    struct eris_gc *gc = vm->gc;
+    assert (gc->phase == GC_IDLE && !gc->num_gray);
+    ++gc->cycle;
+    gc->phase = GC_MARK;
+    gc->colour ^= GC_LINK_MARK;
+    vm->gc_colour = gc->colour;
+    __atomic_store_n(&vm->gc_marking, true, __ATOMIC_RELAXED);
+
+    /* Everything so far is white now; the sweep will get to it all. */
+    splice(&gc->objs, gc->orphans, gc->orphans_tail);
+    gc->orphans = gc->orphans_tail = NULL;
+    for (eris_thread_t *t = vm->threads; t; t = t->next) {
+        splice(&gc->objs, t->gc_objs, t->gc_objs_tail);
+        t->gc_objs = t->gc_objs_tail = NULL;
+    }
+
+    gc->next_global = 0;
+    gc->next_remembered = gc->remembered;
+    gc->next_held = 0;
+    gc->held_done = false;
+    gc->next_thread = vm->threads;
+    scan_thread(gc, thread, S);
+}
+
+/* Sweeping. */
+static void sweep_begin(eris_vm_t *vm)
+{
+    struct eris_gc *gc = vm->gc;
+    gc->phase = GC_SWEEP;
+    /* Threads entering the VM that see this know we're done with their
+     * registers; see eris_gc_enter. */
+    __atomic_store_n(&vm->gc_marking, false, __ATOMIC_RELEASE);
+    gc->sweeping = gc->objs;
+    gc->objs = NULL;
+}
+
+/* Sweeps until we're done, or `step' is over. Returns whether we're done. */
+static bool sweep(struct eris_gc *gc, step_t *step)
+{
+    while (gc->sweeping) {
+        if (step_over(step))
+            return false;
+        gc_link_t *link = gc->sweeping;
+        obj_t *obj = link_obj(link);
+        gc->sweeping = link->next;
+        size_t size = link_size(link);
+        step->work += size;
+        if (is_marked(gc, link)) {
+            link->next = gc->objs;
+            gc->objs = link;
+        }
+        else {
+            size += eris_free(obj);
+            __atomic_sub_fetch(&gc->heap, size, __ATOMIC_RELAXED);
+            gc->stats.freed_bytes += size;
+        }
+    }
+    return true;
+}
+
+static void sweep_end(struct eris_gc *gc)
+{
+    gc->phase = GC_IDLE;
+    ++gc->stats.cycles;
+    /* What was born meanwhile isn't swept till next time, but survived. */
+    gc->live = __atomic_load_n(&gc->heap, __ATOMIC_RELAXED);
+    size_t growth = percent(gc->live, gc->config.growth_percent);
+    gc->threshold = MAX(gc->live + growth, ERIS_GC_MIN_HEAP);
+}
+
+/* Works on the collection under way until `step' is over. */
+static void work(eris_vm_t *vm, step_t *step)
+{
+    struct eris_gc *gc = vm->gc;
+    switch (gc->phase) {
+      case GC_IDLE:
+        break;
+      case GC_MARK:
+        if (!mark(vm, step))
+            break;
+        sweep_begin(vm);
+        /* fall through */
+      case GC_SWEEP:
+        if (sweep(gc, step))
+            sweep_end(gc);
+        break;
+      default: IMPOSSIBLE("bad GC phase: %d", (int) gc->phase);
+    }
+}
+
+
+/* Interface. */
+bool eris_gc_init(eris_vm_t *vm)
+{
+    struct eris_gc *gc = calloc(1, sizeof *gc);
+    if (!gc)
+        return false;
+    gc->config = (eris_gc_config_t) {
+        .step_bytes = ERIS_GC_STEP_BYTES,
+        .work_percent = ERIS_GC_WORK_PERCENT,
+        .growth_percent = ERIS_GC_GROWTH_PERCENT,
+        .max_pause_ns = ERIS_GC_MAX_PAUSE_NS,
+    };
+    gc->phase = GC_IDLE;
+    gc->threshold = ERIS_GC_MIN_HEAP;
+    pthread_mutex_init(&gc->lock, NULL);
+    vm->gc = gc;
+    vm->gc_colour = gc->colour = 0;
+    vm->gc_marking = false;
+    return true;
+}
+
+static void free_list(gc_link_t *list)
+{
+    while (list) {
+        gc_link_t *next = list->next;
+        eris_free(link_obj(list));
+        list = next;
+    }
+}
+
+void eris_gc_free(eris_vm_t *vm)
+{
+    struct eris_gc *gc = vm->gc;
+    assert (!vm->threads);
+    free_list(gc->objs);
+    free_list(gc->sweeping);
+    free_list(gc->orphans);
+    JudyLFreeArray(&gc->held, PJE0);
+    free(gc->gray);
+    pthread_mutex_destroy(&gc->lock);
+    free(gc);
+}
+
+/* Adds between `need' and `want' bytes to the heap, as credit, as far as the
+ * hard limit allows. Returns how many, or 0 if not even `need'. */
+static size_t reserve(struct eris_gc *gc, size_t need, size_t want)
+{
+    size_t limit = gc->config.hard_limit ? gc->config.hard_limit : SIZE_MAX;
+    size_t heap = __atomic_load_n(&gc->heap, __ATOMIC_RELAXED), got;
+    do {
+        size_t room = heap < limit ? limit - heap : 0;
+        if (room < need)
+            return 0;
+        got = MIN(want, room);
+    } while (!__atomic_compare_exchange_n(&gc->heap, &heap, heap + got, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    heap += got;
+    size_t peak = __atomic_load_n(&gc->peak, __ATOMIC_RELAXED);
+    while (peak < heap
+           && !__atomic_compare_exchange_n(&gc->peak, &peak, heap, true,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    return got;
+}
+
+bool eris_gc_step(eris_thread_t *thread, size_t size)
+{
+    eris_vm_t *vm = thread->vm;
+    struct eris_gc *gc = vm->gc;
+    bool parallel = __atomic_load_n(&gc->parallel, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&gc->heap, thread->gc_credit, __ATOMIC_RELAXED);
+    thread->gc_credit = reserve(gc, size, MAX(gc->config.step_bytes, size));
+
+    if (!thread->gc_credit && !parallel) {
+        /* Out of room; but the collection under way, if any, may make us
+         * some, and it's better to pause for it now than to fail. */
+        pthread_mutex_lock(&gc->lock);
+        if (gc->phase != GC_IDLE) {
+            step_t step;
+            step_begin(&step, SIZE_MAX, 0);
+            work(vm, &step);
+            step_end(gc, &step);
+        }
+        pthread_mutex_unlock(&gc->lock);
+        thread->gc_credit = reserve(gc, size, size);
+    }
+    if (!thread->gc_credit) {
+        __atomic_add_fetch(&gc->stats.limit_failures, 1, __ATOMIC_RELAXED);
+        thread->gc_pending = true;
+        return false;
+    }
+    if (parallel)
+        return true;
+
+    pthread_mutex_lock(&gc->lock);
+    if (gc->phase == GC_IDLE) {
+        size_t heap = __atomic_load_n(&gc->heap, __ATOMIC_RELAXED);
+        size_t soft = gc->config.soft_limit ? gc->config.soft_limit
+            : gc->config.hard_limit / 2;
+        if (heap >= gc->threshold || (soft && heap >= soft))
+            thread->gc_pending = true;
+    }
+    else {
+        step_t step;
+        step_begin(&step,
+                   percent(gc->config.step_bytes, gc->config.work_percent),
+                   gc->config.max_pause_ns);
+        work(vm, &step);
+        step_end(gc, &step);
+    }
+    pthread_mutex_unlock(&gc->lock);
+    return true;
+}
+
+/* Entering the VM announces itself, then checks whether anyone's taking a
+ * snapshot; taking one announces that, then checks whether anyone's in the VM.
+ * Both use sequentially consistent atomics, so that at least one of them sees
+ * the other, and backs off. Once in, we scan our registers, if marking hasn't
+ * yet, before we can change them. */
+void eris_gc_enter(eris_thread_t *thread)
+{
+    eris_vm_t *vm = thread->vm;
+    struct eris_gc *gc = vm->gc;
+    if (thread->gc_entered) {
+        __atomic_store_n(&thread->gc_entered, thread->gc_entered + 1,
+                         __ATOMIC_RELAXED);
+        return;
+    }
+    for (;;) {
+        __atomic_store_n(&thread->gc_entered, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&gc->stopping, __ATOMIC_SEQ_CST))
+            break;
+        __atomic_store_n(&thread->gc_entered, 0, __ATOMIC_SEQ_CST);
+        /* The snapshot holds the lock till it's done. */
+        pthread_mutex_lock(&gc->lock);
+        pthread_mutex_unlock(&gc->lock);
+    }
+    if (UNLIKELY(__atomic_load_n(&vm->gc_marking, __ATOMIC_ACQUIRE))) {
+        pthread_mutex_lock(&gc->lock);
+        if (vm->gc_marking)
+            scan_thread(gc, thread, NULL);
+        pthread_mutex_unlock(&gc->lock);
+    }
+}
+
+void eris_gc_leave(eris_thread_t *thread)
+{
+    assert (thread->gc_entered);
+    __atomic_store_n(&thread->gc_entered, thread->gc_entered - 1,
+                     __ATOMIC_RELEASE);
+}
+
+/* Keeps threads but `thread' out of the VM, if none are in it. Call with the
+ * lock held, and if it returns true, start_others before letting go. */
+static bool stop_others(eris_thread_t *thread)
+{
+    struct eris_gc *gc = thread->vm->gc;
+    __atomic_store_n(&gc->stopping, true, __ATOMIC_SEQ_CST);
+    for (eris_thread_t *t = thread->vm->threads; t; t = t->next) {
+        if (t != thread && __atomic_load_n(&t->gc_entered, __ATOMIC_SEQ_CST)) {
+            __atomic_store_n(&gc->stopping, false, __ATOMIC_RELAXED);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void start_others(struct eris_gc *gc)
+{
+    __atomic_store_n(&gc->stopping, false, __ATOMIC_RELEASE);
+}
+
+/* Starts a collection, if `thread' is in `vm_calls' eris_vm_calls and nobody
+ * else is in the VM. `S' is as for snapshot. */
+static void safepoint(eris_thread_t *thread, size_t vm_calls,
+                      const vm_state_t *S)
+{
+    eris_vm_t *vm = thread->vm;
+    struct eris_gc *gc = vm->gc;
+    /* If we can't start now, an allocation will ask again. */
+    thread->gc_pending = false;
+    if (thread->vm_calls != vm_calls
+        || __atomic_load_n(&gc->parallel, __ATOMIC_RELAXED))
+        return;
+
+    pthread_mutex_lock(&gc->lock);
+    if (gc->phase == GC_IDLE && stop_others(thread)) {
+        step_t step;
+        step_begin(&step, 0, 0);
+        snapshot(thread, S);
+        step_end(gc, &step);
+        start_others(gc);
+    }
+    pthread_mutex_unlock(&gc->lock);
+}
+
+void eris_gc_safepoint(const vm_state_t *S)
+{
+    safepoint(S->thread, 1, S);
+}
+
+void eris_gc_api_safepoint(eris_thread_t *thread)
+{
+    safepoint(thread, 0, NULL);
+}
+
+void eris_gc_shade_slow(eris_thread_t *thread, val_t old)
+{
+    eris_vm_t *vm = thread->vm;
+    pthread_mutex_lock(&vm->gc->lock);
+    if (vm->gc_marking)
+        shade(vm->gc, old);
+    pthread_mutex_unlock(&vm->gc->lock);
+}
+
+void eris_gc_remember(eris_thread_t *thread, obj_t *obj)
+{
+    struct eris_gc *gc = thread->vm->gc;
+    assert (!(obj->header & HEADER_FOREIGN));
+    pthread_mutex_lock(&gc->lock);
+    if (!(obj->header & HEADER_REMEMBERED)) {
+        __atomic_or_fetch(&obj->header, HEADER_REMEMBERED, __ATOMIC_RELAXED);
+        obj_link(obj)->next = gc->remembered;
+        gc->remembered = obj_link(obj);
+    }
+    pthread_mutex_unlock(&gc->lock);
+}
+
+bool eris_gc_hold(eris_thread_t *thread, const void *key, val_t v)
+{
+    eris_vm_t *vm = thread->vm;
+    struct eris_gc *gc = vm->gc;
+    pthread_mutex_lock(&gc->lock);
+    PPvoid_t slot = JudyLIns(&gc->held, (Word_t) key, PJE0);
+    bool ok = slot != PPJERR && !*slot;
+    if (ok) {
+        *slot = (void *) (uintptr_t) v;
+        /* Marking may be past the held values already. */
+        if (vm->gc_marking)
+            shade(gc, v);
+    }
+    pthread_mutex_unlock(&gc->lock);
+    return ok;
+}
+
+bool eris_gc_held(eris_thread_t *thread, const void *key, val_t *out)
+{
+    struct eris_gc *gc = thread->vm->gc;
+    pthread_mutex_lock(&gc->lock);
+    PPvoid_t slot = JudyLGet(gc->held, (Word_t) key, PJE0);
+    if (slot)
+        *out = (val_t) (uintptr_t) *slot;
+    pthread_mutex_unlock(&gc->lock);
+    return slot;
+}
+
+void eris_gc_drop(eris_thread_t *thread, const void *key)
+{
+    eris_vm_t *vm = thread->vm;
+    struct eris_gc *gc = vm->gc;
+    pthread_mutex_lock(&gc->lock);
+    PPvoid_t slot = JudyLGet(gc->held, (Word_t) key, PJE0);
+    if (slot) {
+        /* The deletion barrier, as for an overwritten field. */
+        if (vm->gc_marking)
+            shade(gc, (val_t) (uintptr_t) *slot);
+        JudyLDel(&gc->held, (Word_t) key, PJE0);
+    }
+    pthread_mutex_unlock(&gc->lock);
+}
+
+bool eris_gc_fiber_spawned(eris_thread_t *thread, fiber_t *fiber)
+{
+    /* Anything in its registers yet is reachable from ours; see scan_fiber.
+     */
+    fiber->gc_cycle = thread->vm->gc->cycle;
+    return Judy1Set(&thread->gc_fibers, (Word_t) fiber, PJE0) != JERR;
+}
+
+void eris_gc_fiber_done(eris_thread_t *thread, fiber_t *fiber)
+{
+    Judy1Unset(&thread->gc_fibers, (Word_t) fiber, PJE0);
+}
+
+void eris_gc_resume_slow(eris_thread_t *thread, fiber_t *fiber)
+{
+    eris_vm_t *vm = thread->vm;
+    struct eris_gc *gc = vm->gc;
+    pthread_mutex_lock(&gc->lock);
+    if (vm->gc_marking && fiber->stack && fiber->gc_cycle != gc->cycle)
+        scan_fiber(gc, fiber);
+    pthread_mutex_unlock(&gc->lock);
+}
+
+void eris_gc_clean(val_t *regs, val_t *end)
+{
+    clean(regs, end);
+}
+
+void eris_gc_parallel(eris_vm_t *vm, bool entering)
+{
+    if (entering)
+        __atomic_add_fetch(&vm->gc->parallel, 1, __ATOMIC_RELAXED);
+    else
+        __atomic_sub_fetch(&vm->gc->parallel, 1, __ATOMIC_RELAXED);
+}
+
+void eris_gc_thread_new(eris_thread_t *thread)
+{
+    eris_vm_t *vm = thread->vm;
+    pthread_mutex_lock(&vm->gc->lock);
+    /* There's nothing in our registers yet to scan. */
+    thread->root_fiber.gc_cycle = vm->gc->cycle;
+    thread->next = vm->threads;
+    vm->threads = thread;
+    pthread_mutex_unlock(&vm->gc->lock);
+}
+
+void eris_gc_thread_destroy(eris_thread_t *thread)
+{
+    struct eris_gc *gc = thread->vm->gc;
+    pthread_mutex_lock(&gc->lock);
+    eris_thread_t **p = &thread->vm->threads;
+    while (*p != thread)
+        p = &(*p)->next;
+    *p = thread->next;
+    if (gc->next_thread == thread)
+        gc->next_thread = thread->next;
+    __atomic_sub_fetch(&gc->heap, thread->gc_credit, __ATOMIC_RELAXED);
+    if (thread->gc_objs) {
+        if (!gc->orphans)
+            gc->orphans_tail = thread->gc_objs_tail;
+        splice(&gc->orphans, thread->gc_objs, thread->gc_objs_tail);
+    }
+    Word_t index = 0;
+    for (int found = Judy1First(thread->gc_fibers, &index, PJE0); found;
+         found = Judy1Next(thread->gc_fibers, &index, PJE0)) {
+        ((fiber_t *) index)->stack = NULL;
+        __atomic_sub_fetch(&gc->heap, eris_fiber_stack_charge(),
+                           __ATOMIC_RELAXED);
+    }
+    Judy1FreeArray(&thread->gc_fibers, PJE0);
+    pthread_mutex_unlock(&gc->lock);
+}
+
+void eris_gc_lock(eris_vm_t *vm)
+{
+    pthread_mutex_lock(&vm->gc->lock);
+}
+
+void eris_gc_unlock(eris_vm_t *vm)
+{
+    pthread_mutex_unlock(&vm->gc->lock);
+}
+
+void eris_gc_get_config(eris_vm_t *vm, eris_gc_config_t *out)
+{
+    *out = vm->gc->config;
+}
+
+void eris_gc_set_config(eris_vm_t *vm, const eris_gc_config_t *config)
+{
+    pthread_mutex_lock(&vm->gc->lock);
+    vm->gc->config = *config;
+    /* Steps that do no work would never finish a collection. */
+    if (!vm->gc->config.step_bytes)
+        vm->gc->config.step_bytes = 1;
+    if (!vm->gc->config.work_percent)
+        vm->gc->config.work_percent = 1;
+    pthread_mutex_unlock(&vm->gc->lock);
+}
+
+void eris_gc_stats(eris_vm_t *vm, eris_gc_stats_t *out)
+{
+    struct eris_gc *gc = vm->gc;
+    pthread_mutex_lock(&gc->lock);
+    *out = gc->stats;
+    out->heap_bytes = __atomic_load_n(&gc->heap, __ATOMIC_RELAXED);
+    for (eris_thread_t *t = vm->threads; t; t = t->next)
+        out->heap_bytes -= MIN(t->gc_credit, out->heap_bytes);
+    out->peak_bytes = __atomic_load_n(&gc->peak, __ATOMIC_RELAXED);
+    out->live_bytes = gc->live;
+    pthread_mutex_unlock(&gc->lock);
+}
+
+void eris_gc_stats_print(const eris_gc_stats_t *stats, FILE *out)
+{
+    fprintf(out, "gc cycles %" PRIu64 "\n", stats->cycles);
+    fprintf(out, "gc pauses %" PRIu64 "\n", stats->pauses);
+    fprintf(out, "gc pause-ns-total %" PRIu64 "\n", stats->pause_ns_total);
+    fprintf(out, "gc pause-ns-max %" PRIu64 "\n", stats->pause_ns_max);
+    fprintf(out, "gc freed-bytes %" PRIu64 "\n", stats->freed_bytes);
+    fprintf(out, "gc heap-bytes %zu\n", stats->heap_bytes);
+    fprintf(out, "gc peak-bytes %zu\n", stats->peak_bytes);
+    fprintf(out, "gc live-bytes %zu\n", stats->live_bytes);
+    fprintf(out, "gc limit-failures %" PRIu64 "\n", stats->limit_failures);
+    for (size_t i = 0; i < ERIS_GC_PAUSE_BUCKETS; ++i)
+        if (stats->pause_hist[i])
+            fprintf(out, "gc-pauses %" PRIu64 "ns %" PRIu64 "\n",
+                    (uint64_t) 1 << i, stats->pause_hist[i]);
+}
+
+void eris_gc_collect(eris_frame_t *S)
+{
+    eris_vm_t *vm = S->thread->vm;
+    struct eris_gc *gc = vm->gc;
+    step_t step;
+    pthread_mutex_lock(&gc->lock);
+    step_begin(&step, SIZE_MAX, 0);
+    work(vm, &step);
+    if (!S->thread->vm_calls && stop_others(S->thread)) {
+        snapshot(S->thread, NULL);
+        start_others(gc);
+        work(vm, &step);
+    }
+    step_end(gc, &step);
+    pthread_mutex_unlock(&gc->lock);
+}
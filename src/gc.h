@@ -0,0 +1,206 @@
+/* The garbage collector: incremental, non-moving mark and sweep.
+ *
+ * Objects allocated with a frame (see eris_new) are collected: everything eris
+ * code and the C API make. Each hides a gc_link_t in front of its header, and
+ * starts out on its thread's list of new objects. Those allocated without one
+ * (by the loader, the assembler, eris_intern) live until the VM does, like
+ * static and foreign objects; and we assume they only refer to collected ones
+ * if stored there through eris_gc_store, which remembers them as roots.
+ *
+ * A collection begins with a snapshot, taken at a safe point, with nobody else
+ * in the VM: where eris code calls or jumps backward, with its thread in only
+ * the one eris_vm_call (so no builtin's C code holds values we can't see); or
+ * where a call to the C API begins, outside eris code, with its caller's
+ * values all in slots. It scans only that thread's registers, and takes every
+ * thread's new objects for the sweep. Marking then goes on a step at a time,
+ * as threads allocate, starting with the rest of the roots: the globals,
+ * remembered objects, held ones (see eris_gc_hold), other threads' registers
+ * and everyone's unfinished fibers. So does sweeping, afterwards. Objects
+ * allocated meanwhile are born black, and stay on their threads' lists, where
+ * the sweep won't look, until the next snapshot. Marks live in gc_link_ts, not
+ * headers, and what counts as marked flips with each snapshot, so that
+ * everything turns white at once without our touching it.
+ *
+ * Steps stop short at `max_pause_ns' (see eris_gc_config_t). A snapshot takes
+ * as long as its thread's stack is deep, though; and a thread that would go
+ * past the hard limit finishes the collection under way first, at once.
+ *
+ * What the snapshot reached stays reachable as far as we're concerned, so we
+ * needn't rescan anything: a deletion barrier (eris_gc_shade) marks what gets
+ * overwritten in objects and globals while we mark; and a thread entering the
+ * VM, or resuming a fiber, first scans the registers it's about to use, if we
+ * haven't yet. Registers above a stack's live ones may still hold what its
+ * last calls left there, which the snapshot would miss; so scanning a stack
+ * clears those out, to nil.
+ *
+ * Nothing collects during the parallel builtins' parallel sections (see
+ * pool.h), or while code nests eris_vm_calls; a heap built up there waits for
+ * a safe point with neither. A collection can't start while other threads are
+ * in the VM either, so threads that rarely all leave it at once hold it off.
+ *
+ * Threads share a VM's collector under its lock, which steps and barriers take
+ * in turn. Taking a snapshot also keeps other threads out of the VM until it's
+ * done: each enters it (see eris_gc_enter) for eris_vm_call, and for calls to
+ * the C API that touch its slots.
+ */
+#ifndef _GC_H_
+#define _GC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "misc.h"
+#include "types.h"
+#include "vm.h"
+
+/* Collections start no sooner than the heap reaches this. */
+#define ERIS_GC_MIN_HEAP ((size_t) 4 << 20)
+
+/* Defaults for eris_gc_config_t. */
+#define ERIS_GC_STEP_BYTES ((size_t) 64 << 10)
+#define ERIS_GC_WORK_PERCENT 200
+#define ERIS_GC_GROWTH_PERCENT 100
+#define ERIS_GC_MAX_PAUSE_NS 1000000
+
+/* A stack's registers above its live ones were written by calls that have
+ * since returned. Each call's registers start within its caller's, and an
+ * instruction names at most 256; so among them, there are never this many
+ * clean (not an object) registers in a row. */
+#define ERIS_GC_STACK_GAP 512
+
+/* What precedes every object eris_new allocates. Uncollected objects are only
+ * on a list once remembered. The top bit of `size' is a collected object's
+ * mark, which is only ours to touch once it's off its thread's list. */
+typedef struct gc_link {
+    struct gc_link *next;
+    size_t size;                /* of the object, header and all; and mark */
+} gc_link_t;
+
+#define GC_LINK_MARK (~(size_t) 0 ^ (~(size_t) 0 >> 1))
+
+static inline size_t link_size(const gc_link_t *link)
+{
+    return link->size & ~GC_LINK_MARK;
+}
+
+static inline gc_link_t *obj_link(obj_t *obj)
+{
+    return (gc_link_t *) obj - 1;
+}
+
+static inline obj_t *link_obj(gc_link_t *link)
+{
+    return (obj_t *) (link + 1);
+}
+
+/* Sets up and frees `vm's collector. The latter frees every collected object
+ * left, so call it once `vm's threads are gone. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_gc_init(eris_vm_t *vm);
+void eris_gc_free(eris_vm_t *vm);
+
+/* For eris_new, when `thread' has run out of credit for `size' bytes: does a
+ * step of the collection under way, if any, and gives it more. Returns false
+ * iff that would take the heap past its hard limit, even once we've finished
+ * the collection under way, if we can. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_gc_step(eris_thread_t *thread, size_t size);
+
+/* Starts a collection, if one is due and we can, at the safe point `*S'. */
+void eris_gc_safepoint(const vm_state_t *S);
+
+/* For the interpreter and compiled code, at the safe points they poll the
+ * profiler at. Compiled code leaves those to the interpreter while
+ * `gc_pending' is set, as it does when a sample is due. */
+static inline void eris_gc_poll(vm_state_t S)
+{
+    if (UNLIKELY(S.thread->gc_pending))
+        eris_gc_safepoint(&S);
+}
+
+/* For eris_vm_call and the C API: `thread' enters the VM, waiting out any
+ * snapshot another's taking, and scanning its registers if we're marking and
+ * haven't yet; and leaves it. Calls nest. */
+void eris_gc_enter(eris_thread_t *thread);
+void eris_gc_leave(eris_thread_t *thread);
+
+/* For the C API, at the start of calls that allocate, before they enter the
+ * VM. */
+void eris_gc_api_safepoint(eris_thread_t *thread);
+
+static inline void eris_gc_api_poll(eris_thread_t *thread)
+{
+    if (UNLIKELY(thread->gc_pending))
+        eris_gc_api_safepoint(thread);
+}
+
+/* The deletion barrier. Call it with the value in any field of an object
+ * about to be overwritten, other than while initializing it, or in any fiber's
+ * registers but the running one's. */
+void eris_gc_shade_slow(eris_thread_t *thread, val_t old);
+
+static inline void eris_gc_shade(eris_thread_t *thread, val_t old)
+{
+    if (UNLIKELY(__atomic_load_n(&thread->vm->gc_marking, __ATOMIC_RELAXED)))
+        eris_gc_shade_slow(thread, old);
+}
+
+/* Stores `v' in `*slot', a field of `obj'. Objects that aren't collected, but
+ * come to refer to ones that are, are remembered as roots for good. Foreign
+ * objects can't. */
+void eris_gc_remember(eris_thread_t *thread, obj_t *obj);
+
+static inline
+void eris_gc_store(eris_thread_t *thread, obj_t *obj, val_t *slot, val_t v)
+{
+    eris_gc_shade(thread, *slot);
+    if (UNLIKELY(!(obj->header & (HEADER_COLLECTED | HEADER_REMEMBERED)))
+        && VAL_IS_OBJ(v) && v != VAL_UNDEFINED
+        && VAL_OBJ(v)->header & HEADER_COLLECTED)
+        eris_gc_remember(thread, obj);
+    *slot = v;
+}
+
+/* For serial.c: holds the object `v' as a root under `key', until it's
+ * dropped; eris_gc_held finds what's held under `key', if anything. Holding
+ * fails iff something's held under `key' already, or we run out of memory. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_gc_hold(eris_thread_t *thread, const void *key, val_t v);
+ERIS_WARN_UNUSED_RESULT
+bool eris_gc_held(eris_thread_t *thread, const void *key, val_t *out);
+void eris_gc_drop(eris_thread_t *thread, const void *key);
+
+/* For fiber.c. A new fiber joins its thread's unfinished ones, which are
+ * roots; that fails iff we run out of memory. A fiber about to run has its
+ * stack scanned first, if we're marking and haven't yet. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_gc_fiber_spawned(eris_thread_t *thread, fiber_t *fiber);
+void eris_gc_fiber_done(eris_thread_t *thread, fiber_t *fiber);
+void eris_gc_resume_slow(eris_thread_t *thread, fiber_t *fiber);
+
+static inline void eris_gc_resume(eris_thread_t *thread, fiber_t *fiber)
+{
+    if (UNLIKELY(__atomic_load_n(&thread->vm->gc_marking, __ATOMIC_RELAXED)))
+        eris_gc_resume_slow(thread, fiber);
+}
+
+/* Clears out the registers from `regs' up, as far as they were used, short of
+ * `end'. For stacks no fiber's using any more. */
+void eris_gc_clean(val_t *regs, val_t *end);
+
+/* For pool.c, around each parallel section. */
+void eris_gc_parallel(eris_vm_t *vm, bool entering);
+
+/* For eris_thread_new and eris_thread_destroy: adds `thread' to its VM's
+ * list, and takes it off, handing its objects over to the VM. Its fibers can't
+ * run any more, so they're no longer roots, and lose their stacks. */
+void eris_gc_thread_new(eris_thread_t *thread);
+void eris_gc_thread_destroy(eris_thread_t *thread);
+
+/* For stats.c: takes and lets go of `vm's collector lock, under which its list
+ * of threads changes. */
+void eris_gc_lock(eris_vm_t *vm);
+void eris_gc_unlock(eris_vm_t *vm);
+
+#endif
@@ -0,0 +1,181 @@
+#define _DEFAULT_SOURCE
+
+#include "jit.h"
+
+#ifdef ERIS_JIT
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "misc.h"
+#include "prof.h"
+#include "runtime.h"
+#include "types.h"
+#include "vm.h"
+
+/* Generated from src/jit/stencils.c by jitgen; see main.mk. */
+#include "jit_stencils.h"
+
+static const uintptr_t symbol_addrs[] = {
+#define X(sym) (uintptr_t) &sym,
+    JIT_SYMBOLS(X)
+#undef X
+    0
+};
+
+static const uintptr_t data_addrs[] = {
+#define X(data) (uintptr_t) data,
+    JIT_DATA(X)
+#undef X
+    0
+};
+
+/* Compilation is rare; one lock for all of it is plenty. */
+static pthread_mutex_t compile_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The pc an instruction jumps to, if any. */
+static size_t jump_target(const proto_t *proto, size_t pc)
+{
+    instr_t instr = proto->code[pc];
+    switch ((enum op) VM_OP(instr)) {
+      case OP_JUMP:
+        return pc + VM_SIGNED_LONGARG(instr);
+      case OP_IF:
+      case OP_IFNOT:
+        return jump_target(proto, pc + 1);
+      case OP_TAILCALL_SELF:
+      case OP_TAILCALL_SELF0:
+        return 0;
+
+      case OP_MOVE: case OP_LOAD_INT: case OP_LOAD_UPVAL: case OP_LOAD_CELL:
+      case OP_LOAD_GLOBAL: case OP_CALL_CELL: case OP_CALL_REG:
+      case OP_CALL_CELL_N: case OP_CALL_REG_N:
+      case OP_TAILCALL_CELL: case OP_TAILCALL_REG:
+      case OP_TAILCALL_CELL0: case OP_TAILCALL_REG0:
+      case OP_RETURN: case OP_RETURN_N:
+      case OP_CLOSE:
+      default:
+        IMPOSSIBLE("instruction %zu doesn't jump", pc);
+    }
+}
+
+static const jit_stencil_t *stencil_for(const proto_t *proto, size_t pc)
+{
+    instr_t instr = proto->code[pc];
+    switch ((enum op) VM_OP(instr)) {
+      case OP_MOVE: return &jit_stencil_MOVE;
+      case OP_LOAD_INT: return &jit_stencil_LOAD_INT;
+      case OP_LOAD_UPVAL: return &jit_stencil_LOAD_UPVAL;
+      case OP_LOAD_CELL: return &jit_stencil_LOAD_CELL;
+      case OP_LOAD_GLOBAL: return &jit_stencil_LOAD_GLOBAL;
+      case OP_TAILCALL_SELF: return &jit_stencil_TAILCALL_SELF;
+      case OP_TAILCALL_SELF0: return &jit_stencil_TAILCALL_SELF0;
+      case OP_JUMP:
+        return VM_SIGNED_LONGARG(instr) < 0
+            ? &jit_stencil_JUMP_BACK : &jit_stencil_JUMP;
+      case OP_IF:
+        return jump_target(proto, pc) <= pc
+            ? &jit_stencil_IF_BACK : &jit_stencil_IF;
+      case OP_IFNOT:
+        return jump_target(proto, pc) <= pc
+            ? &jit_stencil_IFNOT_BACK : &jit_stencil_IFNOT;
+
+        /* These we leave to the interpreter. */
+      case OP_CALL_CELL: case OP_CALL_REG:
+      case OP_CALL_CELL_N: case OP_CALL_REG_N:
+      case OP_TAILCALL_CELL: case OP_TAILCALL_REG:
+      case OP_TAILCALL_CELL0: case OP_TAILCALL_REG0:
+      case OP_RETURN: case OP_RETURN_N:
+      case OP_CLOSE:
+        return &jit_stencil_exit;
+
+      default:
+        IMPOSSIBLE("unrecognized opcode: %u", VM_OP(instr));
+    }
+}
+
+static uintptr_t hole_value(const jit_hole_t *hole, const proto_t *proto,
+                            const struct eris_jit_code *jit, size_t pc)
+{
+    instr_t instr = proto->code[pc];
+    uintptr_t base = (uintptr_t) jit->mem;
+    switch ((enum jit_hole_kind) hole->kind) {
+      case JIT_HOLE_ARG1: return VM_ARG1(instr);
+      case JIT_HOLE_ARG2: return VM_ARG2(instr);
+      case JIT_HOLE_ARG3: return VM_ARG3(instr);
+      case JIT_HOLE_LONGARG: return VM_LONGARG(instr);
+      case JIT_HOLE_SIGNED_LONGARG:
+        return (uintptr_t) (intptr_t) VM_SIGNED_LONGARG(instr);
+      case JIT_HOLE_IP: return (uintptr_t) &proto->code[pc];
+      case JIT_HOLE_CONTINUE:
+        assert (pc + 1 < proto->code_len);
+        return base + jit->offsets[pc + 1];
+      case JIT_HOLE_NEXT2:
+        assert (pc + 2 < proto->code_len);
+        return base + jit->offsets[pc + 2];
+      case JIT_HOLE_TARGET:
+        return base + jit->offsets[jump_target(proto, pc)];
+      case JIT_HOLE_SYMBOL: return symbol_addrs[hole->index];
+      case JIT_HOLE_DATA: return data_addrs[hole->index];
+      default:
+        IMPOSSIBLE("unrecognized hole kind: %u", (unsigned) hole->kind);
+    }
+}
+
+void eris_jit_compile(proto_t *proto)
+{
+    assert (proto->verified);
+    pthread_mutex_lock(&compile_lock);
+    /* Code compiled ahead of time beats ours. */
+    if (proto->jit || proto->aot)
+        goto done;
+
+    struct eris_jit_code *jit = malloc(
+        sizeof *jit + sizeof jit->offsets[0] * proto->code_len);
+    if (!jit)
+        goto done;
+
+    /* Lay out the code. */
+    size_t size = 0;
+    for (size_t pc = 0; pc < proto->code_len; ++pc) {
+        jit->offsets[pc] = size;
+        size += stencil_for(proto, pc)->size;
+    }
+
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        free(jit);
+        goto done;
+    }
+    jit->mem = mem;
+    jit->size = size;
+
+    /* Copy and patch. */
+    for (size_t pc = 0; pc < proto->code_len; ++pc) {
+        const jit_stencil_t *stencil = stencil_for(proto, pc);
+        unsigned char *code = jit->mem + jit->offsets[pc];
+        memcpy(code, stencil->code, stencil->size);
+        for (size_t i = 0; i < stencil->num_holes; ++i) {
+            const jit_hole_t *hole = &stencil->holes[i];
+            uint64_t value = hole_value(hole, proto, jit, pc) + hole->addend;
+            memcpy(code + hole->offset, &value, sizeof value);
+        }
+    }
+
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC)) {
+        munmap(mem, size);
+        free(jit);
+        goto done;
+    }
+
+    __atomic_store_n(&proto->jit, jit, __ATOMIC_RELEASE);
+
+  done:
+    pthread_mutex_unlock(&compile_lock);
+}
+
+#endif  /* ERIS_JIT */
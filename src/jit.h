@@ -0,0 +1,101 @@
+/* The template JIT.
+ *
+ * Once a verified proto has been called ERIS_JIT_THRESHOLD times, we compile
+ * it by pasting together pre-assembled machine code "stencils", one per
+ * instruction, and patching their "holes" with the instruction's operands and
+ * the addresses of its successors. The stencils are compiled at build time from
+ * src/jit/stencils.c, and extracted from the resulting object file by
+ * src/jit/jitgen.c (this is "copy-and-patch" compilation).
+ *
+ * Compiled code runs with `regs' pinned in a register and keeps to its own
+ * proto: loads, jumps, conditionals and self tail calls. At any other
+ * instruction (calls, returns, CLOSE) it stores the IP and returns, and the
+ * interpreter takes over from there. It does likewise at backward jumps,
+ * conditional or not, when the profiler wants a sample (see prof.h) or a
+ * collection is due (see gc.h).
+ *
+ * Only built on x86-64 (with ERIS_JIT defined); elsewhere these are no-ops.
+ */
+#ifndef _JIT_H_
+#define _JIT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "misc.h"
+#include "types.h"
+
+#define ERIS_JIT_THRESHOLD 1000
+
+/* The signature of every stencil, and so of compiled code. */
+typedef void jit_func_t(vm_state_t *S, val_t *regs, closure_t *func);
+
+/* What to patch into a hole. jitgen names these after the _JIT_* symbols
+ * stencils.c refers to them by. */
+enum jit_hole_kind {
+    JIT_HOLE_ARG1, JIT_HOLE_ARG2, JIT_HOLE_ARG3,
+    JIT_HOLE_LONGARG, JIT_HOLE_SIGNED_LONGARG,
+    /* The address of the instruction being compiled. */
+    JIT_HOLE_IP,
+    /* Compiled code for the next instruction, the one after that, and the
+     * instruction's jump target. */
+    JIT_HOLE_CONTINUE, JIT_HOLE_NEXT2, JIT_HOLE_TARGET,
+    /* An external symbol, or a data block from stencils.o, at `index'. */
+    JIT_HOLE_SYMBOL, JIT_HOLE_DATA,
+};
+
+typedef struct {
+    uint32_t offset;
+    uint16_t kind;
+    uint16_t index;
+    int64_t addend;
+} jit_hole_t;
+
+typedef struct {
+    const unsigned char *code;
+    size_t size;
+    const jit_hole_t *holes;
+    size_t num_holes;
+} jit_stencil_t;
+
+struct eris_jit_code {
+    unsigned char *mem;
+    size_t size;
+    /* offsets[pc] is where the code for instruction `pc' begins. */
+    uint32_t offsets[];
+};
+
+#ifdef ERIS_JIT
+
+/* Compiles `proto', which must be verified. Does nothing if it's already
+ * compiled, or if we fail to. */
+void eris_jit_compile(proto_t *proto);
+
+/* Called whenever the interpreter enters a verified proto. */
+static inline void eris_jit_count(proto_t *proto)
+{
+    if (UNLIKELY(__atomic_add_fetch(&proto->num_calls, 1, __ATOMIC_RELAXED)
+                 == ERIS_JIT_THRESHOLD))
+        eris_jit_compile(proto);
+}
+
+/* Runs compiled code, if any, from `S->ip' until it reaches an instruction it
+ * leaves to the interpreter. Updates `S->ip'. */
+static inline void eris_jit_run(vm_state_t *S)
+{
+    struct eris_jit_code *jit =
+        __atomic_load_n(&S->func->proto->jit, __ATOMIC_ACQUIRE);
+    if (jit) {
+        size_t pc = S->ip - S->func->proto->code;
+        ((jit_func_t *) (jit->mem + jit->offsets[pc]))(S, S->regs, S->func);
+    }
+}
+
+#else  /* ERIS_JIT */
+
+static inline void eris_jit_count(proto_t *proto) { (void) proto; }
+static inline void eris_jit_run(vm_state_t *S) { (void) S; }
+
+#endif  /* ERIS_JIT */
+
+#endif
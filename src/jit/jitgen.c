@@ -0,0 +1,298 @@
+/* Generates jit_stencils.h from stencils.o; see jit.h and stencils.c.
+ *
+ * Usage: jitgen stencils.o > jit_stencils.h
+ *
+ * For each function eris_stencil_NAME in the object file, we emit its machine
+ * code as jit_code_NAME, its holes as jit_holes_NAME, and a jit_stencil_t
+ * jit_stencil_NAME tying them together. Relocations against the _JIT_* symbols
+ * become holes of the corresponding JIT_HOLE_* kind; relocations against
+ * other undefined symbols become JIT_HOLE_SYMBOLs, indexing into the list
+ * JIT_SYMBOLS(X); and relocations against read-only data sections become
+ * JIT_HOLE_DATAs, indexing into the list JIT_DATA(X), whose contents we also
+ * emit.
+ *
+ * Only handles x86-64 ELF relocatable objects using R_X86_64_64 relocations
+ * (ie. compiled with -mcmodel=large -fno-pic). Anything else is an error.
+ */
+#include <elf.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STENCIL_PREFIX "eris_stencil_"
+#define HOLE_PREFIX "_JIT_"
+#define MAX_NAMES 256
+
+static const char *filename;
+static unsigned char *file;
+static size_t file_size;
+
+static Elf64_Shdr *sections;
+static size_t num_sections;
+static const char *section_names;
+
+static Elf64_Sym *syms;
+static size_t num_syms;
+static const char *sym_names;
+
+/* Undefined symbols and data sections we've referenced so far. */
+static const char *symbols[MAX_NAMES];
+static size_t num_symbols;
+static size_t data_sections[MAX_NAMES];
+static size_t num_data_sections;
+
+static void die(const char *format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    fprintf(stderr, "jitgen: %s: ", filename);
+    vfprintf(stderr, format, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+    exit(1);
+}
+
+static void *at(size_t offset, size_t size)
+{
+    if (offset > file_size || size > file_size - offset)
+        die("truncated or malformed");
+    return file + offset;
+}
+
+static void read_file(void)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f)
+        die("can't open");
+    size_t cap = 1 << 16;
+    file = malloc(cap);
+    size_t n;
+    while (file && (n = fread(file + file_size, 1, cap - file_size, f))) {
+        file_size += n;
+        if (file_size == cap)
+            file = realloc(file, cap *= 2);
+    }
+    if (!file || ferror(f))
+        die("can't read");
+    fclose(f);
+}
+
+static void read_headers(void)
+{
+    Elf64_Ehdr *eh = at(0, sizeof *eh);
+    if (memcmp(eh->e_ident, ELFMAG, SELFMAG)
+        || eh->e_ident[EI_CLASS] != ELFCLASS64
+        || eh->e_ident[EI_DATA] != ELFDATA2LSB
+        || eh->e_type != ET_REL
+        || eh->e_machine != EM_X86_64)
+        die("not an x86-64 ELF relocatable object");
+
+    num_sections = eh->e_shnum;
+    sections = at(eh->e_shoff, num_sections * sizeof *sections);
+    Elf64_Shdr *shstr = &sections[eh->e_shstrndx];
+    section_names = at(shstr->sh_offset, shstr->sh_size);
+
+    for (size_t i = 0; i < num_sections; ++i) {
+        if (sections[i].sh_type != SHT_SYMTAB)
+            continue;
+        num_syms = sections[i].sh_size / sizeof *syms;
+        syms = at(sections[i].sh_offset, sections[i].sh_size);
+        Elf64_Shdr *str = &sections[sections[i].sh_link];
+        sym_names = at(str->sh_offset, str->sh_size);
+    }
+    if (!syms)
+        die("no symbol table");
+}
+
+static bool has_prefix(const char *s, const char *prefix)
+{
+    return !strncmp(s, prefix, strlen(prefix));
+}
+
+static void emit_bytes(const char *type, const char *name,
+                       const unsigned char *bytes, size_t size)
+{
+    printf("static const unsigned char %s%s[] = {", type, name);
+    for (size_t i = 0; i < size; ++i)
+        printf("%s0x%02x,", i % 12 ? " " : "\n    ", bytes[i]);
+    printf("\n};\n\n");
+}
+
+/* Returns the index of `name' among the symbols we've referenced. */
+static size_t symbol_index(const char *name)
+{
+    size_t i;
+    for (i = 0; i < num_symbols; ++i)
+        if (!strcmp(symbols[i], name))
+            return i;
+    if (num_symbols == MAX_NAMES)
+        die("too many symbols");
+    symbols[num_symbols] = name;
+    return num_symbols++;
+}
+
+/* Likewise for data sections, emitting them as we first see them. */
+static size_t data_index(size_t section)
+{
+    size_t i;
+    for (i = 0; i < num_data_sections; ++i)
+        if (data_sections[i] == section)
+            return i;
+    if (num_data_sections == MAX_NAMES)
+        die("too many data sections");
+
+    Elf64_Shdr *sh = &sections[section];
+    if ((sh->sh_flags & (SHF_WRITE | SHF_EXECINSTR))
+        || sh->sh_type != SHT_PROGBITS)
+        die("reference to unsupported section %s",
+            section_names + sh->sh_name);
+    for (size_t j = 0; j < num_sections; ++j)
+        if (sections[j].sh_type == SHT_RELA && sections[j].sh_info == section)
+            die("data section %s needs relocating",
+                section_names + sh->sh_name);
+
+    char name[32];
+    snprintf(name, sizeof name, "%zu", i);
+    emit_bytes("jit_data_", name,
+               at(sh->sh_offset, sh->sh_size), sh->sh_size);
+    data_sections[num_data_sections] = section;
+    return num_data_sections++;
+}
+
+typedef struct {
+    size_t offset;
+    const char *kind;
+    size_t index;
+    int64_t addend;
+} hole_t;
+
+static int hole_cmp(const void *a, const void *b)
+{
+    size_t x = ((const hole_t *) a)->offset, y = ((const hole_t *) b)->offset;
+    return (x > y) - (x < y);
+}
+
+static void emit_stencil(const Elf64_Sym *sym)
+{
+    const char *name = sym_names + sym->st_name + strlen(STENCIL_PREFIX);
+    size_t section = sym->st_shndx;
+    if (section == SHN_UNDEF || section >= num_sections)
+        die("stencil %s isn't defined", name);
+    Elf64_Shdr *sh = &sections[section];
+    size_t start = sym->st_value, size = sym->st_size;
+    const unsigned char *code = at(sh->sh_offset + start, size);
+
+    /* Gather holes. */
+    hole_t *holes = NULL;
+    size_t num_holes = 0;
+    for (size_t i = 0; i < num_sections; ++i) {
+        Elf64_Shdr *rsh = &sections[i];
+        if (rsh->sh_type == SHT_REL && rsh->sh_info == section)
+            die("unexpected REL relocations");
+        if (rsh->sh_type != SHT_RELA || rsh->sh_info != section)
+            continue;
+
+        size_t n = rsh->sh_size / sizeof(Elf64_Rela);
+        Elf64_Rela *relas = at(rsh->sh_offset, rsh->sh_size);
+        for (size_t j = 0; j < n; ++j) {
+            Elf64_Rela *r = &relas[j];
+            if (r->r_offset < start || r->r_offset >= start + size)
+                continue;
+            if (ELF64_R_TYPE(r->r_info) != R_X86_64_64)
+                die("stencil %s: unsupported relocation type %u", name,
+                    (unsigned) ELF64_R_TYPE(r->r_info));
+            if (ELF64_R_SYM(r->r_info) >= num_syms)
+                die("malformed relocation");
+
+            Elf64_Sym *target = &syms[ELF64_R_SYM(r->r_info)];
+            const char *tname = sym_names + target->st_name;
+            hole_t hole = { r->r_offset - start, NULL, 0, r->r_addend };
+            if (ELF64_ST_TYPE(target->st_info) == STT_SECTION) {
+                hole.kind = "DATA";
+                hole.index = data_index(target->st_shndx);
+            }
+            else if (target->st_shndx != SHN_UNDEF) {
+                die("stencil %s refers to local symbol %s", name, tname);
+            }
+            else if (has_prefix(tname, HOLE_PREFIX)) {
+                hole.kind = tname + strlen(HOLE_PREFIX);
+            }
+            else {
+                hole.kind = "SYMBOL";
+                hole.index = symbol_index(tname);
+            }
+
+            if (!(holes = realloc(holes, (num_holes + 1) * sizeof *holes)))
+                die("out of memory");
+            holes[num_holes++] = hole;
+        }
+    }
+    qsort(holes, num_holes, sizeof *holes, hole_cmp);
+
+    /* If we end by jumping to the next instruction's code, strip the jump, and
+     * just fall through to it instead. That jump is `movabs $_JIT_CONTINUE,
+     * %reg; jmp *%reg', ie. REX.W(+B) B8+r imm64, (REX.B) FF E0+r. */
+    if (num_holes) {
+        hole_t *last = &holes[num_holes - 1];
+        size_t movabs = last->offset - 2;
+        size_t jmp = last->offset + 8;
+        bool rex_b = code[movabs] & 1;
+        if (!strcmp(last->kind, "CONTINUE") && !last->addend
+            && last->offset >= 2
+            && (code[movabs] & ~1) == 0x48
+            && (code[movabs + 1] & ~7) == 0xb8
+            && jmp + 2 + rex_b == size
+            && (!rex_b || code[jmp] == 0x41)
+            && code[jmp + rex_b] == 0xff
+            && code[jmp + rex_b + 1] == (0xe0 | (code[movabs + 1] & 7)))
+        {
+            size = movabs;
+            --num_holes;
+        }
+    }
+
+    emit_bytes("jit_code_", name, code, size);
+
+    printf("static const jit_hole_t jit_holes_%s[] = {\n", name);
+    for (size_t i = 0; i < num_holes; ++i)
+        printf("    { %zu, JIT_HOLE_%s, %zu, %lld },\n", holes[i].offset,
+               holes[i].kind, holes[i].index, (long long) holes[i].addend);
+    if (!num_holes)
+        printf("    { 0, 0, 0, 0 }\n");
+    printf("};\n\n");
+
+    printf("static const jit_stencil_t jit_stencil_%s = {\n"
+           "    jit_code_%s, %zu, jit_holes_%s, %zu\n"
+           "};\n\n", name, name, size, name, num_holes);
+    free(holes);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s stencils.o\n", argv[0]);
+        return 2;
+    }
+    filename = argv[1];
+    read_file();
+    read_headers();
+
+    printf("/* Generated by jitgen from %s. Do not edit. */\n\n", filename);
+    for (size_t i = 0; i < num_syms; ++i) {
+        const char *name = sym_names + syms[i].st_name;
+        if (ELF64_ST_TYPE(syms[i].st_info) == STT_FUNC
+            && has_prefix(name, STENCIL_PREFIX))
+            emit_stencil(&syms[i]);
+    }
+
+    printf("#define JIT_SYMBOLS(X)");
+    for (size_t i = 0; i < num_symbols; ++i)
+        printf(" \\\n    X(%s)", symbols[i]);
+    printf("\n\n#define JIT_DATA(X)");
+    for (size_t i = 0; i < num_data_sections; ++i)
+        printf(" \\\n    X(jit_data_%zu)", i);
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,171 @@
+/* Stencils for the template JIT; see jit.h.
+ *
+ * This file isn't linked into eris. It's compiled with the large code model, so
+ * that every reference to a hole or an external symbol is a 64-bit absolute
+ * address, and jitgen turns the resulting object file into jit_stencils.h.
+ *
+ * Each stencil is a function named eris_stencil_OP. They all share a signature,
+ * so that jumping between them is a sibling call, which keeps `S', `regs' and
+ * `func' in the same registers throughout. When a stencil ends by jumping to
+ * _JIT_CONTINUE, jitgen strips the jump, and the stencil falls through into the
+ * next instruction's code instead.
+ */
+#include <string.h>
+
+#include "jit.h"
+#include "misc.h"
+#include "prof.h"
+#include "runtime.h"
+#include "stats.h"
+#include "types.h"
+#include "vm.h"
+
+/* Holes. Their addresses are patched with the values we want. */
+extern char _JIT_ARG1[], _JIT_ARG2[], _JIT_ARG3[];
+extern char _JIT_LONGARG[], _JIT_SIGNED_LONGARG[];
+extern char _JIT_IP[];
+extern char _JIT_CONTINUE[], _JIT_NEXT2[], _JIT_TARGET[];
+
+#define ARG1            ((size_t) _JIT_ARG1)
+#define ARG2            ((size_t) _JIT_ARG2)
+#define ARG3            ((size_t) _JIT_ARG3)
+#define LONGARG         ((size_t) _JIT_LONGARG)
+#define SIGNED_LONGARG  ((intptr_t) _JIT_SIGNED_LONGARG)
+#define IP              ((instr_t *) _JIT_IP)
+
+#define GOTO(hole) return ((jit_func_t *) _JIT_##hole)(S, regs, func)
+
+#define STENCIL(name)                                                   \
+    void eris_stencil_##name(vm_state_t *S, val_t *regs, closure_t *func)
+
+/* Compiled code does the interpreter's counting; see stats.h. */
+#define COUNT(op) STAT(S->thread, instrs[OP_##op]++)
+
+/* Hands control back to the interpreter at the current instruction. */
+STENCIL(exit)
+{
+    S->ip = IP;
+    (void) regs, (void) func;
+}
+
+STENCIL(MOVE)
+{
+    COUNT(MOVE);
+    regs[ARG1] = regs[ARG2];
+    GOTO(CONTINUE);
+}
+
+STENCIL(LOAD_INT)
+{
+    /* May allocate; need to update frame IP in case of GC scan. */
+    S->frame->data.call.ip = IP;
+
+    if (UNLIKELY(!make_fixnum(&regs[ARG1], SIGNED_LONGARG,
+                              S->thread, S->frame))) {
+        /* Let the interpreter retry, and raise if it fails too. */
+        S->ip = IP;
+        return;
+    }
+    COUNT(LOAD_INT);
+    GOTO(CONTINUE);
+}
+
+STENCIL(LOAD_UPVAL)
+{
+    COUNT(LOAD_UPVAL);
+    regs[ARG1] = func->upvals[ARG2];
+    GOTO(CONTINUE);
+}
+
+STENCIL(LOAD_CELL)
+{
+    COUNT(LOAD_CELL);
+    regs[ARG1] = deref_cell(get_cell(func->upvals[ARG2]));
+    GOTO(CONTINUE);
+}
+
+STENCIL(LOAD_GLOBAL)
+{
+    COUNT(LOAD_GLOBAL);
+    regs[ARG1] = deref_cell(&S->globals[LONGARG]);
+    GOTO(CONTINUE);
+}
+
+/* Loops leave it to the interpreter to take profiling samples (see prof.h),
+ * and to start collections (see gc.h). */
+#define POLL_PROF() do {                                                \
+        if (eris_prof_due(S->thread) || UNLIKELY(S->thread->gc_pending)) { \
+            S->ip = IP;                         \
+            return;                             \
+        }                                       \
+    } while (0)
+
+STENCIL(TAILCALL_SELF)
+{
+    POLL_PROF();
+    COUNT(TAILCALL_SELF);
+    STAT(S->thread, closure_calls++);
+    STAT(S->thread, tail_calls++);
+    memmove(regs, regs + ARG2, sizeof(val_t) * ARG3);
+    GOTO(TARGET);
+}
+
+STENCIL(TAILCALL_SELF0)
+{
+    POLL_PROF();
+    COUNT(TAILCALL_SELF0);
+    STAT(S->thread, closure_calls++);
+    STAT(S->thread, tail_calls++);
+    GOTO(TARGET);
+}
+
+STENCIL(JUMP)
+{
+    COUNT(JUMP);
+    GOTO(TARGET);
+}
+
+/* Backward jumps. */
+STENCIL(JUMP_BACK)
+{
+    POLL_PROF();
+    COUNT(JUMP);
+    GOTO(TARGET);
+}
+
+/* TARGET is where the following JUMP goes; NEXT2 is the instruction after
+ * it. */
+STENCIL(IF)
+{
+    COUNT(IF);
+    if (!VAL_IS_NIL(regs[ARG1]))
+        GOTO(NEXT2);
+    GOTO(TARGET);
+}
+
+STENCIL(IFNOT)
+{
+    COUNT(IFNOT);
+    if (VAL_IS_NIL(regs[ARG1]))
+        GOTO(NEXT2);
+    GOTO(TARGET);
+}
+
+/* Conditional backward jumps, which close loops just as JUMP_BACK does. */
+STENCIL(IF_BACK)
+{
+    POLL_PROF();
+    COUNT(IF);
+    if (!VAL_IS_NIL(regs[ARG1]))
+        GOTO(NEXT2);
+    GOTO(TARGET);
+}
+
+STENCIL(IFNOT_BACK)
+{
+    POLL_PROF();
+    COUNT(IFNOT);
+    if (VAL_IS_NIL(regs[ARG1]))
+        GOTO(NEXT2);
+    GOTO(TARGET);
+}
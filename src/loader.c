@@ -0,0 +1,72 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "loader.h"
+#include "misc.h"
+#include "runtime.h"
+#include "types.h"
+#include "vm.h"
+
+static bool consecutive(size_t n, const uint8_t *idxs)
+{
+    if (!n)
+        return false;
+    for (size_t i = 1; i < n; ++i)
+        if (idxs[i] != idxs[0] + i)
+            return false;
+    return true;
+}
+
+bool eris_proto_set_capture(proto_t *proto,
+                            size_t n_upval_idxs, const upval_t *upval_idxs,
+                            size_t n_reg_idxs, const reg_t *reg_idxs,
+                            eris_thread_t *thread, frame_t *frame)
+{
+    capture_t *cap = &proto->capture;
+    assert (n_upval_idxs + n_reg_idxs == proto->num_upvals);
+    *cap = ((capture_t) {
+            .num_from_upvals = n_upval_idxs,
+            .num_from_regs = n_reg_idxs,
+    });
+
+    if (!proto->num_upvals) {
+        /* It must live as long as `proto' does; see gc.h. */
+        if (!(CONTENTS_OBJ(proto)->header & HEADER_COLLECTED))
+            frame = NULL;
+        closure_t *shared;
+        if (!new_closure(&shared, 0, thread, frame))
+            return false;
+        shared->proto = proto;
+        cap->shared = shared;
+        return true;
+    }
+
+    if (!(cap->indices = malloc(proto->num_upvals)))
+        return false;
+    for (size_t i = 0; i < n_upval_idxs; ++i)
+        cap->indices[i] = upval_idxs[i];
+    for (size_t i = 0; i < n_reg_idxs; ++i)
+        cap->indices[n_upval_idxs + i] = reg_idxs[i];
+
+    cap->upvals_consecutive = consecutive(n_upval_idxs, cap->indices);
+    cap->regs_consecutive = consecutive(n_reg_idxs,
+                                        cap->indices + n_upval_idxs);
+    return true;
+}
+
+bool eris_global_slot(eris_vm_t *vm, const char *name, size_t len,
+                      longarg_t *slot)
+{
+    PPvoid_t entry = JudyHSGet(vm->global_slots, (void*) name, len);
+    if (!entry) {
+        if (vm->num_globals == ERIS_VM_GLOBALS)
+            return false;
+        entry = JudyHSIns(&vm->global_slots, (void*) name, len, PJE0);
+        if (entry == PPJERR)
+            return false;
+        *entry = (void*) (uintptr_t) vm->num_globals++;
+    }
+    *slot = (longarg_t) (uintptr_t) *entry;
+    return true;
+}
@@ -0,0 +1,65 @@
+/* Load-time processing of protos. The loader runs these over each proto it
+ * loads, before any of its code gets executed. */
+#ifndef _LOADER_H_
+#define _LOADER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "misc.h"
+#include "types.h"
+
+/* Builds `proto->capture', the descriptor CLOSE uses to build closures over
+ * `proto'. Closures capture, in order, their parent's upvals at indices
+ * `upval_idxs' and its registers `reg_idxs'. `proto->num_upvals' must equal
+ * the total number captured.
+ *
+ * Returns false iff allocation failed; caller should raise an exception.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_proto_set_capture(proto_t *proto,
+                            size_t n_upval_idxs, const upval_t *upval_idxs,
+                            size_t n_reg_idxs, const reg_t *reg_idxs,
+                            eris_thread_t *thread, frame_t *frame);
+
+/* Checks that `proto's code is well-formed: that its register, upval, local
+ * function and jump operands are all in bounds, that conditionals are followed
+ * by jumps and tail calls by returns, that control can't run off the end of its
+ * code, and so on. If so, marks it verified, so that it runs in the fast
+ * interpreter loop. Otherwise, returns false and, if `why' is non-NULL, stores
+ * a description of the problem there.
+ *
+ * Any protos `proto' closes over must have had their captures set first.
+ */
+bool eris_proto_verify(proto_t *proto, const char **why);
+
+/* Peephole-optimizes verified, not-yet-compiled `proto' in place: threads
+ * jumps, drops unreachable code, drops MOVEs and constant loads whose results
+ * are already in place or are never read, and hoists upval loads out of loops.
+ * Leaves `proto' verified. Its local functions need optimizing separately.
+ * Hoisting may reallocate its code, which must have come from malloc.
+ *
+ * Returns false iff allocation failed, in which case `proto' is still valid,
+ * but perhaps only partly optimized.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_proto_optimize(proto_t *proto);
+
+/* The global table. Code reaches globals with LOAD_GLOBAL, by slot; this maps
+ * the `len'-byte name `name' to its slot, giving it a new, undefined one the
+ * first time. Not safe to call from several threads at once.
+ *
+ * Returns false iff the table is full or allocation failed.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_global_slot(eris_vm_t *vm, const char *name, size_t len,
+                      longarg_t *slot);
+
+/* The cell in slot `slot', for defining the global. Pass what it held to
+ * eris_gc_shade first, if code might be running on `vm' (see gc.h). */
+static inline cell_t *eris_global_cell(eris_vm_t *vm, longarg_t slot)
+{
+    return &vm->globals[slot];
+}
+
+#endif
@@ -11,6 +11,9 @@
 #define STR_(x) #x
 #define STR(x) STR_(x)
 
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
+
 #define ARRAY_LEN(x) (sizeof(x)/sizeof((x)[0]))
 
 /* Useful for calculating eg. how many buckets of size "denom" are needed to
@@ -0,0 +1,444 @@
+#include <limits.h>
+
+#include <gmp.h>
+
+#include "misc.h"
+#include "num.h"
+#include "runtime.h"
+#include "types.h"
+#include "vm.h"
+
+/* We trade fixnums with GMP's _si functions, which take longs. */
+#if INTPTR_MAX != LONG_MAX
+#error "intptr_t and long must be the same size"
+#endif
+
+#define INTPTR_BITS (sizeof(intptr_t) * CHAR_BIT)
+
+/* A number, unpacked. We borrow bignums and rationals rather than copying
+ * them. */
+typedef struct {
+    enum num_tag tag;
+    union {
+        intptr_t i;
+        mpz_srcptr z;
+        mpq_srcptr q;
+        double d;
+    } u;
+} operand_t;
+
+static bool unpack(val_t v, operand_t *out)
+{
+    num_t *num;
+    if (get_fixnum(v, &out->u.i)) {
+        out->tag = NUM_INTPTR;
+        return true;
+    }
+    if (get_flonum(v, &out->u.d)) {
+        out->tag = NUM_DOUBLE;
+        return true;
+    }
+    if (!VAL_AS(num, v, &num))
+        return false;
+    switch ((enum num_tag) num->tag) {
+      case NUM_MPZ:
+        out->tag = NUM_MPZ;
+        out->u.z = num->data.v_mpz;
+        return true;
+      case NUM_MPQ:
+        out->tag = NUM_MPQ;
+        out->u.q = num->data.v_mpq;
+        return true;
+      case NUM_INTPTR: case NUM_DOUBLE:
+        /* get_fixnum and get_flonum take these. */
+      default:
+        IMPOSSIBLE("unrecognized number tag: %u", (unsigned) num->tag);
+    }
+}
+
+static double to_double(const operand_t *x)
+{
+    switch (x->tag) {
+      case NUM_INTPTR: return (double) x->u.i;
+      case NUM_MPZ: return mpz_get_d(x->u.z);
+      case NUM_MPQ: return mpq_get_d(x->u.q);
+      case NUM_DOUBLE: return x->u.d;
+      default:
+        IMPOSSIBLE("unrecognized number tag: %u", (unsigned) x->tag);
+    }
+}
+
+/* Converting exact numbers up the tower. These return `x's own bignum or
+ * rational if it has one, and otherwise initialize `tmp' to `x' and return it;
+ * pass what they return to the matching put_ function when done. */
+static mpz_srcptr get_mpz(const operand_t *x, mpz_ptr tmp)
+{
+    assert (x->tag == NUM_INTPTR || x->tag == NUM_MPZ);
+    if (x->tag == NUM_MPZ)
+        return x->u.z;
+    mpz_init_set_si(tmp, x->u.i);
+    return tmp;
+}
+
+static void put_mpz(mpz_srcptr z, mpz_ptr tmp)
+{
+    if (z == tmp)
+        mpz_clear(tmp);
+}
+
+static mpq_srcptr get_mpq(const operand_t *x, mpq_ptr tmp)
+{
+    assert (x->tag != NUM_DOUBLE);
+    if (x->tag == NUM_MPQ)
+        return x->u.q;
+    mpq_init(tmp);
+    if (x->tag == NUM_MPZ)
+        mpq_set_z(tmp, x->u.z);
+    else
+        mpq_set_si(tmp, x->u.i, 1);
+    return tmp;
+}
+
+static void put_mpq(mpq_srcptr q, mpq_ptr tmp)
+{
+    if (q == tmp)
+        mpq_clear(tmp);
+}
+
+
+/* Boxing results, demoting them as far as they'll go. Collected boxes are
+ * charged for their limbs. */
+static size_t mpz_bytes(mpz_srcptr z)
+{
+    return mpz_size(z) * sizeof(mp_limb_t);
+}
+
+static size_t mpq_bytes(mpq_srcptr q)
+{
+    return mpz_bytes(mpq_numref(q)) + mpz_bytes(mpq_denref(q));
+}
+
+static bool new_charged_num(num_t **out, size_t bytes,
+                            eris_thread_t *thread, frame_t *frame)
+{
+    if (frame && !eris_charge(thread, bytes))
+        return false;
+    if (!new_num(out, thread, frame)) {
+        if (frame)
+            eris_uncharge(thread, bytes);
+        return false;
+    }
+    return true;
+}
+
+bool eris_num_box_mpz(val_t *out, mpz_ptr z,
+                      eris_thread_t *thread, frame_t *frame)
+{
+    num_t *num;
+    if (mpz_fits_slong_p(z)) {
+        intptr_t i = mpz_get_si(z);
+        mpz_clear(z);
+        return make_fixnum(out, i, thread, frame);
+    }
+    if (!new_charged_num(&num, mpz_bytes(z), thread, frame)) {
+        mpz_clear(z);
+        return false;
+    }
+    num->tag = NUM_MPZ;
+    *num->data.v_mpz = *z;
+    *out = CONTENTS_VAL(num);
+    return true;
+}
+
+bool eris_num_box_mpq(val_t *out, mpq_ptr q,
+                      eris_thread_t *thread, frame_t *frame)
+{
+    num_t *num;
+    /* GMP keeps rationals in lowest terms, so this is an integer iff its
+     * denominator is 1. If so, steal its numerator. */
+    if (!mpz_cmp_ui(mpq_denref(q), 1)) {
+        mpz_clear(mpq_denref(q));
+        return eris_num_box_mpz(out, mpq_numref(q), thread, frame);
+    }
+    if (!new_charged_num(&num, mpq_bytes(q), thread, frame)) {
+        mpq_clear(q);
+        return false;
+    }
+    num->tag = NUM_MPQ;
+    *num->data.v_mpq = *q;
+    *out = CONTENTS_VAL(num);
+    return true;
+}
+
+
+/* Arithmetic. Each operation comes in a version for every rank; the fixnum
+ * one fails on overflow, which sends us up to bignums. `product' says whether
+ * a result can be as long as its operands together, rather than a bit longer
+ * than the longer; for rationals, it can anyway. */
+typedef struct {
+    bool (*fixnum)(intptr_t *acc, intptr_t x);
+    void (*mpz)(mpz_ptr, mpz_srcptr, mpz_srcptr);
+    void (*mpq)(mpq_ptr, mpq_srcptr, mpq_srcptr);
+    double (*flonum)(double, double);
+    bool product;
+} arith_t;
+
+static double add_flonum(double x, double y) { return x + y; }
+static double sub_flonum(double x, double y) { return x - y; }
+static double mul_flonum(double x, double y) { return x * y; }
+
+static const arith_t add_op = { fixnum_add, mpz_add, mpq_add, add_flonum,
+                                false };
+static const arith_t sub_op = { fixnum_sub, mpz_sub, mpq_sub, sub_flonum,
+                                false };
+static const arith_t mul_op = { fixnum_mul, mpz_mul, mpq_mul, mul_flonum,
+                                true };
+
+static size_t mpz_bits(mpz_srcptr z) { return mpz_sizeinbase(z, 2); }
+
+static size_t mpq_bits(mpq_srcptr q)
+{
+    return mpz_bits(mpq_numref(q)) + mpz_bits(mpq_denref(q));
+}
+
+static bool arith(const arith_t *op, val_t *out, val_t a, val_t b,
+                  eris_thread_t *thread, frame_t *frame)
+{
+    operand_t x, y;
+    if (!unpack(a, &x) || !unpack(b, &y))
+        return false;
+    enum num_tag rank = MAX(x.tag, y.tag);
+
+    if (rank == NUM_INTPTR) {
+        intptr_t r = x.u.i;
+        if (op->fixnum(&r, y.u.i))
+            return make_fixnum(out, r, thread, frame);
+        rank = NUM_MPZ;
+    }
+
+    if (rank == NUM_MPZ) {
+        mpz_t tx, ty, r;
+        mpz_srcptr zx = get_mpz(&x, tx), zy = get_mpz(&y, ty);
+        size_t bx = mpz_bits(zx), by = mpz_bits(zy);
+        if ((op->product ? bx + by : MAX(bx, by) + 1) > ERIS_NUM_MAX_BITS) {
+            put_mpz(zx, tx);
+            put_mpz(zy, ty);
+            return false;
+        }
+        mpz_init(r);
+        op->mpz(r, zx, zy);
+        put_mpz(zx, tx);
+        put_mpz(zy, ty);
+        return eris_num_box_mpz(out, r, thread, frame);
+    }
+
+    if (rank == NUM_MPQ) {
+        mpq_t tx, ty, r;
+        mpq_srcptr qx = get_mpq(&x, tx), qy = get_mpq(&y, ty);
+        if (mpq_bits(qx) + mpq_bits(qy) + 1 > ERIS_NUM_MAX_BITS) {
+            put_mpq(qx, tx);
+            put_mpq(qy, ty);
+            return false;
+        }
+        mpq_init(r);
+        op->mpq(r, qx, qy);
+        put_mpq(qx, tx);
+        put_mpq(qy, ty);
+        return eris_num_box_mpq(out, r, thread, frame);
+    }
+
+    return make_flonum(out, op->flonum(to_double(&x), to_double(&y)),
+                       thread, frame);
+}
+
+bool eris_num_add(val_t *out, val_t a, val_t b,
+                  eris_thread_t *thread, frame_t *frame)
+{
+    return arith(&add_op, out, a, b, thread, frame);
+}
+
+bool eris_num_sub(val_t *out, val_t a, val_t b,
+                  eris_thread_t *thread, frame_t *frame)
+{
+    return arith(&sub_op, out, a, b, thread, frame);
+}
+
+bool eris_num_mul(val_t *out, val_t a, val_t b,
+                  eris_thread_t *thread, frame_t *frame)
+{
+    return arith(&mul_op, out, a, b, thread, frame);
+}
+
+bool eris_num_to_double(val_t v, double *out)
+{
+    operand_t x;
+    if (!unpack(v, &x))
+        return false;
+    *out = to_double(&x);
+    return true;
+}
+
+bool eris_num_eq(bool *out, val_t a, val_t b)
+{
+    operand_t x, y;
+    if (!unpack(a, &x) || !unpack(b, &y))
+        return false;
+    enum num_tag rank = MAX(x.tag, y.tag);
+    switch (rank) {
+      case NUM_INTPTR:
+        *out = x.u.i == y.u.i;
+        return true;
+      case NUM_MPZ: {
+          mpz_t tx, ty;
+          mpz_srcptr zx = get_mpz(&x, tx), zy = get_mpz(&y, ty);
+          *out = !mpz_cmp(zx, zy);
+          put_mpz(zx, tx);
+          put_mpz(zy, ty);
+          return true;
+      }
+      case NUM_MPQ: {
+          mpq_t tx, ty;
+          mpq_srcptr qx = get_mpq(&x, tx), qy = get_mpq(&y, ty);
+          *out = mpq_equal(qx, qy);
+          put_mpq(qx, tx);
+          put_mpq(qy, ty);
+          return true;
+      }
+      case NUM_DOUBLE:
+        *out = to_double(&x) == to_double(&y);
+        return true;
+      default:
+        IMPOSSIBLE("unrecognized number tag: %u", (unsigned) rank);
+    }
+}
+
+
+/* Bitwise operations. On fixnums these can't overflow, except for shifting
+ * left. */
+typedef struct {
+    intptr_t (*fixnum)(intptr_t, intptr_t);
+    void (*mpz)(mpz_ptr, mpz_srcptr, mpz_srcptr);
+} bitop_t;
+
+static intptr_t and_fixnum(intptr_t x, intptr_t y) { return x & y; }
+static intptr_t or_fixnum(intptr_t x, intptr_t y) { return x | y; }
+static intptr_t xor_fixnum(intptr_t x, intptr_t y) { return x ^ y; }
+
+static const bitop_t and_op = { and_fixnum, mpz_and };
+static const bitop_t or_op = { or_fixnum, mpz_ior };
+static const bitop_t xor_op = { xor_fixnum, mpz_xor };
+
+static bool is_integer(const operand_t *x)
+{
+    return x->tag == NUM_INTPTR || x->tag == NUM_MPZ;
+}
+
+static bool bitop(const bitop_t *op, val_t *out, val_t a, val_t b,
+                  eris_thread_t *thread, frame_t *frame)
+{
+    operand_t x, y;
+    if (!unpack(a, &x) || !unpack(b, &y)
+        || !is_integer(&x) || !is_integer(&y))
+        return false;
+    if (x.tag == NUM_INTPTR && y.tag == NUM_INTPTR)
+        return make_fixnum(out, op->fixnum(x.u.i, y.u.i), thread, frame);
+
+    mpz_t tx, ty, r;
+    mpz_srcptr zx = get_mpz(&x, tx), zy = get_mpz(&y, ty);
+    mpz_init(r);
+    op->mpz(r, zx, zy);
+    put_mpz(zx, tx);
+    put_mpz(zy, ty);
+    return eris_num_box_mpz(out, r, thread, frame);
+}
+
+bool eris_num_and(val_t *out, val_t a, val_t b,
+                  eris_thread_t *thread, frame_t *frame)
+{
+    return bitop(&and_op, out, a, b, thread, frame);
+}
+
+bool eris_num_or(val_t *out, val_t a, val_t b,
+                 eris_thread_t *thread, frame_t *frame)
+{
+    return bitop(&or_op, out, a, b, thread, frame);
+}
+
+bool eris_num_xor(val_t *out, val_t a, val_t b,
+                  eris_thread_t *thread, frame_t *frame)
+{
+    return bitop(&xor_op, out, a, b, thread, frame);
+}
+
+bool eris_num_not(val_t *out, val_t a, eris_thread_t *thread, frame_t *frame)
+{
+    operand_t x;
+    if (!unpack(a, &x) || !is_integer(&x))
+        return false;
+    if (x.tag == NUM_INTPTR)
+        return make_fixnum(out, ~x.u.i, thread, frame);
+    mpz_t r;
+    mpz_init(r);
+    mpz_com(r, x.u.z);
+    return eris_num_box_mpz(out, r, thread, frame);
+}
+
+bool eris_num_shl(val_t *out, val_t a, size_t n,
+                  eris_thread_t *thread, frame_t *frame)
+{
+    operand_t x;
+    if (!unpack(a, &x) || !is_integer(&x))
+        return false;
+    if (x.tag == NUM_INTPTR && n < INTPTR_BITS - 1
+        && x.u.i >= INTPTR_MIN >> n && x.u.i <= INTPTR_MAX >> n)
+        return make_fixnum(out, (intptr_t) ((uintptr_t) x.u.i << n),
+                           thread, frame);
+
+    mpz_t tx, r;
+    mpz_srcptr zx = get_mpz(&x, tx);
+    if (mpz_sgn(zx) && (n > ERIS_NUM_MAX_BITS
+                        || mpz_bits(zx) > ERIS_NUM_MAX_BITS - n)) {
+        put_mpz(zx, tx);
+        return false;
+    }
+    mpz_init(r);
+    mpz_mul_2exp(r, zx, n);
+    put_mpz(zx, tx);
+    return eris_num_box_mpz(out, r, thread, frame);
+}
+
+bool eris_num_shr(val_t *out, val_t a, size_t n,
+                  eris_thread_t *thread, frame_t *frame)
+{
+    operand_t x;
+    if (!unpack(a, &x) || !is_integer(&x))
+        return false;
+    /* Like VM_SIGNED_LONGARG, this depends on >> being arithmetic. */
+    if (x.tag == NUM_INTPTR)
+        return make_fixnum(out, n < INTPTR_BITS ? x.u.i >> n : -(x.u.i < 0),
+                           thread, frame);
+    /* Rounding towards negative infinity is what makes it arithmetic. */
+    mpz_t r;
+    mpz_init(r);
+    mpz_fdiv_q_2exp(r, x.u.z, n);
+    return eris_num_box_mpz(out, r, thread, frame);
+}
+
+size_t eris_num_clear(num_t *num)
+{
+    size_t bytes = 0;
+    switch ((enum num_tag) num->tag) {
+      case NUM_MPZ:
+        bytes = mpz_bytes(num->data.v_mpz);
+        mpz_clear(num->data.v_mpz);
+        break;
+      case NUM_MPQ:
+        bytes = mpq_bytes(num->data.v_mpq);
+        mpq_clear(num->data.v_mpq);
+        break;
+      case NUM_INTPTR: case NUM_DOUBLE: break;
+      default:
+        IMPOSSIBLE("unrecognized number tag: %u", (unsigned) num->tag);
+    }
+    return bytes;
+}
@@ -0,0 +1,79 @@
+/* Generic arithmetic over the numeric tower: fixnums, then bignums (mpz), then
+ * rationals (mpq), then flonums. An operation on two numbers happens at the
+ * higher of their ranks, and its result is demoted to the lowest rank that
+ * represents it exactly: a rational with denominator 1 becomes an integer, and
+ * an integer that fits in an intptr_t becomes a fixnum. Flonums never demote.
+ *
+ * The builtins handle the common fixnum and flonum cases themselves, and come
+ * here for everything else. Every function here fails, leaving `*out' alone,
+ * if an argument is of the wrong type or allocation fails; the caller should
+ * raise an exception.
+ *
+ * Bignums' and rationals' limbs are charged to the heap (see eris_charge); but
+ * GMP aborts when it can't get the memory for one, so operations also fail,
+ * as for a type error, if their result could be more than ERIS_NUM_MAX_BITS
+ * bits (32 MiB) long, counting a rational's numerator and denominator
+ * together. What GMP allocates for its own scratch space goes uncharged.
+ */
+#ifndef _NUM_H_
+#define _NUM_H_
+
+#include <stdbool.h>
+
+#include "misc.h"
+#include "types.h"
+
+#define ERIS_NUM_MAX_BITS ((size_t) 1 << 28)
+
+/* Converts any number to a double. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_num_to_double(val_t v, double *out);
+
+ERIS_WARN_UNUSED_RESULT
+bool eris_num_add(val_t *out, val_t a, val_t b,
+                  eris_thread_t *thread, frame_t *frame);
+ERIS_WARN_UNUSED_RESULT
+bool eris_num_sub(val_t *out, val_t a, val_t b,
+                  eris_thread_t *thread, frame_t *frame);
+ERIS_WARN_UNUSED_RESULT
+bool eris_num_mul(val_t *out, val_t a, val_t b,
+                  eris_thread_t *thread, frame_t *frame);
+
+/* Stores whether a = b in `*out'. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_num_eq(bool *out, val_t a, val_t b);
+
+/* Bitwise operations, on integers only. They treat negative numbers as
+ * infinitely sign-extended two's complement, so SHR is arithmetic. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_num_and(val_t *out, val_t a, val_t b,
+                  eris_thread_t *thread, frame_t *frame);
+ERIS_WARN_UNUSED_RESULT
+bool eris_num_or(val_t *out, val_t a, val_t b,
+                 eris_thread_t *thread, frame_t *frame);
+ERIS_WARN_UNUSED_RESULT
+bool eris_num_xor(val_t *out, val_t a, val_t b,
+                  eris_thread_t *thread, frame_t *frame);
+ERIS_WARN_UNUSED_RESULT
+bool eris_num_not(val_t *out, val_t a, eris_thread_t *thread, frame_t *frame);
+ERIS_WARN_UNUSED_RESULT
+bool eris_num_shl(val_t *out, val_t a, size_t n,
+                  eris_thread_t *thread, frame_t *frame);
+ERIS_WARN_UNUSED_RESULT
+bool eris_num_shr(val_t *out, val_t a, size_t n,
+                  eris_thread_t *thread, frame_t *frame);
+
+/* Boxes `z' or `q', demoted as far as it'll go. These take ownership of it,
+ * freeing it if they fail. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_num_box_mpz(val_t *out, mpz_ptr z,
+                      eris_thread_t *thread, frame_t *frame);
+ERIS_WARN_UNUSED_RESULT
+bool eris_num_box_mpq(val_t *out, mpq_ptr q,
+                      eris_thread_t *thread, frame_t *frame);
+
+/* Frees the bignum or rational that `num' holds, if any, returning what it was
+ * charged. For eris_free. */
+size_t eris_num_clear(num_t *num);
+
+#endif
@@ -0,0 +1,618 @@
+/* The load-time peephole optimizer. */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "loader.h"
+#include "misc.h"
+#include "types.h"
+#include "vm.h"
+
+#define NUM_REGS 256            /* registers are named by a byte */
+#define NONE ((size_t) -1)
+
+/* Our working state: `proto's code, and which of its instructions we've
+ * decided to drop, and which start basic blocks (ie. are jumped to). */
+typedef struct {
+    proto_t *proto;
+    bool *dead;
+    bool *label;
+    bool changed;
+} opt_t;
+
+static void drop(opt_t *o, size_t pc)
+{
+    if (!o->dead[pc]) {
+        o->dead[pc] = true;
+        o->changed = true;
+    }
+}
+
+static bool is_cond(op_t op) { return op == OP_IF || op == OP_IFNOT; }
+
+static size_t jump_target(const proto_t *proto, size_t pc)
+{
+    return (size_t) ((ptrdiff_t) pc + VM_SIGNED_LONGARG(proto->code[pc]));
+}
+
+/* Whether the JUMP at `pc' is the one an IF or IFNOT skips over. */
+static bool is_cond_jump(const proto_t *proto, size_t pc)
+{
+    return pc && is_cond(VM_OP(proto->code[pc-1]));
+}
+
+static bool set_jump(proto_t *proto, size_t pc, size_t target)
+{
+    ptrdiff_t offset = (ptrdiff_t) target - (ptrdiff_t) pc;
+    if (offset < INT16_MIN || offset > INT16_MAX)
+        return false;
+    proto->code[pc] = VM_INSTR_LONG(OP_JUMP, 0,
+                                    (longarg_t) (signed_longarg_t) offset);
+    return true;
+}
+
+
+/* Jump threading. A jump to a jump goes straight to the latter's target; an
+ * unconditional jump to a return becomes that return. */
+static void thread_jumps(opt_t *o)
+{
+    proto_t *proto = o->proto;
+    for (size_t pc = 0; pc < proto->code_len; ++pc) {
+        if (o->dead[pc] || VM_OP(proto->code[pc]) != OP_JUMP)
+            continue;
+        size_t target = jump_target(proto, pc);
+        /* Give up on cycles of jumps; they're infinite loops anyway. */
+        for (size_t steps = 0;
+             VM_OP(proto->code[target]) == OP_JUMP
+                 && steps < proto->code_len;
+             ++steps)
+            target = jump_target(proto, target);
+
+        op_t op = VM_OP(proto->code[target]);
+        if ((op == OP_RETURN || op == OP_RETURN_N)
+            && !is_cond_jump(proto, pc)) {
+            proto->code[pc] = proto->code[target];
+            o->changed = true;
+        } else if (op != OP_JUMP && target != jump_target(proto, pc)
+                   && set_jump(proto, pc, target)) {
+            o->changed = true;
+        }
+    }
+}
+
+
+/* Dead code: anything control can't reach from the start. */
+static bool mark_unreachable(opt_t *o)
+{
+    proto_t *proto = o->proto;
+    size_t len = proto->code_len, num_pending = 0;
+    bool *seen = calloc(len, sizeof *seen);
+    size_t *pending = malloc(len * sizeof *pending);
+    if (!seen || !pending) {
+        free(seen);
+        free(pending);
+        return false;
+    }
+
+#define VISIT(pc) do {                          \
+        size_t pc_ = (pc);                      \
+        if (!seen[pc_]) {                       \
+            seen[pc_] = true;                   \
+            pending[num_pending++] = pc_;       \
+        }                                       \
+    } while (0)
+
+    VISIT(0);
+    while (num_pending) {
+        size_t pc = pending[--num_pending];
+        switch ((enum op) VM_OP(proto->code[pc])) {
+          case OP_JUMP:
+            VISIT(jump_target(proto, pc));
+            break;
+          case OP_IF: case OP_IFNOT:
+            VISIT(pc + 1);
+            VISIT(pc + 2);
+            break;
+          case OP_RETURN: case OP_RETURN_N:
+            break;
+          case OP_MOVE: case OP_LOAD_INT: case OP_LOAD_UPVAL: case OP_LOAD_CELL:
+          case OP_LOAD_GLOBAL: case OP_CALL_CELL: case OP_CALL_REG:
+          case OP_CALL_CELL_N: case OP_CALL_REG_N: case OP_CLOSE:
+          /* A tail call to a builtin goes on to the RETURN after it. */
+          case OP_TAILCALL_CELL: case OP_TAILCALL_REG:
+          case OP_TAILCALL_CELL0: case OP_TAILCALL_REG0:
+          case OP_TAILCALL_SELF: case OP_TAILCALL_SELF0:
+          default:
+            VISIT(pc + 1);
+            break;
+        }
+    }
+#undef VISIT
+
+    for (size_t pc = 0; pc < len; ++pc)
+        if (!seen[pc])
+            drop(o, pc);
+    free(seen);
+    free(pending);
+    return true;
+}
+
+/* Branches to where we'd have gone anyway: JUMP +1, and IF or IFNOT followed
+ * by one. */
+static void drop_null_jumps(opt_t *o)
+{
+    proto_t *proto = o->proto;
+    for (size_t pc = 0; pc < proto->code_len; ++pc) {
+        if (o->dead[pc] || VM_OP(proto->code[pc]) != OP_JUMP
+            || VM_SIGNED_LONGARG(proto->code[pc]) != 1)
+            continue;
+        drop(o, pc);
+        if (is_cond_jump(proto, pc))
+            drop(o, pc - 1);
+    }
+}
+
+static void find_labels(opt_t *o)
+{
+    proto_t *proto = o->proto;
+    memset(o->label, 0, proto->code_len * sizeof *o->label);
+    /* TAILCALL_SELF jumps to the start. */
+    o->label[0] = true;
+    for (size_t pc = 0; pc < proto->code_len; ++pc)
+        if (!o->dead[pc] && VM_OP(proto->code[pc]) == OP_JUMP)
+            o->label[jump_target(proto, pc)] = true;
+}
+
+
+/* Redundant loads and dead stores, within each basic block. We number the
+ * values registers hold, so that we know when two hold the same one; and
+ * remember which loads are of the same constant (upval or integer) so as to
+ * give them the same number. Registers a call clobbers get fresh numbers.
+ *
+ * A MOVE, LOAD_INT or LOAD_UPVAL whose register is overwritten before anything
+ * reads it, or that's followed by a RETURN that doesn't read it, is dead.
+ * Calls leave garbage above their argument registers, but we don't count that
+ * as overwriting them.
+ */
+typedef struct {
+    size_t vn[NUM_REGS];
+    /* The last MOVE or constant load into each register, if nothing has read
+     * the register since; else NONE. */
+    size_t store[NUM_REGS];
+    /* The constant loads we've seen: instructions with ARG1 masked out, and
+     * the numbers of the values they load. */
+    instr_t *consts;
+    size_t *const_vns;
+    size_t num_consts;
+    size_t next_vn;
+} block_t;
+
+#define CONST_KEY(instr) ((instr) & ~(instr_t) 0xff00)
+
+static void block_reset(block_t *b)
+{
+    for (size_t r = 0; r < NUM_REGS; ++r) {
+        b->vn[r] = b->next_vn++;
+        b->store[r] = NONE;
+    }
+    b->num_consts = 0;
+}
+
+static void reads(block_t *b, size_t from, size_t n)
+{
+    for (size_t r = from; r < from + n && r < NUM_REGS; ++r)
+        b->store[r] = NONE;
+}
+
+/* A write of a new value to `r', by the instruction at `pc' if it's a MOVE or
+ * constant load. */
+static void writes(opt_t *o, block_t *b, size_t r, size_t pc, size_t vn)
+{
+    if (b->store[r] != NONE)
+        drop(o, b->store[r]);
+    b->store[r] = pc;
+    b->vn[r] = vn;
+}
+
+static void clobbers(block_t *b, size_t from)
+{
+    for (size_t r = from; r < NUM_REGS; ++r) {
+        b->vn[r] = b->next_vn++;
+        b->store[r] = NONE;
+    }
+}
+
+static size_t const_vn(block_t *b, instr_t instr)
+{
+    instr_t key = CONST_KEY(instr);
+    for (size_t i = 0; i < b->num_consts; ++i)
+        if (b->consts[i] == key)
+            return b->const_vns[i];
+    b->consts[b->num_consts] = key;
+    return b->const_vns[b->num_consts++] = b->next_vn++;
+}
+
+static void optimize_blocks(opt_t *o, block_t *b)
+{
+    proto_t *proto = o->proto;
+    for (size_t pc = 0; pc < proto->code_len; ++pc) {
+        if (o->label[pc])
+            block_reset(b);
+        if (o->dead[pc])
+            continue;
+
+        instr_t instr = proto->code[pc];
+        arg_t arg1 = VM_ARG1(instr), arg2 = VM_ARG2(instr);
+        arg_t arg3 = VM_ARG3(instr);
+        size_t vn;
+
+        switch ((enum op) VM_OP(instr)) {
+          case OP_MOVE:
+            if (b->vn[arg1] == b->vn[arg2]) {
+                drop(o, pc);
+                break;
+            }
+            /* Copy from the start of a chain of MOVEs, so that the ones in
+             * between may turn out to be dead. */
+            if (b->store[arg2] != NONE
+                && VM_OP(proto->code[b->store[arg2]]) == OP_MOVE) {
+                arg_t from = VM_ARG2(proto->code[b->store[arg2]]);
+                if (b->vn[from] == b->vn[arg2]) {
+                    arg2 = from;
+                    proto->code[pc] = VM_INSTR(OP_MOVE, arg1, arg2, 0);
+                    o->changed = true;
+                }
+            }
+            vn = b->vn[arg2];
+            reads(b, arg2, 1);
+            writes(o, b, arg1, pc, vn);
+            break;
+
+          case OP_LOAD_INT:
+          case OP_LOAD_UPVAL:
+            vn = const_vn(b, instr);
+            if (b->vn[arg1] == vn)
+                drop(o, pc);
+            else
+                writes(o, b, arg1, pc, vn);
+            break;
+
+          case OP_LOAD_CELL:
+          case OP_LOAD_GLOBAL:
+            b->vn[arg1] = b->next_vn++;
+            b->store[arg1] = NONE;
+            break;
+
+          case OP_CLOSE: {
+              const capture_t *cap =
+                  &proto->local_funcs[VM_LONGARG(instr)]->capture;
+              for (size_t i = 0; i < cap->num_from_regs; ++i)
+                  reads(b, cap->indices[cap->num_from_upvals + i], 1);
+              b->vn[arg1] = b->next_vn++;
+              b->store[arg1] = NONE;
+              break;
+          }
+
+          case OP_CALL_REG_N:
+            reads(b, arg1, 1);
+            /* fall through */
+          case OP_CALL_CELL_N:
+            reads(b, arg2, VM_CALL_N_NARGS(instr));
+            clobbers(b, arg2);
+            break;
+
+          case OP_CALL_REG:
+            reads(b, arg1, 1);
+            /* fall through */
+          case OP_CALL_CELL:
+            reads(b, arg2, arg3);
+            clobbers(b, arg2);
+            break;
+
+          /* Nothing reads what we haven't returned. */
+          case OP_RETURN:
+          case OP_RETURN_N:
+            reads(b, arg1, VM_OP(instr) == OP_RETURN ? 1 : arg2);
+            for (size_t r = 0; r < NUM_REGS; ++r)
+                if (b->store[r] != NONE)
+                    drop(o, b->store[r]);
+            block_reset(b);
+            break;
+
+          /* The rest end their blocks, as far as we're concerned. */
+          case OP_TAILCALL_CELL: case OP_TAILCALL_REG:
+          case OP_TAILCALL_CELL0: case OP_TAILCALL_REG0:
+          case OP_TAILCALL_SELF: case OP_TAILCALL_SELF0:
+          case OP_JUMP:
+          case OP_IF: case OP_IFNOT:
+          default:
+            block_reset(b);
+            break;
+        }
+    }
+}
+
+
+/* Loop-invariant upval loads. A loop is the code from the target of a JUMP
+ * back to it up to the last such JUMP, so long as nothing outside jumps into
+ * its middle. If control goes straight from the head of a loop to a
+ * LOAD_UPVAL, touching its register nowhere on the way, and nothing else in the
+ * loop writes that register but the same load, then it holds that upval
+ * throughout the loop; upvals never change. So we load it just once, before
+ * the head: jumps from outside the loop go to the new load, and those from
+ * inside past it, and the loads in the loop are dropped.
+ *
+ * That grows the code, so we do it one load at a time, and only once the other
+ * passes have run out of work.
+ */
+static bool is_control(op_t op)
+{
+    switch ((enum op) op) {
+      case OP_JUMP: case OP_IF: case OP_IFNOT:
+      case OP_RETURN: case OP_RETURN_N:
+      case OP_TAILCALL_CELL: case OP_TAILCALL_REG:
+      case OP_TAILCALL_CELL0: case OP_TAILCALL_REG0:
+      case OP_TAILCALL_SELF: case OP_TAILCALL_SELF0:
+        return true;
+      case OP_MOVE: case OP_LOAD_INT: case OP_LOAD_UPVAL: case OP_LOAD_CELL:
+      case OP_LOAD_GLOBAL: case OP_CALL_CELL: case OP_CALL_REG:
+      case OP_CALL_CELL_N: case OP_CALL_REG_N: case OP_CLOSE:
+      default:
+        return false;
+    }
+}
+
+/* Whether `instr' may write register `r' and go on to the next instruction.
+ * Control instructions don't; a TAILCALL_SELF goes back to the start of the
+ * code, where the load we'd insert before a loop starting there would be. */
+static bool writes_reg(instr_t instr, size_t r)
+{
+    switch ((enum op) VM_OP(instr)) {
+      case OP_MOVE: case OP_LOAD_INT: case OP_LOAD_UPVAL: case OP_LOAD_CELL:
+      case OP_LOAD_GLOBAL: case OP_CLOSE:
+        return VM_ARG1(instr) == r;
+      case OP_CALL_CELL: case OP_CALL_REG:
+      case OP_CALL_CELL_N: case OP_CALL_REG_N:
+        return r >= VM_ARG2(instr);
+      case OP_JUMP: case OP_IF: case OP_IFNOT:
+      case OP_RETURN: case OP_RETURN_N:
+      case OP_TAILCALL_CELL: case OP_TAILCALL_REG:
+      case OP_TAILCALL_CELL0: case OP_TAILCALL_REG0:
+      case OP_TAILCALL_SELF: case OP_TAILCALL_SELF0:
+      default:
+        return false;
+    }
+}
+
+/* Whether `instr', which isn't a control instruction, may read or write
+ * register `r'. */
+static bool uses_reg(const proto_t *proto, instr_t instr, size_t r)
+{
+    switch ((enum op) VM_OP(instr)) {
+      case OP_MOVE:
+        return VM_ARG1(instr) == r || VM_ARG2(instr) == r;
+      case OP_CLOSE: {
+          const capture_t *cap =
+              &proto->local_funcs[VM_LONGARG(instr)]->capture;
+          for (size_t i = 0; i < cap->num_from_regs; ++i)
+              if (cap->indices[cap->num_from_upvals + i] == r)
+                  return true;
+          return VM_ARG1(instr) == r;
+      }
+      case OP_CALL_REG: case OP_CALL_REG_N:
+        return VM_ARG1(instr) == r || r >= VM_ARG2(instr);
+      case OP_LOAD_INT: case OP_LOAD_UPVAL: case OP_LOAD_CELL:
+      case OP_LOAD_GLOBAL: case OP_CALL_CELL: case OP_CALL_CELL_N:
+      case OP_JUMP: case OP_IF: case OP_IFNOT:
+      case OP_RETURN: case OP_RETURN_N:
+      case OP_TAILCALL_CELL: case OP_TAILCALL_REG:
+      case OP_TAILCALL_CELL0: case OP_TAILCALL_REG0:
+      case OP_TAILCALL_SELF: case OP_TAILCALL_SELF0:
+      default:
+        return writes_reg(instr, r);
+    }
+}
+
+/* The LOAD_UPVAL we can hoist out of the loop from `head' to `end', if any;
+ * else NONE. */
+static size_t invariant_load(const proto_t *proto, size_t head, size_t end)
+{
+    bool used[NUM_REGS] = { false };
+    for (size_t pc = head;
+         pc <= end && !is_control(VM_OP(proto->code[pc]));
+         ++pc) {
+        instr_t instr = proto->code[pc];
+        if (VM_OP(instr) == OP_LOAD_UPVAL && !used[VM_ARG1(instr)]) {
+            size_t other = head;
+            while (other <= end && (proto->code[other] == instr
+                                    || !writes_reg(proto->code[other],
+                                                   VM_ARG1(instr))))
+                ++other;
+            if (other > end)
+                return pc;
+        }
+        for (size_t r = 0; r < NUM_REGS; ++r)
+            used[r] = used[r] || uses_reg(proto, instr, r);
+    }
+    return NONE;
+}
+
+/* Where the JUMP at `pc' to `target' should go once we've inserted a load at
+ * `head', before the loop that ends at `end'. Both are from before. */
+static size_t hoisted_target(size_t head, size_t end, size_t pc, size_t target)
+{
+    if (target == head && (pc < head || pc > end))
+        return head;
+    return target + (target >= head);
+}
+
+/* Whether every JUMP's offset will still fit once we've inserted a load at
+ * `head'. */
+static bool hoist_fits(const proto_t *proto, size_t head, size_t end)
+{
+    for (size_t pc = 0; pc < proto->code_len; ++pc) {
+        if (VM_OP(proto->code[pc]) != OP_JUMP)
+            continue;
+        ptrdiff_t offset =
+            (ptrdiff_t) hoisted_target(head, end, pc, jump_target(proto, pc))
+            - (ptrdiff_t) (pc + (pc >= head));
+        if (offset < INT16_MIN || offset > INT16_MAX)
+            return false;
+    }
+    return true;
+}
+
+static bool hoist(opt_t *o, block_t *b, size_t head, size_t end, size_t load)
+{
+    proto_t *proto = o->proto;
+    size_t len = proto->code_len;
+    instr_t *code = realloc(proto->code, (len + 1) * sizeof *code);
+    if (!code)
+        return false;
+    proto->code = code;
+    bool *dead = realloc(o->dead, (len + 1) * sizeof *dead);
+    if (!dead)
+        return false;
+    o->dead = dead;
+    bool *label = realloc(o->label, (len + 1) * sizeof *label);
+    if (!label)
+        return false;
+    o->label = label;
+    instr_t *consts = realloc(b->consts, (len + 1) * sizeof *consts);
+    if (!consts)
+        return false;
+    b->consts = consts;
+    size_t *const_vns = realloc(b->const_vns, (len + 1) * sizeof *const_vns);
+    if (!const_vns)
+        return false;
+    b->const_vns = const_vns;
+
+    instr_t instr = code[load];
+    memmove(code + head + 1, code + head, (len - head) * sizeof *code);
+    code[head] = instr;
+    proto->code_len = len + 1;
+    memset(o->dead, 0, (len + 1) * sizeof *o->dead);
+    for (size_t pc = 0; pc < len; ++pc) {
+        size_t at = pc + (pc >= head);
+        if (VM_OP(code[at]) != OP_JUMP)
+            continue;
+        size_t target = (size_t) ((ptrdiff_t) pc
+                                  + VM_SIGNED_LONGARG(code[at]));
+        set_jump(proto, at, hoisted_target(head, end, pc, target));
+    }
+    for (size_t pc = head + 1; pc <= end + 1; ++pc)
+        if (code[pc] == instr)
+            drop(o, pc);
+    return true;
+}
+
+static bool hoist_loads(opt_t *o, block_t *b)
+{
+    proto_t *proto = o->proto;
+    size_t len = proto->code_len;
+    /* The last JUMP back to each instruction, if any. */
+    size_t *ends = malloc(len * sizeof *ends);
+    if (!ends)
+        return false;
+    for (size_t pc = 0; pc < len; ++pc)
+        ends[pc] = NONE;
+    for (size_t pc = 0; pc < len; ++pc)
+        if (VM_OP(proto->code[pc]) == OP_JUMP
+            && jump_target(proto, pc) <= pc)
+            ends[jump_target(proto, pc)] = pc;
+
+    bool ok = true;
+    for (size_t head = 0; head < len; ++head) {
+        size_t end = ends[head];
+        /* An IF or IFNOT must stay right before its JUMP. */
+        if (end == NONE || is_cond_jump(proto, head))
+            continue;
+        size_t pc = 0;
+        for (; pc < len; ++pc)
+            if ((pc < head || pc > end)
+                && VM_OP(proto->code[pc]) == OP_JUMP
+                && jump_target(proto, pc) > head
+                && jump_target(proto, pc) <= end)
+                break;
+        if (pc < len)
+            continue;
+        size_t load = invariant_load(proto, head, end);
+        if (load != NONE && hoist_fits(proto, head, end)) {
+            ok = hoist(o, b, head, end, load);
+            break;
+        }
+    }
+    free(ends);
+    return ok;
+}
+
+
+/* Squeezes out the dead instructions. Jumps to them go to the next live one
+ * instead, which is where they'd have gone on to. */
+static bool compact(opt_t *o)
+{
+    proto_t *proto = o->proto;
+    size_t len = proto->code_len;
+    size_t *new_pc = malloc(len * sizeof *new_pc);
+    if (!new_pc)
+        return false;
+    size_t n = 0;
+    for (size_t pc = 0; pc < len; ++pc) {
+        new_pc[pc] = n;
+        n += !o->dead[pc];
+    }
+    for (size_t pc = 0; pc < len; ++pc) {
+        if (o->dead[pc] || VM_OP(proto->code[pc]) != OP_JUMP)
+            continue;
+        /* Jumps only get shorter, so the offset still fits. */
+        size_t target = new_pc[jump_target(proto, pc)];
+        proto->code[pc] = VM_INSTR_LONG(
+            OP_JUMP, 0,
+            (longarg_t) (signed_longarg_t)
+            ((ptrdiff_t) target - (ptrdiff_t) new_pc[pc]));
+    }
+    n = 0;
+    for (size_t pc = 0; pc < len; ++pc)
+        if (!o->dead[pc])
+            proto->code[n++] = proto->code[pc];
+    proto->code_len = n;
+    memset(o->dead, 0, len * sizeof *o->dead);
+    free(new_pc);
+    return true;
+}
+
+bool eris_proto_optimize(proto_t *proto)
+{
+    assert (proto->verified && !proto->jit && !proto->aot);
+    size_t len = proto->code_len;
+    opt_t o = { .proto = proto };
+    block_t b = { .next_vn = 0 };
+    bool ok = (o.dead = calloc(len, sizeof *o.dead))
+        && (o.label = calloc(len, sizeof *o.label))
+        && (b.consts = malloc(len * sizeof *b.consts))
+        && (b.const_vns = malloc(len * sizeof *b.const_vns));
+
+    /* Each pass can make work for the others, so go until none finds any. */
+    do {
+        o.changed = false;
+        if (!ok)
+            break;
+        thread_jumps(&o);
+        ok = mark_unreachable(&o);
+        if (!ok)
+            break;
+        drop_null_jumps(&o);
+        find_labels(&o);
+        optimize_blocks(&o, &b);
+        ok = compact(&o);
+        if (ok && !o.changed)
+            ok = hoist_loads(&o, &b);
+    } while (o.changed);
+
+    free(o.dead);
+    free(o.label);
+    free(b.consts);
+    free(b.const_vns);
+    assert (!ok || eris_proto_verify(proto, NULL));
+    return ok;
+}
@@ -0,0 +1,408 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "gc.h"
+#include "misc.h"
+#include "pool.h"
+#include "runtime.h"
+#include "types.h"
+#include "vm.h"
+
+/* A job is a range of task indices [0, num_tasks). It is split evenly between
+ * its participants (the pool's workers, plus the thread that submitted it),
+ * each of which repeatedly takes `grain' tasks off the front of its own range.
+ * A participant whose range runs dry steals the back half of somebody else's.
+ *
+ * Jobs only ever write to disjoint parts of a preallocated output array, and
+ * the functions they call are required to be pure, so tasks may run in any
+ * order on any thread.
+ */
+
+typedef struct {
+    pthread_mutex_t lock;
+    size_t lo, hi;
+} range_t;
+
+typedef struct job job_t;
+
+/* Runs tasks [lo, hi) of `job' on `thread'. Returns false on failure. */
+typedef bool (*task_fn_t)(job_t *job, eris_thread_t *thread,
+                          val_t *regs, frame_t *frame, size_t lo, size_t hi);
+
+struct job {
+    task_fn_t run;
+    size_t num_tasks;
+    size_t grain;
+
+    val_t func;
+    size_t num_elems;
+    size_t block;               /* elements per task, for reductions */
+    const val_t *in;
+    val_t *out;
+
+    range_t *ranges;            /* one per participant */
+    size_t num_parts;
+    /* These are guarded by the pool's lock. */
+    size_t active;              /* participants that haven't finished */
+    bool failed;
+};
+
+typedef struct {
+    eris_pool_t *pool;
+    size_t index;               /* participant index; 0 is the submitter */
+    eris_thread_t *thread;
+    pthread_t tid;
+} worker_t;
+
+struct eris_pool {
+    /* Held by a job's submitter until the job is done. Would-be submitters
+     * that can't get it just run serially, which also takes care of tasks
+     * that themselves call parallel builtins. */
+    pthread_mutex_t submit;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;        /* a job was posted, or we're shutting down */
+    pthread_cond_t done;        /* a job's last participant finished */
+    job_t *job;
+    unsigned long generation;   /* bumped whenever a job is posted */
+    bool shutdown;
+
+    size_t num_workers;
+    worker_t workers[];
+};
+
+
+static eris_pool_t *pool_new(eris_vm_t *vm, size_t num_workers);
+
+
+/* Running jobs. */
+static bool take(range_t *r, size_t grain, size_t *lo, size_t *hi)
+{
+    pthread_mutex_lock(&r->lock);
+    bool ok = r->lo < r->hi;
+    if (ok) {
+        *lo = r->lo;
+        *hi = r->lo + MIN(grain, r->hi - r->lo);
+        r->lo = *hi;
+    }
+    pthread_mutex_unlock(&r->lock);
+    return ok;
+}
+
+static bool steal(job_t *job, size_t me, size_t *lo, size_t *hi)
+{
+    for (size_t i = 1; i < job->num_parts; ++i) {
+        range_t *r = &job->ranges[(me + i) % job->num_parts];
+        pthread_mutex_lock(&r->lock);
+        /* Leave the victim anything too small to be worth splitting. */
+        if (r->hi - r->lo > job->grain) {
+            *lo = r->lo + (r->hi - r->lo) / 2;
+            *hi = r->hi;
+            r->hi = *lo;
+            pthread_mutex_unlock(&r->lock);
+            return true;
+        }
+        pthread_mutex_unlock(&r->lock);
+    }
+    return false;
+}
+
+static bool participate(job_t *job, size_t me, eris_thread_t *thread,
+                        val_t *regs, frame_t *frame)
+{
+    range_t *mine = &job->ranges[me];
+    size_t lo, hi;
+    for (;;) {
+        if (!take(mine, job->grain, &lo, &hi)) {
+            if (!steal(job, me, &lo, &hi))
+                return true;
+            /* Make the loot our own, so that it can be stolen in turn. */
+            pthread_mutex_lock(&mine->lock);
+            mine->lo = lo;
+            mine->hi = hi;
+            pthread_mutex_unlock(&mine->lock);
+            continue;
+        }
+        if (!job->run(job, thread, regs, frame, lo, hi))
+            return false;
+    }
+}
+
+/* Call with pool->lock held. */
+static void finish(eris_pool_t *pool, job_t *job, bool ok)
+{
+    if (!ok)
+        job->failed = true;
+    if (--job->active == 0)
+        pthread_cond_signal(&pool->done);
+}
+
+static void *worker_main(void *arg)
+{
+    worker_t *w = arg;
+    eris_pool_t *pool = w->pool;
+    val_t *regs = w->thread->regs;
+    frame_t *frame = w->thread->frames;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->shutdown)
+            break;
+        seen = pool->generation;
+        job_t *job = pool->job;
+        pthread_mutex_unlock(&pool->lock);
+
+        /* We enter the VM before filling in registers; see eris_vm_call. */
+        eris_gc_enter(w->thread);
+        bool ok = participate(job, w->index, w->thread, regs, frame);
+        eris_gc_leave(w->thread);
+
+        pthread_mutex_lock(&pool->lock);
+        finish(pool, job, ok);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/* Returns the vm's pool with its submit lock held, or NULL if `n' elements
+ * should be handled serially. */
+static eris_pool_t *claim_pool(eris_vm_t *vm, size_t n)
+{
+    if (n < vm->par_cutoff)
+        return NULL;
+
+    pthread_mutex_lock(&vm->pool_lock);
+    if (!vm->pool && vm->par_workers) {
+        size_t num_workers = vm->par_workers;
+        if (num_workers == ERIS_PAR_DEFAULT_WORKERS) {
+            long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+            num_workers = ncpus > 1 ? (size_t) ncpus - 1 : 0;
+        }
+        vm->pool = pool_new(vm, num_workers);
+    }
+    eris_pool_t *pool = vm->pool;
+    pthread_mutex_unlock(&vm->pool_lock);
+
+    if (!pool || !pool->num_workers || pthread_mutex_trylock(&pool->submit))
+        return NULL;
+    return pool;
+}
+
+/* Runs `job' on `pool', which must have been claimed by claim_pool. */
+static bool run_parallel(eris_pool_t *pool, job_t *job, eris_thread_t *thread,
+                         val_t *regs, frame_t *frame)
+{
+    size_t num_parts = pool->num_workers + 1;
+    range_t ranges[num_parts];
+    for (size_t i = 0; i < num_parts; ++i) {
+        pthread_mutex_init(&ranges[i].lock, NULL);
+        ranges[i].lo = job->num_tasks * i / num_parts;
+        ranges[i].hi = job->num_tasks * (i + 1) / num_parts;
+    }
+    job->ranges = ranges;
+    job->num_parts = num_parts;
+    job->active = num_parts;
+    job->failed = false;
+    eris_gc_parallel(thread->vm, true);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->job = job;
+    ++pool->generation;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    bool ok = participate(job, 0, thread, regs, frame);
+
+    pthread_mutex_lock(&pool->lock);
+    finish(pool, job, ok);
+    while (job->active)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    ok = !job->failed;
+    pool->job = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    eris_gc_parallel(thread->vm, false);
+    for (size_t i = 0; i < num_parts; ++i)
+        pthread_mutex_destroy(&ranges[i].lock);
+    pthread_mutex_unlock(&pool->submit);
+    return ok;
+}
+
+/* Runs `job' on `pool' if it's non-NULL (and claimed), else serially. */
+static bool run(eris_pool_t *pool, job_t *job, eris_thread_t *thread,
+                val_t *regs, frame_t *frame)
+{
+    if (!pool)
+        return job->run(job, thread, regs, frame, 0, job->num_tasks);
+    job->grain = 1 + job->num_tasks
+        / ((pool->num_workers + 1) * ERIS_PAR_SPLITS);
+    return run_parallel(pool, job, thread, regs, frame);
+}
+
+
+/* Tasks. */
+static bool from_fn_task(job_t *job, eris_thread_t *thread, val_t *regs,
+                         frame_t *frame, size_t lo, size_t hi)
+{
+    for (size_t i = lo; i < hi; ++i) {
+        if (!make_fixnum(&regs[1], (intptr_t) i, thread, frame))
+            return false;
+        regs[0] = job->func;
+        if (!eris_vm_call(thread, regs, frame, 1, NULL))
+            return false;
+        job->out[i] = regs[0];
+    }
+    return true;
+}
+
+static bool map_task(job_t *job, eris_thread_t *thread, val_t *regs,
+                     frame_t *frame, size_t lo, size_t hi)
+{
+    for (size_t i = lo; i < hi; ++i) {
+        regs[0] = job->func;
+        regs[1] = job->in[i];
+        if (!eris_vm_call(thread, regs, frame, 1, NULL))
+            return false;
+        job->out[i] = regs[0];
+    }
+    return true;
+}
+
+/* Task b folds block b of the input into out[b]. */
+static bool reduce_task(job_t *job, eris_thread_t *thread, val_t *regs,
+                        frame_t *frame, size_t lo, size_t hi)
+{
+    for (size_t b = lo; b < hi; ++b) {
+        size_t i = b * job->block;
+        size_t end = MIN(i + job->block, job->num_elems);
+        val_t acc = job->in[i];
+        for (++i; i < end; ++i) {
+            regs[0] = job->func;
+            regs[1] = acc;
+            regs[2] = job->in[i];
+            if (!eris_vm_call(thread, regs, frame, 2, NULL))
+                return false;
+            acc = regs[0];
+        }
+        job->out[b] = acc;
+    }
+    return true;
+}
+
+
+/* Interface. */
+bool eris_par_from_fn(eris_thread_t *thread, val_t *regs, frame_t *frame,
+                      val_t f, size_t n, val_t *out)
+{
+    job_t job = { .run = from_fn_task, .num_tasks = n, .func = f,
+                  .num_elems = n, .out = out };
+    return run(claim_pool(thread->vm, n), &job, thread, regs, frame);
+}
+
+bool eris_par_map(eris_thread_t *thread, val_t *regs, frame_t *frame,
+                  val_t f, size_t n, const val_t *in, val_t *out)
+{
+    job_t job = { .run = map_task, .num_tasks = n, .func = f,
+                  .num_elems = n, .in = in, .out = out };
+    return run(claim_pool(thread->vm, n), &job, thread, regs, frame);
+}
+
+bool eris_par_reduce(eris_thread_t *thread, val_t *regs, frame_t *frame,
+                     val_t f, val_t init, size_t n, const val_t *in,
+                     val_t *out)
+{
+    val_t acc = init;
+    if (n) {
+        /* Fold ERIS_PAR_SPLITS blocks per participant in parallel, then fold
+         * their results together in order. Associativity makes this kosher. */
+        eris_pool_t *pool = claim_pool(thread->vm, n);
+        size_t num_blocks = !pool ? 1
+            : MIN(n, (pool->num_workers + 1) * ERIS_PAR_SPLITS);
+        val_t *partials = malloc(num_blocks * sizeof(val_t));
+        if (!partials) {
+            if (pool)
+                pthread_mutex_unlock(&pool->submit);
+            return false;
+        }
+
+        job_t job = { .run = reduce_task, .func = f, .num_elems = n,
+                      .in = in, .out = partials };
+        job.block = INTDIV_CEIL(n, num_blocks);
+        job.num_tasks = INTDIV_CEIL(n, job.block);
+        if (!run(pool, &job, thread, regs, frame)) {
+            free(partials);
+            return false;
+        }
+
+        for (size_t b = 0; b < job.num_tasks; ++b) {
+            regs[0] = f;
+            regs[1] = acc;
+            regs[2] = partials[b];
+            if (!eris_vm_call(thread, regs, frame, 2, NULL)) {
+                free(partials);
+                return false;
+            }
+            acc = regs[0];
+        }
+        free(partials);
+    }
+    *out = acc;
+    return true;
+}
+
+
+/* Creating & destroying pools. */
+static eris_pool_t *pool_new(eris_vm_t *vm, size_t num_workers)
+{
+    eris_pool_t *pool = malloc(sizeof *pool + num_workers * sizeof(worker_t));
+    if (!pool)
+        return NULL;
+    pthread_mutex_init(&pool->submit, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->job = NULL;
+    pool->generation = 0;
+    pool->shutdown = false;
+
+    /* If we can't start as many workers as asked, make do with fewer. */
+    pool->num_workers = 0;
+    for (size_t i = 0; i < num_workers; ++i) {
+        worker_t *w = &pool->workers[i];
+        w->pool = pool;
+        w->index = i + 1;
+        if (!(w->thread = eris_thread_new(vm)))
+            break;
+        if (pthread_create(&w->tid, NULL, worker_main, w)) {
+            eris_thread_destroy(w->thread);
+            break;
+        }
+        ++pool->num_workers;
+    }
+    return pool;
+}
+
+void eris_pool_destroy(eris_pool_t *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->num_workers; ++i) {
+        pthread_join(pool->workers[i].tid, NULL);
+        eris_thread_destroy(pool->workers[i].thread);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->submit);
+    free(pool);
+}
@@ -0,0 +1,50 @@
+/* Work-stealing thread pool, for builtins which apply pure functions over
+ * large index ranges (seq-from-fn, seq-map, seq-reduce). */
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "misc.h"
+#include "types.h"
+
+/* Means "one worker per online CPU, not counting the calling thread". */
+#define ERIS_PAR_DEFAULT_WORKERS ((size_t) -1)
+/* Inputs shorter than this aren't worth waking up the workers for. */
+#define ERIS_PAR_DEFAULT_CUTOFF 4096
+/* Each participant's share of a job is split into about this many chunks, so
+ * that there is something left to steal when participants run unevenly. */
+#define ERIS_PAR_SPLITS 32
+
+/* Each of these calls the eris function `f' once per element, possibly on
+ * several OS threads at once and in no particular order; so `f' had better be
+ * pure. `regs' is scratch register space above the caller's live registers,
+ * and `frame' is the caller's control frame, as for eris_vm_call.
+ *
+ * They return false iff something went wrong (eg. we ran out of memory), in
+ * which case the caller should raise an exception.
+ */
+
+/* out[i] = (f i), for 0 <= i < n. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_par_from_fn(eris_thread_t *thread, val_t *regs, frame_t *frame,
+                      val_t f, size_t n, val_t *out);
+
+/* out[i] = (f in[i]), for 0 <= i < n. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_par_map(eris_thread_t *thread, val_t *regs, frame_t *frame,
+                  val_t f, size_t n, const val_t *in, val_t *out);
+
+/* *out = (f ... (f (f init in[0]) in[1]) ... in[n-1]). Since the elements are
+ * combined in parallel, `f' must be associative.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_par_reduce(eris_thread_t *thread, val_t *regs, frame_t *frame,
+                     val_t f, val_t init, size_t n, const val_t *in,
+                     val_t *out);
+
+/* Stops and joins all of the pool's workers. */
+void eris_pool_destroy(eris_pool_t *pool);
+
+#endif
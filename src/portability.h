@@ -19,6 +19,9 @@
  * - UNREACHABLE: expression that never executes; indicates unreachability.
  *   (optimization)
  *
+ * - ALWAYS_INLINE, NOINLINE: Insist that a function be, or not be, inlined.
+ *   (optimization)
+ *
  * - EXPECT_LONG(x, v): Indicates that we "expect" x to have the value v, which
  *   should be a constant. (optimization)
  *
@@ -37,6 +40,8 @@
 #define NORETURN __attribute__((__noreturn__))
 #define UNREACHABLE (__builtin_unreachable())
 #define EXPECT_LONG __builtin_expect
+#define ALWAYS_INLINE __attribute__((__always_inline__))
+#define NOINLINE __attribute__((__noinline__))
 
 #else  /* __GNUC__ */
 
@@ -44,6 +49,12 @@
 #if __has_attribute(__noreturn__)
 #define NORETURN __attribute__((__noreturn__))
 #endif
+#if __has_attribute(__always_inline__)
+#define ALWAYS_INLINE __attribute__((__always_inline__))
+#endif
+#if __has_attribute(__noinline__)
+#define NOINLINE __attribute__((__noinline__))
+#endif
 #endif  /* __has_attribute */
 
 #ifdef __has_builtin
@@ -73,6 +84,14 @@
 #define EXPECT_LONG(x,v) ((void)(v),(x))
 #endif
 
+#ifndef ALWAYS_INLINE
+#define ALWAYS_INLINE
+#endif
+
+#ifndef NOINLINE
+#define NOINLINE
+#endif
+
 
 /* ---------- Derived macros ----------
  *
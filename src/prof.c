@@ -0,0 +1,282 @@
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <eris/eris.h>
+
+#include "misc.h"
+#include "prof.h"
+#include "runtime.h"
+#include "types.h"
+#include "vm.h"
+
+volatile sig_atomic_t eris_prof_pending;
+
+typedef struct {
+    const proto_t *proto;
+    size_t pc;
+} prof_loc_t;
+
+/* A distinct stack we've sampled, and how often. Leaf first. */
+typedef struct prof_stack {
+    struct prof_stack *next;
+    size_t hash;
+    size_t count;
+    size_t depth;
+    prof_loc_t locs[];
+} prof_stack_t;
+
+struct eris_prof {
+    /* Samples come from whichever threads notice the timer. */
+    pthread_mutex_t lock;
+    prof_stack_t **buckets;
+    size_t num_buckets;
+    size_t num_stacks;
+    size_t num_dropped;         /* samples we didn't have memory for */
+};
+
+/* The timer and handler are shared by every running profiler (see prof.h).
+ * `timer_lock' guards them, the count of profilers using them, and the handler
+ * and timer they displaced, to put back when the last one stops. */
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t timer_users;
+static struct sigaction old_action;
+static struct itimerval old_timer;
+
+static void on_sigprof(int sig)
+{
+    eris_prof_pending = 1;
+    (void) sig;
+}
+
+
+/* Recording samples. */
+static size_t hash_locs(const prof_loc_t *locs, size_t depth)
+{
+    /* FNV-1a over the locations' words. */
+    size_t h = (size_t) 14695981039346656037ULL;
+    for (size_t i = 0; i < depth; ++i) {
+        h = (h ^ (uintptr_t) locs[i].proto) * (size_t) 1099511628211ULL;
+        h = (h ^ locs[i].pc) * (size_t) 1099511628211ULL;
+    }
+    return h;
+}
+
+static bool grow(struct eris_prof *prof)
+{
+    size_t n = prof->num_buckets ? 2 * prof->num_buckets : 256;
+    prof_stack_t **buckets = calloc(n, sizeof *buckets);
+    if (!buckets)
+        return false;
+    for (size_t i = 0; i < prof->num_buckets; ++i) {
+        prof_stack_t *s, *next;
+        for (s = prof->buckets[i]; s; s = next) {
+            next = s->next;
+            s->next = buckets[s->hash % n];
+            buckets[s->hash % n] = s;
+        }
+    }
+    free(prof->buckets);
+    prof->buckets = buckets;
+    prof->num_buckets = n;
+    return true;
+}
+
+static void record(struct eris_prof *prof, const prof_loc_t *locs,
+                   size_t depth)
+{
+    size_t hash = hash_locs(locs, depth);
+    pthread_mutex_lock(&prof->lock);
+
+    if (prof->num_stacks >= prof->num_buckets && !grow(prof)
+        && !prof->num_buckets)
+        goto drop;
+
+    prof_stack_t **bucket = &prof->buckets[hash % prof->num_buckets];
+    for (prof_stack_t *s = *bucket; s; s = s->next) {
+        if (s->hash == hash && s->depth == depth
+            && !memcmp(s->locs, locs, depth * sizeof *locs)) {
+            ++s->count;
+            goto done;
+        }
+    }
+
+    prof_stack_t *s = malloc(sizeof *s + depth * sizeof *locs);
+    if (!s)
+        goto drop;
+    s->hash = hash;
+    s->count = 1;
+    s->depth = depth;
+    memcpy(s->locs, locs, depth * sizeof *locs);
+    s->next = *bucket;
+    *bucket = s;
+    ++prof->num_stacks;
+    goto done;
+
+  drop:
+    ++prof->num_dropped;
+  done:
+    pthread_mutex_unlock(&prof->lock);
+}
+
+void eris_prof_sample(const vm_state_t *S)
+{
+    /* Leave the sample to a VM that's profiling, if we aren't. */
+    eris_vm_t *vm = S->thread->vm;
+    if (!vm->profiling)
+        return;
+    eris_prof_pending = 0;
+    struct eris_prof *prof = vm->prof;
+
+    prof_loc_t locs[ERIS_PROF_MAX_DEPTH];
+    size_t depth = 0;
+    const proto_t *proto = S->func->proto;
+    if (proto->code_len)
+        locs[depth++] = (prof_loc_t) { proto, S->ip - proto->code };
+
+    /* Our callers' IPs are up to date, since they're at their calls. We stop
+     * at the frame eris_vm_call made for its trampoline, whose proto has no
+     * code, or at the edge of eris code. */
+    for (frame_t *f = S->frame + 1;
+         depth < ERIS_PROF_MAX_DEPTH && f->tag == FRAME_CALL;
+         ++f)
+    {
+        proto = f->data.call.func->proto;
+        if (!proto->code_len)
+            break;
+        locs[depth++] = (prof_loc_t) { proto, f->data.call.ip - proto->code };
+    }
+
+    if (depth)
+        record(prof, locs, depth);
+}
+
+
+/* Public interface. */
+bool eris_prof_start(eris_vm_t *vm, unsigned hz)
+{
+    if (!hz || hz > 1000000)
+        return false;
+    if (!vm->prof) {
+        if (!(vm->prof = calloc(1, sizeof *vm->prof)))
+            return false;
+        pthread_mutex_init(&vm->prof->lock, NULL);
+    }
+    if (vm->profiling)
+        return true;
+
+    pthread_mutex_lock(&timer_lock);
+    if (!timer_users) {
+        struct sigaction action;
+        memset(&action, 0, sizeof action);
+        action.sa_handler = on_sigprof;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGPROF, &action, &old_action))
+            goto fail;
+
+        struct itimerval timer;
+        timer.it_interval.tv_sec = 0;
+        timer.it_interval.tv_usec = 1000000 / hz;
+        timer.it_value = timer.it_interval;
+        if (setitimer(ITIMER_PROF, &timer, &old_timer)) {
+            sigaction(SIGPROF, &old_action, NULL);
+            goto fail;
+        }
+    }
+    ++timer_users;
+    pthread_mutex_unlock(&timer_lock);
+    vm->profiling = true;
+    return true;
+
+  fail:
+    pthread_mutex_unlock(&timer_lock);
+    return false;
+}
+
+void eris_prof_stop(eris_vm_t *vm)
+{
+    if (!vm->profiling)
+        return;
+    vm->profiling = false;
+
+    pthread_mutex_lock(&timer_lock);
+    if (!--timer_users) {
+        setitimer(ITIMER_PROF, &old_timer, NULL);
+        sigaction(SIGPROF, &old_action, NULL);
+        eris_prof_pending = 0;
+    }
+    pthread_mutex_unlock(&timer_lock);
+}
+
+static void write_loc(FILE *out, const prof_loc_t *loc)
+{
+    if (loc->proto->name)
+        fprintf(out, "%s+%zu", loc->proto->name, loc->pc);
+    else
+        fprintf(out, "proto@%p+%zu", (void *) loc->proto, loc->pc);
+}
+
+void eris_prof_dump(eris_vm_t *vm, FILE *out)
+{
+    struct eris_prof *prof = vm->prof;
+    if (!prof)
+        return;
+
+    pthread_mutex_lock(&prof->lock);
+    for (size_t i = 0; i < prof->num_buckets; ++i) {
+        for (prof_stack_t *s = prof->buckets[i]; s; s = s->next) {
+            /* Root first. */
+            for (size_t j = s->depth; j-- > 0;) {
+                write_loc(out, &s->locs[j]);
+                fputc(j ? ';' : ' ', out);
+            }
+            fprintf(out, "%zu\n", s->count);
+        }
+    }
+    if (prof->num_dropped)
+        fprintf(out, "[dropped] %zu\n", prof->num_dropped);
+    pthread_mutex_unlock(&prof->lock);
+}
+
+static void clear(struct eris_prof *prof)
+{
+    for (size_t i = 0; i < prof->num_buckets; ++i) {
+        prof_stack_t *s, *next;
+        for (s = prof->buckets[i]; s; s = next) {
+            next = s->next;
+            free(s);
+        }
+        prof->buckets[i] = NULL;
+    }
+    prof->num_stacks = 0;
+    prof->num_dropped = 0;
+}
+
+void eris_prof_reset(eris_vm_t *vm)
+{
+    if (!vm->prof)
+        return;
+    pthread_mutex_lock(&vm->prof->lock);
+    clear(vm->prof);
+    pthread_mutex_unlock(&vm->prof->lock);
+}
+
+void eris_prof_free(eris_vm_t *vm)
+{
+    if (!vm->prof)
+        return;
+    eris_prof_stop(vm);
+    clear(vm->prof);
+    free(vm->prof->buckets);
+    pthread_mutex_destroy(&vm->prof->lock);
+    free(vm->prof);
+    vm->prof = NULL;
+}
@@ -0,0 +1,46 @@
+/* The sampling profiler.
+ *
+ * While any VM's profiler is running, a SIGPROF timer sets `eris_prof_pending',
+ * and the interpreter polls it at calls and backward jumps (as does compiled
+ * code at backward jumps). Whichever thread of a profiling VM notices it first
+ * takes a sample of its control stack, attributing time to each frame's proto
+ * and bytecode offset; threads of other VMs leave it be. Samples are aggregated
+ * by stack, and can be dumped in collapsed-stack format for flamegraph tools;
+ * see eris_prof_dump in eris.h.
+ *
+ * There's only one timer and one handler per process, so profilers running on
+ * several VMs at once share them: the first to start installs them, and the
+ * last to stop puts back what was there before.
+ */
+#ifndef _PROF_H_
+#define _PROF_H_
+
+#include <signal.h>
+
+#include "misc.h"
+#include "types.h"
+
+/* Frames deeper than this are left off samples. */
+#define ERIS_PROF_MAX_DEPTH 256
+
+extern volatile sig_atomic_t eris_prof_pending;
+
+void eris_prof_sample(const vm_state_t *S);
+
+/* Whether `thread' should take a sample. */
+static inline bool eris_prof_due(const eris_thread_t *thread)
+{
+    return UNLIKELY(eris_prof_pending) && thread->vm->profiling;
+}
+
+/* Takes `S' by value so that the interpreter's copy needn't leave registers. */
+static inline void eris_prof_poll(vm_state_t S)
+{
+    if (eris_prof_due(S.thread))
+        eris_prof_sample(&S);
+}
+
+/* Frees the profiling data of `vm', when it's destroyed. */
+void eris_prof_free(eris_vm_t *vm);
+
+#endif
@@ -2,31 +2,87 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <stddef.h>
+#include <string.h>
 
+#include "aio.h"
+#include "fiber.h"
+#include "gc.h"
+#include "num.h"
+#include "pool.h"
+#include "prof.h"
 #include "runtime.h"
+#include "stats.h"
+#include "str.h"
+#include "vm.h"
 
 bool eris_new(obj_t **out,
               eris_thread_t *thread, frame_t *frame,
-              shape_t *tag, size_t size)
+              eris_shape_id_t shape, size_t size)
 {
     assert (size >= sizeof(obj_t)); /* sanity/precondition */
-    obj_t *obj = malloc(size);
-    if (!obj) {
-        assert(0 && "malloc failed"); /* FIXME: remove */
+    /* Only what's allocated with a frame is collected; see gc.h. */
+    if (frame) {
+        assert (thread);
+        if (!eris_charge(thread, size))
+            return false;
+    }
+
+    gc_link_t *link = malloc(sizeof *link + size);
+    if (!link) {
+        if (frame)
+            eris_uncharge(thread, size);
         return false;
     }
-    assert (obj);
-    obj->tag = tag;
+    link->size = size;
+    obj_t *obj = link_obj(link);
+    obj->header = shape;
+    obj->len = 0;
+    if (frame) {
+        obj->header |= HEADER_COLLECTED;
+        link->size |= thread->vm->gc_colour;
+        link->next = thread->gc_objs;
+        if (!thread->gc_objs)
+            thread->gc_objs_tail = link;
+        thread->gc_objs = link;
+    }
+    else {
+        link->next = NULL;
+    }
     *out = obj;
+    if (thread) {
+        STAT(thread, allocs[shape]++);
+        STAT(thread, alloc_bytes[shape] += size);
+    }
+    return true;
+}
+
+bool eris_charge(eris_thread_t *thread, size_t size)
+{
+    if (UNLIKELY(size > thread->gc_credit) && !eris_gc_step(thread, size))
+        return false;
+    thread->gc_credit -= size;
     return true;
+}
 
-    (void) thread; (void) frame;
+void eris_uncharge(eris_thread_t *thread, size_t size)
+{
+    thread->gc_credit += size;
 }
 
-void eris_free(obj_t *obj)
+size_t eris_free(obj_t *obj)
 {
     assert(obj);
-    free(obj);
+    size_t charged = 0;
+    if (obj->header & HEADER_FOREIGN)
+        return 0;
+    if (OBJ_ISA(string, obj))
+        charged = eris_str_clear(OBJ_CONTENTS(string, obj));
+    else if (OBJ_ISA(num, obj))
+        charged = eris_num_clear(OBJ_CONTENTS(num, obj));
+    else if (OBJ_ISA(fiber, obj))
+        charged = eris_fiber_clear(OBJ_CONTENTS(fiber, obj));
+    free(obj_link(obj));
+    return charged;
 }
 
 void eris_vbug(const char *fmt, va_list ap)
@@ -43,3 +99,129 @@ void eris_bug(const char *fmt, ...)
     eris_vbug(fmt, ap);
     va_end(ap);                 /* unreachable */
 }
+
+
+/* Creating vms & threads. */
+eris_vm_t *eris_vm_new(void)
+{
+    eris_vm_t *vm = calloc(1, sizeof *vm);
+    if (!vm)
+        return NULL;
+
+    /* Most of the global table never gets touched, so calloc can leave it to
+     * the OS to zero, unless "undefined" isn't zero. */
+    if (!(vm->globals = calloc(ERIS_VM_GLOBALS, sizeof *vm->globals))) {
+        free(vm);
+        return NULL;
+    }
+    if (!eris_gc_init(vm)) {
+        free(vm->globals);
+        free(vm);
+        return NULL;
+    }
+    if (VAL_UNDEFINED)
+        for (size_t i = 0; i < ERIS_VM_GLOBALS; ++i)
+            vm->globals[i].val = VAL_UNDEFINED;
+
+    symbol_t *sym;
+    if (!eris_intern(vm, "t", 1, &sym)) {
+        JudyHSFreeArray(&vm->symbols, PJE0);
+        eris_gc_free(vm);
+        free(vm->globals);
+        free(vm);
+        return NULL;
+    }
+    vm->symbol_t = CONTENTS_VAL(sym);
+
+    pthread_mutex_init(&vm->pool_lock, NULL);
+    vm->par_workers = ERIS_PAR_DEFAULT_WORKERS;
+    vm->par_cutoff = ERIS_PAR_DEFAULT_CUTOFF;
+    return vm;
+}
+
+void eris_vm_destroy(eris_vm_t *vm)
+{
+    /* Must go first; its workers own threads on our thread list. */
+    if (vm->pool)
+        eris_pool_destroy(vm->pool);
+    while (vm->threads)
+        eris_thread_destroy(vm->threads);
+    eris_gc_free(vm);
+    eris_prof_free(vm);
+    pthread_mutex_destroy(&vm->pool_lock);
+    JudyHSFreeArray(&vm->global_slots, PJE0);
+    JudyHSFreeArray(&vm->symbols, PJE0);
+    free(vm->globals);
+    free(vm);
+}
+
+void eris_vm_set_parallelism(eris_vm_t *vm, size_t workers, size_t cutoff)
+{
+    pthread_mutex_lock(&vm->pool_lock);
+    /* Workers are started on demand, so just drop any existing pool. */
+    if (vm->pool) {
+        eris_pool_destroy(vm->pool);
+        vm->pool = NULL;
+    }
+    vm->par_workers = workers;
+    vm->par_cutoff = cutoff;
+    pthread_mutex_unlock(&vm->pool_lock);
+}
+
+eris_thread_t *eris_thread_new(eris_vm_t *vm)
+{
+    eris_thread_t *thread = calloc(1, sizeof *thread);
+    /* Zeroed, so that registers nobody's written yet hold nothing the GC
+     * might take for an object; see gc.h. */
+    val_t *regs = calloc(ERIS_THREAD_REGS, sizeof(val_t));
+    frame_t *frames = malloc(ERIS_THREAD_FRAMES * sizeof(frame_t));
+    if (!thread || !regs || !frames) {
+        free(thread); free(regs); free(frames);
+        return NULL;
+    }
+
+    thread->vm = vm;
+    thread->regs = regs;
+    thread->num_regs = ERIS_THREAD_REGS;
+    thread->frames = frames + ERIS_THREAD_FRAMES;
+    thread->num_frames = ERIS_THREAD_FRAMES;
+    thread->root_fiber.thread = thread;
+    thread->root_fiber.result = eris_nil;
+    thread->root_fiber.io_fd = -1;
+    thread->fiber = &thread->root_fiber;
+
+    eris_gc_thread_new(thread);
+    return thread;
+}
+
+void eris_thread_destroy(eris_thread_t *thread)
+{
+    eris_stats_retire(thread);
+    eris_gc_thread_destroy(thread);
+    eris_fiber_free_stacks(thread);
+    eris_aio_free(thread);
+
+    free(thread->regs);
+    free((frame_t*) thread->frames - thread->num_frames);
+    free(thread);
+}
+
+eris_vm_t *eris_thread_vm(eris_thread_t *thread) { return thread->vm; }
+
+
+/* Symbols. */
+bool eris_intern(eris_vm_t *vm, const char *name, size_t len, symbol_t **out)
+{
+    PPvoid_t entry = JudyHSIns(&vm->symbols, (void*) name, len, PJE0);
+    if (entry == PPJERR)
+        return false;
+    if (!*entry) {
+        symbol_t *sym;
+        if (!new_symbol(&sym, len, NULL, NULL))
+            return false;
+        memcpy((char*) sym->data, name, len);
+        *entry = sym;
+    }
+    *out = *entry;
+    return true;
+}
@@ -11,11 +11,50 @@
 
 /* Core runtime functions */
 
-/* Interface to the VM loop. */
-void eris_vm_run(vm_state_t *state);
+/* Size of each VM's global table. LOAD_GLOBAL's slot operand is 16 bits, so
+ * every slot it can name exists, and it needn't check. */
+#define ERIS_VM_GLOBALS (1 << 16)
 
-/* Sets `*out` to the newly allocated object on success.
- * `size` should be the size of the object /including/ the tag.
+/* Sizes of the stacks allocated by eris_thread_new. */
+#define ERIS_THREAD_REGS   (1 << 16)
+#define ERIS_THREAD_FRAMES (1 << 12)
+
+/* Interface to the VM loop. Runs until we return or unwind into a
+ * FRAME_C_CALL frame. Returns the number of values returned, which are in
+ * state->regs[0] onward, or ERIS_VM_RAISED if we unwound.
+ */
+#define ERIS_VM_RAISED ((size_t) -2)
+size_t eris_vm_run(vm_state_t *state);
+
+/* Calls the function in regs[0] with the `nargs' arguments in
+ * regs[1..nargs], leaving its return values in regs[0] onward (or nil there,
+ * if there are none) and, unless `nresults' is NULL, how many there are in
+ * `*nresults'. `frame' is the caller's control frame; the callee's frames are
+ * pushed below it. Every register from `regs' upward may be clobbered. From
+ * outside the VM, call eris_gc_enter before filling them in, since the GC may
+ * clear out registers above a thread's slots till then (see gc.h).
+ *
+ * Returns false iff the callee raised (eg. it ran out of memory), in which
+ * case regs[0] is nil and `*nresults' is 0. A raise in a fiber the callee
+ * spawned only ends that fiber (see fiber.h).
+ *
+ * This is how C code (eg. builtins) calls back into eris.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_vm_call(eris_thread_t *thread, val_t *regs, frame_t *frame,
+                  nargs_t nargs, size_t *nresults);
+
+/* Calls `builtin' as the CALL instruction at `state->ip' would, with arguments
+ * from `state->regs[offset]' on. For compiled code (see aot.h), which hands
+ * the call back to the interpreter if we return false: if the builtin raised,
+ * to retry it; or if it switched fibers, to resume the one now in `*state'.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_vm_builtin(vm_state_t *state, builtin_t *builtin, reg_t offset,
+                     nargs_t nargs, nresults_t nresults);
+
+/* Sets `*out` to the newly allocated object on success, with a zero length.
+ * `size` should be the size of the object /including/ the header.
  *
  * Returns false iff allocation failed due to OOM; caller should raise an
  * exception in this case.
@@ -23,7 +62,30 @@ void eris_vm_run(vm_state_t *state);
 ERIS_WARN_UNUSED_RESULT
 bool eris_new(obj_t **out,
               eris_thread_t *thread, frame_t *frame,
-              shape_t *tag, size_t size);
+              eris_shape_id_t shape, size_t size);
+
+/* Charges `size' bytes of memory outside any object's header and body (a
+ * bignum's limbs, a string's index, a fiber's stack, an I/O buffer) to
+ * `thread's share of the heap, so that they count towards its limits (see
+ * eris_gc_config_t); and gives them back. Fails iff they'd take the heap past
+ * its hard limit; the caller should raise an exception.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_charge(eris_thread_t *thread, size_t size);
+void eris_uncharge(eris_thread_t *thread, size_t size);
+
+/* Frees `obj', which eris_new allocated, and anything it alone owns outside the
+ * heap. For the GC, to whom it returns how much of that was charged to the
+ * heap, since whoever charged it may not be around to give it back. */
+size_t eris_free(obj_t *obj);
+
+/* The VM's one symbol named by the `len' bytes at `name', made the first time
+ * it's asked for. Not safe to call from several threads at once.
+ *
+ * Returns false iff allocation failed.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_intern(eris_vm_t *vm, const char *name, size_t len, symbol_t **out);
 
 /* Convenience functions. */
 static inline
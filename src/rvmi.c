@@ -7,6 +7,7 @@
 
 #include "misc.h"
 #include "types.h"
+#include "loader.h"
 #include "runtime.h"
 #include "vm.h"
 
@@ -33,16 +34,18 @@ instr_t foo_code[] = {
 
 proto_t foo_proto = {
     .code = foo_code,
+    .code_len = sizeof foo_code / sizeof foo_code[0],
     .num_args = 1,
+    .num_regs = 1,
     .num_upvals = 0,
     .variadic = false,
 };
 
 struct {
-    shape_t *tag;
+    obj_t obj;
     closure_t closure;
 } foo = {
-    .tag = SHAPE_TAG(closure),
+    .obj = { .header = SHAPE_ID(closure) },
     .closure = {
         .proto = &foo_proto,
     }
@@ -65,13 +68,20 @@ closure_t *make_bar(void)
         abort();
     *proto = ((proto_t) {
             .code = bar_code,
+            .code_len = sizeof bar_code / sizeof bar_code[0],
             .num_args = 0,
             .num_upvals = 1,
-            .variadic = false });
+            .num_regs = 2,
+            .variadic = false,
+            .num_local_funcs = 1 });
 
     closure_t *foo = make_foo();
     proto->local_funcs[0] = foo->proto;
 
+    const char *why;
+    if (!eris_proto_verify(&foo_proto, &why) || !eris_proto_verify(proto, &why))
+        eris_bug("verification failed: %s", why);
+
     obj_t *gfoo = make_cell("foo", CONTENTS_VAL(foo));
 
     closure_t *bar;
@@ -0,0 +1,624 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gmp.h>
+
+#include "gc.h"
+#include "misc.h"
+#include "num.h"
+#include "runtime.h"
+#include "serial.h"
+#include "str.h"
+#include "types.h"
+#include "vm.h"
+
+/* The buffer header. `root' is the ref to the value the buffer holds. We set
+ * `decoded' once we start decoding it, and refuse a buffer that has it set,
+ * since its refs may not be refs any more; what a buffer decoded to, the VM
+ * keeps (see eris_serial_decode). */
+typedef struct {
+    uint32_t magic;             /* SERIAL_MAGIC, in the encoder's byte order */
+    uint16_t version;
+    uint8_t layout;             /* the encoder's offsetof(string_t, data) */
+    uint8_t decoded;
+    uint64_t length;            /* of the encoding, in bytes, header included */
+    uint64_t root;
+} serial_header_t;
+
+#define SERIAL_MAGIC 0x53495245 /* "ERIS", little-endian */
+#define SERIAL_VERSION 1
+
+/* Records are aligned to this, and their bodies padded to it. */
+#define ALIGN 8
+#define ALIGNED(n) (INTDIV_CEIL((n), ALIGN) * ALIGN)
+
+/* A ref is a 64-bit word whose low two bits are its tag. An object ref is the
+ * offset from the start of the buffer of the object's record, which, being
+ * aligned, has a zero tag. Fixnums that fit in the rest of a ref are kept
+ * there; REF_RESERVED is for mappings, once we have them. */
+#define REF_TAG_BITS 2
+#define REF_TAG_MASK ((uint64_t) 3)
+enum ref_tag { REF_OBJ, REF_FIXNUM, REF_NIL, REF_RESERVED };
+
+#define REF_FIXNUM_MAX ((INT64_C(1) << (63 - REF_TAG_BITS)) - 1)
+#define REF_FIXNUM_MIN (-REF_FIXNUM_MAX - 1)
+
+/* The records. Each is an obj_t whose shape is tagged HEADER_FOREIGN, and
+ * whose length is as CONTENTS_LEN says, followed by its body:
+ *
+ * - A string's body is a string_t with a NULL `index', as the string itself
+ *   will be once decoded.
+ *
+ * - A symbol's body is its name, padded to at least a word, since decoding
+ *   replaces the first word with the val_t of the interned symbol.
+ *
+ * - A seq's body is its elements' refs; a vec's a vec_t whose `data' are refs.
+ *   Decoding rewrites each into the val_t it stands for.
+ *
+ * - A num's length is in words, and its body is a num_tag word, which decoding
+ *   replaces with the val_t of the number, then the number. An intptr or double
+ *   takes a word. A bignum takes its signed size in words, then the absolute
+ *   value's words, least significant first, in native byte order. A rational
+ *   takes its numerator's signed size, its denominator's size, then both.
+ */
+static size_t record_size(eris_shape_id_t shape, size_t len)
+{
+    switch (shape) {
+      case ERIS_SHAPE_NUM: case ERIS_SHAPE_SEQ:
+        return sizeof(obj_t) + len * sizeof(uint64_t);
+      case ERIS_SHAPE_VEC:
+        return sizeof(obj_t) + sizeof(vec_t) + len * sizeof(uint64_t);
+      case ERIS_SHAPE_STRING:
+        return sizeof(obj_t) + ALIGNED(offsetof(string_t, data) + len);
+      case ERIS_SHAPE_SYMBOL:
+        return sizeof(obj_t) + ALIGNED(MAX(len, sizeof(uint64_t)));
+      case ERIS_SHAPE_NIL: case ERIS_SHAPE_BUILTIN: case ERIS_SHAPE_PROTO:
+      case ERIS_SHAPE_CLOSURE: case ERIS_SHAPE_C_CLOSURE: case ERIS_SHAPE_CELL:
+      case ERIS_SHAPE_FIBER: case ERIS_NUM_SHAPES:
+      default:
+        return 0;
+    }
+}
+
+
+/* Encoding. We lay records out breadth-first, filling in seqs' and vecs' refs
+ * after we've made their records, so deep structures don't take a deep C
+ * stack. */
+struct todo {
+    size_t slots;               /* offset of the record's first ref */
+    val_t val;                  /* the seq or vec it's a record of */
+};
+
+typedef struct {
+    char *buf;
+    size_t len, cap;
+    /* A JudyL array from the objects we've made records of to their refs, so
+     * shared structure stays shared. */
+    Pvoid_t refs;
+    struct todo *todo;
+    size_t num_todo, cap_todo;
+} writer_t;
+
+/* Appends `size' zeroed bytes, a multiple of ALIGN; puts their offset in
+ * `*off'. */
+static bool grow(writer_t *w, size_t size, size_t *off)
+{
+    if (w->cap - w->len < size) {
+        size_t cap = MAX(2 * w->cap, w->len + size);
+        char *buf = realloc(w->buf, cap);
+        if (!buf)
+            return false;
+        w->buf = buf;
+        w->cap = cap;
+    }
+    memset(w->buf + w->len, 0, size);
+    *off = w->len;
+    w->len += size;
+    return true;
+}
+
+static bool new_record(writer_t *w, eris_shape_id_t shape, size_t len,
+                       size_t *off)
+{
+    if (len > UINT32_MAX || !grow(w, record_size(shape, len), off))
+        return false;
+    obj_t *obj = (obj_t *) (w->buf + *off);
+    obj->header = (header_t) shape | HEADER_FOREIGN;
+    obj->len = (uint32_t) len;
+    return true;
+}
+
+static void *body(writer_t *w, size_t off)
+{
+    return obj_contents((obj_t *) (w->buf + off));
+}
+
+static bool push_todo(writer_t *w, size_t slots, val_t val)
+{
+    if (w->num_todo == w->cap_todo) {
+        size_t cap = MAX(2 * w->cap_todo, 16);
+        struct todo *todo = realloc(w->todo, cap * sizeof *todo);
+        if (!todo)
+            return false;
+        w->todo = todo;
+        w->cap_todo = cap;
+    }
+    w->todo[w->num_todo++] = (struct todo) { slots, val };
+    return true;
+}
+
+/* The words of the absolute value of `z', least significant first. */
+static void export_mpz(uint64_t *words, mpz_srcptr z)
+{
+    mpz_export(words, NULL, -1, sizeof *words, 0, 0, z);
+}
+
+static size_t mpz_words(mpz_srcptr z)
+{
+    return INTDIV_CEIL(mpz_sizeinbase(z, 2), 64);
+}
+
+static uint64_t signed_words(mpz_srcptr z)
+{
+    int64_t n = (int64_t) mpz_words(z);
+    return (uint64_t) (mpz_sgn(z) < 0 ? -n : n);
+}
+
+static bool emit_num(writer_t *w, val_t v, uint64_t *ref)
+{
+    intptr_t i;
+    double d;
+    num_t *num;
+    size_t off;
+    uint64_t *words;
+
+    if (get_fixnum(v, &i)) {
+        if (i >= REF_FIXNUM_MIN && i <= REF_FIXNUM_MAX) {
+            *ref = (uint64_t) i << REF_TAG_BITS | REF_FIXNUM;
+            return true;
+        }
+        if (!new_record(w, ERIS_SHAPE_NUM, 2, &off))
+            return false;
+        words = body(w, off);
+        words[0] = NUM_INTPTR;
+        words[1] = (uint64_t) i;
+    } else if (get_flonum(v, &d)) {
+        if (!new_record(w, ERIS_SHAPE_NUM, 2, &off))
+            return false;
+        words = body(w, off);
+        words[0] = NUM_DOUBLE;
+        memcpy(&words[1], &d, sizeof d);
+    } else {
+        num = VAL_CONTENTS(num, v);
+        switch ((enum num_tag) num->tag) {
+          case NUM_MPZ: {
+              mpz_srcptr z = num->data.v_mpz;
+              if (!new_record(w, ERIS_SHAPE_NUM, 2 + mpz_words(z), &off))
+                  return false;
+              words = body(w, off);
+              words[0] = NUM_MPZ;
+              words[1] = signed_words(z);
+              export_mpz(&words[2], z);
+              break;
+          }
+          case NUM_MPQ: {
+              mpz_srcptr n = mpq_numref(num->data.v_mpq);
+              mpz_srcptr d = mpq_denref(num->data.v_mpq);
+              size_t n_words = mpz_words(n);
+              if (!new_record(w, ERIS_SHAPE_NUM, 3 + n_words + mpz_words(d),
+                              &off))
+                  return false;
+              words = body(w, off);
+              words[0] = NUM_MPQ;
+              words[1] = signed_words(n);
+              words[2] = mpz_words(d);
+              export_mpz(&words[3], n);
+              export_mpz(&words[3 + n_words], d);
+              break;
+          }
+          case NUM_INTPTR: case NUM_DOUBLE:
+          default:
+            IMPOSSIBLE("unrecognized number tag: %d", (int) num->tag);
+        }
+    }
+    *ref = off;
+    return true;
+}
+
+static bool emit(writer_t *w, val_t v, uint64_t *ref)
+{
+    if (VAL_IS_NIL(v)) {
+        *ref = REF_NIL;
+        return true;
+    }
+    if (!VAL_IS_OBJ(v) || VAL_ISA(num, v))
+        return emit_num(w, v, ref);
+
+    obj_t *obj = VAL_OBJ(v);
+    PPvoid_t entry = JudyLIns(&w->refs, (Word_t) obj, PJE0);
+    if (entry == PPJERR)
+        return false;
+    if (*entry) {
+        *ref = (uint64_t) (uintptr_t) *entry;
+        return true;
+    }
+
+    eris_shape_id_t shape = OBJ_SHAPE_ID(obj);
+    void *contents = obj_contents(obj);
+    size_t len = CONTENTS_LEN(contents), off;
+    switch (shape) {
+      case ERIS_SHAPE_STRING: {
+          string_t *str = contents;
+          if (!new_record(w, shape, len, &off))
+              return false;
+          string_t *copy = body(w, off);
+          copy->num_chars = str->num_chars;
+          copy->ascii = str->ascii;
+          memcpy((char *) copy->data, str->data, len);
+          break;
+      }
+      case ERIS_SHAPE_SYMBOL:
+        if (!new_record(w, shape, len, &off))
+            return false;
+        memcpy(body(w, off), ((symbol_t *) contents)->data, len);
+        break;
+      case ERIS_SHAPE_SEQ:
+        if (!new_record(w, shape, len, &off)
+            || !push_todo(w, off + sizeof(obj_t), v))
+            return false;
+        break;
+      case ERIS_SHAPE_VEC:
+        len = ((vec_t *) contents)->len;
+        if (!new_record(w, shape, len, &off)
+            || !push_todo(w, off + sizeof(obj_t) + sizeof(vec_t), v))
+            return false;
+        ((vec_t *) body(w, off))->len = len;
+        break;
+      case ERIS_SHAPE_NIL: case ERIS_SHAPE_NUM: case ERIS_SHAPE_BUILTIN:
+      case ERIS_SHAPE_PROTO: case ERIS_SHAPE_CLOSURE: case ERIS_SHAPE_C_CLOSURE:
+      case ERIS_SHAPE_CELL: case ERIS_SHAPE_FIBER: case ERIS_NUM_SHAPES:
+      default:
+        return false;
+    }
+    *entry = (void *) (uintptr_t) off;
+    *ref = off;
+    return true;
+}
+
+/* Fills in the refs of the seqs and vecs we've made records of, and of those
+ * we make records of meanwhile. */
+static bool fill(writer_t *w)
+{
+    while (w->num_todo) {
+        struct todo todo = w->todo[--w->num_todo];
+        const val_t *data;
+        size_t len;
+        seq_t *seq;
+        vec_t *vec;
+        if (VAL_AS(seq, todo.val, &seq)) {
+            data = seq->data;
+            len = CONTENTS_LEN(seq);
+        } else {
+            vec = VAL_CONTENTS(vec, todo.val);
+            data = vec->data;
+            len = vec->len;
+        }
+        for (size_t i = 0; i < len; ++i) {
+            uint64_t ref;
+            if (!emit(w, data[i], &ref))
+                return false;
+            /* emit may have moved the buffer. */
+            ((uint64_t *) (w->buf + todo.slots))[i] = ref;
+        }
+    }
+    return true;
+}
+
+bool eris_serial_encode(val_t v, void **buf, size_t *len)
+{
+    writer_t w = { NULL, 0, 0, NULL, NULL, 0, 0 };
+    size_t off;
+    uint64_t root;
+    bool ok = sizeof(val_t) == sizeof(uint64_t)
+        && grow(&w, sizeof(serial_header_t), &off)
+        && emit(&w, v, &root)
+        && fill(&w);
+    JudyLFreeArray(&w.refs, PJE0);
+    free(w.todo);
+    if (!ok) {
+        free(w.buf);
+        return false;
+    }
+
+    *(serial_header_t *) w.buf = (serial_header_t) {
+        .magic = SERIAL_MAGIC,
+        .version = SERIAL_VERSION,
+        .layout = offsetof(string_t, data),
+        .decoded = 0,
+        .length = w.len,
+        .root = root,
+    };
+    *buf = w.buf;
+    *len = w.len;
+    return true;
+}
+
+
+/* Decoding. The buffer may have come from anywhere, so we check everything.
+ * We make one pass over the records to check them and to decode those that
+ * don't refer to others, then another to rewrite the refs of seqs and vecs.
+ *
+ * The numbers we box are collected objects, which the GC can't see in the
+ * buffer; so the value decoded comes with an owner, a seq of it and them,
+ * which the GC holds as a root under the buffer's address until it's released.
+ * That's also where we find the value if asked to decode the buffer again. */
+typedef struct {
+    char *buf;
+    size_t len;
+    /* A bit per word of the buffer: whether a record starts there. */
+    uint64_t *starts;
+    eris_thread_t *thread;
+    frame_t *frame;
+    /* The numbers we've boxed, for the owner. */
+    val_t *nums;
+    size_t num_nums, cap_nums;
+} reader_t;
+
+/* Notes `v', which we've just made, for the owner, if it's boxed. */
+static bool keep(reader_t *r, val_t v)
+{
+    if (!VAL_IS_OBJ(v))
+        return true;
+    if (r->num_nums == r->cap_nums) {
+        size_t cap = MAX(2 * r->cap_nums, 16);
+        val_t *nums = realloc(r->nums, cap * sizeof *nums);
+        if (!nums)
+            return false;
+        r->nums = nums;
+        r->cap_nums = cap;
+    }
+    r->nums[r->num_nums++] = v;
+    return true;
+}
+
+static bool is_record(const reader_t *r, uint64_t off)
+{
+    size_t word = off / ALIGN;
+    return off < r->len && !(off % ALIGN)
+        && (r->starts[word / 64] >> (word % 64) & 1);
+}
+
+/* Sets `z' from `words', whose count and sign are those of `size'. */
+static void import_mpz(mpz_ptr z, int64_t size, const uint64_t *words)
+{
+    mpz_import(z, (size_t) (size < 0 ? -size : size), -1, sizeof *words, 0, 0,
+               words);
+    if (size < 0)
+        mpz_neg(z, z);
+}
+
+/* Whether `size', a word from a bignum record, is a size we'll accept. */
+static bool size_ok(uint64_t size)
+{
+    int64_t n = (int64_t) size;
+    return n >= -(int64_t) UINT32_MAX && n <= (int64_t) UINT32_MAX;
+}
+
+static uint64_t abs_size(uint64_t size)
+{
+    int64_t n = (int64_t) size;
+    return (uint64_t) (n < 0 ? -n : n);
+}
+
+static bool decode_num(reader_t *r, obj_t *obj)
+{
+    uint64_t *words = obj_contents(obj);
+    size_t len = obj->len;
+    double d;
+    val_t v;
+    if (len < 2)
+        return false;
+
+    switch ((enum num_tag) words[0]) {
+      case NUM_INTPTR:
+        if (len != 2 || !make_fixnum(&v, (intptr_t) words[1],
+                                     r->thread, r->frame))
+            return false;
+        break;
+      case NUM_DOUBLE:
+        memcpy(&d, &words[1], sizeof d);
+        if (len != 2 || !make_flonum(&v, d, r->thread, r->frame))
+            return false;
+        break;
+      case NUM_MPZ: {
+          if (!size_ok(words[1]) || abs_size(words[1]) != len - 2)
+              return false;
+          mpz_t z;
+          mpz_init(z);
+          import_mpz(z, (int64_t) words[1], &words[2]);
+          if (!eris_num_box_mpz(&v, z, r->thread, r->frame))
+              return false;
+          break;
+      }
+      case NUM_MPQ: {
+          if (len < 3 || !size_ok(words[1]) || words[2] > UINT32_MAX
+              || abs_size(words[1]) + words[2] != len - 3)
+              return false;
+          mpq_t q;
+          mpq_init(q);
+          import_mpz(mpq_numref(q), (int64_t) words[1], &words[3]);
+          import_mpz(mpq_denref(q), (int64_t) words[2],
+                     &words[3 + abs_size(words[1])]);
+          if (!mpz_sgn(mpq_denref(q))) {
+              mpq_clear(q);
+              return false;
+          }
+          mpq_canonicalize(q);
+          if (!eris_num_box_mpq(&v, q, r->thread, r->frame))
+              return false;
+          break;
+      }
+      default:
+        return false;
+    }
+    memcpy(words, &v, sizeof v);
+    return keep(r, v);
+}
+
+/* Checks a record, and decodes it if it doesn't refer to others. */
+static bool decode_record(reader_t *r, obj_t *obj)
+{
+    void *contents = obj_contents(obj);
+    size_t len = obj->len;
+    switch (OBJ_SHAPE_ID(obj)) {
+      case ERIS_SHAPE_NUM:
+        return decode_num(r, obj);
+      case ERIS_SHAPE_STRING: {
+          /* Read `ascii' as a byte, lest it not be a valid bool. */
+          string_t *str = contents;
+          size_t num_chars;
+          bool ascii;
+          unsigned char ascii_byte;
+          memcpy(&ascii_byte, &str->ascii, 1);
+          return !str->index
+              && eris_utf8_scan(str->data, len, &num_chars, &ascii)
+              && num_chars == str->num_chars && ascii_byte == ascii;
+      }
+      case ERIS_SHAPE_SYMBOL: {
+          symbol_t *sym;
+          if (!eris_intern(r->thread->vm, contents, len, &sym))
+              return false;
+          val_t v = CONTENTS_VAL(sym);
+          memcpy(contents, &v, sizeof v);
+          return true;
+      }
+      case ERIS_SHAPE_SEQ:
+        return true;
+      case ERIS_SHAPE_VEC:
+        return ((vec_t *) contents)->len == len;
+      case ERIS_SHAPE_NIL: case ERIS_SHAPE_BUILTIN: case ERIS_SHAPE_PROTO:
+      case ERIS_SHAPE_CLOSURE: case ERIS_SHAPE_C_CLOSURE: case ERIS_SHAPE_CELL:
+      case ERIS_SHAPE_FIBER: case ERIS_NUM_SHAPES:
+      default:
+        return false;
+    }
+}
+
+/* The value `ref' stands for, once the records it might refer to are
+ * decoded. */
+static bool resolve(reader_t *r, uint64_t ref, val_t *out)
+{
+    switch ((enum ref_tag) (ref & REF_TAG_MASK)) {
+      case REF_OBJ:
+        break;
+      case REF_FIXNUM:
+        return make_fixnum(out, (intptr_t) ((int64_t) ref >> REF_TAG_BITS),
+                           r->thread, r->frame)
+            && keep(r, *out);
+      case REF_NIL:
+        *out = eris_nil;
+        return ref == REF_NIL;
+      case REF_RESERVED:
+      default:
+        return false;
+    }
+
+    if (!is_record(r, ref))
+        return false;
+    obj_t *obj = (obj_t *) (r->buf + ref);
+    eris_shape_id_t shape = OBJ_SHAPE_ID(obj);
+    if (shape == ERIS_SHAPE_NUM || shape == ERIS_SHAPE_SYMBOL)
+        memcpy(out, obj_contents(obj), sizeof *out);
+    else
+        *out = OBJ_VAL(obj);
+    return true;
+}
+
+static bool resolve_all(reader_t *r, uint64_t *refs, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        val_t v;
+        if (!resolve(r, refs[i], &v))
+            return false;
+        memcpy(&refs[i], &v, sizeof v);
+    }
+    return true;
+}
+
+static bool decode(reader_t *r, serial_header_t *header, val_t *out)
+{
+    size_t size;
+    for (size_t off = sizeof *header; off < r->len; off += size) {
+        obj_t *obj = (obj_t *) (r->buf + off);
+        if (r->len - off < sizeof *obj
+            || (obj->header & ~HEADER_SHAPE_MASK) != HEADER_FOREIGN
+            || !(size = record_size(OBJ_SHAPE_ID(obj), obj->len))
+            || size > r->len - off)
+            return false;
+        size_t word = off / ALIGN;
+        r->starts[word / 64] |= (uint64_t) 1 << (word % 64);
+        if (!decode_record(r, obj))
+            return false;
+    }
+
+    for (size_t off = sizeof *header; off < r->len; off += size) {
+        obj_t *obj = (obj_t *) (r->buf + off);
+        size = record_size(OBJ_SHAPE_ID(obj), obj->len);
+        if (OBJ_ISA(seq, obj)) {
+            if (!resolve_all(r, obj_contents(obj), obj->len))
+                return false;
+        } else if (OBJ_ISA(vec, obj)) {
+            if (!resolve_all(r, (uint64_t *) OBJ_CONTENTS(vec, obj)->data,
+                             obj->len))
+                return false;
+        }
+    }
+    return resolve(r, header->root, out);
+}
+
+/* Makes the owner of `root', which we've decoded `buf' to, and holds it. */
+static bool hold(reader_t *r, void *buf, val_t root)
+{
+    seq_t *owner;
+    if (!new_seq(&owner, r->num_nums + 1, r->thread, r->frame))
+        return false;
+    owner->data[0] = root;
+    memcpy(&owner->data[1], r->nums, r->num_nums * sizeof *r->nums);
+    return eris_gc_hold(r->thread, buf, CONTENTS_VAL(owner));
+}
+
+bool eris_serial_decode(val_t *out, void *buf, size_t len,
+                        eris_thread_t *thread, frame_t *frame)
+{
+    serial_header_t *header = buf;
+    val_t owner;
+    if (eris_gc_held(thread, buf, &owner)) {
+        *out = VAL_CONTENTS(seq, owner)->data[0];
+        return true;
+    }
+    if ((uintptr_t) buf % ALIGN || len < sizeof *header
+        || header->magic != SERIAL_MAGIC
+        || header->version != SERIAL_VERSION
+        || header->layout != offsetof(string_t, data)
+        || header->decoded
+        || header->length > len || header->length % ALIGN
+        || header->length < sizeof *header)
+        return false;
+
+    reader_t r = { buf, header->length, NULL, thread, frame, NULL, 0, 0 };
+    if (!(r.starts = calloc(INTDIV_CEIL(r.len / ALIGN, 64), sizeof(uint64_t))))
+        return false;
+    header->decoded = 1;
+    bool ok = decode(&r, header, out) && hold(&r, buf, *out);
+    free(r.starts);
+    free(r.nums);
+    return ok;
+}
+
+void eris_serial_release(eris_thread_t *thread, void *buf)
+{
+    eris_gc_drop(thread, buf);
+}
@@ -0,0 +1,41 @@
+/* Serializing values: nil, numbers, strings, symbols, and seqs and vecs of
+ * them; shared structure, cycles included, survives the round trip.
+ *
+ * The encoding is an image of the objects themselves, laid out as they are in
+ * memory, so that decoding can leave them where they are: a buffer header,
+ * then one record per object, each an obj_t header (whose length prefixes its
+ * contents) and 8-byte aligned. Where a record refers to another value, it
+ * holds a 64-bit ref; see serial.c. Decoding rewrites each ref into the val_t
+ * it stands for, so strings, seqs and vecs are used straight from the buffer,
+ * and re-interns symbols and boxes numbers, which can't be. The GC (see gc.h)
+ * doesn't look inside the buffer, so it holds those numbers, till the buffer's
+ * released, along with the value, which decoding the buffer again returns.
+ *
+ * That ties the format to our object layout and byte order, so it's for
+ * passing values between processes on like machines, not for keeping them.
+ * Mappings don't exist yet; when they do, they'll want a record of their own.
+ */
+#ifndef _SERIAL_H_
+#define _SERIAL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "misc.h"
+#include "types.h"
+
+/* Encodes `v' into a buffer we malloc. Fails iff `v' holds something we can't
+ * encode (a function, say), or allocation failed. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_serial_encode(val_t v, void **buf, size_t *len);
+
+/* Decode the value in the first `len' bytes of `buf' in place, and release
+ * the buffer, as eris_deserialize and eris_release_buffer in eris.h describe.
+ * Decode inside the VM (see eris_gc_enter), allocating with `frame'; it fails
+ * iff `buf' isn't a valid encoding, or allocation failed. */
+ERIS_WARN_UNUSED_RESULT
+bool eris_serial_decode(val_t *out, void *buf, size_t len,
+                        eris_thread_t *thread, frame_t *frame);
+void eris_serial_release(eris_thread_t *thread, void *buf);
+
+#endif
@@ -1,22 +1,28 @@
 #include "types.h"
 
-#define SHAPE(shape)                             \
-    shape_t eris_shape_##shape = {               \
-        .name = #shape                           \
+#define SHAPE(shape, ID)                         \
+    [ERIS_SHAPE_##ID] = {                        \
+        .name = #shape,                          \
+        .id = ERIS_SHAPE_##ID                    \
     }
 
-SHAPE(nil);
-SHAPE(num);
-SHAPE(builtin);
-SHAPE(proto);
-SHAPE(closure);
-SHAPE(c_closure);
-SHAPE(string);
-SHAPE(seq);
-SHAPE(vec);
-SHAPE(symbol);
-SHAPE(cell);
+const shape_t eris_shapes[ERIS_NUM_SHAPES] = {
+    SHAPE(nil, NIL),
+    SHAPE(num, NUM),
+    SHAPE(builtin, BUILTIN),
+    SHAPE(proto, PROTO),
+    SHAPE(closure, CLOSURE),
+    SHAPE(c_closure, C_CLOSURE),
+    SHAPE(string, STRING),
+    SHAPE(seq, SEQ),
+    SHAPE(vec, VEC),
+    SHAPE(symbol, SYMBOL),
+    SHAPE(cell, CELL),
+    SHAPE(fiber, FIBER),
+};
 
 /* Statically allocated values. */
-const obj_t eris_nil_obj = { .tag = &eris_shape_nil };
+#if !defined ERIS_NANBOX && !defined ERIS_NIL_NULL
+const obj_t eris_nil_obj = { .header = ERIS_SHAPE_NIL };
 const val_t eris_nil = (val_t) &eris_nil_obj;
+#endif
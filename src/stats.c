@@ -0,0 +1,108 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <eris/eris.h>
+
+#include "gc.h"
+#include "misc.h"
+#include "stats.h"
+#include "types.h"
+
+static const char *const op_names[ERIS_STATS_MAX_OPS] = {
+#define OP_NAME(op) [OP_##op] = #op
+    OP_NAME(MOVE), OP_NAME(LOAD_INT), OP_NAME(LOAD_UPVAL), OP_NAME(LOAD_CELL),
+    OP_NAME(LOAD_GLOBAL),
+    OP_NAME(CALL_CELL), OP_NAME(CALL_REG), OP_NAME(CALL_CELL_N),
+    OP_NAME(CALL_REG_N), OP_NAME(TAILCALL_CELL), OP_NAME(TAILCALL_REG),
+    OP_NAME(TAILCALL_CELL0), OP_NAME(TAILCALL_REG0), OP_NAME(TAILCALL_SELF),
+    OP_NAME(TAILCALL_SELF0), OP_NAME(JUMP), OP_NAME(RETURN),
+    OP_NAME(RETURN_N), OP_NAME(IF), OP_NAME(IFNOT), OP_NAME(CLOSE),
+#undef OP_NAME
+};
+
+#ifdef ERIS_STATS
+/* The counters are all uint64_ts, so we can add them up wholesale. */
+#define NUM_COUNTERS (sizeof(eris_stats_t) / sizeof(uint64_t))
+
+static void add_stats(eris_stats_t *to, const eris_stats_t *from)
+{
+    uint64_t *t = (uint64_t *) to;
+    const uint64_t *f = (const uint64_t *) from;
+    for (size_t i = 0; i < NUM_COUNTERS; ++i)
+        t[i] += f[i];
+}
+#endif
+
+bool eris_stats_snapshot(eris_vm_t *vm, eris_stats_t *out)
+{
+    memset(out, 0, sizeof *out);
+#ifdef ERIS_STATS
+    eris_gc_lock(vm);
+    add_stats(out, &vm->retired_stats);
+    for (eris_thread_t *t = vm->threads; t; t = t->next)
+        add_stats(out, &t->stats);
+    eris_gc_unlock(vm);
+    return true;
+#else
+    (void) vm;
+    return false;
+#endif
+}
+
+void eris_stats_reset(eris_vm_t *vm)
+{
+#ifdef ERIS_STATS
+    eris_gc_lock(vm);
+    memset(&vm->retired_stats, 0, sizeof vm->retired_stats);
+    for (eris_thread_t *t = vm->threads; t; t = t->next)
+        memset(&t->stats, 0, sizeof t->stats);
+    eris_gc_unlock(vm);
+#else
+    (void) vm;
+#endif
+}
+
+void eris_stats_retire(eris_thread_t *thread)
+{
+#ifdef ERIS_STATS
+    /* It's still on the VM's list, so zero its counters, lest a snapshot
+     * count them twice. */
+    eris_gc_lock(thread->vm);
+    add_stats(&thread->vm->retired_stats, &thread->stats);
+    memset(&thread->stats, 0, sizeof thread->stats);
+    eris_gc_unlock(thread->vm);
+#else
+    (void) thread;
+#endif
+}
+
+static void print_counter(FILE *out, const char *kind, const char *name,
+                          uint64_t n)
+{
+    if (n)
+        fprintf(out, "%s %s %" PRIu64 "\n", kind, name, n);
+}
+
+void eris_stats_print(const eris_stats_t *stats, FILE *out)
+{
+    for (size_t i = 0; i < ERIS_NUM_SHAPES; ++i) {
+        print_counter(out, "allocs", eris_shapes[i].name, stats->allocs[i]);
+        print_counter(out, "alloc-bytes", eris_shapes[i].name,
+                      stats->alloc_bytes[i]);
+    }
+    print_counter(out, "calls", "closure", stats->closure_calls);
+    print_counter(out, "calls", "builtin", stats->builtin_calls);
+    print_counter(out, "calls", "c-closure", stats->c_closure_calls);
+    print_counter(out, "calls", "tail", stats->tail_calls);
+    print_counter(out, "calls", "non-tail", stats->non_tail_calls);
+    for (size_t i = 0; i < ERIS_STATS_MAX_OPS; ++i) {
+        char unknown[16];
+        const char *name = op_names[i];
+        if (!name) {
+            snprintf(unknown, sizeof unknown, "op%zu", i);
+            name = unknown;
+        }
+        print_counter(out, "instrs", name, stats->instrs[i]);
+    }
+}
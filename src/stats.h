@@ -0,0 +1,26 @@
+/* Runtime statistics; see eris_stats_snapshot in eris.h.
+ *
+ * Each thread keeps its own counters, which only it writes, so counting needs
+ * no synchronization. Snapshots sum over a VM's threads, plus whatever its
+ * destroyed threads had counted, under its collector's lock (see gc.h), since
+ * threads come and go meanwhile.
+ */
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include "misc.h"
+#include "types.h"
+
+/* Use as eg. STAT(thread, closure_calls++). Compiles to nothing unless
+ * ERIS_STATS is defined. */
+#ifdef ERIS_STATS
+#define STAT(thread, counter_expr) ((void) ((thread)->stats.counter_expr))
+#else
+#define STAT(thread, counter_expr) ((void) 0)
+#endif
+
+/* Folds `thread's counters into its VM's, when it's destroyed. Takes the
+ * collector's lock, so call it without. */
+void eris_stats_retire(eris_thread_t *thread);
+
+#endif
@@ -0,0 +1,237 @@
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "misc.h"
+#include "runtime.h"
+#include "str.h"
+#include "types.h"
+#include "vm.h"
+
+/* How long a UTF-8 sequence starting with `lead' is; 0 if `lead' can't start
+ * one (it's a continuation byte, or could only start an overlong encoding or
+ * one past U+10FFFF). */
+static size_t seq_len(unsigned char lead)
+{
+    if (lead < 0x80) return 1;
+    if (lead < 0xc2) return 0;
+    if (lead < 0xe0) return 2;
+    if (lead < 0xf0) return 3;
+    if (lead < 0xf5) return 4;
+    return 0;
+}
+
+static bool is_cont(unsigned char c) { return (c & 0xc0) == 0x80; }
+
+/* How long the valid non-ASCII sequence at `p' is, given `avail' bytes; 0 if
+ * it's invalid. */
+static size_t valid_seq(const unsigned char *p, size_t avail)
+{
+    size_t n = seq_len(p[0]);
+    if (!n || n > avail)
+        return 0;
+    for (size_t k = 1; k < n; ++k)
+        if (!is_cont(p[k]))
+            return 0;
+    /* Overlong 3- and 4-byte encodings, surrogates, and past U+10FFFF. */
+    if ((p[0] == 0xe0 && p[1] < 0xa0) || (p[0] == 0xed && p[1] >= 0xa0)
+        || (p[0] == 0xf0 && p[1] < 0x90) || (p[0] == 0xf4 && p[1] >= 0x90))
+        return 0;
+    return n;
+}
+
+/* How many bytes at the start of `p' are ASCII. */
+static size_t ascii_prefix(const unsigned char *p, size_t len)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) (p + i));
+        if (_mm_movemask_epi8(chunk))
+            break;
+    }
+#else
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, sizeof word);
+        if (word & UINT64_C(0x8080808080808080))
+            break;
+    }
+#endif
+    while (i < len && p[i] < 0x80)
+        ++i;
+    return i;
+}
+
+bool eris_utf8_scan(const char *data, size_t len,
+                    size_t *num_chars, bool *ascii)
+{
+    const unsigned char *p = (const unsigned char *) data;
+    size_t i = 0, chars = 0;
+    while (i < len) {
+        size_t run = ascii_prefix(p + i, len - i);
+        i += run;
+        chars += run;
+        /* Non-ASCII text tends to come in runs too, so stay out of
+         * ascii_prefix until we see an ASCII byte. */
+        while (i < len && p[i] >= 0x80) {
+            size_t n = valid_seq(p + i, len - i);
+            if (!n)
+                return false;
+            i += n;
+            ++chars;
+        }
+    }
+    *num_chars = chars;
+    *ascii = chars == len;
+    return true;
+}
+
+size_t eris_utf8_cut(const char *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *) data;
+    for (size_t k = 1; k <= MIN(len, 3); ++k) {
+        if (!is_cont(p[len - k]))
+            return seq_len(p[len - k]) > k ? k : 0;
+    }
+    return 0;
+}
+
+/* The offset of the `n'th code point at or after byte `i' of `p', counting
+ * from 0; `len' if there aren't that many. `i' needn't be on a code point
+ * boundary. Since we only count lead bytes, we can skip whole chunks at a
+ * time. */
+static size_t skip_chars(const unsigned char *p, size_t len, size_t i,
+                         size_t n)
+{
+#ifdef __SSE2__
+    const __m128i cont_max = _mm_set1_epi8(-64); /* 0xc0 */
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) (p + i));
+        /* Continuation bytes are 0x80-0xbf, ie. -128 to -65. */
+        unsigned conts = _mm_movemask_epi8(_mm_cmplt_epi8(chunk, cont_max));
+        size_t leads = 16 - __builtin_popcount(conts);
+        if (leads > n)
+            break;
+        n -= leads;
+    }
+#endif
+    for (; i < len; ++i)
+        if (!is_cont(p[i]) && !n--)
+            return i;
+    return len;
+}
+
+static size_t index_entries(const string_t *str)
+{
+    return INTDIV_CEIL(str->num_chars, STR_INDEX_STRIDE);
+}
+
+static uint32_t *build_index(const string_t *str)
+{
+    const unsigned char *p = (const unsigned char *) str->data;
+    size_t len = CONTENTS_LEN(str);
+    size_t entries = index_entries(str);
+    uint32_t *index = malloc(entries * sizeof *index);
+    if (!index)
+        return NULL;
+    size_t i = 0;
+    for (size_t k = 0; k < entries; ++k) {
+        i = skip_chars(p, len, i, k ? STR_INDEX_STRIDE : 0);
+        index[k] = (uint32_t) i;
+    }
+    return index;
+}
+
+bool eris_str_seek(string_t *str, size_t n, size_t *out,
+                   eris_thread_t *thread)
+{
+    size_t len = CONTENTS_LEN(str);
+    if (n == str->num_chars) {
+        *out = len;
+        return true;
+    }
+
+    /* Strings are shared between threads, so several may race to build the
+     * index. The losers throw theirs away. Only collected strings get freed,
+     * giving back what their indexes were charged, so only theirs are. */
+    uint32_t *index = __atomic_load_n(&str->index, __ATOMIC_ACQUIRE);
+    if (!index) {
+        uint32_t *expected = NULL;
+        bool collected = CONTENTS_OBJ(str)->header & HEADER_COLLECTED;
+        size_t charge = collected ? index_entries(str) * sizeof *index : 0;
+        if (!eris_charge(thread, charge))
+            return false;
+        if (!(index = build_index(str))) {
+            eris_uncharge(thread, charge);
+            return false;
+        }
+        if (!__atomic_compare_exchange_n(&str->index, &expected, index, false,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            free(index);
+            eris_uncharge(thread, charge);
+            index = expected;
+        }
+    }
+    *out = skip_chars((const unsigned char *) str->data, len,
+                      index[n / STR_INDEX_STRIDE], n % STR_INDEX_STRIDE);
+    return true;
+}
+
+uint32_t eris_str_decode_slow(const string_t *str, size_t offset)
+{
+    const unsigned char *p = (const unsigned char *) str->data + offset;
+    size_t n = seq_len(p[0]);
+    assert (n >= 2 && offset + n <= CONTENTS_LEN(str));
+    uint32_t c = p[0] & (0x7f >> n);
+    for (size_t k = 1; k < n; ++k)
+        c = c << 6 | (p[k] & 0x3f);
+    return c;
+}
+
+bool eris_str_new(string_t **out, const char *data, size_t len,
+                  eris_thread_t *thread, frame_t *frame)
+{
+    size_t num_chars;
+    bool ascii;
+    string_t *str;
+    if (!eris_utf8_scan(data, len, &num_chars, &ascii)
+        || !new_string(&str, len, thread, frame))
+        return false;
+    memcpy((char *) str->data, data, len);
+    str->num_chars = num_chars;
+    str->ascii = ascii;
+    str->index = NULL;
+    *out = str;
+    return true;
+}
+
+bool eris_str_slice(string_t **out, string_t *str, size_t from, size_t to,
+                    eris_thread_t *thread, frame_t *frame)
+{
+    assert (from <= to && to <= str->num_chars);
+    size_t start, end;
+    string_t *slice;
+    if (!eris_str_offset(str, from, &start, thread)
+        || !eris_str_offset(str, to, &end, thread)
+        || !new_string(&slice, end - start, thread, frame))
+        return false;
+    memcpy((char *) slice->data, str->data + start, end - start);
+    slice->num_chars = to - from;
+    /* A slice is ASCII iff each of its code points is one byte. */
+    slice->ascii = slice->num_chars == end - start;
+    slice->index = NULL;
+    *out = slice;
+    return true;
+}
+
+size_t eris_str_clear(string_t *str)
+{
+    if (!str->index)
+        return 0;
+    free(str->index);
+    return index_entries(str) * sizeof *str->index;
+}
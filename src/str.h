@@ -0,0 +1,76 @@
+/* Strings. These are immutable and always valid UTF-8, and know how many code
+ * points they hold. Pure-ASCII strings are indexed directly; other strings get
+ * a sparse index from code points to byte offsets the first time they're
+ * indexed into, so that finding the nth code point means scanning at most
+ * STR_INDEX_STRIDE of them.
+ */
+#ifndef _STR_H_
+#define _STR_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "misc.h"
+#include "types.h"
+
+#define STR_INDEX_STRIDE 64
+
+/* Checks that `data' is `len' bytes of valid UTF-8. If so, stores how many code
+ * points it holds in `*num_chars', and whether they're all ASCII in `*ascii'.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_utf8_scan(const char *data, size_t len,
+                    size_t *num_chars, bool *ascii);
+
+/* How many bytes at the end of `data' start a UTF-8 sequence that the end cuts
+ * short; 0 if none do. Says nothing of whether the rest is valid. */
+size_t eris_utf8_cut(const char *data, size_t len);
+
+/* Makes a string holding a copy of `data'. Fails iff `data' isn't valid UTF-8
+ * or allocation failed; either way the caller should raise an exception.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_str_new(string_t **out, const char *data, size_t len,
+                  eris_thread_t *thread, frame_t *frame);
+
+/* The byte offset of `str's code point `n', where n <= str->num_chars. Fails
+ * iff allocation failed, building the index, which is charged to `thread's
+ * share of the heap (see eris_charge).
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_str_seek(string_t *str, size_t n, size_t *out,
+                   eris_thread_t *thread);
+
+ERIS_WARN_UNUSED_RESULT
+static inline bool eris_str_offset(string_t *str, size_t n, size_t *out,
+                                   eris_thread_t *thread)
+{
+    if (LIKELY(str->ascii)) {
+        *out = n;
+        return true;
+    }
+    return eris_str_seek(str, n, out, thread);
+}
+
+/* The code point starting at byte `offset' of `str'. */
+uint32_t eris_str_decode_slow(const string_t *str, size_t offset);
+
+static inline uint32_t eris_str_decode(const string_t *str, size_t offset)
+{
+    unsigned char c = (unsigned char) str->data[offset];
+    return LIKELY(c < 0x80) ? c : eris_str_decode_slow(str, offset);
+}
+
+/* The substring of `str' from code point `from' up to, but not including,
+ * `to'; from <= to <= str->num_chars. Fails iff allocation failed.
+ */
+ERIS_WARN_UNUSED_RESULT
+bool eris_str_slice(string_t **out, string_t *str, size_t from, size_t to,
+                    eris_thread_t *thread, frame_t *frame);
+
+/* Frees `str's index, if it has one, returning what it was charged. For
+ * eris_free. */
+size_t eris_str_clear(string_t *str);
+
+#endif
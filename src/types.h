@@ -5,6 +5,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <pthread.h>
+
 #include <gmp.h>
 
 /* We use Judy arrays for various things. Not because we've actually determined
@@ -37,6 +39,7 @@ typedef   uint8_t   builtin_op_t;
 
 typedef   uint8_t   reg_t;
 typedef   uint8_t   nargs_t;
+typedef   uint8_t   nresults_t;
 typedef   uint8_t   upval_t;
 
 /* Opcode values. Note that this is not the type used to represent opcodes in
@@ -45,11 +48,13 @@ typedef   uint8_t   upval_t;
  * handled all the branches in a switch.
  */
 enum op {
-    OP_MOVE, OP_LOAD_INT, OP_LOAD_UPVAL, OP_LOAD_CELL,
+    OP_MOVE, OP_LOAD_INT, OP_LOAD_UPVAL, OP_LOAD_CELL, OP_LOAD_GLOBAL,
 
     /* unconditional control flow operators */
-    OP_CALL_CELL, OP_CALL_REG, OP_TAILCALL_CELL, OP_TAILCALL_REG,
-    OP_JUMP, OP_RETURN,
+    OP_CALL_CELL, OP_CALL_REG, OP_CALL_CELL_N, OP_CALL_REG_N,
+    OP_TAILCALL_CELL, OP_TAILCALL_REG,
+    OP_TAILCALL_CELL0, OP_TAILCALL_REG0, OP_TAILCALL_SELF, OP_TAILCALL_SELF0,
+    OP_JUMP, OP_RETURN, OP_RETURN_N,
 
     /* conditional control flow operators */
     OP_IF, OP_IFNOT,
@@ -74,57 +79,162 @@ enum builtin_op {
 /* Eris object structures */
 typedef struct {
     const char *name;           /* a C string, null-byte and all. */
-    /* TODO: gc information. */
+    eris_shape_id_t id;
 } shape_t;
 
-/* An object is a pointer to its shape, followed by a value of that shape. */
+/* The shape table, indexed by shape id. Adding a shape means adding an id to
+ * eris_shape_id_t, and an entry to the table in shapes.c. */
+extern const shape_t eris_shapes[ERIS_NUM_SHAPES];
+
+/* An object is a header, followed by a value of its shape. The header packs the
+ * id of the object's shape with bits for the GC:
+ *
+ *   bits 0-7    shape id
+ *   bit 8       reserved (the GC marks objects in their gc_link_t)
+ *   bits 9-10   GC age
+ *   bit 11      foreign: lives in memory we didn't allocate, eg. a buffer
+ *               eris_deserialize decoded in place, so never free it
+ *   bits 12-19  pin count: while it's nonzero the GC mustn't move the object.
+ *               It saturates, pinning the object for good; see obj_pin.
+ *   bit 20      collected: the GC frees the object once it's unreachable
+ *   bit 21      remembered: the GC treats this uncollected object as a root
+ *   bits 22-31  reserved
+ *
+ * See gc.h for the last two.
+ *
+ * Values need word alignment, so the header shares its word with a 32-bit
+ * length. Seqs, strings and symbols keep their lengths there instead of in
+ * their own contents; see CONTENTS_LEN in vm.h.
+ */
+typedef uint32_t header_t;
+
+#define HEADER_SHAPE_BITS  8
+#define HEADER_SHAPE_MASK  ((header_t) ((1 << HEADER_SHAPE_BITS) - 1))
+#define HEADER_AGE_SHIFT   9
+#define HEADER_AGE_MASK    ((header_t) 3 << HEADER_AGE_SHIFT)
+#define HEADER_FOREIGN     ((header_t) 1 << 11)
+#define HEADER_PIN_SHIFT   12
+#define HEADER_PIN_ONE     ((header_t) 1 << HEADER_PIN_SHIFT)
+#define HEADER_PIN_MASK    ((header_t) 0xff << HEADER_PIN_SHIFT)
+#define HEADER_COLLECTED   ((header_t) 1 << 20)
+#define HEADER_REMEMBERED  ((header_t) 1 << 21)
+
 typedef struct {
-    shape_t *tag;
+    header_t header;
+    uint32_t len;
     /* The value goes here. */
 } obj_t;
 
-/* For declaring shapes. */
-#define SHAPE(name)                             \
-    extern shape_t eris_shape_##name;           \
-    typedef struct name name##_t;               \
+/* For declaring shapes. SHAPE_ID_name is the shape's eris_shape_id_t. */
+#define SHAPE(name, ID)                                 \
+    enum { SHAPE_ID_##name = ERIS_SHAPE_##ID };         \
+    typedef struct name name##_t;                       \
     struct name
 
-extern shape_t eris_shape_nil;
+/* Value representation. By default a val_t is a pointer to an obj_t, nil
+ * included, and every number is boxed in a num_t.
+ *
+ * With ERIS_NIL_NULL (NIL_NULL=1 in config.mk), nil is instead the null
+ * pointer, so that testing for it is testing for zero. Everything else stays
+ * the same.
+ *
+ * With ERIS_NANBOX (NANBOX=1 in config.mk), a val_t is 64 bits, and anything
+ * that isn't a NaN is a double, stored as itself. The NaNs are canonicalized
+ * to VAL_NAN, which frees up the rest of the NaN space: there, the top 16 bits
+ * are one of the tags below, and the low 48 a payload. Pointers fit in 48 bits
+ * on the platforms we care about, and so do most fixnums; ones that don't are
+ * boxed as usual. See vm.h for the accessors.
+ */
+#ifdef ERIS_NANBOX
+#if UINTPTR_MAX != UINT64_MAX
+#error "NaN-boxing needs 64-bit pointers"
+#endif
+
+#define VAL_TAG_SHIFT     48
+#define VAL_PAYLOAD_MASK  ((UINT64_C(1) << VAL_TAG_SHIFT) - 1)
+#define VAL_TAG_OBJ       UINT64_C(0xfff9) /* payload is an obj_t * */
+#define VAL_TAG_FIXNUM    UINT64_C(0xfffa) /* payload is a 48-bit fixnum */
+#define VAL_TAG_NIL       UINT64_C(0xfffb) /* payload is 0 */
+#define VAL_TAG_UNDEFINED UINT64_C(0xfffc) /* payload is 0 */
+#define VAL_NAN           UINT64_C(0x7ff8000000000000)
+
+#define eris_nil ((val_t) (VAL_TAG_NIL << VAL_TAG_SHIFT))
+#define VAL_UNDEFINED ((val_t) (VAL_TAG_UNDEFINED << VAL_TAG_SHIFT))
+#elif defined ERIS_NIL_NULL
+#define eris_nil ((val_t) 0)
+#define VAL_UNDEFINED ((val_t) 1) /* no object lives at an odd address */
+#else
 extern const val_t eris_nil;
+#define VAL_UNDEFINED ((val_t) 0)
+#endif
 
-/* TODO: complex numbers. */
+/* TODO: complex numbers.
+ *
+ * The tags are in the order of the numeric tower; see num.h. */
 typedef uint8_t num_tag_t;
-enum num_tag { NUM_INTPTR, NUM_MPQ, NUM_DOUBLE };
+enum num_tag { NUM_INTPTR, NUM_MPZ, NUM_MPQ, NUM_DOUBLE };
 
-SHAPE(num) {
+SHAPE(num, NUM) {
     num_tag_t tag;
     union {
         intptr_t v_intptr;
+        mpz_t v_mpz;
         mpq_t v_mpq;
         double v_double;
     } data;
 };
 
-SHAPE(builtin) {
+SHAPE(builtin, BUILTIN) {
     builtin_op_t op;
     nargs_t num_args;
     bool variadic;
 };
 
-SHAPE(proto) {
+/* Describes which of its parent's upvals and registers a closure over a given
+ * proto captures, in that order. Built at load time; see loader.h. */
+typedef struct {
+    upval_t num_from_upvals;
+    upval_t num_from_regs;
+    /* Whether the respective index lists are nonempty runs of consecutive
+     * indices, in which case we copy them with memcpy. */
+    bool upvals_consecutive;
+    bool regs_consecutive;
+    /* The first num_from_upvals are parent upval indices; the rest are parent
+     * register numbers. */
+    uint8_t *indices;
+    /* Non-NULL iff we capture nothing. Since closures are immutable, every
+     * CLOSE of such a proto can just hand out this one closure. */
+    struct closure *shared;
+} capture_t;
+
+SHAPE(proto, PROTO) {
+    const char *name;           /* for backtraces and profiles; may be NULL */
     instr_t *code;
+    size_t code_len;            /* in instr_ts */
     nargs_t num_args;
     upval_t num_upvals;
+    /* Number of registers our code uses, arguments included. */
+    uint16_t num_regs;
     bool variadic;
+    /* Set by the verifier (see loader.h). Verified protos run in a faster
+     * interpreter loop, which omits the checks the verifier made redundant. */
+    bool verified;
+    /* For the template JIT (see jit.h). `jit' is NULL until we're compiled. */
+    uint32_t num_calls;
+    struct eris_jit_code *jit;
+    /* Our code compiled ahead of time, if any; see aot.h. */
+    const struct eris_aot_entry *aot;
+    capture_t capture;
+    size_t num_local_funcs;
     proto_t *local_funcs[];
 };
 
-SHAPE(closure) {
+SHAPE(closure, CLOSURE) {
     proto_t *proto;
     val_t upvals[];
 };
 
-SHAPE(c_closure) {
+SHAPE(c_closure, C_CLOSURE) {
     eris_c_func_t func;
     void *data;
     val_t name;                 /* invariant: is a string */
@@ -132,39 +242,82 @@ SHAPE(c_closure) {
     val_t upvals[];
 };
 
-/* TODO: figure out unicode/encoding issues. */
-SHAPE(string) {
-    size_t len;
+/* Seqs, strings and symbols get their lengths from their headers; for strings,
+ * that's in bytes.
+ *
+ * NOT C99 SPEC: a struct can't have only a flexible array member, so seqs and
+ * symbols use zero-length arrays, a GNU extension clang also supports.
+ */
+/* Strings are immutable, valid UTF-8. See str.h. */
+SHAPE(string, STRING) {
+    size_t num_chars;           /* in code points */
+    bool ascii;                 /* iff num_chars is the length in bytes */
+    /* For non-ASCII strings, the byte offsets of every STR_INDEX_STRIDE'th
+     * code point, built the first time we index into the string; NULL until
+     * then. Access it atomically. */
+    uint32_t *index;
     const char data[];
 };
 
 /* TODO: Immutable sequence representation should be smarter.
  * At the very least, ropes, if not finger trees.
  */
-SHAPE(seq) {
-    size_t len;
-    val_t data[];
+SHAPE(seq, SEQ) {
+    val_t data[0];
 };
 
 /* NB. differ from seqs in tha they are mutable */
 /* TODO: these should be extensible arrays with a capacity & size. */
-SHAPE(vec) {
+SHAPE(vec, VEC) {
     size_t len;
     val_t data[];
 };
 
-SHAPE(symbol) {
-    size_t len;
-    const char data[];
+SHAPE(symbol, SYMBOL) {
+    const char data[0];
 };
 
-SHAPE(cell) {
-    /* If this is 0/NULL, the cell is undefined. */
+SHAPE(cell, CELL) {
+    /* If this is VAL_UNDEFINED, the cell is undefined. */
     val_t val;
     /* Information on where the cell came from. */
     symbol_t *symbol;
 };
 
+/* A lightweight thread of eris code, with register and control stacks of its
+ * own, scheduled cooperatively by its OS thread. See fiber.h. */
+SHAPE(fiber, FIBER) {
+    /* Where we left off, while we're not running; as in vm_state_t. `frame'
+     * is really a frame_t *. */
+    instr_t *ip;
+    val_t *regs;
+    void *frame;
+    closure_t *func;
+    eris_thread_t *thread;      /* whose scheduler runs us */
+    /* Our stacks. NULL once we're done, and for a thread's root fiber, which
+     * runs on the thread's own. */
+    void *stack;
+    /* While we wait in a JOIN, the fiber we're waiting on, and where to put
+     * what it returns. */
+    fiber_t *joining;
+    val_t *dest;
+    val_t result;               /* once we're done */
+    bool done;
+    bool io_done;               /* whether our I/O's done; see below */
+    /* The next fiber on the run queue or list of waiters we're on. */
+    fiber_t *next;
+    fiber_t *waiters;           /* the fibers JOINing us */
+    /* While we wait on I/O (see aio.h): the buffer it needs, its result once
+     * it's done, the socket it's connecting (or -1), and what the buffer's
+     * charged to the heap, which a read's length bounds. */
+    void *io_buf;
+    intptr_t io_result;
+    int io_fd;
+    uint32_t io_charge;
+    /* The last collection to have scanned our stack; see gc.h. */
+    uint64_t gc_cycle;
+};
+
 /* clean up our macros */
 #undef SHAPE
 
@@ -173,6 +326,9 @@ SHAPE(cell) {
 typedef uint8_t frame_tag_t;
 enum frame_tag {
     FRAME_CALL, FRAME_C_CALL,
+    /* The bottom of a fiber's control stack; returning into it ends the
+     * fiber. */
+    FRAME_FIBER,
     /* TODO: exceptions */
     /* FRAME_HANDLE, */
 };
@@ -209,28 +365,99 @@ typedef struct {
     frame_t *frame;
     closure_t *func;
     eris_thread_t *thread;
+    /* Our VM's global table, for LOAD_GLOBAL. */
+    cell_t *globals;
 } vm_state_t;
 
 
 /* Runtime data structures */
+
+/* Defined in pool.h. */
+typedef struct eris_pool eris_pool_t;
+/* Defined in prof.c. */
+struct eris_prof;
+/* Defined in gc.c and gc.h. */
+struct eris_gc;
+struct gc_link;
+
 struct eris_vm {
-    /* TODO: GC metadata. */
-    /* Judy array of interned symbols. */
+    /* The GC's state (see gc.h); the mark it gives new objects, which counts
+     * as marked until its next snapshot flips it; and whether it's marking,
+     * for its barriers. */
+    struct eris_gc *gc;
+    size_t gc_colour;
+    bool gc_marking;
+    /* Interned symbols: a JudyHS array mapping names to them. See eris_intern
+     * in runtime.h. */
     Pvoid_t symbols;
     val_t symbol_t;         /* the "t" symbol, used as a canonical true value */
+
+    /* The global table: ERIS_VM_GLOBALS cells, which LOAD_GLOBAL indexes
+     * directly, and a JudyHS array mapping names to their slots in it. See
+     * eris_global_slot in loader.h. */
+    cell_t *globals;
+    Pvoid_t global_slots;
+    size_t num_globals;
     /* Linked list of threads. */
     eris_thread_t *threads;
+
+    /* Worker pool for parallel builtins; created lazily under `pool_lock'. */
+    eris_pool_t *pool;
+    pthread_mutex_t pool_lock;
+    size_t par_workers;         /* # of extra OS threads the pool may use */
+    size_t par_cutoff;          /* inputs shorter than this run serially */
+
+    /* Samples from the profiler; NULL if it's never been started. */
+    struct eris_prof *prof;
+    bool profiling;             /* whether `prof' is taking samples */
+
+#ifdef ERIS_STATS
+    /* Counts from threads since destroyed. See stats.h. */
+    eris_stats_t retired_stats;
+#endif
 };
 
 struct eris_thread {
     eris_vm_t *vm;
-    /* Whether a frame has been created on this thread and is in use. */
-    bool in_use;
+    /* The frame created on this thread, if it's in use; NULL if not. */
+    eris_frame_t *api_frame;
     /* `regs' points to bottom of register stack. */
     val_t *regs;
     /* `frames' points to top of frame stack. dereferencing it is disallowed. */
     void *frames;
-    /* TODO: GC metadata (eg. size of register & frame stacks). */
+    /* Sizes of the register and frame stacks, in val_ts and frame_ts. */
+    size_t num_regs;
+    size_t num_frames;
+#ifdef ERIS_STATS
+    /* Only ever written by this thread. See stats.h. */
+    eris_stats_t stats;
+#endif
+    /* Fibers (see fiber.h). `fiber' is the one running, or that will run when
+     * we next enter the VM; `root_fiber' stands for whoever entered it from C.
+     * The run queue holds the fibers ready to run, oldest first. */
+    fiber_t *fiber;
+    fiber_t root_fiber;
+    fiber_t *run_head, *run_tail;
+    /* How many eris_vm_calls we're inside. Fibers only switch when it's 1, so
+     * that no C code of ours is left waiting on a fiber's stack. */
+    size_t vm_calls;
+    /* Unused fiber stacks, and the slabs of memory they're carved from. */
+    void *free_stacks;
+    void *stack_slabs;
+    /* Our asynchronous I/O's ring, once we've needed it, and how many fibers
+     * are parked waiting on it. See aio.h. */
+    struct eris_aio *aio;
+    size_t io_waiting;
+    /* For the GC (see gc.h): the objects we've allocated since it last took
+     * them, newest first; how many more bytes we may allocate before its next
+     * step; whether it wants to start a collection at our next safe point;
+     * our unfinished fibers, a Judy1 set; and how many eris_gc_enters we're
+     * inside, which other threads read atomically. */
+    struct gc_link *gc_objs, *gc_objs_tail;
+    size_t gc_credit;
+    bool gc_pending;
+    Pvoid_t gc_fibers;
+    size_t gc_entered;
     /* Next thread on thread list. */
     eris_thread_t *next;
 };
@@ -0,0 +1,178 @@
+/* The bytecode verifier. */
+#include <assert.h>
+
+#include "loader.h"
+#include "misc.h"
+#include "types.h"
+#include "vm.h"
+
+#define FAIL(msg) do { *why = (msg); return false; } while (0)
+
+static bool is_tail_call(op_t op)
+{
+    switch ((enum op) op) {
+      case OP_TAILCALL_CELL: case OP_TAILCALL_REG:
+      case OP_TAILCALL_CELL0: case OP_TAILCALL_REG0:
+      case OP_TAILCALL_SELF: case OP_TAILCALL_SELF0:
+        return true;
+      case OP_MOVE: case OP_LOAD_INT: case OP_LOAD_UPVAL: case OP_LOAD_CELL:
+      case OP_LOAD_GLOBAL: case OP_CALL_CELL: case OP_CALL_REG: case OP_CALL_CELL_N:
+      case OP_CALL_REG_N: case OP_JUMP: case OP_RETURN: case OP_RETURN_N:
+      case OP_IF: case OP_IFNOT: case OP_CLOSE:
+        return false;
+      default:
+        return false;
+    }
+}
+
+/* Whether control can't proceed from an instruction to the next one. */
+static bool is_terminator(op_t op)
+{
+    return op == OP_JUMP || op == OP_RETURN || op == OP_RETURN_N
+        || is_tail_call(op);
+}
+
+static bool verify_instr(const proto_t *proto, size_t pc, const char **why)
+{
+    instr_t instr = proto->code[pc];
+    size_t num_regs = proto->num_regs;
+    size_t num_upvals = proto->num_upvals;
+    arg_t arg1 = VM_ARG1(instr), arg2 = VM_ARG2(instr), arg3 = VM_ARG3(instr);
+
+    /* The registers a call uses as its arguments and results. */
+    size_t offset = arg2, nargs = arg3, nresults = 1;
+
+    switch ((enum op) VM_OP(instr)) {
+      case OP_MOVE:
+        if (arg1 >= num_regs || arg2 >= num_regs)
+            FAIL("register out of bounds");
+        return true;
+
+      case OP_LOAD_INT:
+      case OP_LOAD_GLOBAL:
+        if (arg1 >= num_regs)
+            FAIL("register out of bounds");
+        return true;
+
+      case OP_LOAD_UPVAL:
+      case OP_LOAD_CELL:
+        if (arg1 >= num_regs)
+            FAIL("register out of bounds");
+        if (arg2 >= num_upvals)
+            FAIL("upval out of bounds");
+        return true;
+
+      case OP_CALL_CELL_N:
+      case OP_CALL_REG_N:
+        nargs = VM_CALL_N_NARGS(instr);
+        nresults = VM_CALL_N_NRESULTS(instr);
+        /* fall through */
+      case OP_CALL_CELL:
+      case OP_CALL_REG:
+      case OP_TAILCALL_CELL:
+      case OP_TAILCALL_REG:
+      case OP_TAILCALL_CELL0:
+      case OP_TAILCALL_REG0:
+        if (VM_OP(instr) == OP_TAILCALL_CELL0
+            || VM_OP(instr) == OP_TAILCALL_REG0)
+            offset = 0;
+        if (VM_OP(instr) == OP_CALL_CELL
+            || VM_OP(instr) == OP_CALL_CELL_N
+            || VM_OP(instr) == OP_TAILCALL_CELL
+            || VM_OP(instr) == OP_TAILCALL_CELL0) {
+            if (arg1 >= num_upvals)
+                FAIL("upval out of bounds");
+        }
+        else if (arg1 >= num_regs)
+            FAIL("register out of bounds");
+        if (offset + MAX(MAX(nargs, nresults), 1) > num_regs)
+            FAIL("call window out of bounds");
+        return true;
+
+      case OP_TAILCALL_SELF:
+        if (offset + nargs > num_regs)
+            FAIL("call window out of bounds");
+        /* fall through */
+      case OP_TAILCALL_SELF0:
+        if (nargs != proto->num_args || proto->variadic)
+            FAIL("self tail call with wrong number of arguments");
+        return true;
+
+      case OP_JUMP: {
+          ptrdiff_t target = (ptrdiff_t) pc + VM_SIGNED_LONGARG(instr);
+          if (target < 0 || (size_t) target >= proto->code_len)
+              FAIL("jump out of bounds");
+          return true;
+      }
+
+      case OP_RETURN:
+        if (arg1 >= num_regs)
+            FAIL("register out of bounds");
+        return true;
+
+      case OP_RETURN_N:
+        if ((size_t) arg1 + arg2 > num_regs)
+            FAIL("register out of bounds");
+        return true;
+
+      case OP_IF:
+      case OP_IFNOT:
+        if (arg1 >= num_regs)
+            FAIL("register out of bounds");
+        /* The jump we skip over must be followed by something to skip to. */
+        if (pc + 2 >= proto->code_len
+            || VM_OP(proto->code[pc+1]) != OP_JUMP)
+            FAIL("conditional not followed by a jump");
+        return true;
+
+      case OP_CLOSE: {
+          longarg_t idx = VM_LONGARG(instr);
+          if (arg1 >= num_regs)
+              FAIL("register out of bounds");
+          if (idx >= proto->num_local_funcs)
+              FAIL("local function out of bounds");
+
+          const capture_t *cap = &proto->local_funcs[idx]->capture;
+          for (size_t i = 0; i < cap->num_from_upvals; ++i)
+              if (cap->indices[i] >= num_upvals)
+                  FAIL("captured upval out of bounds");
+          for (size_t i = 0; i < cap->num_from_regs; ++i)
+              if (cap->indices[cap->num_from_upvals + i] >= num_regs)
+                  FAIL("captured register out of bounds");
+          return true;
+      }
+
+      default:
+        FAIL("unrecognized opcode");
+    }
+}
+
+bool eris_proto_verify(proto_t *proto, const char **why)
+{
+    const char *ignored;
+    if (!why)
+        why = &ignored;
+
+    proto->verified = false;
+    if (!proto->code_len)
+        FAIL("empty code");
+    if (proto->num_regs < proto->num_args + proto->variadic)
+        FAIL("too few registers for arguments");
+
+    for (size_t pc = 0; pc < proto->code_len; ++pc) {
+        if (!verify_instr(proto, pc, why))
+            return false;
+        /* A tail call to a builtin falls through to the next instr, which
+         * returns its result. */
+        if (is_tail_call(VM_OP(proto->code[pc]))
+            && (pc + 1 >= proto->code_len
+                || VM_OP(proto->code[pc+1]) != OP_RETURN))
+            FAIL("tail call not followed by a return");
+    }
+
+    if (!is_terminator(VM_OP(proto->code[proto->code_len - 1])))
+        FAIL("control falls off the end of the code");
+
+    proto->verified = true;
+    return true;
+}
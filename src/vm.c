@@ -1,59 +1,337 @@
 #include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <eris/eris.h>
 
+#include "aio.h"
+#include "aot.h"
+#include "fiber.h"
+#include "gc.h"
+#include "jit.h"
 #include "misc.h"
+#include "num.h"
+#include "pool.h"
+#include "prof.h"
 #include "runtime.h"
+#include "stats.h"
+#include "str.h"
 #include "types.h"
 #include "vm.h"
 
 #define FRAME(f) (f)->data.call
 
+/* Returned by vm_loop when we enter a proto that needs the other loop. Unlike
+ * ERIS_VM_RAISED, it never gets out of eris_vm_run. */
+#define VM_SWITCH_LOOP ((size_t) -1)
+
 /* Helper functions. */
+
+/* Runtime checks on code that the verifier (see loader.h) hasn't vouched for.
+ * The fast loop passes `verified' as the constant true, so that these vanish
+ * entirely from it.
+ */
+static inline
+size_t check_reg(bool verified, const vm_state_t *S, size_t reg)
+{
+    if (!verified && UNLIKELY(reg >= S->func->proto->num_regs))
+        eris_bug("register %zu out of bounds", reg);
+    return reg;
+}
+
+/* Checks that registers [first, first+num) are in bounds. */
+static inline
+void check_regs(bool verified, const vm_state_t *S, size_t first, size_t num)
+{
+    if (!verified && UNLIKELY(first + num > S->func->proto->num_regs))
+        eris_bug("registers %zu-%zu out of bounds", first, first + num - 1);
+}
+
 static inline
-void do_cond(vm_state_t *S, bool cond)
+size_t check_upval(bool verified, const vm_state_t *S, size_t upval)
+{
+    if (!verified && UNLIKELY(upval >= S->func->proto->num_upvals))
+        eris_bug("upval %zu out of bounds", upval);
+    return upval;
+}
+
+static inline
+cell_t *check_cell(bool verified, val_t v)
+{
+    if (!verified && UNLIKELY(!VAL_ISA(cell, v)))
+        eris_bug("cell instruction on a non-cell");
+    return get_cell(v);
+}
+
+/* Jumps `offset' instrs from the current IP. */
+static inline
+void do_jump(vm_state_t *S, ptrdiff_t offset, bool verified)
+{
+    if (!verified) {
+        const proto_t *proto = S->func->proto;
+        ptrdiff_t target = S->ip - proto->code + offset;
+        if (UNLIKELY(target < 0 || (size_t) target >= proto->code_len))
+            eris_bug("jump out of bounds");
+    }
+    S->ip += offset;
+}
+
+static inline
+void do_cond(vm_state_t *S, bool cond, bool verified)
 {
     /* The instruction after a conditional is required to be a jump. */
+    if (!verified && UNLIKELY(VM_OP(S->ip[1]) != OP_JUMP))
+        eris_bug("conditional not followed by a jump");
     assert (VM_OP(S->ip[1]) == OP_JUMP);
 
-    if (cond)
+    if (cond) {
         /* Skip next instruction. */
-        S->ip += 2;
-    else
+        do_jump(S, 2, verified);
+    }
+    else {
         /* Make the following jump. (1 + ...) because the current IP is 1
          * behind that of the jump instruction.
          */
-        S->ip += 1 + VM_SIGNED_LONGARG(*(S->ip + 1));
+        do_jump(S, 1 + VM_SIGNED_LONGARG(*(S->ip + 1)), verified);
+    }
 }
 
 
-/* The main loop */
+/* Allocating, for the main loop and eris_vm_builtin. Each has a vm_state_t S
+ * and a `raise' label to go to when allocation fails. */
+#define NEW(shape, ...) do {                                    \
+        if (!new_##shape(__VA_ARGS__, S.thread, S.frame)) {     \
+            goto raise;                                         \
+        }                                                       \
+    } while (0)
 
-/* TODO: Use computed gotos if available. See femtolisp's flisp.c for a good way
- * to do this.
- */
+#define NEW_SEQ(...) NEW(seq, __VA_ARGS__)
+#define NEW_NUM(...) NEW(num, __VA_ARGS__)
+#define NEW_CLOSURE(...) NEW(closure, __VA_ARGS__)
+
+/* Like NEW, but for numbers, which needn't be objects; see vm.h. */
+#define MAKE(kind, out, x) do {                                 \
+        if (!make_##kind(out, x, S.thread, S.frame)) {          \
+            goto raise;                                         \
+        }                                                       \
+    } while (0)
+
+#define MAKE_FIXNUM(out, i) MAKE(fixnum, out, i)
+#define MAKE_FLONUM(out, d) MAKE(flonum, out, d)
+
+
+/* Calling into eris from C. */
+
+/* The closure eris_vm_call's trampoline code pretends to be in. Its registers,
+ * as far as the GC's concerned, are as many as a call can use. */
+static proto_t trampoline_proto = {
+    .code = NULL,
+    .num_regs = 1 + UINT8_MAX,
+    .variadic = false,
+    .verified = true,           /* it's our own code, after all */
+};
+
+static closure_t trampoline_func = { .proto = &trampoline_proto };
 
-void eris_vm_run(vm_state_t *state)
+bool eris_vm_call(eris_thread_t *thread, val_t *regs, frame_t *frame,
+                  nargs_t nargs, size_t *nresults_out)
 {
-    vm_state_t S = *state;
-#define REG(n)      (S.regs[n])
+    /* A trampoline that tail-calls REG[0]. If that's a closure, it returns
+     * straight to our FRAME_C_CALL frame with its result in REG[0]; if it's a
+     * builtin, its result lands in REG[1] and the RETURN puts it in place. */
+    instr_t trampoline[] = {
+        VM_INSTR(OP_TAILCALL_REG, 0, 1, nargs),
+        VM_INSTR(OP_RETURN, 1, 0, 0),
+    };
+
+    frame_t *c_frame = frame - 1;
+    c_frame->tag = FRAME_C_CALL;
+    c_frame->data.c_call.func = NULL;
+    c_frame->data.c_call.num_regs = 0;
+
+    frame_t *call_frame = c_frame - 1;
+    call_frame->tag = FRAME_CALL;
+    FRAME(call_frame).ip = trampoline;
+    FRAME(call_frame).func = &trampoline_func;
+
+    vm_state_t state = ((vm_state_t) {
+            .ip = trampoline,
+            .regs = regs,
+            .frame = call_frame,
+            .func = &trampoline_func,
+            .thread = thread,
+            .globals = thread->vm->globals,
+    });
+    eris_gc_enter(thread);
+    ++thread->vm_calls;
+    size_t nresults = eris_vm_run(&state);
+    --thread->vm_calls;
+    eris_gc_leave(thread);
+    bool ok = nresults != ERIS_VM_RAISED;
+    if (!ok)
+        nresults = 0;
+    if (!nresults)
+        regs[0] = eris_nil;
+    if (nresults_out)
+        *nresults_out = nresults;
+    return ok;
+}
 
+
+/* Calling builtins from compiled code (see aot.h). The builtin's body is the
+ * main loop's, but where the loop would raise, or switch fibers and carry on
+ * with the next, we return false, leaving the rest to the interpreter. */
+bool eris_vm_builtin(vm_state_t *state, builtin_t *builtin, reg_t offset,
+                     nargs_t nargs, nresults_t nresults)
+{
+    vm_state_t S = *state;
     if (0) {
       raise:
-        /* TODO: Stack-unwinding code */
-        assert (0 && "unimplemented");
+        return false;
     }
 
-#define NEW(shape, ...) do {                                    \
-        if (!new_##shape(__VA_ARGS__, S.thread, S.frame)) {     \
+    switch (builtin->op) {
+#define BUILTIN(name, num_args, variadic, ...)                  \
+        case CAT(BOP_,name): { __VA_ARGS__ } break;
+#define ARG(i)  S.regs[offset+(i)]
+#define DEST    S.regs[offset]
+#define UNIMPLEMENTED eris_bug("builtin %u unimplemented", builtin->op);
+/* As in the main loop, below; but it's for the interpreter to resume the fiber
+ * we switch to, so we hand it over in `*state'. */
+#define SWITCH_FIBER(switch_) do {                              \
+        for (nresults_t i_ = 1; i_ < nresults; ++i_)            \
+            S.regs[offset + i_] = eris_nil;                     \
+        ++S.ip;                                                 \
+        PARK_FIBER(switch_);                                    \
+    } while (0)
+#define PARK_FIBER(park_) do {                                  \
+        vm_state_t next_ = S;                                   \
+        if (!(park_))                                           \
             goto raise;                                         \
+        *state = next_;                                         \
+        return false;                                           \
+    } while (0)
+
+#include "builtins.expando"
+
+#undef PARK_FIBER
+#undef SWITCH_FIBER
+#undef UNIMPLEMENTED
+#undef DEST
+#undef ARG
+#undef BUILTIN
+
+      default: IMPOSSIBLE("unrecognized builtin: %u", builtin->op);
+    }
+
+    for (nresults_t i = 1; i < nresults; ++i)
+        S.regs[offset + i] = eris_nil;
+    return true;
+}
+
+
+/* The main loop */
+
+/* TODO: Use computed gotos if available. See femtolisp's flisp.c for a good way
+ * to do this.
+ */
+
+/* We instantiate the main loop twice: a checked loop, for protos which haven't
+ * been verified, and a fast loop, which trusts the verifier and omits the
+ * runtime checks it made redundant. Each hands control back here when we call
+ * or return into a proto that needs the other.
+ */
+static inline ALWAYS_INLINE
+size_t vm_loop(vm_state_t *state, const bool verified);
+
+static NOINLINE size_t vm_loop_checked(vm_state_t *state)
+{
+    return vm_loop(state, false);
+}
+
+static NOINLINE size_t vm_loop_fast(vm_state_t *state)
+{
+    return vm_loop(state, true);
+}
+
+size_t eris_vm_run(vm_state_t *state)
+{
+    size_t nresults;
+    do {
+        nresults = state->func->proto->verified
+            ? vm_loop_fast(state)
+            : vm_loop_checked(state);
+    } while (nresults == VM_SWITCH_LOOP);
+    return nresults;
+}
+
+static inline ALWAYS_INLINE
+size_t vm_loop(vm_state_t *state, const bool verified)
+{
+    vm_state_t S = *state;
+#define REG(n)      (S.regs[check_reg(verified, &S, (n))])
+
+    /* Call after changing S.func, to switch loops if need be. */
+#define ENTERED_FUNC() do {                                     \
+        if (UNLIKELY(S.func->proto->verified != verified)) {    \
+            *state = S;                                         \
+            return VM_SWITCH_LOOP;                              \
         }                                                       \
     } while (0)
 
-#define NEW_SEQ(...) NEW(seq, __VA_ARGS__)
-#define NEW_NUM(...) NEW(num, __VA_ARGS__)
-#define NEW_CLOSURE(...) NEW(closure, __VA_ARGS__)
+    /* Runs the current proto's compiled code, if any, until it gets to an
+     * instruction it leaves to us. Only verified protos get compiled. Code
+     * compiled ahead of time (see aot.h) may call and return, and leave us in
+     * another proto entirely; JIT-compiled code just moves the IP. */
+#define JIT_RUN() do {                                  \
+        if (verified) {                                 \
+            vm_state_t jit_state = S;                   \
+            if (eris_aot_run(&jit_state)) {             \
+                S = jit_state;                          \
+                ENTERED_FUNC();                         \
+            }                                           \
+            else {                                      \
+                eris_jit_run(&jit_state);               \
+                S.ip = jit_state.ip;                    \
+            }                                           \
+        }                                               \
+    } while (0)
+
+    /* After a backward jump: maybe take a profiling sample or start a
+     * collection, and get back into compiled code, which leaves loops to us
+     * when either is due. */
+#define LOOPED() do {                           \
+        eris_prof_poll(S);                      \
+        eris_gc_poll(S);                        \
+        JIT_RUN();                              \
+    } while (0)
+
+    if (0) {
+      raise:
+        /* TODO: exceptions, and handlers to catch them. Till then, we unwind
+         * to the C code that entered us, which fails, or to the bottom of the
+         * fiber we're in, which ends it with nil. */
+        for (;;) {
+            ++S.frame;
+            frame_tag_t frame_tag = *(frame_tag_t*) S.frame;
+            switch ((enum frame_tag) frame_tag) {
+              case FRAME_CALL: continue;
+              case FRAME_C_CALL: return ERIS_VM_RAISED;
+              case FRAME_FIBER: {
+                  vm_state_t next = S;
+                  eris_fiber_exit(&next, eris_nil);
+                  S = next;
+                  ENTERED_FUNC();
+                  JIT_RUN();
+                  goto begin;
+              }
+              default: IMPOSSIBLE("unrecognized or unimplemented frame tag: %u",
+                                  frame_tag);
+            }
+        }
+    }
 
     /* The ((void) 0)s that you see in the following code are garbage to appease
      * the C99 spec, which allows only that a _statement_, not a _declaration_,
@@ -61,6 +339,7 @@ void eris_vm_run(vm_state_t *state)
   begin:
     (void) 0;
     const instr_t instr = *S.ip;
+    STAT(S.thread, instrs[VM_OP(instr)]++);
 
     /* Use these macros only if their value is to be used only once. */
 #define OP   VM_OP(instr)
@@ -70,8 +349,8 @@ void eris_vm_run(vm_state_t *state)
 #define LONGARG VM_LONGARG(instr)
 #define SIGNED_LONGARG VM_SIGNED_LONGARG(instr)
 
-#define UPVAL(upval) (S.func->upvals[(upval)])
-#define CELL(upval) (deref_cell(get_cell(UPVAL(upval))))
+#define UPVAL(upval) (S.func->upvals[check_upval(verified, &S, (upval))])
+#define CELL(upval) (deref_cell(check_cell(verified, UPVAL(upval))))
 
     /* TODO: order cases by frequency. */
     switch ((enum op) OP) {
@@ -81,14 +360,9 @@ void eris_vm_run(vm_state_t *state)
         break;
 
       case OP_LOAD_INT: {
-          /* Allocating; need to update frame IP in case of GC scan. */
+          /* May allocate; need to update frame IP in case of GC scan. */
           FRAME(S.frame).ip = S.ip;
-
-          num_t *num;
-          NEW_NUM(&num);
-          num->tag = NUM_INTPTR;
-          num->data.v_intptr = SIGNED_LONGARG;
-          REG(ARG1) = CONTENTS_VAL(num);
+          MAKE_FIXNUM(&REG(ARG1), SIGNED_LONGARG);
           ++S.ip;
       }
         break;
@@ -103,6 +377,12 @@ void eris_vm_run(vm_state_t *state)
         ++S.ip;
         break;
 
+        /* LOAD_GLOBAL r1, l: the global in slot l of the global table. */
+      case OP_LOAD_GLOBAL:
+        REG(ARG1) = deref_cell(&S.globals[LONGARG]);
+        ++S.ip;
+        break;
+
 
         /* Call instructions. */
         /* FORMAT OF CALL INSTR:
@@ -126,6 +406,15 @@ void eris_vm_run(vm_state_t *state)
          *  contains the function to be called. A type check is necessary as
          *  usual.
          *
+         *  CALL_CELL_N and CALL_REG_N expect several return values: the high
+         *  3 bits of ARG3 say how many, the low 5 bits how many arguments there
+         *  are. The callee's return values end up in registers ARG2 onward;
+         *  missing ones are filled in with nil, extra ones ignored.
+         *
+         *  TAILCALL_CELL0 and TAILCALL_REG0 are for tail calls whose arguments
+         *  the compiler has already put in registers 0 onward. They ignore
+         *  ARG2, and don't need to move the arguments down.
+         *
          *  CALL_FUNC gets the closure being called for CALL and TAILCALL ops.
          *  CALL_REG_FUNC does the same for CALL_REG and TAILCALL_REG.
          */
@@ -135,35 +424,90 @@ void eris_vm_run(vm_state_t *state)
         {
             val_t funcval;
             bool tail_call;
+            reg_t offset;
+            nargs_t nargs;
+            /* Only used when calling builtins; for closures, the callee's
+             * RETURN looks at our CALL instr to find out. */
+            nresults_t nresults;
 
           case OP_CALL_CELL:
             funcval = CELL_FUNC;
             tail_call = false;
+            offset = ARG2;
+            nargs = ARG3;
+            nresults = 1;
             goto call;
 
           case OP_CALL_REG:
             funcval = REG_FUNC;
             tail_call = false;
+            offset = ARG2;
+            nargs = ARG3;
+            nresults = 1;
+            goto call;
+
+          case OP_CALL_CELL_N:
+            funcval = CELL_FUNC;
+            tail_call = false;
+            offset = ARG2;
+            nargs = VM_CALL_N_NARGS(instr);
+            nresults = VM_CALL_N_NRESULTS(instr);
+            goto call;
+
+          case OP_CALL_REG_N:
+            funcval = REG_FUNC;
+            tail_call = false;
+            offset = ARG2;
+            nargs = VM_CALL_N_NARGS(instr);
+            nresults = VM_CALL_N_NRESULTS(instr);
             goto call;
 
           case OP_TAILCALL_CELL:
             funcval = CELL_FUNC;
             tail_call = true;
+            offset = ARG2;
+            nargs = ARG3;
+            nresults = 1;
             goto call;
 
           case OP_TAILCALL_REG:
             funcval = REG_FUNC;
             tail_call = true;
+            offset = ARG2;
+            nargs = ARG3;
+            nresults = 1;
+            goto call;
+
+          case OP_TAILCALL_CELL0:
+            funcval = CELL_FUNC;
+            tail_call = true;
+            offset = 0;
+            nargs = ARG3;
+            nresults = 1;
+            goto call;
+
+          case OP_TAILCALL_REG0:
+            funcval = REG_FUNC;
+            tail_call = true;
+            offset = 0;
+            nargs = ARG3;
+            nresults = 1;
             goto call;
 
           call: (void) 0;
+            check_regs(verified, &S, offset, MAX(MAX(nargs, nresults), 1));
+            if (UNLIKELY(!VAL_IS_OBJ(funcval)))
+                goto raise;     /* TODO: type error */
             obj_t *funcobj = VAL_OBJ(funcval);
-            reg_t offset = ARG2;
-            nargs_t nargs = ARG3;
+            if (tail_call)
+                STAT(S.thread, tail_calls++);
+            else
+                STAT(S.thread, non_tail_calls++);
 
             /* Calling closures */
-            if (LIKELY(funcobj->tag == SHAPE_TAG(closure))) {
+            if (LIKELY(OBJ_ISA(closure, funcobj))) {
                 closure_t *func = OBJ_CONTENTS(closure, funcobj);
+                STAT(S.thread, closure_calls++);
 
                 /* TODO: think very hard about what happens on control stack
                  * overflow. */
@@ -201,8 +545,11 @@ void eris_vm_run(vm_state_t *state)
                      * frame's func gets set unconditionally, below.
                      */
 
-                    /* Move down arguments into appropriate slots. */
-                    memmove(S.regs, S.regs + offset, sizeof(val_t) * nargs);
+                    /* Move down arguments into appropriate slots, unless
+                     * they're already there. */
+                    if (offset)
+                        memmove(S.regs, S.regs + offset,
+                                sizeof(val_t) * nargs);
                 }
 
                 /* Update frame. */
@@ -211,10 +558,17 @@ void eris_vm_run(vm_state_t *state)
                 /* Jump into the function. */
                 S.func = func;
                 S.ip = S.func->proto->code;
+                ENTERED_FUNC();
+                if (verified)
+                    eris_jit_count(S.func->proto);
+                eris_prof_poll(S);
+                eris_gc_poll(S);
+                JIT_RUN();
             }
             /* Calling builtins */
-            else if (LIKELY(funcobj->tag == SHAPE_TAG(builtin))) {
+            else if (LIKELY(OBJ_ISA(builtin, funcobj))) {
                 builtin_t *builtin = OBJ_CONTENTS(builtin, funcobj);
+                STAT(S.thread, builtin_calls++);
                 if (UNLIKELY(nargs != builtin->num_args)
                     && (UNLIKELY(!builtin->variadic)
                         || UNLIKELY(nargs < builtin->num_args)))
@@ -228,9 +582,34 @@ void eris_vm_run(vm_state_t *state)
 #define ARG(i)  S.regs[offset+(i)]
 #define DEST    S.regs[offset]
 #define UNIMPLEMENTED eris_bug("builtin %u unimplemented", builtin->op);
+/* For builtins that switch fibers (see fiber.h). We finish the call first, so
+ * that the fiber resumes after it; then `switch_' replaces `next_', a copy of
+ * S, with the state of the fiber to run next. (A copy, like JIT_RUN's, so that
+ * S needn't live in memory.) */
+#define SWITCH_FIBER(switch_) do {                              \
+        for (nresults_t i_ = 1; i_ < nresults; ++i_)            \
+            S.regs[offset + i_] = eris_nil;                     \
+        ++S.ip;                                                 \
+        PARK_FIBER(switch_);                                    \
+    } while (0)
+
+/* For builtins that wait on I/O (see aio.h): like SWITCH_FIBER, but leaves the
+ * ip at the call, so that the builtin runs again when the fiber's woken, to
+ * finish up. */
+#define PARK_FIBER(park_) do {                                  \
+        vm_state_t next_ = S;                                   \
+        if (!(park_))                                           \
+            goto raise;                                         \
+        S = next_;                                              \
+        ENTERED_FUNC();                                         \
+        JIT_RUN();                                              \
+        goto begin;                                             \
+    } while (0)
 
 #include "builtins.expando"
 
+#undef PARK_FIBER
+#undef SWITCH_FIBER
 #undef UNIMPLEMENTED
 #undef DEST
 #undef ARG
@@ -239,12 +618,18 @@ void eris_vm_run(vm_state_t *state)
                   default: IMPOSSIBLE("unrecognized builtin: %u", builtin->op);
                 }
 
+                /* Builtins return exactly one value. */
+                for (nresults_t i = 1; i < nresults; ++i)
+                    S.regs[offset + i] = eris_nil;
+
                 /* Incrementing IP works even if tail_call is true, since then
                  * next instr is guaranteed to be an OP_RETURN. */
                 ++S.ip;
+                JIT_RUN();
             }
             /* Calling C closures */
-            else if (LIKELY(funcobj->tag == SHAPE_TAG(c_closure))) {
+            else if (LIKELY(OBJ_ISA(c_closure, funcobj))) {
+                STAT(S.thread, c_closure_calls++);
                 assert(0 && "unimplemented"); /* TODO */
                 /* TODO: what if the C func calls eris_c_tailcall? */
                 /* Incrementing IP works even if tail_call is true, since then
@@ -259,6 +644,27 @@ void eris_vm_run(vm_state_t *state)
             break;
         }
 
+        /* Self tail calls, ie. loops. The verifier guarantees that the number
+         * of arguments matches our arity, so only unverified code checks it;
+         * and since we call the closure we're already in, the control frame
+         * stays as it is. TAILCALL_SELF r2, u3 moves its u3 arguments down
+         * from register r2; TAILCALL_SELF0 is for when they're already in
+         * place. */
+      case OP_TAILCALL_SELF:
+      case OP_TAILCALL_SELF0:
+        if (!verified && UNLIKELY(ARG3 != S.func->proto->num_args
+                                  || S.func->proto->variadic))
+            eris_bug("bad self tail call");
+        if (OP == OP_TAILCALL_SELF) {
+            check_regs(verified, &S, ARG2, ARG3);
+            memmove(S.regs, S.regs + ARG2, sizeof(val_t) * ARG3);
+        }
+        STAT(S.thread, closure_calls++);
+        STAT(S.thread, tail_calls++);
+        S.ip = S.func->proto->code;
+        LOOPED();
+        break;
+
 
         /* Other instructions. */
       case OP_JUMP:
@@ -271,80 +677,153 @@ void eris_vm_run(vm_state_t *state)
          * appropriate modulo arithmetic, and if gcc & clang are smart enough
          * this will compile into a nop on x86(-64). Should test this, though.
          */
-        S.ip += SIGNED_LONGARG;
+        do_jump(&S, SIGNED_LONGARG, verified);
+        if (SIGNED_LONGARG < 0)
+            LOOPED();
         break;
 
-      case OP_RETURN: {
-          /* Put the return value where it ought to be. */
-          REG(0) = REG(ARG1);
-
-          ++S.frame;              /* pop control stack (it grows down) */
-          frame_tag_t frame_tag = *(frame_tag_t*) S.frame;
-          switch ((enum frame_tag) EXPECT_LONG(frame_tag, FRAME_CALL)) {
-            case FRAME_CALL: break;
-              /* C calls inevitably come through our API, so the API function
-               * that called us will do the necessary cleaning up. */
-            case FRAME_C_CALL: return;
-            default: IMPOSSIBLE("unrecognized or unimplemented frame tag: %u",
-                                frame_tag);
-          }
-          /* Okay, we're returning into an Eris closure. */
-
-          /* We determine how far to pop the stack by looking at the argument
-           * offset given in the CALL instruction that set up our frame.
-           */
-          S.regs -= VM_ARG2(*FRAME(S.frame).ip);
-          S.ip = FRAME(S.frame).ip + 1; /* +1 to skip past the call instr. */
-          S.func = FRAME(S.frame).func;
-      }
-        break;
+        {
+            nresults_t nresults;
+
+          case OP_RETURN:
+            /* Put the return value where it ought to be. */
+            REG(0) = REG(ARG1);
+            nresults = 1;
+            goto ret;
+
+          case OP_RETURN_N:
+            /* Return values REG[ARG1] through REG[ARG1 + ARG2 - 1]. */
+            nresults = ARG2;
+            check_regs(verified, &S, ARG1, nresults);
+            memmove(S.regs, S.regs + ARG1, sizeof(val_t) * nresults);
+            goto ret;
+
+          ret: (void) 0;
+            ++S.frame;              /* pop control stack (it grows down) */
+            frame_tag_t frame_tag = *(frame_tag_t*) S.frame;
+            switch ((enum frame_tag) EXPECT_LONG(frame_tag, FRAME_CALL)) {
+              case FRAME_CALL: break;
+                /* C calls inevitably come through our API, so the API
+                 * function that called us will do the necessary cleaning up.
+                 */
+              case FRAME_C_CALL: return nresults;
+              case FRAME_FIBER: {
+                  /* Our fiber's done; on to the next. */
+                  vm_state_t next = S;
+                  eris_fiber_exit(&next, nresults ? S.regs[0] : eris_nil);
+                  S = next;
+                  ENTERED_FUNC();
+                  JIT_RUN();
+                  goto begin;
+              }
+              default: IMPOSSIBLE("unrecognized or unimplemented frame tag: %u",
+                                  frame_tag);
+            }
+            /* Okay, we're returning into an Eris closure. */
+            const instr_t call_instr = *FRAME(S.frame).ip;
+
+            /* If it wanted more values than we gave it, fill in with nil. A
+             * plain call wants one. Not through REG: S.func is still the
+             * callee, whose registers may be fewer, and the call checked these
+             * against the caller's. */
+            if (UNLIKELY(VM_IS_CALL_N(call_instr))) {
+                for (nresults_t i = nresults;
+                     i < VM_CALL_N_NRESULTS(call_instr);
+                     ++i)
+                    S.regs[i] = eris_nil;
+            }
+            else if (UNLIKELY(!nresults)) {
+                S.regs[0] = eris_nil;
+            }
 
-      case OP_IF:
-        do_cond(&S, !VAL_IS_NIL(REG(ARG1)));
-        break;
+            /* We determine how far to pop the stack by looking at the argument
+             * offset given in the CALL instruction that set up our frame.
+             */
+            S.regs -= VM_ARG2(call_instr);
+            S.ip = FRAME(S.frame).ip + 1; /* +1 to skip past the call instr. */
+            S.func = FRAME(S.frame).func;
+            ENTERED_FUNC();
+            JIT_RUN();
+            break;
+        }
 
-      case OP_IFNOT:
-        do_cond(&S, VAL_IS_NIL(REG(ARG1)));
-        break;
+      case OP_IF: {
+          const instr_t *from = S.ip;
+          do_cond(&S, !VAL_IS_NIL(REG(ARG1)), verified);
+          if (S.ip < from)
+              LOOPED();
+          break;
+      }
 
-        /* NB. logical CLOSE instr spans multiple (>= 2) instr_ts.
-         * TODO: document format of CLOSE instr. */
+      case OP_IFNOT: {
+          const instr_t *from = S.ip;
+          do_cond(&S, VAL_IS_NIL(REG(ARG1)), verified);
+          if (S.ip < from)
+              LOOPED();
+          break;
+      }
+
+        /* FORMAT OF CLOSE INSTR:
+         *    OP (8 bits): the opcode
+         *  ARG1 (8 bits): register to put the closure in
+         *  LONGARG (16 bits): index into our proto's local_funcs
+         *
+         * Which upvals & registers to capture is described by the local
+         * func's capture descriptor, built at load time.
+         */
       case OP_CLOSE: {
+          if (!verified && UNLIKELY(LONGARG >= S.func->proto->num_local_funcs))
+              eris_bug("local function %u out of bounds", LONGARG);
+          proto_t *proto = S.func->proto->local_funcs[LONGARG];
+          const capture_t *cap = &proto->capture;
+
+          /* Closures over nothing are all alike; share one. */
+          if (cap->shared) {
+              REG(ARG1) = CONTENTS_VAL(cap->shared);
+              ++S.ip;
+              break;
+          }
+
           /* Allocating; need to update frame IP in case of GC scan. */
           FRAME(S.frame).ip = S.ip;
 
-          upval_t nupvals_upvals = ARG2; /* # upvals from parent upvals */
-          upval_t nupvals_regs = ARG3;   /* # upvals from registers */
-          upval_t nupvals = nupvals_upvals + nupvals_regs;
           closure_t *func;
-          NEW_CLOSURE(&func, nupvals);
-          REG(ARG1) = CONTENTS_VAL(func);
-
-          /* TODO: carefully consider manually optimizing this. */
+          NEW_CLOSURE(&func, proto->num_upvals);
+          func->proto = proto;
+
+          val_t *upvals = func->upvals;
+          const uint8_t *idx = cap->indices;
+          if (cap->upvals_consecutive) {
+              check_upval(verified, &S, idx[0] + cap->num_from_upvals - 1);
+              memcpy(upvals, &UPVAL(idx[0]),
+                     sizeof(val_t) * cap->num_from_upvals);
+          }
+          else {
+              for (size_t i = 0; i < cap->num_from_upvals; ++i)
+                  upvals[i] = UPVAL(idx[i]);
+          }
 
-          /* Actually construct the closure. */
-          ++S.ip;
-          arg_t which_func = VM_ARG0(*S.ip);
-          func->proto = S.func->proto->local_funcs[which_func];
-
-          /* We read the indices from which to populate the new closure's upvals
-           * from the instructions following the OP_CLOSE. */
-          size_t i = 1;
-          for (; i <= nupvals_upvals; ++i) {
-              upval_t idx = VM_ARGN(*(S.ip + i / sizeof(instr_t)),
-                                    i % sizeof(instr_t));
-              func->upvals[i] = S.func->upvals[idx];
+          upvals += cap->num_from_upvals;
+          idx += cap->num_from_upvals;
+          if (cap->regs_consecutive) {
+              check_regs(verified, &S, idx[0], cap->num_from_regs);
+              memcpy(upvals, &REG(idx[0]),
+                     sizeof(val_t) * cap->num_from_regs);
           }
-          for (; i <= nupvals; ++i) {
-              upval_t idx = VM_ARGN(*(S.ip + i / sizeof(instr_t)),
-                                    i % sizeof(instr_t));
-              func->upvals[i] = REG(idx);
+          else {
+              for (size_t i = 0; i < cap->num_from_regs; ++i)
+                  upvals[i] = REG(idx[i]);
           }
-          S.ip += INTDIV_CEIL(1 + nupvals, sizeof(instr_t));
+
+          /* Only now, since ARG1 may be among the registers we capture. */
+          REG(ARG1) = CONTENTS_VAL(func);
+          ++S.ip;
       }
         break;
 
       default:
+        if (!verified)
+            eris_bug("unrecognized or unimplemented opcode: %u", OP);
         IMPOSSIBLE("unrecognized or unimplemented opcode: %u", OP);
     }
 
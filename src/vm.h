@@ -2,6 +2,10 @@
 #ifndef _VM_H_
 #define _VM_H_
 
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
 #include "misc.h"
 #include "runtime.h"
 #include "types.h"
@@ -30,6 +34,21 @@
  */
 #define VM_SIGNED_LONGARG(instr) ((signed_longarg_t) VM_LONGARG(instr))
 
+/* CALL_CELL_N and CALL_REG_N split their third argument in two. */
+#define VM_IS_CALL_N(instr)                                             \
+    (VM_OP(instr) == OP_CALL_CELL_N || VM_OP(instr) == OP_CALL_REG_N)
+#define VM_CALL_N_NARGS(instr)     ((nargs_t) (VM_ARG3(instr) & 0x1f))
+#define VM_CALL_N_NRESULTS(instr)  ((nresults_t) (VM_ARG3(instr) >> 5))
+#define VM_CALL_N_ARG3(nargs, nresults) ((nargs) | ((nresults) << 5))
+
+/* Encoding single-chunk instructions; the inverse of the above. */
+#define VM_INSTR(op, a1, a2, a3)                                        \
+    ((instr_t) (op) | ((instr_t) (arg_t) (a1) << 8)                     \
+     | ((instr_t) (arg_t) (a2) << 16) | ((instr_t) (arg_t) (a3) << 24))
+#define VM_INSTR_LONG(op, a1, longarg)                                  \
+    ((instr_t) (op) | ((instr_t) (arg_t) (a1) << 8)                     \
+     | ((instr_t) (longarg_t) (longarg) << 16))
+
 /* Type checkers and converters.
  *
  * Some of these are uppercase even though they are functions. This is as a
@@ -41,15 +60,43 @@
  * - It makes compiler errors more helpful
  */
 #define SHAPE_TYPE(shape) shape##_t
-#define SHAPE_TAG(shape) (&eris_shape_##shape)
+#define SHAPE_ID(shape) ((eris_shape_id_t) SHAPE_ID_##shape)
 
 /* TODO: rename these so it's clearer what they do. */
 
+/* See "Value representation" in types.h. VAL_OBJ is only meaningful when
+ * VAL_IS_OBJ holds, which is always, unless we're NaN-boxing or nil is NULL. */
+#ifdef ERIS_NANBOX
+static inline
+uint64_t VAL_TAG(val_t v) { return v >> VAL_TAG_SHIFT; }
+
+static inline
+bool VAL_IS_OBJ(val_t v) { return VAL_TAG(v) == VAL_TAG_OBJ; }
+
+static inline
+val_t OBJ_VAL(obj_t *o)
+{
+    assert (!((uintptr_t) o & ~VAL_PAYLOAD_MASK));
+    return (val_t) o | VAL_TAG_OBJ << VAL_TAG_SHIFT;
+}
+
+static inline
+obj_t *VAL_OBJ(val_t v) { return (obj_t*) (v & VAL_PAYLOAD_MASK); }
+#else
+#ifdef ERIS_NIL_NULL
+static inline
+bool VAL_IS_OBJ(val_t v) { return v != eris_nil; }
+#else
+static inline
+bool VAL_IS_OBJ(val_t v) { return true; (void) v; }
+#endif
+
 static inline
 val_t OBJ_VAL(obj_t *o) { return (val_t) o; }
 
 static inline
 obj_t *VAL_OBJ(val_t v){ return (obj_t*) v; }
+#endif
 
 #define VAL_CONTENTS(shape, val) OBJ_CONTENTS(shape, VAL_OBJ(val))
 #define OBJ_CONTENTS(shape, obj) ((SHAPE_TYPE(shape)*)obj_contents(obj))
@@ -62,16 +109,70 @@ obj_t *CONTENTS_OBJ(void *ptr) { return ((obj_t*)(ptr)) - 1; }
 static inline
 val_t CONTENTS_VAL(void *ptr) { return OBJ_VAL(CONTENTS_OBJ(ptr)); }
 
+/* The length in an object's header; see obj_t. */
+static inline
+size_t CONTENTS_LEN(const void *ptr) { return ((const obj_t*) ptr - 1)->len; }
+
+static inline
+eris_shape_id_t OBJ_SHAPE_ID(obj_t *obj)
+{
+    return (eris_shape_id_t) (obj->header & HEADER_SHAPE_MASK);
+}
+
+static inline
+const shape_t *OBJ_SHAPE(obj_t *obj) { return &eris_shapes[OBJ_SHAPE_ID(obj)]; }
+
 static inline
 bool VAL_IS_NIL(val_t v) { return v == eris_nil; }
 
+#if !defined ERIS_NANBOX && !defined ERIS_NIL_NULL
 static inline
 bool OBJ_IS_NIL(obj_t *o) { return VAL_IS_NIL(OBJ_VAL(o)); }
+#endif
 
-#define VAL_ISA(shape, val) OBJ_ISA(shape, VAL_OBJ(val))
-#define OBJ_ISA(shape, obj) obj_isa(SHAPE_TAG(shape), obj)
+#define VAL_ISA(shape, val) val_isa(SHAPE_ID(shape), val)
+#define OBJ_ISA(shape, obj) obj_isa(SHAPE_ID(shape), obj)
 static inline
-bool obj_isa(shape_t *tag, obj_t *obj) { return obj->tag == tag; }
+bool obj_isa(eris_shape_id_t id, obj_t *obj) { return OBJ_SHAPE_ID(obj) == id; }
+
+/* Pinning, for the C API's borrowed views. Foreign objects never move anyway,
+ * and may live in memory we'd rather not write to, so we leave them be. Other
+ * threads may pin the same object, or the GC remember it, meanwhile; so we
+ * update headers atomically. */
+static inline
+bool obj_pinned(const obj_t *obj)
+{
+    return __atomic_load_n(&obj->header, __ATOMIC_RELAXED)
+        & (HEADER_PIN_MASK | HEADER_FOREIGN);
+}
+
+static inline
+void obj_pin(obj_t *obj)
+{
+    header_t h = __atomic_load_n(&obj->header, __ATOMIC_RELAXED);
+    while (!(h & HEADER_FOREIGN) && (h & HEADER_PIN_MASK) != HEADER_PIN_MASK
+           && !__atomic_compare_exchange_n(&obj->header, &h,
+                                           h + HEADER_PIN_ONE, true,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static inline
+void obj_unpin(obj_t *obj)
+{
+    header_t h = __atomic_load_n(&obj->header, __ATOMIC_RELAXED), pins;
+    assert ((h & HEADER_PIN_MASK) || h & HEADER_FOREIGN);
+    while ((pins = h & HEADER_PIN_MASK) && pins != HEADER_PIN_MASK
+           && !__atomic_compare_exchange_n(&obj->header, &h,
+                                           h - HEADER_PIN_ONE, true,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+static inline
+bool val_isa(eris_shape_id_t id, val_t v)
+{
+    return VAL_IS_OBJ(v) && obj_isa(id, VAL_OBJ(v));
+}
 
 /* WTB: macro-defining macros */
 #define MAKE_SHAPE_GETTER(shape)                                        \
@@ -82,6 +183,10 @@ bool obj_isa(shape_t *tag, obj_t *obj) { return obj->tag == tag; }
             return true;                                                \
         }                                                               \
         return false;                                                   \
+    }                                                                   \
+    static inline                                                       \
+    bool get_val_as_##shape(val_t _val, SHAPE_TYPE(shape) **_out) {     \
+        return VAL_IS_OBJ(_val) && get_obj_as_##shape(VAL_OBJ(_val), _out); \
     }
 
 MAKE_SHAPE_GETTER(num)
@@ -94,11 +199,12 @@ MAKE_SHAPE_GETTER(seq)
 MAKE_SHAPE_GETTER(vec)
 MAKE_SHAPE_GETTER(symbol)
 MAKE_SHAPE_GETTER(cell)
+MAKE_SHAPE_GETTER(fiber)
 
 #undef MAKE_SHAPE_GETTER
 
 #define OBJ_AS(shape, obj, out) get_obj_as_##shape((obj), (out))
-#define VAL_AS(shape, val, out) OBJ_AS(shape, VAL_OBJ(val), out)
+#define VAL_AS(shape, val, out) get_val_as_##shape((val), (out))
 
 
 /* This is to be used only in cases where we statically know that v is a "cell".
@@ -111,7 +217,7 @@ static inline cell_t *get_cell(val_t v)
 
 static inline val_t deref_cell(cell_t *g)
 {
-    if (UNLIKELY(!g->val)) {
+    if (UNLIKELY(g->val == VAL_UNDEFINED)) {
         /* Cell is undefined. */
         /* TODO: print out symbol name. */
         eris_bug("reference to undefined cell");
@@ -119,6 +225,104 @@ static inline val_t deref_cell(cell_t *g)
     return g->val;
 }
 
+/* Succeeds iff `v' is a fixnum. */
+static inline bool get_fixnum(val_t v, intptr_t *out)
+{
+#ifdef ERIS_NANBOX
+    if (LIKELY(VAL_TAG(v) == VAL_TAG_FIXNUM)) {
+        /* Sign-extend the payload. Like VM_SIGNED_LONGARG, this depends on
+         * 2's-complement. */
+        *out = (intptr_t) (v << (64 - VAL_TAG_SHIFT)) >> (64 - VAL_TAG_SHIFT);
+        return true;
+    }
+#endif
+    num_t *num;
+    if (LIKELY(VAL_AS(num, v, &num)) && LIKELY(num->tag == NUM_INTPTR)) {
+        *out = num->data.v_intptr;
+        return true;
+    }
+    return false;
+}
+
+/* Succeeds iff `v' is a flonum, ie. a double. */
+static inline bool get_flonum(val_t v, double *out)
+{
+#ifdef ERIS_NANBOX
+    if (LIKELY(VAL_TAG(v) < VAL_TAG_OBJ)) {
+        memcpy(out, &v, sizeof *out);
+        return true;
+    }
+    return false;
+#else
+    num_t *num;
+    if (LIKELY(VAL_AS(num, v, &num)) && LIKELY(num->tag == NUM_DOUBLE)) {
+        *out = num->data.v_double;
+        return true;
+    }
+    return false;
+#endif
+}
+
+/* Succeeds iff `v' is a fixnum or a flonum, which it converts to a double. */
+static inline bool get_real(val_t v, double *out)
+{
+    intptr_t i;
+    if (get_fixnum(v, &i)) {
+        *out = (double) i;
+        return true;
+    }
+    return get_flonum(v, out);
+}
+
+/* Succeeds iff `v' is a non-negative fixnum, eg. a valid sequence index. */
+static inline bool get_index(val_t v, size_t *out)
+{
+    intptr_t i;
+    if (LIKELY(get_fixnum(v, &i)) && LIKELY(i >= 0)) {
+        *out = (size_t) i;
+        return true;
+    }
+    return false;
+}
+
+/* Succeeds iff `v' is a fixnum that could be a file descriptor. */
+static inline bool get_fd(val_t v, int *out)
+{
+    intptr_t i;
+    if (LIKELY(get_fixnum(v, &i)) && LIKELY(i >= 0 && i <= INT_MAX)) {
+        *out = (int) i;
+        return true;
+    }
+    return false;
+}
+
+/* Fixnum arithmetic. These fail, leaving `*acc' alone, on overflow. */
+static inline bool fixnum_add(intptr_t *acc, intptr_t x)
+{
+    if (x > 0 ? *acc > INTPTR_MAX - x : *acc < INTPTR_MIN - x)
+        return false;
+    *acc += x;
+    return true;
+}
+
+static inline bool fixnum_sub(intptr_t *acc, intptr_t x)
+{
+    if (x > 0 ? *acc < INTPTR_MIN + x : *acc > INTPTR_MAX + x)
+        return false;
+    *acc -= x;
+    return true;
+}
+
+static inline bool fixnum_mul(intptr_t *acc, intptr_t x)
+{
+    intptr_t a = *acc;
+    if (a > 0 ? (x > 0 ? a > INTPTR_MAX / x : x < INTPTR_MIN / a)
+        : (x > 0 ? a < INTPTR_MIN / x : a && x < INTPTR_MAX / a))
+        return false;
+    *acc = a * x;
+    return true;
+}
+
 
 /* Memory allocators. */
 #define SHAPE_SIZE(shape) (sizeof(obj_t) + sizeof(SHAPE_TYPE(shape)))
@@ -147,26 +351,31 @@ static inline val_t deref_cell(cell_t *g)
  * #define MAKE_CLOSURE(nupvals) MAKE_WITH(closure, upvals, nupvals)
  * #define MAKE_SEQ(nelems) MAKE_WITH(seq, data, nelems) */
 
-/* Allocators for specific types. */
-#define MAKE_ALLOCATOR_(shape, size, ...)                               \
+/* Allocators for specific types. The NELEMS ones record the number of
+ * elements in the object's header, and fail if it doesn't fit. */
+#define MAKE_ALLOCATOR_(shape, size, length, ...)                       \
     static inline                                                       \
     bool new_##shape(SHAPE_TYPE(shape) **out, __VA_ARGS__               \
                      eris_thread_t *thread,                             \
                      frame_t *frame)                                    \
     {                                                                   \
         obj_t *obj;                                                     \
-        if (LIKELY(eris_new(&obj, thread, frame, SHAPE_TAG(shape), size))) { \
+        if (UNLIKELY((size_t) (length) > UINT32_MAX))                   \
+            return false;                                               \
+        if (LIKELY(eris_new(&obj, thread, frame, SHAPE_ID(shape), size))) { \
+            obj->len = (uint32_t) (length);                             \
             *out = OBJ_CONTENTS(shape, obj);                            \
             return true;                                                \
         }                                                               \
         return false;                                                   \
     }
 
-#define MAKE_ALLOCATOR(shape) MAKE_ALLOCATOR_(shape, SHAPE_SIZE(shape),)
+#define MAKE_ALLOCATOR(shape) MAKE_ALLOCATOR_(shape, SHAPE_SIZE(shape), 0,)
 #define MAKE_ALLOCATOR_NELEMS(shape, elem_mem) MAKE_ALLOCATOR_( \
         shape,                                                  \
         SHAPE_SIZE(shape) + nelems * membersize(                \
             SHAPE_TYPE(shape), elem_mem[0]),                    \
+        nelems,                                                 \
         size_t nelems,)
 
 MAKE_ALLOCATOR(num)
@@ -179,9 +388,52 @@ MAKE_ALLOCATOR_NELEMS(seq, data)
 MAKE_ALLOCATOR_NELEMS(vec, data)
 MAKE_ALLOCATOR_NELEMS(symbol, data)
 MAKE_ALLOCATOR(cell)
+MAKE_ALLOCATOR(fiber)
 
 #undef MAKE_ALLOCATOR_NELEMS
 #undef MAKE_ALLOCATOR
 #undef MAKE_ALLOCATOR_
 
+/* Number constructors. Like the allocators, these fail if they need memory and
+ * can't get it; but when NaN-boxing, they usually don't need any. */
+static inline
+bool make_fixnum(val_t *out, intptr_t i, eris_thread_t *thread, frame_t *frame)
+{
+#ifdef ERIS_NANBOX
+    intptr_t bound = (intptr_t) 1 << (VAL_TAG_SHIFT - 1);
+    if (LIKELY(i >= -bound && i < bound)) {
+        *out = VAL_TAG_FIXNUM << VAL_TAG_SHIFT | ((val_t) i & VAL_PAYLOAD_MASK);
+        return true;
+    }
+#endif
+    num_t *num;
+    if (!new_num(&num, thread, frame))
+        return false;
+    num->tag = NUM_INTPTR;
+    num->data.v_intptr = i;
+    *out = CONTENTS_VAL(num);
+    return true;
+}
+
+static inline
+bool make_flonum(val_t *out, double d, eris_thread_t *thread, frame_t *frame)
+{
+#ifdef ERIS_NANBOX
+    if (UNLIKELY(d != d))
+        *out = VAL_NAN;
+    else
+        memcpy(out, &d, sizeof *out);
+    return true;
+    (void) thread, (void) frame;
+#else
+    num_t *num;
+    if (!new_num(&num, thread, frame))
+        return false;
+    num->tag = NUM_DOUBLE;
+    num->data.v_double = d;
+    *out = CONTENTS_VAL(num);
+    return true;
+#endif
+}
+
 #endif